@@ -0,0 +1,110 @@
+#include "BackgroundSave.h"
+#include <cstdio>
+#include <sstream>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace {
+
+// same layout as Manager::saveText
+bool writeTextFile(const std::string& filename, uint64_t next_id, const VersionStore::ReadView& view,
+                   std::string& error, std::atomic<size_t>& progress) {
+    std::FILE* f = std::fopen(filename.c_str(), "wb");
+    if (!f) { error = "cannot open file"; return false; }
+    const size_t kFlushBytes = size_t(1) << 20;
+    const size_t kProgressStep = 32768;
+    std::string buf;
+    buf.reserve(kFlushBytes + 4096);
+    bool ok = true;
+    size_t unreported = 0;
+    auto line = [&](const auto& item) {
+        item.serializeTo(buf);
+        buf += '\n';
+        if (++unreported == kProgressStep) {
+            progress.fetch_add(unreported, std::memory_order_relaxed);
+            unreported = 0;
+        }
+        if (buf.size() >= kFlushBytes) {
+            ok = ok && std::fwrite(buf.data(), 1, buf.size(), f) == buf.size();
+            buf.clear();
+        }
+    };
+    buf += "NEXT_ID|" + std::to_string(next_id) + "\n#PIPES\n";
+    view.forEachPipe([&](const Pipe& p) { line(p); });
+    buf += "#STATIONS\n";
+    view.forEachStation([&](const CompressorStation& s) { line(s); });
+    progress.fetch_add(unreported, std::memory_order_relaxed);
+    ok = ok && std::fwrite(buf.data(), 1, buf.size(), f) == buf.size();
+#ifndef _WIN32
+    ok = ok && std::fflush(f) == 0 && fsync(fileno(f)) == 0;
+#endif
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok) error = "write failed";
+    return ok;
+}
+
+}
+
+std::string SaveStatus::toString() const {
+    static const char* kStates[] = { "idle", "running", "done", "failed" };
+    std::ostringstream oss;
+    oss << kStates[size_t(state)];
+    if (state == State::Idle) return oss.str();
+    oss << " " << filename << " version=" << version << " records=" << records_done << "/" << records_total
+        << " (" << int(fraction() * 100.0) << "%) " << seconds << "s";
+    if (!error.empty()) oss << " error: " << error;
+    return oss.str();
+}
+
+BackgroundSave::BackgroundSave(const VersionStore& versions, const std::string& filename_, SaveFormat format_,
+                               uint64_t next_id_, DoneCallback done_)
+    : view(std::make_unique<VersionStore::ReadView>(versions)), version(view->version()),
+      filename(filename_), format(format_), next_id(next_id_), done(std::move(done_)),
+      records_total(view->pipeCount() + view->stationCount()),
+      start(std::chrono::steady_clock::now()) {
+    worker = std::thread([this]{ run(); });
+}
+
+BackgroundSave::~BackgroundSave() {
+    if (worker.joinable()) worker.join();
+}
+
+SaveStatus BackgroundSave::status() const {
+    SaveStatus s;
+    s.state = state.load(std::memory_order_acquire);
+    s.filename = filename;
+    s.version = version;
+    s.records_done = records_done.load(std::memory_order_relaxed);
+    s.records_total = records_total;
+    if (s.state == SaveStatus::State::Running) {
+        s.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } else {
+        s.seconds = seconds.load(std::memory_order_relaxed);
+        s.error = error;
+    }
+    return s;
+}
+
+bool BackgroundSave::wait() {
+    if (worker.joinable()) worker.join();
+    return state.load(std::memory_order_acquire) == SaveStatus::State::Done;
+}
+
+void BackgroundSave::run() {
+    std::string tmp = filename + ".tmp";
+    std::string err;
+    bool ok = format == SaveFormat::Binary
+        ? writeSnapshot(tmp, next_id, *view, err, nullptr, &records_done)
+        : writeTextFile(tmp, next_id, *view, err, records_done);
+    view.reset();
+    if (ok && std::rename(tmp.c_str(), filename.c_str()) != 0) {
+        ok = false;
+        err = "cannot rename " + tmp;
+    }
+    if (!ok) std::remove(tmp.c_str());
+    error = err;
+    seconds.store(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+    state.store(ok ? SaveStatus::State::Done : SaveStatus::State::Failed, std::memory_order_release);
+    if (done) done(status());
+}
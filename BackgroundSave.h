@@ -0,0 +1,70 @@
+#ifndef BACKGROUNDSAVE_H
+#define BACKGROUNDSAVE_H
+
+#include "Snapshot.h"
+#include "VersionStore.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <cstdint>
+#include <cstddef>
+
+struct SaveStatus {
+    enum class State { Idle, Running, Done, Failed };
+    State state = State::Idle;
+    std::string filename;
+    uint64_t version = 0;      // published version being written
+    size_t records_done = 0;
+    size_t records_total = 0;
+    double seconds = 0.0;      // so far, or in total once finished
+    std::string error;
+
+    double fraction() const { return records_total ? double(records_done) / double(records_total) : 1.0; }
+    std::string toString() const;
+};
+
+// Writes one published version (see VersionStore) to a file on its own
+// thread. Versions are copy-on-write and the view is pinned when the save
+// starts, so the writer keeps editing and publishing meanwhile; only memory
+// of records replaced during the save is held until it ends. The data goes
+// to FILE.tmp, which is synced and then renamed over FILE, so readers of
+// FILE see either the old or the complete new contents.
+class BackgroundSave {
+public:
+    // called on the save thread once the file is in place (or the save failed)
+    using DoneCallback = std::function<void(const SaveStatus&)>;
+
+    // pins the latest published version of versions, then starts the thread
+    BackgroundSave(const VersionStore& versions, const std::string& filename, SaveFormat format,
+                   uint64_t next_id, DoneCallback done = nullptr);
+    ~BackgroundSave(); // waits for the save
+    BackgroundSave(const BackgroundSave&) = delete;
+    BackgroundSave& operator=(const BackgroundSave&) = delete;
+
+    bool finished() const { return state.load(std::memory_order_acquire) != SaveStatus::State::Running; }
+    SaveStatus status() const;
+    // block until the save ends; true if the file was written
+    bool wait();
+
+private:
+    std::unique_ptr<VersionStore::ReadView> view; // released as soon as the records are written
+    uint64_t version;
+    std::string filename;
+    SaveFormat format;
+    uint64_t next_id;
+    DoneCallback done;
+    std::atomic<SaveStatus::State> state{SaveStatus::State::Running};
+    std::atomic<size_t> records_done{0};
+    size_t records_total;
+    std::chrono::steady_clock::time_point start;
+    std::atomic<double> seconds{0.0};
+    std::string error; // written by the save thread before state leaves Running
+    std::thread worker;
+
+    void run();
+};
+
+#endif // BACKGROUNDSAVE_H
@@ -0,0 +1,90 @@
+#include "BulkUpdate.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+// === PipeUpdate
+PipeUpdate& PipeUpdate::setName(std::string_view n) { name_op = FieldOp::Set; name = intern(n); return *this; }
+PipeUpdate& PipeUpdate::setDiameter(double d) { diameter_op = FieldOp::Set; diameter = d; return *this; }
+PipeUpdate& PipeUpdate::scaleDiameter(double factor) { diameter_op = FieldOp::Scale; diameter = factor; return *this; }
+PipeUpdate& PipeUpdate::addDiameter(double delta) { diameter_op = FieldOp::Add; diameter = delta; return *this; }
+PipeUpdate& PipeUpdate::setInRepair(bool r) { repair_op = FieldOp::Set; in_repair = r; return *this; }
+PipeUpdate& PipeUpdate::toggleInRepair() { repair_op = FieldOp::Toggle; return *this; }
+
+bool PipeUpdate::empty() const {
+    return name_op == FieldOp::Keep && diameter_op == FieldOp::Keep && repair_op == FieldOp::Keep;
+}
+
+void PipeUpdate::apply(Pipe& p) const {
+    if (name_op == FieldOp::Set) p.setName(name);
+    switch (diameter_op) {
+        case FieldOp::Set: p.setDiameter(diameter); break;
+        case FieldOp::Scale: p.setDiameter(p.getDiameter() * diameter); break;
+        case FieldOp::Add: p.setDiameter(p.getDiameter() + diameter); break;
+        default: break;
+    }
+    if (repair_op == FieldOp::Set) p.setInRepair(in_repair);
+    else if (repair_op == FieldOp::Toggle) p.setInRepair(!p.isInRepair());
+}
+
+std::string PipeUpdate::toString() const {
+    std::ostringstream os;
+    if (name_op == FieldOp::Set) os << " name=\"" << name.view() << "\"";
+    if (diameter_op == FieldOp::Set) os << " diameter=" << diameter;
+    if (diameter_op == FieldOp::Scale) os << " diameter*=" << diameter;
+    if (diameter_op == FieldOp::Add) os << " diameter+=" << diameter;
+    if (repair_op == FieldOp::Set) os << " in_repair=" << (in_repair ? "1" : "0");
+    if (repair_op == FieldOp::Toggle) os << " in_repair=toggle";
+    std::string s = os.str();
+    return s.empty() ? "no change" : s.substr(1);
+}
+
+// === StationUpdate
+StationUpdate& StationUpdate::setName(std::string_view n) { name_op = FieldOp::Set; name = intern(n); return *this; }
+StationUpdate& StationUpdate::setClassification(std::string_view c) {
+    class_op = FieldOp::Set;
+    class_code = Dictionary::classifications().code(c);
+    return *this;
+}
+StationUpdate& StationUpdate::setTotalWorkshops(int t) { total_op = FieldOp::Set; total = t; return *this; }
+StationUpdate& StationUpdate::scaleTotalWorkshops(double factor) { total_op = FieldOp::Scale; total = factor; return *this; }
+StationUpdate& StationUpdate::addTotalWorkshops(int delta) { total_op = FieldOp::Add; total = delta; return *this; }
+StationUpdate& StationUpdate::setWorkingWorkshops(int w) { working_op = FieldOp::Set; working = w; return *this; }
+StationUpdate& StationUpdate::scaleWorkingWorkshops(double factor) { working_op = FieldOp::Scale; working = factor; return *this; }
+StationUpdate& StationUpdate::addWorkingWorkshops(int delta) { working_op = FieldOp::Add; working = delta; return *this; }
+
+bool StationUpdate::empty() const {
+    return name_op == FieldOp::Keep && class_op == FieldOp::Keep && !touchesWorkshops();
+}
+
+static int applyCount(FieldOp op, double arg, int v) {
+    switch (op) {
+        case FieldOp::Set: return static_cast<int>(arg);
+        case FieldOp::Scale: return static_cast<int>(std::max(0L, std::lround(v * arg)));
+        case FieldOp::Add: return std::max(0, v + static_cast<int>(arg));
+        default: return v;
+    }
+}
+
+void StationUpdate::apply(CompressorStation& s) const {
+    if (name_op == FieldOp::Set) s.setName(name);
+    if (class_op == FieldOp::Set) s.setClassCode(class_code);
+    s.setTotalWorkshops(applyCount(total_op, total, s.getTotalWorkshops()));
+    s.setWorkingWorkshops(applyCount(working_op, working, s.getWorkingWorkshops()));
+}
+
+static void describeCount(std::ostream& os, const char* field, FieldOp op, double arg) {
+    if (op == FieldOp::Set) os << " " << field << "=" << arg;
+    if (op == FieldOp::Scale) os << " " << field << "*=" << arg;
+    if (op == FieldOp::Add) os << " " << field << "+=" << arg;
+}
+
+std::string StationUpdate::toString() const {
+    std::ostringstream os;
+    if (name_op == FieldOp::Set) os << " name=\"" << name.view() << "\"";
+    if (class_op == FieldOp::Set) os << " class=\"" << Dictionary::classifications().text(class_code) << "\"";
+    describeCount(os, "total", total_op, total);
+    describeCount(os, "working", working_op, working);
+    std::string s = os.str();
+    return s.empty() ? "no change" : s.substr(1);
+}
@@ -0,0 +1,64 @@
+#ifndef BULKUPDATE_H
+#define BULKUPDATE_H
+
+#include "Pipe.h"
+#include "CompressorStation.h"
+#include <string>
+#include <cstdint>
+
+// Typed field updates for Manager::updatePipes / updateStations. A field is
+// left alone unless one of the builder calls below touches it:
+//   PipeUpdate().scaleDiameter(1.1).toggleInRepair()
+
+// Keep: no change, Set: assign value, Scale: multiply by value,
+// Add: add value, Toggle: flip a flag
+enum class FieldOp : uint8_t { Keep = 0, Set = 1, Scale = 2, Add = 3, Toggle = 4 };
+
+struct PipeUpdate {
+    FieldOp name_op = FieldOp::Keep;
+    InternedString name; // interned once, assigned to every pipe without a pool lookup
+    FieldOp diameter_op = FieldOp::Keep; // Set / Scale / Add
+    double diameter = 0.0;
+    FieldOp repair_op = FieldOp::Keep;   // Set / Toggle
+    bool in_repair = false;
+
+    PipeUpdate& setName(std::string_view n);
+    PipeUpdate& setDiameter(double d);
+    PipeUpdate& scaleDiameter(double factor);
+    PipeUpdate& addDiameter(double delta);
+    PipeUpdate& setInRepair(bool r);
+    PipeUpdate& toggleInRepair();
+
+    bool empty() const;
+    void apply(Pipe& p) const;
+    std::string toString() const;
+};
+
+// workshop counts stay integers: Scale rounds to nearest, Scale and Add clamp at 0
+struct StationUpdate {
+    FieldOp name_op = FieldOp::Keep;
+    InternedString name;
+    FieldOp class_op = FieldOp::Keep;
+    uint32_t class_code = 0; // Dictionary::classifications() code
+    FieldOp total_op = FieldOp::Keep;    // Set / Scale / Add
+    double total = 0.0;
+    FieldOp working_op = FieldOp::Keep;  // Set / Scale / Add
+    double working = 0.0;
+
+    StationUpdate& setName(std::string_view n);
+    StationUpdate& setClassification(std::string_view c);
+    StationUpdate& setTotalWorkshops(int t);
+    StationUpdate& scaleTotalWorkshops(double factor);
+    StationUpdate& addTotalWorkshops(int delta);
+    StationUpdate& setWorkingWorkshops(int w);
+    StationUpdate& scaleWorkingWorkshops(double factor);
+    StationUpdate& addWorkingWorkshops(int delta);
+
+    bool empty() const;
+    // true when percentIdle may change
+    bool touchesWorkshops() const { return total_op != FieldOp::Keep || working_op != FieldOp::Keep; }
+    void apply(CompressorStation& s) const;
+    std::string toString() const;
+};
+
+#endif // BULKUPDATE_H
@@ -0,0 +1,107 @@
+#include "CaseFold.h"
+#include <cstdint>
+
+namespace {
+
+inline bool continuation(unsigned char c) { return (c & 0xC0) == 0x80; }
+
+// simple case folding of a two-byte code point (U+0080..U+07FF)
+uint32_t foldTwoByte(uint32_t c) {
+    if (c < 0x100) {
+        if (c == 0xB5) return 0x3BC;                        // micro sign -> mu
+        if (c >= 0xC0 && c <= 0xDE && c != 0xD7) return c + 0x20;
+        return c;
+    }
+    if (c < 0x180) {
+        // Latin Extended-A: mostly upper / lower pairs; U+0130 only has a full folding
+        if (c == 0x178) return 0xFF;
+        if (c == 0x17F) return 's';
+        bool upper;
+        if (c <= 0x12F || (c >= 0x132 && c <= 0x137) || (c >= 0x14A && c <= 0x177)) upper = c % 2 == 0;
+        else upper = ((c >= 0x139 && c <= 0x148) || (c >= 0x179 && c <= 0x17E)) && c % 2 == 1;
+        return upper ? c + 1 : c;
+    }
+    if (c >= 0x386 && c <= 0x3AB) {
+        // Greek capitals with and without tonos
+        if (c == 0x386) return 0x3AC;
+        if (c >= 0x388 && c <= 0x38A) return c + 0x25;
+        if (c == 0x38C) return 0x3CC;
+        if (c == 0x38E || c == 0x38F) return c + 0x3F;
+        if (c >= 0x391 && c != 0x3A2) return c + 0x20;
+        return c;
+    }
+    if (c >= 0x370 && c < 0x400) {
+        // the rest of the Greek block: archaic letters, symbol forms and Coptic
+        if (c == 0x370 || c == 0x372 || c == 0x376) return c + 1;
+        if (c == 0x37F) return 0x3F3;                       // yot
+        if (c == 0x3C2) return 0x3C3;                       // final sigma
+        if (c == 0x3CF) return 0x3D7;                       // kai
+        if (c >= 0x3D8 && c <= 0x3EF) return c % 2 == 0 ? c + 1 : c;
+        switch (c) {
+        case 0x3D0: return 0x3B2;                           // beta symbol
+        case 0x3D1: case 0x3F4: return 0x3B8;               // theta symbols
+        case 0x3D5: return 0x3C6;                           // phi symbol
+        case 0x3D6: return 0x3C0;                           // pi symbol
+        case 0x3F0: return 0x3BA;                           // kappa symbol
+        case 0x3F1: return 0x3C1;                           // rho symbol
+        case 0x3F5: return 0x3B5;                           // lunate epsilon symbol
+        case 0x3F7: case 0x3FA: return c + 1;               // sho, san
+        case 0x3F9: return 0x3F2;                           // lunate sigma
+        case 0x3FD: case 0x3FE: case 0x3FF: return c - 0x82; // reversed / dotted lunate sigmas
+        }
+        return c;
+    }
+    if (c >= 0x400 && c < 0x530) {
+        if (c < 0x410) return c + 0x50;                     // Ѐ..Џ
+        if (c < 0x430) return c + 0x20;                     // А..Я
+        if (c == 0x4C0) return 0x4CF;                       // palochka
+        if ((c >= 0x460 && c <= 0x481) || (c >= 0x48A && c <= 0x4BF) || c >= 0x4D0) return c % 2 == 0 ? c + 1 : c;
+        if (c >= 0x4C1 && c <= 0x4CE) return c % 2 == 1 ? c + 1 : c;
+    }
+    return c;
+}
+
+}
+
+bool foldCase(std::string_view text, std::string& out) {
+    const unsigned char* s = reinterpret_cast<const unsigned char*>(text.data());
+    size_t n = text.size(), i = 0;
+    bool ok = true;
+    out.reserve(out.size() + n);
+    while (i < n) {
+        unsigned char c = s[i];
+        if (c < 0x80) {
+            out += char(c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+            ++i;
+        } else if (c >= 0xC2 && c <= 0xDF && i + 1 < n && continuation(s[i + 1])) {
+            uint32_t f = foldTwoByte((uint32_t(c & 0x1F) << 6) | (s[i + 1] & 0x3F));
+            if (f < 0x80) {
+                out += char(f);
+            } else {
+                out += char(0xC0 | (f >> 6));
+                out += char(0x80 | (f & 0x3F));
+            }
+            i += 2;
+        } else {
+            // three and four byte sequences have nothing to fold here
+            size_t len = c >= 0xE0 && c <= 0xEF ? 3 : c >= 0xF0 && c <= 0xF4 ? 4 : 0;
+            bool whole = len && i + len <= n;
+            for (size_t k = 1; whole && k < len; ++k) whole = continuation(s[i + k]);
+            if (!whole) {
+                ok = false;
+                len = 1;
+            }
+            out.append(text.data() + i, len);
+            i += len;
+        }
+    }
+    return ok;
+}
+
+InternedString foldedName(InternedString name) {
+    thread_local std::string buf;
+    buf.clear();
+    foldCase(name.view(), buf);
+    if (buf == name.view()) return name;
+    return intern(buf);
+}
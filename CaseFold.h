@@ -0,0 +1,25 @@
+#ifndef CASEFOLD_H
+#define CASEFOLD_H
+
+#include "StringPool.h"
+#include <string>
+#include <string_view>
+
+// How name searches compare text.
+//   Exact       byte for byte, as stored
+//   IgnoreCase  after UTF-8 simple case folding ("КС-Север" finds "кс-север")
+enum class NameMatch { Exact, IgnoreCase };
+
+// Appends text with every letter of the Latin (ASCII, Latin-1, Latin
+// Extended-A), Greek and Coptic (U+0370..U+03FF) and Cyrillic blocks folded to lower case, following the
+// simple mappings of Unicode CaseFolding.txt; everything else is copied as it
+// is. Returns false when text is not well-formed UTF-8 (the stray bytes are
+// still copied), in which case a byte-level match on the original may have no
+// folded counterpart.
+bool foldCase(std::string_view text, std::string& out);
+
+// The folded form of an interned name, interned as well so it stays valid for
+// good; a name that folding leaves unchanged is returned as is.
+InternedString foldedName(InternedString name);
+
+#endif // CASEFOLD_H
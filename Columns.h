@@ -0,0 +1,139 @@
+#ifndef COLUMNS_H
+#define COLUMNS_H
+
+#include "Pipe.h"
+#include "CompressorStation.h"
+#include "SlotBitmap.h"
+#include "CaseFold.h"
+#include <vector>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+// Structure-of-arrays mirror of the slot maps, indexed by slot number.
+// Columns are padded to whole 64-slot words so filter kernels can run over
+// full words and mask dead slots with the live bitmap.
+//
+// Next to each name the columns keep its case-folded shadow (foldedName), for
+// case-insensitive search; it is refolded only when the name itself changes.
+// Both are handles, so a folded name lives as long as its column entry.
+struct PipeColumns {
+    std::vector<double> diameter;
+    std::vector<InternedString> name;
+    std::vector<InternedString> folded; // foldedName(name)
+    SlotBitmap live;
+    SlotBitmap repair;
+
+    void set(uint32_t slot, const Pipe& p) {
+        if (slot >= diameter.size()) {
+            size_t n = (size_t(slot) / 64 + 1) * 64;
+            diameter.resize(n, 0.0);
+            if (name.size() < n) {
+                name.resize(n);
+                folded.resize(n);
+            }
+        }
+        diameter[slot] = p.getDiameter();
+        setName(slot, p.getInternedName());
+        live.set(slot, true);
+        repair.set(slot, p.isInRepair());
+    }
+
+    // the names stay for a set() of the same entity, which then skips refolding
+    void unset(uint32_t slot) {
+        live.set(slot, false);
+        repair.set(slot, false);
+    }
+
+    // after unset(), when the entity is gone: lets go of its names
+    void forget(uint32_t slot) {
+        name[slot] = InternedString();
+        folded[slot] = InternedString();
+    }
+
+    // slot must already be covered by the columns
+    void setName(uint32_t slot, const InternedString& n) {
+        if (name[slot] != n) folded[slot] = foldedName(n);
+        name[slot] = n;
+    }
+
+    size_t memoryBytes() const {
+        return diameter.capacity() * sizeof(double) + (name.capacity() + folded.capacity()) * sizeof(InternedString) + live.memoryBytes() + repair.memoryBytes();
+    }
+
+    // Names stay: a rebuild over the same entities finds them unchanged and
+    // refolds nothing (and keeps the pool from dropping and re-interning
+    // them across a reload); forgetDead() lets go of the rest afterwards.
+    void clear() {
+        diameter.clear();
+        live.clear();
+        repair.clear();
+    }
+
+    void forgetDead() {
+        for (uint32_t slot = 0; slot < name.size(); ++slot) {
+            if (!live.test(slot)) forget(slot);
+        }
+    }
+};
+
+struct StationColumns {
+    std::vector<int32_t> total;
+    std::vector<int32_t> working;
+    std::vector<InternedString> name;
+    std::vector<InternedString> folded;
+    std::vector<uint32_t> class_code; // Dictionary::classifications() codes
+    SlotBitmap live;
+
+    void set(uint32_t slot, const CompressorStation& s) {
+        if (slot >= total.size()) {
+            size_t n = (size_t(slot) / 64 + 1) * 64;
+            total.resize(n, 0);
+            working.resize(n, 0);
+            if (name.size() < n) {
+                name.resize(n);
+                folded.resize(n);
+            }
+            class_code.resize(n, 0);
+        }
+        total[slot] = s.getTotalWorkshops();
+        working[slot] = s.getWorkingWorkshops();
+        setName(slot, s.getInternedName());
+        class_code[slot] = s.getClassCode();
+        live.set(slot, true);
+    }
+
+    void unset(uint32_t slot) {
+        live.set(slot, false);
+    }
+
+    void forget(uint32_t slot) {
+        name[slot] = InternedString();
+        folded[slot] = InternedString();
+    }
+
+    void setName(uint32_t slot, const InternedString& n) {
+        if (name[slot] != n) folded[slot] = foldedName(n);
+        name[slot] = n;
+    }
+
+    size_t memoryBytes() const {
+        return (total.capacity() + working.capacity()) * sizeof(int32_t) + (name.capacity() + folded.capacity()) * sizeof(InternedString)
+             + class_code.capacity() * sizeof(uint32_t) + live.memoryBytes();
+    }
+
+    void clear() {
+        total.clear();
+        working.clear();
+        class_code.clear();
+        live.clear();
+    }
+
+    void forgetDead() {
+        for (uint32_t slot = 0; slot < name.size(); ++slot) {
+            if (!live.test(slot)) forget(slot);
+        }
+    }
+};
+
+#endif // COLUMNS_H
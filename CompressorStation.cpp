@@ -1,24 +1,28 @@
 #include "CompressorStation.h"
-#include <sstream>
-#include <vector>
+#include <charconv>
 #include <stdexcept>
 
 CompressorStation::CompressorStation()
-    : id(0), name(""), total_workshops(0), working_workshops(0), classification("") {}
+    : id(0), total_workshops(0), working_workshops(0), class_code(0) {}
 
-CompressorStation::CompressorStation(uint64_t id_, const std::string& name_, int total_, int working_, const std::string& classification_)
-    : id(id_), name(name_), total_workshops(total_), working_workshops(working_), classification(classification_) {}
+CompressorStation::CompressorStation(uint64_t id_, std::string_view name_, int total_, int working_, std::string_view classification_)
+    : id(id_), name(intern(name_)), total_workshops(total_), working_workshops(working_),
+      class_code(Dictionary::classifications().code(classification_)) {}
 
 uint64_t CompressorStation::getId() const { return id; }
-std::string CompressorStation::getName() const { return name; }
+std::string_view CompressorStation::getName() const { return name.view(); }
+InternedString CompressorStation::getInternedName() const { return name; }
 int CompressorStation::getTotalWorkshops() const { return total_workshops; }
 int CompressorStation::getWorkingWorkshops() const { return working_workshops; }
-std::string CompressorStation::getClassification() const { return classification; }
+std::string_view CompressorStation::getClassification() const { return Dictionary::classifications().text(class_code); }
+uint32_t CompressorStation::getClassCode() const { return class_code; }
 
-void CompressorStation::setName(const std::string& n) { name = n; }
+void CompressorStation::setName(std::string_view n) { name = intern(n); }
+void CompressorStation::setName(InternedString n) { name = n; }
 void CompressorStation::setTotalWorkshops(int t) { total_workshops = t; }
 void CompressorStation::setWorkingWorkshops(int w) { working_workshops = w; }
-void CompressorStation::setClassification(const std::string& c) { classification = c; }
+void CompressorStation::setClassification(std::string_view c) { class_code = Dictionary::classifications().code(c); }
+void CompressorStation::setClassCode(uint32_t code) { class_code = code; }
 
 double CompressorStation::percentIdle() const {
     if (total_workshops <= 0) return 0.0;
@@ -27,25 +31,40 @@ double CompressorStation::percentIdle() const {
 }
 
 std::string CompressorStation::serialize() const {
-    std::ostringstream os;
+    std::string out;
+    serializeTo(out);
+    return out;
+}
+
+void CompressorStation::serializeTo(std::string& out) const {
     // id|name|total|working|classification
-    os << id << '|' << name << '|' << total_workshops << '|' << working_workshops << '|' << classification;
-    return os.str();
+    char buf[24];
+    out.append(buf, std::to_chars(buf, buf + sizeof(buf), id).ptr);
+    out += '|';
+    out.append(name.view());
+    out += '|';
+    out.append(buf, std::to_chars(buf, buf + sizeof(buf), total_workshops).ptr);
+    out += '|';
+    out.append(buf, std::to_chars(buf, buf + sizeof(buf), working_workshops).ptr);
+    out += '|';
+    out.append(getClassification());
 }
 
 CompressorStation CompressorStation::deserialize(const std::string& line) {
-    std::vector<std::string> parts;
-    std::string cur;
-    for (char c : line) {
-        if (c == '|') { parts.push_back(cur); cur.clear(); }
-        else cur.push_back(c);
-    }
-    parts.push_back(cur);
-    if (parts.size() != 5) throw std::runtime_error("CompressorStation::deserialize: wrong format");
-    uint64_t id = std::stoull(parts[0]);
-    std::string name = parts[1];
-    int total = std::stoi(parts[2]);
-    int working = std::stoi(parts[3]);
-    std::string classification = parts[4];
-    return CompressorStation(id, name, total, working, classification);
+    CompressorStation s;
+    ParseStatus st = parse(line, s);
+    if (st != ParseStatus::Ok) throw std::runtime_error(std::string("CompressorStation::deserialize: ") + parseStatusText(st));
+    return s;
+}
+
+ParseStatus CompressorStation::parse(std::string_view line, CompressorStation& out) {
+    // id|name|total|working|classification
+    std::string_view f[5];
+    if (splitFields(line, f, 5) != 5) return ParseStatus::WrongFormat;
+    if (!parseField(f[0], out.id)) return ParseStatus::BadId;
+    if (!parseField(f[2], out.total_workshops)) return ParseStatus::BadNumber;
+    if (!parseField(f[3], out.working_workshops)) return ParseStatus::BadNumber;
+    out.name = intern(f[1]);
+    out.class_code = Dictionary::classifications().code(f[4]);
+    return ParseStatus::Ok;
 }
\ No newline at end of file
@@ -2,34 +2,44 @@
 #define COMPRESSORSTATION_H
 
 #include <string>
+#include <string_view>
 #include <cstdint>
+#include "TextFields.h"
+#include "StringPool.h"
 
 class CompressorStation {
 private:
     uint64_t id;
-    std::string name;
+    InternedString name;
     int total_workshops;      // общее количество цехов
     int working_workshops;    // число задействованных (работающих)
-    std::string classification;
+    uint32_t class_code;      // Dictionary::classifications() code
 
 public:
     CompressorStation();
-    CompressorStation(uint64_t id_, const std::string& name_, int total_, int working_, const std::string& classification_);
+    CompressorStation(uint64_t id_, std::string_view name_, int total_, int working_, std::string_view classification_);
 
     uint64_t getId() const;
-    std::string getName() const;
+    std::string_view getName() const;
+    InternedString getInternedName() const;
     int getTotalWorkshops() const;
     int getWorkingWorkshops() const;
-    std::string getClassification() const;
+    std::string_view getClassification() const;
+    uint32_t getClassCode() const;
 
-    void setName(const std::string& n);
+    void setName(std::string_view n);
+    void setName(InternedString n);
     void setTotalWorkshops(int t);
     void setWorkingWorkshops(int w);
-    void setClassification(const std::string& c);
+    void setClassification(std::string_view c);
+    void setClassCode(uint32_t code);
 
     double percentIdle() const; // процент незадействованных цехов
     std::string serialize() const;
+    void serializeTo(std::string& out) const; // the same line appended to out
     static CompressorStation deserialize(const std::string& line);
+    // non-throwing parser
+    static ParseStatus parse(std::string_view line, CompressorStation& out);
 };
 
 #endif // COMPRESSORSTATION_H
\ No newline at end of file
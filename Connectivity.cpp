@@ -0,0 +1,532 @@
+#include "Connectivity.h"
+#include <algorithm>
+#include <numeric>
+
+// === splay trees
+uint32_t Connectivity::newNode(uint32_t id, bool is_vertex, uint8_t flags) {
+    uint32_t x;
+    if (!free_nodes.empty()) {
+        x = free_nodes.back();
+        free_nodes.pop_back();
+        nodes[x] = Node();
+    } else {
+        x = uint32_t(nodes.size());
+        nodes.emplace_back();
+    }
+    Node& n = nodes[x];
+    n.id = id;
+    n.is_vertex = is_vertex;
+    n.own = n.agg = flags;
+    n.vertices = is_vertex ? 1 : 0;
+    return x;
+}
+
+void Connectivity::freeNode(uint32_t x) {
+    free_nodes.push_back(x);
+}
+
+void Connectivity::update(uint32_t x) const {
+    Node& n = nodes[x];
+    n.count = 1;
+    n.vertices = n.is_vertex ? 1 : 0;
+    n.agg = n.own;
+    if (n.left != kNil) {
+        const Node& l = nodes[n.left];
+        n.count += l.count;
+        n.vertices += l.vertices;
+        n.agg |= l.agg;
+    }
+    if (n.right != kNil) {
+        const Node& r = nodes[n.right];
+        n.count += r.count;
+        n.vertices += r.vertices;
+        n.agg |= r.agg;
+    }
+}
+
+void Connectivity::rotate(uint32_t x) const {
+    uint32_t p = nodes[x].parent;
+    uint32_t g = nodes[p].parent;
+    uint32_t b;
+    if (nodes[p].left == x) {
+        b = nodes[x].right;
+        nodes[p].left = b;
+        nodes[x].right = p;
+    } else {
+        b = nodes[x].left;
+        nodes[p].right = b;
+        nodes[x].left = p;
+    }
+    if (b != kNil) nodes[b].parent = p;
+    nodes[p].parent = x;
+    nodes[x].parent = g;
+    if (g != kNil) {
+        if (nodes[g].left == p) nodes[g].left = x;
+        else nodes[g].right = x;
+    }
+    update(p);
+    update(x);
+}
+
+void Connectivity::splay(uint32_t x) const {
+    while (nodes[x].parent != kNil) {
+        uint32_t p = nodes[x].parent;
+        uint32_t g = nodes[p].parent;
+        if (g != kNil) rotate((nodes[g].left == p) == (nodes[p].left == x) ? p : x);
+        rotate(x);
+    }
+}
+
+// a and b are roots; the sequence of a is followed by the sequence of b
+uint32_t Connectivity::join(uint32_t a, uint32_t b) const {
+    if (a == kNil) return b;
+    if (b == kNil) return a;
+    uint32_t x = a;
+    while (nodes[x].right != kNil) x = nodes[x].right;
+    splay(x);
+    nodes[x].right = b;
+    nodes[b].parent = x;
+    update(x);
+    return x;
+}
+
+uint32_t Connectivity::splitBefore(uint32_t x) const {
+    splay(x);
+    uint32_t l = nodes[x].left;
+    if (l != kNil) {
+        nodes[l].parent = kNil;
+        nodes[x].left = kNil;
+        update(x);
+    }
+    return l;
+}
+
+uint32_t Connectivity::splitAfter(uint32_t x) const {
+    splay(x);
+    uint32_t r = nodes[x].right;
+    if (r != kNil) {
+        nodes[r].parent = kNil;
+        nodes[x].right = kNil;
+        update(x);
+    }
+    return r;
+}
+
+// rotate the tour so that it starts at x; returns the new root
+uint32_t Connectivity::reroot(uint32_t x) const {
+    uint32_t l = splitBefore(x);
+    return join(x, l);
+}
+
+uint32_t Connectivity::position(uint32_t x) const {
+    splay(x);
+    return nodes[x].left == kNil ? 0 : nodes[nodes[x].left].count;
+}
+
+// any node of root's tree with flag set, splayed to the root; kNil if none
+uint32_t Connectivity::findFlag(uint32_t root, uint8_t flag) const {
+    if (root == kNil || !(nodes[root].agg & flag)) return kNil;
+    uint32_t x = root;
+    while (!(nodes[x].own & flag)) {
+        uint32_t l = nodes[x].left;
+        x = (l != kNil && (nodes[l].agg & flag)) ? l : nodes[x].right;
+    }
+    splay(x);
+    return x;
+}
+
+void Connectivity::setFlag(uint32_t x, uint8_t flag, bool on) {
+    splay(x);
+    if (on) nodes[x].own |= flag;
+    else nodes[x].own &= uint8_t(~flag);
+    update(x);
+}
+
+uint32_t Connectivity::buildRange(const std::vector<uint32_t>& seq, size_t lo, size_t hi) {
+    if (lo >= hi) return kNil;
+    size_t mid = lo + (hi - lo) / 2;
+    uint32_t x = seq[mid];
+    uint32_t l = buildRange(seq, lo, mid);
+    uint32_t r = buildRange(seq, mid + 1, hi);
+    nodes[x].left = l;
+    nodes[x].right = r;
+    if (l != kNil) nodes[l].parent = x;
+    if (r != kNil) nodes[r].parent = x;
+    update(x);
+    return x;
+}
+
+// === forests
+uint32_t Connectivity::vertexNode(uint32_t level, uint32_t v) {
+    if (vertex_node.size() <= level) vertex_node.resize(size_t(level) + 1);
+    std::vector<uint32_t>& row = vertex_node[level];
+    if (row.size() <= v) row.resize(size_t(v) + 1, kNil);
+    if (row[v] == kNil) {
+        uint32_t x = newNode(v, true, 0);
+        vertex_node[level][v] = x;
+    }
+    return vertex_node[level][v];
+}
+
+// kNil: v has no node on this level, so it is alone in its tree there
+uint32_t Connectivity::vertexNodeIfAny(uint32_t level, uint32_t v) const {
+    if (level >= vertex_node.size() || v >= vertex_node[level].size()) return kNil;
+    return vertex_node[level][v];
+}
+
+bool Connectivity::connectedAt(uint32_t level, uint32_t u, uint32_t v) const {
+    if (u == v) return true;
+    uint32_t a = vertexNodeIfAny(level, u), b = vertexNodeIfAny(level, v);
+    if (a == kNil || b == kNil) return false;
+    splay(a);
+    splay(b);
+    // a lost its place as root only if b is in the same tree
+    return nodes[a].parent != kNil;
+}
+
+uint32_t Connectivity::sizeAt(uint32_t level, uint32_t v) const {
+    uint32_t a = vertexNodeIfAny(level, v);
+    if (a == kNil) return 1;
+    splay(a);
+    return nodes[a].vertices;
+}
+
+// joins the tours of e's endpoints in forest `level`: tour(u) (u->v) tour(v) (v->u)
+void Connectivity::link(uint32_t level, uint32_t e) {
+    uint32_t uu = vertexNode(level, edges[e].u);
+    uint32_t vv = vertexNode(level, edges[e].v);
+    uint32_t ru = reroot(uu);
+    uint32_t rv = reroot(vv);
+    uint32_t a = newNode(e, false, edges[e].level == level ? kTreeFlag : 0);
+    uint32_t b = newNode(e, false, 0);
+    join(join(join(ru, a), rv), b);
+    std::vector<uint32_t>& tour = edges[e].tour;
+    if (tour.size() < 2 * (size_t(level) + 1)) tour.resize(2 * (size_t(level) + 1), kNil);
+    tour[2 * level] = a;
+    tour[2 * level + 1] = b;
+}
+
+// X a Y b Z -> X Z and Y
+void Connectivity::cut(uint32_t level, uint32_t e) {
+    uint32_t a = edges[e].tour[2 * level];
+    uint32_t b = edges[e].tour[2 * level + 1];
+    if (position(a) > position(b)) std::swap(a, b);
+    uint32_t x = splitBefore(a);
+    splitAfter(a);
+    splitBefore(b);
+    uint32_t z = splitAfter(b);
+    join(x, z);
+    freeNode(a);
+    freeNode(b);
+}
+
+void Connectivity::addNonTree(uint32_t e) {
+    Edge& E = edges[e];
+    uint32_t level = E.level;
+    for (int side = 0; side < 2; ++side) {
+        uint32_t w = side ? E.v : E.u;
+        std::vector<std::vector<uint32_t>>& lists = verts[w].nontree;
+        if (lists.size() <= level) lists.resize(size_t(level) + 1);
+        (side ? E.pos_v : E.pos_u) = uint32_t(lists[level].size());
+        lists[level].push_back(e);
+        if (lists[level].size() == 1) setFlag(vertexNode(level, w), kNonTreeFlag, true);
+    }
+}
+
+void Connectivity::listRemove(uint32_t w, uint32_t e) {
+    const Edge& E = edges[e];
+    std::vector<uint32_t>& list = verts[w].nontree[E.level];
+    uint32_t pos = E.u == w ? E.pos_u : E.pos_v;
+    uint32_t last = list.back();
+    list[pos] = last;
+    list.pop_back();
+    if (last != e) {
+        Edge& L = edges[last];
+        if (L.u == w) L.pos_u = pos;
+        else L.pos_v = pos;
+    }
+    if (list.empty()) setFlag(vertexNode(E.level, w), kNonTreeFlag, false);
+}
+
+void Connectivity::removeNonTree(uint32_t e) {
+    listRemove(edges[e].u, e);
+    listRemove(edges[e].v, e);
+}
+
+// After tree edge (u, v) of level >= `level` was cut: look for a replacement
+// among the level-`level` non-tree edges of the smaller side, raising the
+// level of everything examined that is not one.
+bool Connectivity::reconnect(uint32_t level, uint32_t u, uint32_t v) {
+    uint32_t x = sizeAt(level, u) <= sizeAt(level, v) ? u : v;
+    // the smaller side's tree edges move up so they are not searched again
+    if (uint32_t xn = vertexNodeIfAny(level, x); xn != kNil) {
+        while (true) {
+            splay(xn);
+            uint32_t f = findFlag(xn, kTreeFlag);
+            if (f == kNil) break;
+            uint32_t id = nodes[f].id;
+            setFlag(f, kTreeFlag, false);
+            edges[id].level = level + 1;
+            link(level + 1, id);
+        }
+    }
+    while (true) {
+        uint32_t xn = vertexNodeIfAny(level, x);
+        if (xn == kNil) return false;
+        splay(xn);
+        uint32_t w = findFlag(xn, kNonTreeFlag);
+        if (w == kNil) return false;
+        uint32_t a = nodes[w].id;
+        while (level < verts[a].nontree.size() && !verts[a].nontree[level].empty()) {
+            uint32_t f = verts[a].nontree[level].back();
+            uint32_t other = edges[f].u == a ? edges[f].v : edges[f].u;
+            removeNonTree(f);
+            if (!connectedAt(level, x, other)) {
+                // other is on the far side: f becomes a tree edge of this level
+                edges[f].tree = true;
+                for (uint32_t i = 0; i <= level; ++i) link(i, f);
+                ++tree_edges;
+                return true;
+            }
+            edges[f].level = level + 1;
+            addNonTree(f);
+        }
+    }
+}
+
+// === public
+void Connectivity::growVertices(uint32_t v) {
+    if (verts.size() <= v) verts.resize(size_t(v) + 1);
+}
+
+void Connectivity::setDegree(uint32_t v, uint32_t degree) {
+    Vertex& x = verts[v];
+    x.degree = degree;
+    bool isolated = x.present && degree == 0;
+    if (isolated && x.isolated_pos == kNil) {
+        x.isolated_pos = uint32_t(isolated_list.size());
+        isolated_list.push_back(v);
+    } else if (!isolated && x.isolated_pos != kNil) {
+        uint32_t last = isolated_list.back();
+        isolated_list[x.isolated_pos] = last;
+        verts[last].isolated_pos = x.isolated_pos;
+        isolated_list.pop_back();
+        x.isolated_pos = kNil;
+    }
+}
+
+void Connectivity::addVertex(uint32_t v) {
+    growVertices(v);
+    if (verts[v].present) return;
+    verts[v].present = true;
+    ++present_count;
+    setDegree(v, verts[v].degree);
+}
+
+void Connectivity::removeVertex(uint32_t v) {
+    if (v >= verts.size() || !verts[v].present) return;
+    verts[v].present = false;
+    --present_count;
+    setDegree(v, verts[v].degree);
+    // a vertex without edges is a single node on every level it reached
+    for (auto& row : vertex_node) {
+        if (v < row.size() && row[v] != kNil) {
+            freeNode(row[v]);
+            row[v] = kNil;
+        }
+    }
+    verts[v].nontree.clear();
+}
+
+void Connectivity::insert(uint32_t e, uint32_t u, uint32_t v) {
+    if (e >= edges.size()) edges.resize(size_t(e) + 1);
+    growVertices(std::max(u, v));
+    Edge& E = edges[e];
+    E = Edge();
+    E.u = u;
+    E.v = v;
+    E.present = true;
+    ++edge_count;
+    if (u == v) return;
+    setDegree(u, verts[u].degree + 1);
+    setDegree(v, verts[v].degree + 1);
+    if (!connectedAt(0, u, v)) {
+        E.tree = true;
+        link(0, e);
+        ++tree_edges;
+    } else {
+        addNonTree(e);
+    }
+}
+
+void Connectivity::erase(uint32_t e) {
+    if (!contains(e)) return;
+    Edge& E = edges[e];
+    E.present = false;
+    --edge_count;
+    uint32_t u = E.u, v = E.v;
+    if (u == v) return;
+    setDegree(u, verts[u].degree - 1);
+    setDegree(v, verts[v].degree - 1);
+    if (!E.tree) {
+        removeNonTree(e);
+        return;
+    }
+    uint32_t level = E.level;
+    for (uint32_t i = 0; i <= level; ++i) cut(i, e);
+    E.tour.clear();
+    E.tree = false;
+    --tree_edges;
+    for (uint32_t i = level + 1; i-- > 0;) {
+        if (reconnect(i, u, v)) return;
+    }
+}
+
+bool Connectivity::connected(uint32_t u, uint32_t v) const {
+    return connectedAt(0, u, v);
+}
+
+size_t Connectivity::componentSize(uint32_t v) const {
+    return sizeAt(0, v);
+}
+
+void Connectivity::component(uint32_t v, std::vector<uint32_t>& out) const {
+    out.clear();
+    uint32_t root = vertexNodeIfAny(0, v);
+    if (root == kNil) {
+        out.push_back(v);
+        return;
+    }
+    splay(root);
+    std::vector<uint32_t> stack(1, root);
+    while (!stack.empty()) {
+        uint32_t x = stack.back();
+        stack.pop_back();
+        if (nodes[x].is_vertex) out.push_back(nodes[x].id);
+        if (nodes[x].left != kNil) stack.push_back(nodes[x].left);
+        if (nodes[x].right != kNil) stack.push_back(nodes[x].right);
+    }
+}
+
+void Connectivity::build(const std::vector<uint32_t>& vertices, const std::vector<EdgeSpec>& edgeList) {
+    clear();
+    for (uint32_t v : vertices) addVertex(v);
+    for (const EdgeSpec& s : edgeList) growVertices(std::max(s.u, s.v));
+    uint32_t n = uint32_t(verts.size());
+
+    // spanning forest by union-find (path halving, union by size)
+    std::vector<uint32_t> parent(n), size(n, 1);
+    std::iota(parent.begin(), parent.end(), 0u);
+    auto find = [&](uint32_t x) {
+        while (parent[x] != x) x = parent[x] = parent[parent[x]];
+        return x;
+    };
+    std::vector<uint32_t> tree;
+    for (const EdgeSpec& s : edgeList) {
+        if (s.e >= edges.size()) edges.resize(size_t(s.e) + 1);
+        Edge& E = edges[s.e];
+        E.u = s.u;
+        E.v = s.v;
+        E.present = true;
+        ++edge_count;
+        if (s.u == s.v) continue;
+        setDegree(s.u, verts[s.u].degree + 1);
+        setDegree(s.v, verts[s.v].degree + 1);
+        uint32_t a = find(s.u), b = find(s.v);
+        if (a == b) continue;
+        if (size[a] < size[b]) std::swap(a, b);
+        parent[b] = a;
+        size[a] += size[b];
+        E.tree = true;
+        tree.push_back(s.e);
+        ++tree_edges;
+    }
+
+    // non-tree edges stay on level 0; their vertex flags are laid out with the tours
+    std::vector<uint32_t> nontree_count(n, 0);
+    for (const EdgeSpec& s : edgeList) {
+        if (s.u != s.v && !edges[s.e].tree) { ++nontree_count[s.u]; ++nontree_count[s.v]; }
+    }
+    for (uint32_t v = 0; v < n; ++v) {
+        if (nontree_count[v]) verts[v].nontree.resize(1), verts[v].nontree[0].reserve(nontree_count[v]);
+    }
+    for (const EdgeSpec& s : edgeList) {
+        Edge& E = edges[s.e];
+        if (s.u == s.v || E.tree) continue;
+        E.pos_u = uint32_t(verts[s.u].nontree[0].size());
+        verts[s.u].nontree[0].push_back(s.e);
+        E.pos_v = uint32_t(verts[s.v].nontree[0].size());
+        verts[s.v].nontree[0].push_back(s.e);
+    }
+    auto tourVertex = [&](uint32_t v) {
+        uint32_t x = vertexNode(0, v);
+        if (nontree_count[v]) nodes[x].own = nodes[x].agg = kNonTreeFlag;
+        return x;
+    };
+
+    // Euler tours of the forest by iterative DFS, laid out as balanced splay trees
+    std::vector<uint32_t> first(size_t(n) + 1, 0), adj(tree.size() * 2);
+    for (uint32_t e : tree) { ++first[edges[e].u + 1]; ++first[edges[e].v + 1]; }
+    for (uint32_t v = 0; v < n; ++v) first[v + 1] += first[v];
+    std::vector<uint32_t> fill(first.begin(), first.end() - 1);
+    for (uint32_t e : tree) { adj[fill[edges[e].u]++] = e; adj[fill[edges[e].v]++] = e; }
+    std::vector<char> seen(n, 0);
+    std::vector<uint32_t> seq;
+    struct Frame { uint32_t v, next, via; };
+    std::vector<Frame> stack;
+    for (uint32_t r = 0; r < n; ++r) {
+        if (seen[r] || first[r] == first[r + 1]) continue;
+        seq.clear();
+        seen[r] = 1;
+        seq.push_back(tourVertex(r));
+        stack.push_back(Frame{ r, first[r], kNil });
+        while (!stack.empty()) {
+            Frame& f = stack.back();
+            if (f.next == first[f.v + 1]) {
+                uint32_t via = f.via;
+                stack.pop_back();
+                if (via != kNil) {
+                    // back up to the parent: (child -> parent)
+                    uint32_t b = newNode(via, false, 0);
+                    edges[via].tour[1] = b;
+                    seq.push_back(b);
+                }
+                continue;
+            }
+            uint32_t e = adj[f.next++];
+            uint32_t c = edges[e].u == f.v ? edges[e].v : edges[e].u;
+            if (seen[c]) continue;
+            seen[c] = 1;
+            uint32_t a = newNode(e, false, kTreeFlag);
+            edges[e].tour.assign(2, kNil);
+            edges[e].tour[0] = a;
+            seq.push_back(a);
+            seq.push_back(tourVertex(c));
+            stack.push_back(Frame{ c, first[c], e });
+        }
+        nodes[buildRange(seq, 0, seq.size())].parent = kNil;
+    }
+}
+
+void Connectivity::clear() {
+    nodes.clear();
+    free_nodes.clear();
+    vertex_node.clear();
+    edges.clear();
+    verts.clear();
+    isolated_list.clear();
+    present_count = 0;
+    tree_edges = 0;
+    edge_count = 0;
+}
+
+// containers plus the per-edge lists (estimated from the counts)
+size_t Connectivity::memoryBytes() const {
+    size_t bytes = nodes.capacity() * sizeof(Node) + free_nodes.capacity() * sizeof(uint32_t)
+                 + edges.capacity() * sizeof(Edge) + verts.capacity() * sizeof(Vertex)
+                 + isolated_list.capacity() * sizeof(uint32_t);
+    for (const auto& row : vertex_node) bytes += row.capacity() * sizeof(uint32_t);
+    bytes += tree_edges * 2 * sizeof(uint32_t);                  // tours
+    bytes += (edge_count - tree_edges) * 2 * sizeof(uint32_t);   // non-tree lists
+    return bytes;
+}
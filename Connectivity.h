@@ -0,0 +1,115 @@
+#ifndef CONNECTIVITY_H
+#define CONNECTIVITY_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Fully dynamic connectivity of an undirected multigraph (Holm, de Lichtenberg,
+// Thorup). Every edge has a level; forest F_i holds the spanning-tree edges of
+// level >= i as Euler tours in splay trees, and a tree of F_i never has more
+// than n / 2^i vertices. Deleting a tree edge searches the smaller half for a
+// replacement level by level, promoting whatever it examined, which gives
+// O(log^2 n) amortized updates and O(log n) connectivity queries.
+//
+// Vertex and edge ids are the caller's (station and pipe slots). Queries splay,
+// so even the const members modify internal state: one thread at a time.
+class Connectivity {
+public:
+    // mark v present: it counts as a component and as isolated until an edge arrives
+    void addVertex(uint32_t v);
+    // v must have no edges left
+    void removeVertex(uint32_t v);
+    // u == v is accepted and ignored for connectivity
+    void insert(uint32_t e, uint32_t u, uint32_t v);
+    // no-op for an absent edge
+    void erase(uint32_t e);
+    bool contains(uint32_t e) const { return e < edges.size() && edges[e].present; }
+    uint32_t endpointU(uint32_t e) const { return edges[e].u; }
+    uint32_t endpointV(uint32_t e) const { return edges[e].v; }
+
+    bool connected(uint32_t u, uint32_t v) const;
+    size_t componentSize(uint32_t v) const;
+    // every vertex in v's component, v included
+    void component(uint32_t v, std::vector<uint32_t>& out) const;
+    size_t components() const { return present_count - tree_edges; }
+    // present vertices without any edge
+    const std::vector<uint32_t>& isolated() const { return isolated_list; }
+    size_t edgeCount() const { return edge_count; }
+
+    // Replace everything with the given graph in O((n + m) alpha): union-find
+    // picks a spanning forest, whose Euler tours are laid out directly.
+    struct EdgeSpec { uint32_t e, u, v; };
+    void build(const std::vector<uint32_t>& vertices, const std::vector<EdgeSpec>& edgeList);
+    void clear();
+    size_t memoryBytes() const;
+
+private:
+    static constexpr uint32_t kNil = UINT32_MAX;
+    static constexpr uint8_t kTreeFlag = 1;    // edge node: tree edge whose level is this forest's
+    static constexpr uint8_t kNonTreeFlag = 2; // vertex node: has non-tree edges of this level
+
+    struct Node {
+        uint32_t left = kNil, right = kNil, parent = kNil;
+        uint32_t count = 1;   // nodes in the splay subtree
+        uint32_t vertices = 0; // vertex nodes in the splay subtree
+        uint32_t id = 0;       // vertex or edge id
+        bool is_vertex = false;
+        uint8_t own = 0;       // flags of this node
+        uint8_t agg = 0;       // flags of the subtree
+    };
+    struct Edge {
+        uint32_t u = 0, v = 0;
+        uint32_t level = 0;
+        bool present = false;
+        bool tree = false;
+        uint32_t pos_u = 0, pos_v = 0; // non-tree: index in the endpoints' lists
+        std::vector<uint32_t> tour;    // tree: (u->v, v->u) node pair per level 0..level
+    };
+    struct Vertex {
+        std::vector<std::vector<uint32_t>> nontree; // per level: non-tree edge ids
+        uint32_t degree = 0;
+        uint32_t isolated_pos = kNil;
+        bool present = false;
+    };
+
+    mutable std::vector<Node> nodes;
+    std::vector<uint32_t> free_nodes;
+    std::vector<std::vector<uint32_t>> vertex_node; // [level][vertex], kNil = singleton there
+    std::vector<Edge> edges;
+    std::vector<Vertex> verts;
+    std::vector<uint32_t> isolated_list;
+    size_t present_count = 0;
+    size_t tree_edges = 0;
+    size_t edge_count = 0;
+
+    // splay trees over Euler tour sequences
+    uint32_t newNode(uint32_t id, bool is_vertex, uint8_t flags);
+    void freeNode(uint32_t x);
+    void update(uint32_t x) const;
+    void rotate(uint32_t x) const;
+    void splay(uint32_t x) const;
+    uint32_t join(uint32_t a, uint32_t b) const;
+    uint32_t splitBefore(uint32_t x) const; // returns the left part; x heads the right part
+    uint32_t splitAfter(uint32_t x) const;  // returns the right part; x ends the left part
+    uint32_t reroot(uint32_t x) const;
+    uint32_t position(uint32_t x) const;
+    uint32_t findFlag(uint32_t root, uint8_t flag) const;
+    void setFlag(uint32_t x, uint8_t flag, bool on);
+
+    uint32_t vertexNode(uint32_t level, uint32_t v);
+    uint32_t vertexNodeIfAny(uint32_t level, uint32_t v) const;
+    bool connectedAt(uint32_t level, uint32_t u, uint32_t v) const;
+    uint32_t sizeAt(uint32_t level, uint32_t v) const;
+    void link(uint32_t level, uint32_t e);
+    void cut(uint32_t level, uint32_t e);
+    void addNonTree(uint32_t e);
+    void removeNonTree(uint32_t e);
+    void listRemove(uint32_t vertex, uint32_t e);
+    bool reconnect(uint32_t level, uint32_t u, uint32_t v);
+    uint32_t buildRange(const std::vector<uint32_t>& seq, size_t lo, size_t hi);
+    void growVertices(uint32_t v);
+    void setDegree(uint32_t v, uint32_t degree);
+};
+
+#endif // CONNECTIVITY_H
@@ -0,0 +1,46 @@
+#include "Epoch.h"
+#include <functional>
+#include <thread>
+
+EpochManager::EpochManager() : global(1) {}
+
+EpochManager::~EpochManager() {
+    // no reader may outlive the manager, so everything can go
+    for (const Retired& r : retired) r.deleter(r.ptr);
+}
+
+EpochManager::Guard EpochManager::pin() const {
+    // threads start probing at different slots so they rarely share a line
+    size_t start = std::hash<std::thread::id>()(std::this_thread::get_id()) % kSlots;
+    for (;;) {
+        for (size_t i = 0; i < kSlots; ++i) {
+            Slot& s = slots[(start + i) % kSlots];
+            uint64_t expected = 0;
+            // announcing a slightly old epoch is safe: it only delays reclamation
+            uint64_t e = global.load(std::memory_order_seq_cst);
+            if (s.epoch.load(std::memory_order_relaxed) == 0 &&
+                s.epoch.compare_exchange_strong(expected, e, std::memory_order_seq_cst)) {
+                return Guard(&s.epoch);
+            }
+        }
+        std::this_thread::yield();
+    }
+}
+
+void EpochManager::retire(void* p, void (*deleter)(void*)) {
+    retired.push_back(Retired{ p, deleter, global.load(std::memory_order_relaxed) });
+}
+
+void EpochManager::advance() {
+    uint64_t oldest = global.fetch_add(1, std::memory_order_seq_cst) + 1;
+    for (const Slot& s : slots) {
+        uint64_t e = s.epoch.load(std::memory_order_seq_cst);
+        if (e && e < oldest) oldest = e;
+    }
+    size_t keep = 0;
+    for (size_t i = 0; i < retired.size(); ++i) {
+        if (retired[i].epoch < oldest) retired[i].deleter(retired[i].ptr);
+        else retired[keep++] = retired[i];
+    }
+    retired.resize(keep);
+}
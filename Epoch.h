@@ -0,0 +1,74 @@
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Epoch-based reclamation for one writer and many readers.
+//
+// A reader pins the current epoch for the duration of a read (one CAS on its
+// own cache line, no shared counters). The writer unlinks objects, hands them
+// to retire() and calls advance(); an object is freed once every pinned
+// reader started after it was retired.
+class EpochManager {
+public:
+    static constexpr size_t kSlots = 128; // concurrent pins before readers spin
+
+    class Guard {
+    public:
+        Guard() : slot(nullptr) {}
+        explicit Guard(std::atomic<uint64_t>* s) : slot(s) {}
+        Guard(Guard&& o) noexcept : slot(o.slot) { o.slot = nullptr; }
+        Guard& operator=(Guard&& o) noexcept {
+            if (this != &o) { release(); slot = o.slot; o.slot = nullptr; }
+            return *this;
+        }
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        ~Guard() { release(); }
+
+        void release() {
+            if (slot) slot->store(0, std::memory_order_release);
+            slot = nullptr;
+        }
+
+    private:
+        std::atomic<uint64_t>* slot;
+    };
+
+    EpochManager();
+    ~EpochManager();
+    EpochManager(const EpochManager&) = delete;
+    EpochManager& operator=(const EpochManager&) = delete;
+
+    // reader side, any thread
+    Guard pin() const;
+
+    // writer side, one thread at a time
+    template <typename T>
+    void retire(const T* p) {
+        if (p) retire(const_cast<T*>(p), [](void* x){ delete static_cast<T*>(x); });
+    }
+    void retire(void* p, void (*deleter)(void*));
+    // bump the epoch and free whatever no pinned reader can still reach
+    void advance();
+    size_t pendingCount() const { return retired.size(); }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{ 0 }; // 0 = free, otherwise the pinned epoch
+    };
+    struct Retired {
+        void* ptr;
+        void (*deleter)(void*);
+        uint64_t epoch;
+    };
+
+    mutable Slot slots[kSlots];
+    std::atomic<uint64_t> global;
+    std::vector<Retired> retired;
+};
+
+#endif // EPOCH_H
@@ -0,0 +1,337 @@
+#include "Export.h"
+#include <algorithm>
+#include <charconv>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <climits>
+#else
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+namespace {
+
+// records per formatting chunk; a round is one chunk per thread
+const size_t kChunkRecords = 8192;
+// rounds below this many records are formatted on the calling thread
+const size_t kMinParallel = 2 * kChunkRecords;
+// a typical CSV record; chunk buffers start this big per record and double
+// at most once or twice for longer formats
+const size_t kRecordBytes = 64;
+
+const char* const kPipeCsvHeader = "id,name,diameter,in_repair,input_station,output_station\n";
+const char* const kStationCsvHeader = "id,name,total_workshops,working_workshops,idle_percent,classification\n";
+
+void appendInt(std::string& out, int64_t v) {
+    char buf[24];
+    auto r = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, r.ptr);
+}
+
+void appendUint(std::string& out, uint64_t v) {
+    char buf[24];
+    auto r = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, r.ptr);
+}
+
+// shortest text that reads back to the same double
+void appendDouble(std::string& out, double v) {
+    char buf[32];
+    auto r = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, r.ptr);
+}
+
+// what std::ostream prints by default (%g, 6 significant digits)
+void appendDoubleShort(std::string& out, double v) {
+    char buf[32];
+    auto r = std::to_chars(buf, buf + sizeof(buf), v, std::chars_format::general, 6);
+    out.append(buf, r.ptr);
+}
+
+void appendCsv(std::string& out, std::string_view s) {
+    if (s.find_first_of(",\"\r\n") == std::string_view::npos) {
+        out.append(s);
+        return;
+    }
+    out += '"';
+    for (char c : s) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    out += '"';
+}
+
+void appendJson(std::string& out, std::string_view s) {
+    static const char kHex[] = "0123456789abcdef";
+    out += '"';
+    size_t run = 0; // start of the pending run of plain bytes
+    for (size_t i = 0; i < s.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(s[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        out.append(s.data() + run, i - run);
+        run = i + 1;
+        if (c == '"' || c == '\\') { out += '\\'; out += char(c); }
+        else if (c == '\n') out += "\\n";
+        else if (c == '\t') out += "\\t";
+        else if (c == '\r') out += "\\r";
+        else { out += "\\u00"; out += kHex[c >> 4]; out += kHex[c & 15]; }
+    }
+    out.append(s.data() + run, s.size() - run);
+    out += '"';
+}
+
+void appendJsonNumber(std::string& out, double v) {
+    if (std::isfinite(v)) appendDouble(out, v);
+    else out += "null";
+}
+
+void formatChunk(std::string& out, const Pipe* const* first, const Pipe* const* last, ExportFormat format) {
+    out.reserve(out.size() + size_t(last - first) * kRecordBytes);
+    for (; first != last; ++first) formatRecord(out, **first, format);
+}
+
+void formatChunk(std::string& out, const CompressorStation* const* first, const CompressorStation* const* last, ExportFormat format) {
+    out.reserve(out.size() + size_t(last - first) * kRecordBytes);
+    for (; first != last; ++first) formatRecord(out, **first, format);
+}
+
+template <typename T>
+ExportResult exportAll(ExportSink& sink, const ExportOptions& options,
+                       const std::function<size_t(std::vector<const T*>&, size_t)>& source, const char* csvHeader) {
+    ExportResult res;
+    size_t bytes_before = sink.bytes();
+    unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    size_t round = kChunkRecords * threads;
+    // buffers[i] belongs to chunk i of a round; kept for the whole export
+    std::vector<std::string> buffers(threads);
+    std::vector<const T*> batch;
+    batch.reserve(round);
+    if (options.format == ExportFormat::Csv && options.header) buffers[0] = csvHeader;
+    bool first = true;
+    while (true) {
+        batch.clear();
+        size_t n = source(batch, round);
+        if (n == 0 && !first) break;
+        res.records += n;
+        size_t chunks = n < kMinParallel ? 1 : (n + kChunkRecords - 1) / kChunkRecords;
+        if (!first) buffers[0].clear();
+        if (chunks == 1) {
+            formatChunk(buffers[0], batch.data(), batch.data() + n, options.format);
+        } else {
+            std::vector<std::thread> pool;
+            auto work = [&](size_t c) {
+                if (c) buffers[c].clear();
+                size_t begin = c * kChunkRecords, end = std::min(n, begin + kChunkRecords);
+                formatChunk(buffers[c], batch.data() + begin, batch.data() + end, options.format);
+            };
+            for (size_t c = 1; c < chunks; ++c) pool.emplace_back(work, c);
+            work(0);
+            for (auto& t : pool) t.join();
+        }
+        first = false;
+        if (!sink.write(buffers.data(), chunks)) {
+            res.ok = false;
+            res.error = std::string("write failed: ") + std::strerror(errno);
+            break;
+        }
+        if (n == 0) break;
+    }
+    res.bytes = sink.bytes() - bytes_before;
+    return res;
+}
+
+}
+
+// === formatting
+void formatRecord(std::string& out, const Pipe& p, ExportFormat format) {
+    switch (format) {
+        case ExportFormat::Csv:
+            appendUint(out, p.getId());
+            out += ',';
+            appendCsv(out, p.getName());
+            out += ',';
+            appendDouble(out, p.getDiameter());
+            out += p.isInRepair() ? ",1," : ",0,";
+            appendUint(out, p.getInputStation());
+            out += ',';
+            appendUint(out, p.getOutputStation());
+            break;
+        case ExportFormat::JsonLines:
+            out += "{\"id\":";
+            appendUint(out, p.getId());
+            out += ",\"name\":";
+            appendJson(out, p.getName());
+            out += ",\"diameter\":";
+            appendJsonNumber(out, p.getDiameter());
+            out += p.isInRepair() ? ",\"in_repair\":true" : ",\"in_repair\":false";
+            out += ",\"input_station\":";
+            appendUint(out, p.getInputStation());
+            out += ",\"output_station\":";
+            appendUint(out, p.getOutputStation());
+            out += '}';
+            break;
+        case ExportFormat::Text:
+            out += "ID=";
+            appendUint(out, p.getId());
+            out += " | Name=\"";
+            out.append(p.getName());
+            out += "\" | Diameter=";
+            appendDoubleShort(out, p.getDiameter());
+            out += p.isInRepair() ? " | InRepair=YES" : " | InRepair=NO";
+            if (p.isConnected()) {
+                out += " | KS ";
+                appendUint(out, p.getInputStation());
+                out += " -> KS ";
+                appendUint(out, p.getOutputStation());
+            }
+            break;
+    }
+    out += '\n';
+}
+
+void formatRecord(std::string& out, const CompressorStation& s, ExportFormat format) {
+    switch (format) {
+        case ExportFormat::Csv:
+            appendUint(out, s.getId());
+            out += ',';
+            appendCsv(out, s.getName());
+            out += ',';
+            appendInt(out, s.getTotalWorkshops());
+            out += ',';
+            appendInt(out, s.getWorkingWorkshops());
+            out += ',';
+            appendDouble(out, s.percentIdle());
+            out += ',';
+            appendCsv(out, s.getClassification());
+            break;
+        case ExportFormat::JsonLines:
+            out += "{\"id\":";
+            appendUint(out, s.getId());
+            out += ",\"name\":";
+            appendJson(out, s.getName());
+            out += ",\"total_workshops\":";
+            appendInt(out, s.getTotalWorkshops());
+            out += ",\"working_workshops\":";
+            appendInt(out, s.getWorkingWorkshops());
+            out += ",\"idle_percent\":";
+            appendJsonNumber(out, s.percentIdle());
+            out += ",\"classification\":";
+            appendJson(out, s.getClassification());
+            out += '}';
+            break;
+        case ExportFormat::Text:
+            out += "ID=";
+            appendUint(out, s.getId());
+            out += " | Name=\"";
+            out.append(s.getName());
+            out += "\" | Total=";
+            appendInt(out, s.getTotalWorkshops());
+            out += " | Working=";
+            appendInt(out, s.getWorkingWorkshops());
+            out += " | Idle%=";
+            appendDoubleShort(out, s.percentIdle());
+            out += " | Class=\"";
+            out.append(s.getClassification());
+            out += '"';
+            break;
+    }
+    out += '\n';
+}
+
+ExportResult exportRecords(ExportSink& sink, const ExportOptions& options, const PipeSource& source) {
+    return exportAll<Pipe>(sink, options, source, kPipeCsvHeader);
+}
+
+ExportResult exportRecords(ExportSink& sink, const ExportOptions& options, const StationSource& source) {
+    return exportAll<CompressorStation>(sink, options, source, kStationCsvHeader);
+}
+
+// === ExportSink
+ExportSink::~ExportSink() {
+    close();
+}
+
+#ifndef _WIN32
+bool ExportSink::open(const std::string& filename, std::string& error) {
+    close();
+    fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = "cannot open " + filename + ": " + std::strerror(errno);
+        return false;
+    }
+    owned = true;
+    written = 0;
+    return true;
+}
+
+bool ExportSink::close() {
+    bool ok = true;
+    if (owned && fd >= 0) ok = ::close(fd) == 0;
+    fd = -1;
+    owned = false;
+    return ok;
+}
+
+bool ExportSink::write(const std::string* buffers, size_t count) {
+    std::vector<iovec> iov;
+    iov.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (!buffers[i].empty()) iov.push_back(iovec{ const_cast<char*>(buffers[i].data()), buffers[i].size() });
+    }
+    size_t at = 0;
+    while (at < iov.size()) {
+        int n = int(std::min<size_t>(iov.size() - at, IOV_MAX));
+        ssize_t w = ::writev(fd, iov.data() + at, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w < 0) return false;
+        written += size_t(w);
+        // skip what went out, resume inside a partly written buffer
+        size_t left = size_t(w);
+        while (at < iov.size() && left >= iov[at].iov_len) left -= iov[at++].iov_len;
+        if (left) {
+            iov[at].iov_base = static_cast<char*>(iov[at].iov_base) + left;
+            iov[at].iov_len -= left;
+        }
+    }
+    return true;
+}
+#else
+bool ExportSink::open(const std::string& filename, std::string& error) {
+    close();
+    fd = ::_open(filename.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, 0644);
+    if (fd < 0) {
+        error = "cannot open " + filename + ": " + std::strerror(errno);
+        return false;
+    }
+    owned = true;
+    written = 0;
+    return true;
+}
+
+bool ExportSink::close() {
+    bool ok = true;
+    if (owned && fd >= 0) ok = ::_close(fd) == 0;
+    fd = -1;
+    owned = false;
+    return ok;
+}
+
+bool ExportSink::write(const std::string* buffers, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        size_t done = 0;
+        while (done < buffers[i].size()) {
+            int w = ::_write(fd, buffers[i].data() + done, unsigned(std::min<size_t>(buffers[i].size() - done, 1 << 30)));
+            if (w <= 0) return false;
+            done += size_t(w);
+            written += size_t(w);
+        }
+    }
+    return true;
+}
+#endif
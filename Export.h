@@ -0,0 +1,79 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include "Pipe.h"
+#include "CompressorStation.h"
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Streaming export of pipes and stations.
+//
+// Records are taken from the source one round at a time; a round is cut into
+// chunks that are formatted in parallel, each worker into its own buffer that
+// is reused for every round, and the round's buffers leave in one writev.
+// Numbers are formatted with std::to_chars. Memory stays at a few buffers
+// whatever the number of records.
+//
+//   Csv       header line (unless options.header is false), RFC 4180 quoting
+//   JsonLines one JSON object per line
+//   Text      the console layout of main.cpp ("ID=1 | Name=\"...\" | ...")
+enum class ExportFormat { Csv, JsonLines, Text };
+
+struct ExportOptions {
+    ExportFormat format = ExportFormat::Csv;
+    // page: skip offset records, then export at most limit
+    size_t offset = 0;
+    size_t limit = std::numeric_limits<size_t>::max();
+    bool header = true;   // Csv only
+    unsigned threads = 0; // formatting threads, 0 = hardware concurrency
+};
+
+struct ExportResult {
+    bool ok = true;
+    size_t records = 0;
+    size_t bytes = 0;
+    std::string error;
+};
+
+// Where export output goes: a descriptor owned elsewhere (1 for stdout) or a
+// file created by open().
+class ExportSink {
+public:
+    ExportSink() = default;
+    explicit ExportSink(int fd_) : fd(fd_) {}
+    ~ExportSink();
+    ExportSink(const ExportSink&) = delete;
+    ExportSink& operator=(const ExportSink&) = delete;
+
+    // create or truncate filename
+    bool open(const std::string& filename, std::string& error);
+    bool close();
+    // all count buffers in order, as one writev (repeated after short writes)
+    bool write(const std::string* buffers, size_t count);
+    size_t bytes() const { return written; }
+
+private:
+    int fd = -1;
+    bool owned = false;
+    size_t written = 0;
+};
+
+// Record sources: append up to max record pointers to batch and return how
+// many were appended; 0 ends the export. Records must stay alive and
+// unchanged until the export returns.
+using PipeSource = std::function<size_t(std::vector<const Pipe*>& batch, size_t max)>;
+using StationSource = std::function<size_t(std::vector<const CompressorStation*>& batch, size_t max)>;
+
+// options.offset/limit are applied by the caller's source (see Manager)
+ExportResult exportRecords(ExportSink& sink, const ExportOptions& options, const PipeSource& source);
+ExportResult exportRecords(ExportSink& sink, const ExportOptions& options, const StationSource& source);
+
+// one record in the given format, newline included
+void formatRecord(std::string& out, const Pipe& p, ExportFormat format);
+void formatRecord(std::string& out, const CompressorStation& s, ExportFormat format);
+
+#endif // EXPORT_H
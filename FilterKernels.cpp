@@ -0,0 +1,272 @@
+#include "FilterKernels.h"
+#include <cstring>
+#if defined(__x86_64__) || defined(_M_X64)
+#define FILTER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// 64-slot block mask functions: bit i set when slot base + i matches
+typedef uint64_t (*RangeMaskFn)(const double* v, double lo, double hi);
+typedef uint64_t (*IdleMaskFn)(const int32_t* total, const int32_t* working, double lo, double hi);
+typedef uint64_t (*IntRangeMaskFn)(const int32_t* v, int32_t lo, int32_t hi);
+// first occurrence of p[0..m) in s[0..n), m >= 2 and n >= m
+typedef size_t (*FindFn)(const char* s, size_t n, const char* p, size_t m);
+
+[[maybe_unused]] uint64_t rangeMaskScalar(const double* v, double lo, double hi) {
+    uint64_t m = 0;
+    for (int i = 0; i < 64; ++i) m |= uint64_t(v[i] >= lo && v[i] <= hi) << i;
+    return m;
+}
+
+[[maybe_unused]] uint64_t intRangeMaskScalar(const int32_t* v, int32_t lo, int32_t hi) {
+    uint64_t m = 0;
+    for (int i = 0; i < 64; ++i) m |= uint64_t(v[i] >= lo && v[i] <= hi) << i;
+    return m;
+}
+
+size_t findScalar(const char* s, size_t n, const char* p, size_t m) {
+    return std::string_view(s, n).find(std::string_view(p, m));
+}
+
+// positions from "from" on, where a whole vector block no longer fits
+inline size_t findTail(const char* s, size_t n, const char* p, size_t m, size_t from) {
+    size_t at = findScalar(s + from, n - from, p, m);
+    return at == std::string_view::npos ? at : from + at;
+}
+
+inline double idleScalar(int32_t total, int32_t working) {
+    if (total <= 0) return 0.0;
+    int idle = total - working;
+    return (100.0 * idle) / total;
+}
+
+[[maybe_unused]] uint64_t idleMaskScalar(const int32_t* total, const int32_t* working, double lo, double hi) {
+    uint64_t m = 0;
+    for (int i = 0; i < 64; ++i) {
+        double p = idleScalar(total[i], working[i]);
+        m |= uint64_t(p >= lo && p <= hi) << i;
+    }
+    return m;
+}
+
+#ifdef FILTER_X86
+uint64_t rangeMaskSse2(const double* v, double lo, double hi) {
+    __m128d vlo = _mm_set1_pd(lo), vhi = _mm_set1_pd(hi);
+    uint64_t m = 0;
+    for (int i = 0; i < 64; i += 2) {
+        __m128d x = _mm_loadu_pd(v + i);
+        __m128d ok = _mm_and_pd(_mm_cmpge_pd(x, vlo), _mm_cmple_pd(x, vhi));
+        m |= uint64_t(_mm_movemask_pd(ok)) << i;
+    }
+    return m;
+}
+
+uint64_t idleMaskSse2(const int32_t* total, const int32_t* working, double lo, double hi) {
+    __m128d vlo = _mm_set1_pd(lo), vhi = _mm_set1_pd(hi);
+    __m128d hundred = _mm_set1_pd(100.0), zero = _mm_setzero_pd();
+    uint64_t m = 0;
+    for (int i = 0; i < 64; i += 2) {
+        __m128i t32 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(total + i));
+        __m128i w32 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(working + i));
+        __m128d t = _mm_cvtepi32_pd(t32);
+        __m128d idle = _mm_cvtepi32_pd(_mm_sub_epi32(t32, w32));
+        __m128d p = _mm_div_pd(_mm_mul_pd(hundred, idle), t);
+        p = _mm_and_pd(p, _mm_cmpgt_pd(t, zero)); // total <= 0 -> 0.0
+        __m128d ok = _mm_and_pd(_mm_cmpge_pd(p, vlo), _mm_cmple_pd(p, vhi));
+        m |= uint64_t(_mm_movemask_pd(ok)) << i;
+    }
+    return m;
+}
+
+// Candidate positions are those where both the first and the last pattern
+// byte match (one compare of each against a broadcast per block); only they
+// get a memcmp of the bytes in between.
+size_t findSse2(const char* s, size_t n, const char* p, size_t m) {
+    __m128i first = _mm_set1_epi8(p[0]), last = _mm_set1_epi8(p[m - 1]);
+    size_t i = 0;
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + m - 1));
+        unsigned mask = unsigned(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last))));
+        for (; mask; mask &= mask - 1) {
+            size_t at = i + unsigned(__builtin_ctz(mask));
+            if (std::memcmp(s + at + 1, p + 1, m - 2) == 0) return at;
+        }
+    }
+    return findTail(s, n, p, m, i);
+}
+
+uint64_t intRangeMaskSse2(const int32_t* v, int32_t lo, int32_t hi) {
+    __m128i vlo = _mm_set1_epi32(lo), vhi = _mm_set1_epi32(hi);
+    uint64_t m = 0;
+    for (int i = 0; i < 64; i += 4) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i));
+        __m128i out = _mm_or_si128(_mm_cmplt_epi32(x, vlo), _mm_cmpgt_epi32(x, vhi));
+        m |= uint64_t(~_mm_movemask_ps(_mm_castsi128_ps(out)) & 0xF) << i;
+    }
+    return m;
+}
+
+__attribute__((target("avx2")))
+uint64_t rangeMaskAvx2(const double* v, double lo, double hi) {
+    __m256d vlo = _mm256_set1_pd(lo), vhi = _mm256_set1_pd(hi);
+    uint64_t m = 0;
+    for (int i = 0; i < 64; i += 8) {
+        __m256d a = _mm256_loadu_pd(v + i);
+        __m256d b = _mm256_loadu_pd(v + i + 4);
+        __m256d oka = _mm256_and_pd(_mm256_cmp_pd(a, vlo, _CMP_GE_OQ), _mm256_cmp_pd(a, vhi, _CMP_LE_OQ));
+        __m256d okb = _mm256_and_pd(_mm256_cmp_pd(b, vlo, _CMP_GE_OQ), _mm256_cmp_pd(b, vhi, _CMP_LE_OQ));
+        m |= uint64_t(_mm256_movemask_pd(oka) | (_mm256_movemask_pd(okb) << 4)) << i;
+    }
+    return m;
+}
+
+__attribute__((target("avx2")))
+uint64_t idleMaskAvx2(const int32_t* total, const int32_t* working, double lo, double hi) {
+    __m256d vlo = _mm256_set1_pd(lo), vhi = _mm256_set1_pd(hi);
+    __m256d hundred = _mm256_set1_pd(100.0), zero = _mm256_setzero_pd();
+    uint64_t m = 0;
+    for (int i = 0; i < 64; i += 4) {
+        __m128i t32 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(total + i));
+        __m128i w32 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(working + i));
+        __m256d t = _mm256_cvtepi32_pd(t32);
+        __m256d idle = _mm256_cvtepi32_pd(_mm_sub_epi32(t32, w32));
+        __m256d p = _mm256_div_pd(_mm256_mul_pd(hundred, idle), t);
+        p = _mm256_and_pd(p, _mm256_cmp_pd(t, zero, _CMP_GT_OQ));
+        __m256d ok = _mm256_and_pd(_mm256_cmp_pd(p, vlo, _CMP_GE_OQ), _mm256_cmp_pd(p, vhi, _CMP_LE_OQ));
+        m |= uint64_t(_mm256_movemask_pd(ok)) << i;
+    }
+    return m;
+}
+__attribute__((target("avx2")))
+uint64_t intRangeMaskAvx2(const int32_t* v, int32_t lo, int32_t hi) {
+    __m256i vlo = _mm256_set1_epi32(lo), vhi = _mm256_set1_epi32(hi);
+    uint64_t m = 0;
+    for (int i = 0; i < 64; i += 8) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i));
+        __m256i out = _mm256_or_si256(_mm256_cmpgt_epi32(vlo, x), _mm256_cmpgt_epi32(x, vhi));
+        m |= uint64_t(~_mm256_movemask_ps(_mm256_castsi256_ps(out)) & 0xFF) << i;
+    }
+    return m;
+}
+
+__attribute__((target("avx2")))
+size_t findAvx2(const char* s, size_t n, const char* p, size_t m) {
+    __m256i first = _mm256_set1_epi8(p[0]), last = _mm256_set1_epi8(p[m - 1]);
+    size_t i = 0;
+    for (; i + m - 1 + 32 <= n; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i + m - 1));
+        uint32_t mask = uint32_t(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last))));
+        for (; mask; mask &= mask - 1) {
+            size_t at = i + unsigned(__builtin_ctz(mask));
+            if (std::memcmp(s + at + 1, p + 1, m - 2) == 0) return at;
+        }
+    }
+    // what is left may still hold whole 16-byte blocks
+    size_t at = findSse2(s + i, n - i, p, m);
+    return at == std::string_view::npos ? at : i + at;
+}
+#endif
+
+struct Kernels {
+    RangeMaskFn range;
+    IdleMaskFn idle;
+    IntRangeMaskFn int_range;
+    FindFn find;
+    const char* isa;
+};
+
+Kernels pickKernels() {
+#ifdef FILTER_X86
+#if defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return Kernels{ rangeMaskAvx2, idleMaskAvx2, intRangeMaskAvx2, findAvx2, "avx2" };
+#endif
+    return Kernels{ rangeMaskSse2, idleMaskSse2, intRangeMaskSse2, findSse2, "sse2" };
+#else
+    return Kernels{ rangeMaskScalar, idleMaskScalar, intRangeMaskScalar, findScalar, "scalar" };
+#endif
+}
+
+const Kernels& kernels() {
+    static const Kernels k = pickKernels();
+    return k;
+}
+
+// append base + index of every set bit
+inline size_t emit(uint64_t mask, uint32_t base, std::vector<uint32_t>& sel) {
+    size_t n = 0;
+    while (mask) {
+        sel.push_back(base + uint32_t(__builtin_ctzll(mask)));
+        mask &= mask - 1;
+        ++n;
+    }
+    return n;
+}
+
+}
+
+size_t selectDiameterRange(const PipeColumns& c, double lo, double hi, std::vector<uint32_t>& sel) {
+    RangeMaskFn fn = kernels().range;
+    size_t n = 0;
+    for (size_t w = 0; w < c.live.wordCount(); ++w) {
+        uint64_t live = c.live.word(w);
+        if (!live) continue;
+        n += emit(fn(c.diameter.data() + w * 64, lo, hi) & live, uint32_t(w * 64), sel);
+    }
+    return n;
+}
+
+size_t selectRepair(const PipeColumns& c, bool in_repair, std::vector<uint32_t>& sel) {
+    size_t n = 0;
+    for (size_t w = 0; w < c.live.wordCount(); ++w) {
+        uint64_t live = c.live.word(w);
+        uint64_t rep = c.repair.word(w);
+        n += emit(in_repair ? (rep & live) : (~rep & live), uint32_t(w * 64), sel);
+    }
+    return n;
+}
+
+size_t selectIdleRange(const StationColumns& c, double lo, double hi, std::vector<uint32_t>& sel) {
+    IdleMaskFn fn = kernels().idle;
+    size_t n = 0;
+    for (size_t w = 0; w < c.live.wordCount(); ++w) {
+        uint64_t live = c.live.word(w);
+        if (!live) continue;
+        n += emit(fn(c.total.data() + w * 64, c.working.data() + w * 64, lo, hi) & live, uint32_t(w * 64), sel);
+    }
+    return n;
+}
+
+uint64_t diameterRangeMask(const PipeColumns& c, size_t w, double lo, double hi) {
+    return kernels().range(c.diameter.data() + w * 64, lo, hi);
+}
+
+uint64_t idleRangeMask(const StationColumns& c, size_t w, double lo, double hi) {
+    return kernels().idle(c.total.data() + w * 64, c.working.data() + w * 64, lo, hi);
+}
+
+uint64_t int32RangeMask(const std::vector<int32_t>& col, size_t w, int32_t lo, int32_t hi) {
+    return kernels().int_range(col.data() + w * 64, lo, hi);
+}
+
+uint64_t codeEqMask(const std::vector<uint32_t>& col, size_t w, uint32_t code) {
+    // fixed 64-iteration loop: the compiler vectorizes it at the baseline ISA
+    const uint32_t* v = col.data() + w * 64;
+    uint64_t m = 0;
+    for (unsigned i = 0; i < 64; ++i) m |= uint64_t(v[i] == code) << i;
+    return m;
+}
+
+size_t findSubstring(std::string_view text, std::string_view pattern) {
+    if (pattern.size() > text.size()) return std::string_view::npos;
+    if (pattern.size() < 2) return text.find(pattern);
+    return kernels().find(text.data(), text.size(), pattern.data(), pattern.size());
+}
+
+const char* filterKernelIsa() {
+    return kernels().isa;
+}
@@ -0,0 +1,36 @@
+#ifndef FILTERKERNELS_H
+#define FILTERKERNELS_H
+
+#include "Columns.h"
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Column filters producing selection vectors: each call appends the matching
+// live slot indexes (ascending) to sel and returns how many it appended.
+// The implementation is picked once at startup: AVX2 when the CPU has it,
+// SSE2 on other x86-64 machines, plain scalar code elsewhere.
+
+size_t selectDiameterRange(const PipeColumns& c, double lo, double hi, std::vector<uint32_t>& sel);
+size_t selectRepair(const PipeColumns& c, bool in_repair, std::vector<uint32_t>& sel);
+// percentIdle() in [lo, hi], evaluated exactly like CompressorStation::percentIdle
+size_t selectIdleRange(const StationColumns& c, double lo, double hi, std::vector<uint32_t>& sel);
+
+// Single-word variants for composite predicates: bit i is set when slot
+// w * 64 + i matches. Liveness is not applied; w must be below live.wordCount().
+uint64_t diameterRangeMask(const PipeColumns& c, size_t w, double lo, double hi);
+uint64_t idleRangeMask(const StationColumns& c, size_t w, double lo, double hi);
+uint64_t int32RangeMask(const std::vector<int32_t>& col, size_t w, int32_t lo, int32_t hi);
+uint64_t codeEqMask(const std::vector<uint32_t>& col, size_t w, uint32_t code);
+
+// Position of the first occurrence of pattern in text, or npos, as
+// std::string_view::find. The vector kernels test a block of positions at a
+// time against the pattern's first and last byte and compare the rest only
+// where both match, which skips most of a name in a few instructions.
+size_t findSubstring(std::string_view text, std::string_view pattern);
+
+// "avx2", "sse2" or "scalar"
+const char* filterKernelIsa();
+
+#endif // FILTERKERNELS_H
@@ -0,0 +1,391 @@
+#include "Journal.h"
+#include <cstring>
+#include <array>
+#ifndef _WIN32
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+static const char kJournalMagic[8] = { 'G', 'T', 'N', 'W', 'A', 'L', '0', '1' };
+static const size_t kJournalHeader = 16;
+static const size_t kRecordHeader = 9; // u32 length, u32 crc, u8 op
+
+// === crc32 (IEEE, table driven)
+static const std::array<uint32_t, 256>& crcTable() {
+    static const std::array<uint32_t, 256> table = []() {
+        std::array<uint32_t, 256> t;
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    return table;
+}
+
+static uint32_t crc32Update(uint32_t crc, const void* data, size_t n) {
+    const std::array<uint32_t, 256>& table = crcTable();
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < n; ++i) crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// === payload encoding
+static void putRaw(std::string& out, const void* p, size_t n) { out.append(static_cast<const char*>(p), n); }
+static void putU64(std::string& out, uint64_t v) { putRaw(out, &v, 8); }
+static void putU32(std::string& out, uint32_t v) { putRaw(out, &v, 4); }
+static void putStr(std::string& out, std::string_view s) { putU32(out, static_cast<uint32_t>(s.size())); out.append(s); }
+static void putOp(std::string& out, FieldOp op) { out.push_back(static_cast<char>(op)); }
+static void putF64(std::string& out, double v) { putRaw(out, &v, 8); }
+static void putIds(std::string& out, const std::vector<uint64_t>& ids) {
+    putU32(out, static_cast<uint32_t>(ids.size()));
+    putRaw(out, ids.data(), ids.size() * 8);
+}
+
+namespace {
+
+struct Cursor {
+    const char* p;
+    const char* end;
+    bool ok = true;
+
+    void raw(void* dst, size_t n) {
+        if (static_cast<size_t>(end - p) < n) { ok = false; return; }
+        std::memcpy(dst, p, n);
+        p += n;
+    }
+    uint64_t u64() { uint64_t v = 0; raw(&v, 8); return v; }
+    uint32_t u32() { uint32_t v = 0; raw(&v, 4); return v; }
+    double f64() { double v = 0; raw(&v, 8); return v; }
+    FieldOp op() {
+        uint8_t v = 0;
+        raw(&v, 1);
+        if (v > static_cast<uint8_t>(FieldOp::Toggle)) ok = false;
+        return static_cast<FieldOp>(v);
+    }
+    void ids(std::vector<uint64_t>& out) {
+        uint32_t n = u32();
+        if (!ok || static_cast<size_t>(end - p) / 8 < n) { ok = false; return; }
+        out.resize(n);
+        raw(out.data(), size_t(n) * 8);
+    }
+    std::string str() {
+        uint32_t n = u32();
+        if (!ok || static_cast<size_t>(end - p) < n) { ok = false; return std::string(); }
+        std::string s(p, n);
+        p += n;
+        return s;
+    }
+};
+
+bool decode(JournalOp op, const char* p, size_t n, JournalEntry& e) {
+    Cursor c{ p, p + n };
+    e.op = op;
+    e.id = 0;
+    switch (op) {
+        case JournalOp::PutPipe: {
+            e.id = c.u64();
+            c.raw(&e.diameter, 8);
+            uint8_t r = 0;
+            c.raw(&r, 1);
+            e.in_repair = r != 0;
+            e.name = c.str();
+            e.input_station = e.output_station = 0;
+            if (c.ok && c.end - c.p == 16) {
+                e.input_station = c.u64();
+                e.output_station = c.u64();
+            }
+            break;
+        }
+        case JournalOp::PutStation: {
+            e.id = c.u64();
+            int32_t t = 0, w = 0;
+            c.raw(&t, 4);
+            c.raw(&w, 4);
+            e.total_workshops = t;
+            e.working_workshops = w;
+            e.name = c.str();
+            e.classification = c.str();
+            break;
+        }
+        case JournalOp::DelPipe:
+        case JournalOp::DelStation:
+            e.id = c.u64();
+            break;
+        case JournalOp::UpdatePipes: {
+            PipeUpdate& u = e.pipe_update;
+            u.name_op = c.op();
+            u.name = intern(c.str());
+            u.diameter_op = c.op();
+            u.diameter = c.f64();
+            u.repair_op = c.op();
+            uint8_t r = 0;
+            c.raw(&r, 1);
+            u.in_repair = r != 0;
+            c.ids(e.ids);
+            break;
+        }
+        case JournalOp::UpdateStations: {
+            StationUpdate& u = e.station_update;
+            u.name_op = c.op();
+            u.name = intern(c.str());
+            u.class_op = c.op();
+            // codes are per process, the journal stores the text
+            u.class_code = Dictionary::classifications().code(c.str());
+            u.total_op = c.op();
+            u.total = c.f64();
+            u.working_op = c.op();
+            u.working = c.f64();
+            c.ids(e.ids);
+            break;
+        }
+        default:
+            return false;
+    }
+    return c.ok && c.p == c.end;
+}
+
+bool syncFile(std::FILE* f) {
+    if (std::fflush(f) != 0) return false;
+#ifdef _WIN32
+    return _commit(_fileno(f)) == 0;
+#elif defined(__linux__)
+    return fdatasync(fileno(f)) == 0;
+#else
+    return fsync(fileno(f)) == 0;
+#endif
+}
+
+bool truncateFile(std::FILE* f, uint64_t size) {
+    std::fflush(f);
+#ifdef _WIN32
+    return _chsize_s(_fileno(f), static_cast<long long>(size)) == 0;
+#else
+    return ftruncate(fileno(f), static_cast<off_t>(size)) == 0;
+#endif
+}
+
+}
+
+size_t replayJournal(const std::string& path, uint64_t base,
+                     const std::function<void(const JournalEntry&)>& apply, uint64_t& valid_end) {
+    valid_end = 0;
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) return 0;
+    std::string buf;
+    char block[1 << 16];
+    size_t got;
+    while ((got = std::fread(block, 1, sizeof(block), f)) > 0) buf.append(block, got);
+    std::fclose(f);
+
+    if (buf.size() < kJournalHeader || std::memcmp(buf.data(), kJournalMagic, 8) != 0) return 0;
+    uint64_t file_base;
+    std::memcpy(&file_base, buf.data() + 8, 8);
+    if (file_base != base) return 0;
+
+    size_t pos = kJournalHeader;
+    size_t count = 0;
+    JournalEntry e;
+    while (buf.size() - pos >= kRecordHeader) {
+        uint32_t len, crc;
+        std::memcpy(&len, buf.data() + pos, 4);
+        std::memcpy(&crc, buf.data() + pos + 4, 4);
+        if (buf.size() - pos - kRecordHeader < len) break; // torn tail
+        const char* body = buf.data() + pos + 8; // op byte + payload
+        if (crc32Update(0, body, len + 1) != crc) break;
+        if (!decode(static_cast<JournalOp>(body[0]), body + 1, len, e)) break;
+        apply(e);
+        ++count;
+        pos += kRecordHeader + len;
+    }
+    valid_end = pos;
+    return count;
+}
+
+// === Journal
+Journal::Journal()
+    : file(nullptr), file_size(0), failed(false), interval_ms(2), group_bytes(1 << 20), stop(false) {}
+
+Journal::~Journal() {
+    close();
+}
+
+bool Journal::open(const std::string& path, uint64_t base, uint64_t valid_end, std::string& error) {
+    close();
+    file = std::fopen(path.c_str(), valid_end ? "r+b" : "w+b");
+    if (!file) { error = "cannot open journal"; return false; }
+    if (valid_end) {
+        // cut off a torn tail so new records follow the last good one
+        if (!truncateFile(file, valid_end) || std::fseek(file, 0, SEEK_END) != 0) {
+            close(); error = "cannot truncate journal"; return false;
+        }
+        file_size = valid_end;
+    } else if (!writeHeader(base)) {
+        close(); error = "cannot write journal header"; return false;
+    }
+    stop = false;
+    committer = std::thread(&Journal::run, this);
+    return true;
+}
+
+bool Journal::close() {
+    if (committer.joinable()) {
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            stop = true;
+        }
+        cv.notify_one();
+        committer.join();
+    }
+    std::lock_guard<std::mutex> lk(mtx);
+    bool ok = true;
+    if (file) {
+        ok = commitLocked();
+        std::fclose(file);
+        file = nullptr;
+    }
+    pending.clear();
+    file_size = 0;
+    failed = false;
+    return ok;
+}
+
+bool Journal::writeHeader(uint64_t base) {
+    char h[kJournalHeader];
+    std::memcpy(h, kJournalMagic, 8);
+    std::memcpy(h + 8, &base, 8);
+    if (!truncateFile(file, 0) || std::fseek(file, 0, SEEK_SET) != 0) return false;
+    if (std::fwrite(h, 1, sizeof(h), file) != sizeof(h) || !syncFile(file)) return false;
+    file_size = kJournalHeader;
+    return true;
+}
+
+void Journal::putPipe(const Pipe& p) {
+    scratch.clear();
+    putU64(scratch, p.getId());
+    double d = p.getDiameter();
+    putRaw(scratch, &d, 8);
+    uint8_t r = p.isInRepair() ? 1 : 0;
+    putRaw(scratch, &r, 1);
+    putStr(scratch, p.getName());
+    putU64(scratch, p.getInputStation());
+    putU64(scratch, p.getOutputStation());
+    append(JournalOp::PutPipe, scratch);
+}
+
+void Journal::putStation(const CompressorStation& s) {
+    scratch.clear();
+    putU64(scratch, s.getId());
+    int32_t t = s.getTotalWorkshops(), w = s.getWorkingWorkshops();
+    putRaw(scratch, &t, 4);
+    putRaw(scratch, &w, 4);
+    putStr(scratch, s.getName());
+    putStr(scratch, s.getClassification());
+    append(JournalOp::PutStation, scratch);
+}
+
+void Journal::delPipe(uint64_t id) {
+    scratch.clear();
+    putU64(scratch, id);
+    append(JournalOp::DelPipe, scratch);
+}
+
+void Journal::delStation(uint64_t id) {
+    scratch.clear();
+    putU64(scratch, id);
+    append(JournalOp::DelStation, scratch);
+}
+
+void Journal::updatePipes(const std::vector<uint64_t>& ids, const PipeUpdate& u) {
+    scratch.clear();
+    putOp(scratch, u.name_op);
+    putStr(scratch, u.name.view());
+    putOp(scratch, u.diameter_op);
+    putF64(scratch, u.diameter);
+    putOp(scratch, u.repair_op);
+    scratch.push_back(u.in_repair ? 1 : 0);
+    putIds(scratch, ids);
+    append(JournalOp::UpdatePipes, scratch);
+}
+
+void Journal::updateStations(const std::vector<uint64_t>& ids, const StationUpdate& u) {
+    scratch.clear();
+    putOp(scratch, u.name_op);
+    putStr(scratch, u.name.view());
+    putOp(scratch, u.class_op);
+    putStr(scratch, Dictionary::classifications().text(u.class_code));
+    putOp(scratch, u.total_op);
+    putF64(scratch, u.total);
+    putOp(scratch, u.working_op);
+    putF64(scratch, u.working);
+    putIds(scratch, ids);
+    append(JournalOp::UpdateStations, scratch);
+}
+
+void Journal::append(JournalOp op, const std::string& payload) {
+    std::lock_guard<std::mutex> lk(mtx);
+    if (!file) return;
+    uint32_t len = static_cast<uint32_t>(payload.size());
+    uint8_t opb = static_cast<uint8_t>(op);
+    uint32_t crc = crc32Update(crc32Update(0, &opb, 1), payload.data(), payload.size());
+    putU32(pending, len);
+    putU32(pending, crc);
+    pending.push_back(static_cast<char>(opb));
+    pending.append(payload);
+    if (interval_ms == 0 || pending.size() >= group_bytes) commitLocked();
+}
+
+bool Journal::commit() {
+    std::lock_guard<std::mutex> lk(mtx);
+    return commitLocked();
+}
+
+// A failed group stays pending and is written again by the next commit, after
+// whatever part of it reached the file is cut off.
+bool Journal::commitLocked() {
+    if (!file || pending.empty()) return true;
+    if (failed) {
+        std::clearerr(file);
+        if (!truncateFile(file, file_size) || std::fseek(file, 0, SEEK_END) != 0) return false;
+    }
+    failed = !(std::fwrite(pending.data(), 1, pending.size(), file) == pending.size() && syncFile(file));
+    if (failed) return false;
+    file_size += pending.size();
+    pending.clear();
+    return true;
+}
+
+bool Journal::reset(uint64_t base) {
+    std::lock_guard<std::mutex> lk(mtx);
+    if (!file) return false;
+    pending.clear();
+    failed = !writeHeader(base);
+    return !failed;
+}
+
+void Journal::setGroupCommit(unsigned intervalMs, size_t maxGroupBytes) {
+    std::lock_guard<std::mutex> lk(mtx);
+    interval_ms = intervalMs;
+    group_bytes = maxGroupBytes ? maxGroupBytes : 1;
+}
+
+bool Journal::failing() const {
+    std::lock_guard<std::mutex> lk(mtx);
+    return failed;
+}
+
+uint64_t Journal::size() const {
+    std::lock_guard<std::mutex> lk(mtx);
+    return file_size + pending.size();
+}
+
+void Journal::run() {
+    std::unique_lock<std::mutex> lk(mtx);
+    while (!stop) {
+        cv.wait_for(lk, std::chrono::milliseconds(interval_ms ? interval_ms : 50));
+        commitLocked();
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "Pipe.h"
+#include "CompressorStation.h"
+#include "BulkUpdate.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+// Journal file layout:
+//   header: magic "GTNWAL01", u64 checksum of the snapshot the journal applies to
+//   records: u32 payload length, u32 crc32(op + payload), u8 op, payload
+// PutPipe payloads end with the two station ids; records written before pipes
+// had endpoints lack them and replay as unconnected pipes.
+// Put / Del records carry after-images. Update records carry one bulk update
+// and its target ids; they may scale or toggle, so they rely on the base
+// checksum to be replayed exactly once on top of the snapshot they follow.
+
+enum class JournalOp : uint8_t {
+    PutPipe = 1, PutStation = 2, DelPipe = 3, DelStation = 4,
+    UpdatePipes = 5, UpdateStations = 6
+};
+
+// decoded journal record
+struct JournalEntry {
+    JournalOp op;
+    uint64_t id = 0;
+    std::string name;
+    double diameter = 0.0;
+    bool in_repair = false;
+    uint64_t input_station = 0;
+    uint64_t output_station = 0;
+    int total_workshops = 0;
+    int working_workshops = 0;
+    std::string classification;
+    // UpdatePipes / UpdateStations
+    std::vector<uint64_t> ids;
+    PipeUpdate pipe_update;
+    StationUpdate station_update;
+};
+
+// Replay the journal at path if it was written on top of snapshot `base`.
+// Stops at the first torn or corrupt record. valid_end receives the offset
+// just past the last good record, or 0 when the file is missing or belongs to
+// another snapshot. Returns the number of replayed records.
+size_t replayJournal(const std::string& path, uint64_t base,
+                     const std::function<void(const JournalEntry&)>& apply, uint64_t& valid_end);
+
+// Append-only journal with group commit: records are buffered and written
+// with one write + fsync either when the group fills up or when the
+// background committer's interval expires.
+class Journal {
+public:
+    Journal();
+    ~Journal();
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // valid_end from replayJournal; 0 starts a fresh journal for base
+    bool open(const std::string& path, uint64_t base, uint64_t valid_end, std::string& error);
+    // false if records were still unwritten and are lost
+    bool close();
+    bool isOpen() const { return file != nullptr; }
+
+    void putPipe(const Pipe& p);
+    void putStation(const CompressorStation& s);
+    void delPipe(uint64_t id);
+    void delStation(uint64_t id);
+    void updatePipes(const std::vector<uint64_t>& ids, const PipeUpdate& u);
+    void updateStations(const std::vector<uint64_t>& ids, const StationUpdate& u);
+
+    // write and fsync everything appended so far; on failure the records stay
+    // pending and the next commit writes them again
+    bool commit();
+    // drop all records and start over on top of a new snapshot
+    bool reset(uint64_t base);
+    // true from a failed write until a commit or reset succeeds: records
+    // appended meanwhile are in memory only
+    bool failing() const;
+
+    // intervalMs = 0 commits every record synchronously
+    void setGroupCommit(unsigned intervalMs, size_t maxGroupBytes);
+    uint64_t size() const; // bytes on disk plus pending
+
+private:
+    std::FILE* file;
+    uint64_t file_size; // bytes known to be on disk
+    bool failed;
+    std::string pending;
+    std::string scratch;
+    unsigned interval_ms;
+    size_t group_bytes;
+
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+    bool stop;
+    std::thread committer;
+
+    void append(JournalOp op, const std::string& payload);
+    bool commitLocked();
+    bool writeHeader(uint64_t base);
+    void run();
+};
+
+#endif // JOURNAL_H
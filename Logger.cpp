@@ -0,0 +1,200 @@
+#include "Logger.h"
+#include <chrono>
+#ifndef _WIN32
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+Logger::Logger(const std::string& filename_, LogDurability policy_, size_t fsyncEvery)
+    : ring(new Slot[kCapacity]), enqueue_pos(0), dequeue_pos(0),
+      filename(filename_), file(nullptr), cached_ts(static_cast<std::time_t>(-1)), cached_stamp_len(0),
+      policy(static_cast<int>(policy_)), fsync_every(fsyncEvery ? fsyncEvery : 1), unsynced(0),
+      stop(false), sleeping(false), flush_requested(0), flush_done(0) {
+    for (size_t i = 0; i < kCapacity; ++i) ring[i].seq.store(i, std::memory_order_relaxed);
+    batch.reserve(1 << 16);
+    writer = std::thread(&Logger::run, this);
+}
+
+Logger::~Logger() {
+    stop.store(true, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lk(wake_mtx);
+    }
+    wake_cv.notify_one();
+    if (writer.joinable()) writer.join();
+    closeFile();
+}
+
+void Logger::log(std::string_view msg) {
+    if (enabled()) push(Kind::Line, msg);
+}
+
+void Logger::setFilename(const std::string& filename_) {
+    push(Kind::Reopen, filename_);
+}
+
+void Logger::setDurability(LogDurability policy_, size_t fsyncEvery) {
+    fsync_every.store(fsyncEvery ? fsyncEvery : 1, std::memory_order_relaxed);
+    policy.store(static_cast<int>(policy_), std::memory_order_relaxed);
+}
+
+void Logger::flush() {
+    uint64_t ticket;
+    {
+        std::lock_guard<std::mutex> lk(flush_mtx);
+        ticket = ++flush_requested;
+    }
+    push(Kind::Flush, std::string_view());
+    std::unique_lock<std::mutex> lk(flush_mtx);
+    flush_cv.wait(lk, [&]{ return flush_done >= ticket; });
+}
+
+// === producer side (bounded MPMC ring, used here with a single consumer)
+void Logger::push(Kind kind, std::string_view text) {
+    std::time_t ts = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &ring[pos & kMask];
+        size_t seq = slot->seq.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            // ring is full: let the writer catch up instead of dropping records
+            wakeWriter();
+            std::this_thread::yield();
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        } else {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+    slot->kind = kind;
+    slot->ts = ts;
+    // the slot keeps its buffer, so steady-state logging does not allocate
+    slot->text.assign(text.data(), text.size());
+    slot->seq.store(pos + 1, std::memory_order_release);
+    if (kind != Kind::Line || sleeping.load(std::memory_order_acquire)) wakeWriter();
+}
+
+void Logger::wakeWriter() {
+    {
+        std::lock_guard<std::mutex> lk(wake_mtx);
+    }
+    wake_cv.notify_one();
+}
+
+// === writer side
+void Logger::run() {
+    while (true) {
+        if (drainBatch() > 0) continue;
+        if (stop.load(std::memory_order_acquire)) {
+            while (drainBatch() > 0) {}
+            break;
+        }
+        std::unique_lock<std::mutex> lk(wake_mtx);
+        sleeping.store(true, std::memory_order_seq_cst);
+        Slot& next = ring[dequeue_pos & kMask];
+        if (next.seq.load(std::memory_order_acquire) != dequeue_pos + 1 && !stop.load(std::memory_order_acquire)) {
+            // the timeout bounds latency if a producer misses the sleeping flag
+            wake_cv.wait_for(lk, std::chrono::milliseconds(50));
+        }
+        sleeping.store(false, std::memory_order_relaxed);
+    }
+}
+
+size_t Logger::drainBatch() {
+    size_t n = 0;
+    uint64_t flushes = 0;
+    LogDurability pol = static_cast<LogDurability>(policy.load(std::memory_order_relaxed));
+    size_t every = fsync_every.load(std::memory_order_relaxed);
+    while (n < kCapacity) {
+        Slot& slot = ring[dequeue_pos & kMask];
+        if (slot.seq.load(std::memory_order_acquire) != dequeue_pos + 1) break;
+        ++n;
+        switch (slot.kind) {
+            case Kind::Line:
+                appendStamp(slot.ts);
+                batch.append(" | ");
+                batch.append(slot.text);
+                batch.push_back('\n');
+                ++unsynced;
+                if (pol == LogDurability::FsyncEveryN && unsynced >= every) {
+                    writeBatch();
+                    syncFile();
+                }
+                break;
+            case Kind::Reopen:
+                writeBatch();
+                if (pol != LogDurability::None) syncFile();
+                closeFile();
+                filename = slot.text;
+                break;
+            case Kind::Flush:
+                writeBatch();
+                if (pol != LogDurability::None) syncFile();
+                ++flushes;
+                break;
+        }
+        slot.seq.store(dequeue_pos + kCapacity, std::memory_order_release);
+        ++dequeue_pos;
+    }
+    if (n > 0) {
+        writeBatch();
+        if (pol == LogDurability::PerBatch) syncFile();
+    }
+    if (flushes > 0) {
+        {
+            std::lock_guard<std::mutex> lk(flush_mtx);
+            flush_done += flushes;
+        }
+        flush_cv.notify_all();
+    }
+    return n;
+}
+
+void Logger::appendStamp(std::time_t ts) {
+    if (ts != cached_ts) {
+        std::tm tm;
+#ifdef _WIN32
+        localtime_s(&tm, &ts);
+#else
+        localtime_r(&ts, &tm);
+#endif
+        cached_stamp_len = std::strftime(cached_stamp, sizeof(cached_stamp), "%Y-%m-%d %H:%M:%S", &tm);
+        cached_ts = ts;
+    }
+    batch.append(cached_stamp, cached_stamp_len);
+}
+
+void Logger::writeBatch() {
+    if (batch.empty()) return;
+    if (!file) openFile();
+    if (file) {
+        std::fwrite(batch.data(), 1, batch.size(), file);
+        std::fflush(file);
+    }
+    batch.clear();
+}
+
+void Logger::syncFile() {
+    unsynced = 0;
+    if (!file) return;
+#ifdef _WIN32
+    _commit(_fileno(file));
+#else
+    fsync(fileno(file));
+#endif
+}
+
+void Logger::openFile() {
+    file = std::fopen(filename.c_str(), "ab");
+    // the batch buffer already groups writes, stdio buffering would only copy again
+    if (file) std::setvbuf(file, nullptr, _IONBF, 0);
+}
+
+void Logger::closeFile() {
+    if (file) std::fclose(file);
+    file = nullptr;
+}
@@ -0,0 +1,129 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <type_traits>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <ctime>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+
+// when the writer thread forces log data to disk
+enum class LogDurability {
+    None,        // write(2) per batch, leave flushing to the OS
+    PerBatch,    // fsync after every written batch
+    FsyncEveryN  // fsync after every N records
+};
+
+// Pieces of a log message, appended without temporaries: text, characters,
+// integers and doubles (std::to_chars), and any type with appendTo(std::string&).
+inline void logAppend(std::string& out, std::string_view s) { out.append(s); }
+inline void logAppend(std::string& out, const char* s) { out.append(s); }
+inline void logAppend(std::string& out, char c) { out.push_back(c); }
+inline void logAppend(std::string& out, double v) {
+    char buf[32];
+    out.append(buf, std::to_chars(buf, buf + sizeof(buf), v).ptr);
+}
+template <typename T>
+inline std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool> && !std::is_same_v<T, char>>
+logAppend(std::string& out, T v) {
+    char buf[24];
+    out.append(buf, std::to_chars(buf, buf + sizeof(buf), v).ptr);
+}
+template <typename T>
+inline auto logAppend(std::string& out, const T& v) -> decltype(v.appendTo(out), void()) { v.appendTo(out); }
+
+// Asynchronous action log. Producers push records into a bounded lock-free
+// ring (multi-producer / single-consumer); a background writer keeps the file
+// open, formats timestamps once per second and writes records in batches.
+class Logger {
+public:
+    explicit Logger(const std::string& filename, LogDurability policy = LogDurability::None, size_t fsyncEvery = 64);
+    ~Logger();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    // enqueue one line; the timestamp is taken now, formatting happens on the writer
+    void log(std::string_view msg);
+    // concatenate parts (see logAppend) into a reusable per-thread buffer and
+    // enqueue that; while disabled nothing is formatted at all
+    template <typename... Parts>
+    void logParts(const Parts&... parts) {
+        if (!enabled()) return;
+        thread_local std::string line;
+        line.clear();
+        (logAppend(line, parts), ...);
+        log(line);
+    }
+    // disabled loggers drop lines (reopen and flush requests still apply)
+    bool enabled() const { return on.load(std::memory_order_relaxed); }
+    void setEnabled(bool enabled_) { on.store(enabled_, std::memory_order_relaxed); }
+
+    // records queued before this call go to the old file, later ones to the new file
+    void setFilename(const std::string& filename);
+    void setDurability(LogDurability policy, size_t fsyncEvery = 64);
+
+    // block until every record queued so far is written (and synced per policy)
+    void flush();
+
+private:
+    enum class Kind : uint8_t { Line, Reopen, Flush };
+
+    struct Slot {
+        std::atomic<size_t> seq;
+        Kind kind;
+        std::time_t ts;
+        std::string text;
+    };
+
+    static constexpr size_t kCapacity = 8192; // power of two
+    static constexpr size_t kMask = kCapacity - 1;
+
+    std::unique_ptr<Slot[]> ring;
+    alignas(64) std::atomic<size_t> enqueue_pos;
+    alignas(64) size_t dequeue_pos; // writer thread only
+
+    std::string filename;       // writer thread only (after construction)
+    std::FILE* file;            // writer thread only
+    std::string batch;          // reusable output buffer
+    std::time_t cached_ts;
+    char cached_stamp[32];
+    size_t cached_stamp_len;
+
+    std::atomic<int> policy;
+    std::atomic<size_t> fsync_every;
+    size_t unsynced;
+
+    std::atomic<bool> on{true};
+    std::atomic<bool> stop;
+    std::atomic<bool> sleeping;
+    std::mutex wake_mtx;
+    std::condition_variable wake_cv;
+
+    std::mutex flush_mtx;
+    std::condition_variable flush_cv;
+    uint64_t flush_requested; // guarded by flush_mtx
+    uint64_t flush_done;      // guarded by flush_mtx
+
+    std::thread writer;
+
+    void push(Kind kind, std::string_view text);
+    void wakeWriter();
+    void run();
+    size_t drainBatch();
+    void writeBatch();
+    void syncFile();
+    void openFile();
+    void closeFile();
+    void appendStamp(std::time_t ts);
+};
+
+#endif // LOGGER_H
@@ -1,207 +1,1754 @@
 #include "Manager.h"
-#include <fstream>
-#include <iostream>
+#include "Snapshot.h"
+#include "TextLoader.h"
+#include "FilterKernels.h"
+#include <charconv>
 #include <chrono>
-#include <ctime>
-#include <iomanip>
-#include <sstream>
+#include <cstdio>
+#include <iostream>
 #include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <atomic>
+
+namespace {
+
+// default metrics label: managers are numbered in construction order
+std::atomic<unsigned> manager_seq{0};
+
+bool fileExists(const std::string& path) {
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) return false;
+    std::fclose(f);
+    return true;
+}
 
-Manager::Manager() : next_id(1), log_filename("actions.log") {}
-Manager::Manager(const std::string& logFile) : next_id(1), log_filename(logFile) {}
+// history timestamps: milliseconds since the epoch
+int64_t nowMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+}
+
+Manager::Manager() : next_id(1), log_filename("actions.log"), logger(std::make_shared<Logger>(log_filename)), checkpoint_bytes(64u << 20) { registerMetrics(); }
+Manager::Manager(const std::string& logFile) : next_id(1), log_filename(logFile), logger(std::make_shared<Logger>(log_filename)), checkpoint_bytes(64u << 20) { registerMetrics(); }
+Manager::Manager(std::shared_ptr<Logger> sharedLogger) : next_id(1), logger(std::move(sharedLogger)), checkpoint_bytes(64u << 20) { registerMetrics(); }
+
+Manager::~Manager() {
+    background_save.reset();
+    metrics_dumper.reset();
+    Metrics::global().removeGauges(&gauges);
+    closeJournal();
+}
 
 void Manager::setLogFilename(const std::string& filename) {
     log_filename = filename;
-    logAction("Log filename changed to: " + filename);
+    logger->setFilename(filename);
+    logAction("Log filename changed to: ", filename);
+}
+
+void Manager::setLogDurability(LogDurability policy, size_t fsyncEvery) {
+    logger->setDurability(policy, fsyncEvery);
+}
+
+void Manager::flushLog() {
+    logger->flush();
 }
 
 // public wrapper to allow logging from outside
-void Manager::writeLog(const std::string& msg) {
+void Manager::writeLog(const std::string& msg) const {
     logAction(msg);
 }
 
 uint64_t Manager::makeId() {
-    uint64_t id = next_id++;
+    uint64_t id = next_id;
+    next_id += id_stride;
     return id;
 }
 
-void Manager::logAction(const std::string& msg) {
-    std::ofstream os(log_filename, std::ios::app);
-    if (!os) return;
-    auto now = std::chrono::system_clock::now();
-    std::time_t tt = std::chrono::system_clock::to_time_t(now);
-    std::tm tm;
-#ifdef _WIN32
-    localtime_s(&tm, &tt);
-#else
-    localtime_r(&tt, &tm);
-#endif
-    os << std::put_time(&tm, "%Y-%m-%d %H:%M:%S") << " | " << msg << "\n";
-    os.close();
+void Manager::setIdSequence(uint64_t first, uint64_t stride) {
+    id_stride = stride ? stride : 1;
+    id_residue = first % id_stride;
+    next_id = std::max(next_id, first);
+    alignNextId();
+}
+
+// move next_id forward onto this manager's id sequence
+void Manager::alignNextId() {
+    while (next_id % id_stride != id_residue) ++next_id;
+}
+
+// === index maintenance
+void Manager::indexPipe(uint32_t slot, const Pipe& p) {
+    if (track_versions) dirty_pipes.push_back(p.getId());
+    pipe_cols.set(slot, p);
+    if (bulk || rebuilding) names_stale = true;
+    if (!names_stale) pipe_names.insert(p.getId(), pipe_cols.folded[slot]);
+    aggregates.addPipe(p);
+    if (p.isConnected()) {
+        auto in = station_slots.find(p.getInputStation());
+        auto out = station_slots.find(p.getOutputStation());
+        if (in != station_slots.end() && out != station_slots.end()) topology.connect(slot, in->second.index, out->second.index);
+    }
+    syncService(slot);
+}
+
+void Manager::unindexPipe(uint32_t slot, const Pipe& p) {
+    if (track_versions) dirty_pipes.push_back(p.getId());
+    if (!names_stale) pipe_names.erase(p.getId(), pipe_cols.folded[slot]);
+    pipe_cols.unset(slot);
+    aggregates.removePipe(p);
+    topology.disconnect(slot);
+}
+
+void Manager::indexStation(uint32_t slot, const CompressorStation& s) {
+    if (track_versions) dirty_stations.push_back(s.getId());
+    station_cols.set(slot, s);
+    if (bulk || rebuilding) names_stale = true;
+    if (!names_stale) station_names.insert(s.getId(), station_cols.folded[slot]);
+    station_idle.emplace(s.percentIdle(), s.getId());
+    aggregates.addStation(s);
+    if (bulk) service_stale = true;
+    else if (!rebuilding) service.addVertex(slot);
+    // unchanged workshops (a rename, a rebuild) record nothing
+    if (record_history) history.record(s.getId(), nowMs(), s.getWorkingWorkshops(), s.getTotalWorkshops());
+}
+
+void Manager::unindexStation(uint32_t slot, const CompressorStation& s) {
+    if (track_versions) dirty_stations.push_back(s.getId());
+    if (!names_stale) station_names.erase(s.getId(), station_cols.folded[slot]);
+    station_idle.erase(std::make_pair(s.percentIdle(), s.getId()));
+    station_cols.unset(slot);
+    aggregates.removeStation(s);
+}
+
+// The name indexes are left to the next name lookup (see pipeNames()): a
+// load returns without paying for them.
+void Manager::rebuildIndexes() {
+    // entities are unchanged, so the published versions need nothing new
+    bool tracking = track_versions;
+    track_versions = false;
+    pipe_names.clear();
+    pipe_cols.clear();
+    station_names.clear();
+    station_idle.clear();
+    station_cols.clear();
+    topology.clear();
+    aggregates.clear();
+    rebuilding = true;
+    for (auto it = pipes.begin(); it != pipes.end(); ++it) indexPipe(it.slotIndex(), *it);
+    for (auto it = stations.begin(); it != stations.end(); ++it) indexStation(it.slotIndex(), *it);
+    rebuilding = false;
+    pipe_cols.forgetDead();
+    station_cols.forgetDead();
+    topology.compact();
+    rebuildService();
+    track_versions = tracking;
+}
+
+// Brings the pipe's edge in the service graph in line with the topology and
+// its repair flag. unindexPipe() leaves the edge alone so that an edit which
+// keeps the pipe in service does not delete and re-insert it; callers that
+// take a pipe out without indexing it again (erasePipe) call this afterwards.
+void Manager::syncService(uint32_t slot) {
+    if (bulk) service_stale = true;
+    if (rebuilding || bulk) return;
+    bool active = topology.connected(slot) && !pipe_cols.repair.test(slot);
+    if (service.contains(slot)) {
+        if (active && service.endpointU(slot) == topology.source(slot) && service.endpointV(slot) == topology.target(slot)) return;
+        service.erase(slot);
+    }
+    if (active) service.insert(slot, topology.source(slot), topology.target(slot));
+}
+
+// union-find over the whole network instead of one update per pipe
+void Manager::rebuildService() const {
+    std::vector<uint32_t> vertices;
+    vertices.reserve(stations.size());
+    for (auto it = stations.begin(); it != stations.end(); ++it) vertices.push_back(it.slotIndex());
+    std::vector<Connectivity::EdgeSpec> edges;
+    edges.reserve(topology.edgeCount());
+    for (uint32_t e = 0; e < topology.edgeBound(); ++e) {
+        if (topology.connected(e) && !pipe_cols.repair.test(e)) edges.push_back({ e, topology.source(e), topology.target(e) });
+    }
+    service.build(vertices, edges);
+    service_stale = false;
+}
+
+const Connectivity& Manager::inService() const {
+    if (service_stale) rebuildService();
+    return service;
+}
+
+// both name indexes from the columns, dropping stale entries on the way
+void Manager::rebuildNames() const {
+    rebuildPipeNames();
+    rebuildStationNames();
+    names_stale = false;
+}
+
+// One index alone, once erased names pile up (needsRebuild()); the other
+// indexes are kept up to date by the hooks and are left alone.
+void Manager::rebuildPipeNames() const {
+    pipe_names.clear();
+    for (auto it = pipes.begin(); it != pipes.end(); ++it) pipe_names.insert(it->getId(), pipe_cols.folded[it.slotIndex()]);
+}
+
+void Manager::rebuildStationNames() const {
+    station_names.clear();
+    for (auto it = stations.begin(); it != stations.end(); ++it) station_names.insert(it->getId(), station_cols.folded[it.slotIndex()]);
+}
+
+const TrigramIndex& Manager::pipeNames() const {
+    if (names_stale) rebuildNames();
+    return pipe_names;
+}
+
+const TrigramIndex& Manager::stationNames() const {
+    if (names_stale) rebuildNames();
+    return station_names;
+}
+
+void Manager::logComponents(size_t before) const {
+    size_t after = service.components();
+    if (after != before) logAction("Network components ", before, " -> ", after);
+}
+
+// storage primitives: slot + id index + secondary indexes + journal, no action log
+SlotHandle Manager::insertPipe(Pipe p) {
+    uint64_t id = p.getId();
+    SlotHandle h = pipes.insert(std::move(p));
+    pipe_slots[id] = h;
+    const Pipe& stored = *pipes.get(h);
+    indexPipe(h.index, stored);
+    if (journal) { journal->putPipe(stored); maybeCheckpoint(); }
+    refreshGauges();
+    return h;
+}
+
+bool Manager::erasePipe(uint64_t id) {
+    auto it = pipe_slots.find(id);
+    if (it == pipe_slots.end()) return false;
+    unindexPipe(it->second.index, *pipes.get(it->second));
+    pipe_cols.forget(it->second.index);
+    syncService(it->second.index);
+    pipes.erase(it->second);
+    pipe_slots.erase(it);
+    if (pipe_names.needsRebuild()) rebuildPipeNames();
+    if (journal) { journal->delPipe(id); maybeCheckpoint(); }
+    refreshGauges();
+    return true;
+}
+
+SlotHandle Manager::insertStation(CompressorStation s) {
+    uint64_t id = s.getId();
+    SlotHandle h = stations.insert(std::move(s));
+    station_slots[id] = h;
+    const CompressorStation& stored = *stations.get(h);
+    indexStation(h.index, stored);
+    if (journal) { journal->putStation(stored); maybeCheckpoint(); }
+    refreshGauges();
+    return h;
+}
+
+bool Manager::eraseStation(uint64_t id) {
+    auto it = station_slots.find(id);
+    if (it == station_slots.end()) return false;
+    // Pipes at the station are disconnected here rather than journaled one by
+    // one: replaying the station's Del record repeats it.
+    uint32_t v = it->second.index;
+    std::vector<uint32_t> attached(topology.outEdges(v), topology.outEdges(v) + topology.outDegree(v));
+    attached.insert(attached.end(), topology.inEdges(v), topology.inEdges(v) + topology.inDegree(v));
+    for (uint32_t slot : attached) {
+        Pipe& p = pipes.at(slot);
+        if (!p.isConnected()) continue; // a pipe from the station back to itself is listed twice
+        unindexPipe(slot, p);
+        p.disconnect();
+        indexPipe(slot, p);
+    }
+    unindexStation(it->second.index, *stations.get(it->second));
+    station_cols.forget(v);
+    if (bulk) service_stale = true;
+    else service.removeVertex(v);
+    stations.erase(it->second);
+    station_slots.erase(it);
+    history.erase(id);
+    if (station_names.needsRebuild()) rebuildStationNames();
+    if (journal) { journal->delStation(id); maybeCheckpoint(); }
+    refreshGauges();
+    return true;
+}
+
+// apply edit to one pipe between the unindex/index hooks
+template <typename F>
+bool Manager::editPipe(uint64_t id, F edit) {
+    SlotHandle h = findPipeHandle(id);
+    Pipe* p = pipes.get(h);
+    if (!p) return false;
+    unindexPipe(h.index, *p);
+    edit(*p);
+    indexPipe(h.index, *p);
+    if (pipe_names.needsRebuild()) rebuildPipeNames();
+    if (journal) { journal->putPipe(*pipes.get(h)); maybeCheckpoint(); }
+    refreshGauges();
+    return true;
+}
+
+template <typename F>
+bool Manager::editStation(uint64_t id, F edit) {
+    SlotHandle h = findStationHandle(id);
+    CompressorStation* s = stations.get(h);
+    if (!s) return false;
+    unindexStation(h.index, *s);
+    edit(*s);
+    indexStation(h.index, *s);
+    if (station_names.needsRebuild()) rebuildStationNames();
+    if (journal) { journal->putStation(*stations.get(h)); maybeCheckpoint(); }
+    refreshGauges();
+    return true;
 }
 
 // === Pipes
 uint64_t Manager::addPipe(const std::string& name, double diameter, bool in_repair) {
+    MetricTimer timer(MetricOp::AddPipe);
     uint64_t id = makeId();
-    pipes.emplace_back(id, name, diameter, in_repair);
-    logAction("Added pipe id=" + std::to_string(id) + " name=\"" + name + "\" diameter=" + std::to_string(diameter) + " in_repair=" + (in_repair ? "1":"0"));
+    insertPipe(Pipe(id, name, diameter, in_repair));
+    logAction("Added pipe id=", id, " name=\"", name, "\" diameter=", diameter, " in_repair=", (in_repair ? "1":"0"));
     return id;
 }
 
 bool Manager::removePipeById(uint64_t id) {
-    auto it = std::find_if(pipes.begin(), pipes.end(), [id](const Pipe& p){ return p.getId() == id; });
-    if (it == pipes.end()) return false;
-    logAction("Removed pipe id=" + std::to_string(it->getId()) + " name=\"" + it->getName() + "\"");
-    pipes.erase(it);
-    return true;
+    MetricTimer timer(MetricOp::RemovePipe);
+    auto it = pipe_slots.find(id);
+    if (it == pipe_slots.end()) return timer.result(false);
+    const Pipe* p = pipes.get(it->second);
+    logAction("Removed pipe id=", p->getId(), " name=\"", p->getName(), "\"");
+    return timer.result(erasePipe(id));
+}
+
+const Pipe* Manager::findPipeById(uint64_t id) const {
+    MetricTimer timer(MetricOp::FindPipe);
+    return timer.result(getPipe(findPipeHandle(id)));
+}
+
+SlotHandle Manager::findPipeHandle(uint64_t id) const {
+    auto it = pipe_slots.find(id);
+    return it == pipe_slots.end() ? SlotHandle{} : it->second;
+}
+
+const Pipe* Manager::getPipe(SlotHandle h) const {
+    return pipes.get(h);
+}
+
+bool Manager::setPipeName(uint64_t id, const std::string& name) {
+    MetricTimer timer(MetricOp::SetPipeName);
+    return timer.result(editPipe(id, [&](Pipe& p){ p.setName(name); }));
 }
 
-Pipe* Manager::findPipeById(uint64_t id) {
-    for (auto &p : pipes) if (p.getId() == id) return &p;
-    return nullptr;
+bool Manager::setPipeDiameter(uint64_t id, double diameter) {
+    MetricTimer timer(MetricOp::SetPipeDiameter);
+    return timer.result(editPipe(id, [&](Pipe& p){ p.setDiameter(diameter); }));
 }
 
-std::vector<Pipe*> Manager::findPipesByName(const std::string& substring) {
-    std::vector<Pipe*> res;
-    for (auto &p : pipes) {
-        if (p.getName().find(substring) != std::string::npos) res.push_back(&p);
+bool Manager::setPipeInRepair(uint64_t id, bool in_repair) {
+    MetricTimer timer(MetricOp::SetPipeInRepair);
+    size_t before = service.components();
+    bool ok = editPipe(id, [&](Pipe& p){ p.setInRepair(in_repair); });
+    logComponents(before);
+    return timer.result(ok);
+}
+
+std::vector<const Pipe*> Manager::findPipesByName(const std::string& substring, NameMatch match) const {
+    MetricTimer timer(MetricOp::FindPipesByName);
+    std::vector<const Pipe*> res;
+    bool ignoreCase = match == NameMatch::IgnoreCase;
+    // the index holds folded names, so the folded pattern narrows both modes
+    std::string folded;
+    bool indexable = foldCase(substring, folded) || ignoreCase;
+    std::string_view pattern = ignoreCase ? std::string_view(folded) : std::string_view(substring);
+    const std::vector<InternedString>& names = ignoreCase ? pipe_cols.folded : pipe_cols.name;
+    std::vector<uint64_t> candidates;
+    if (indexable && pipeNames().lookup(folded, candidates)) {
+        // the index may return stale ids, verify each candidate
+        res.reserve(candidates.size());
+        for (uint64_t id : candidates) {
+            SlotHandle h = findPipeHandle(id);
+            const Pipe* p = getPipe(h);
+            if (p && findSubstring(names[h.index], pattern) != std::string_view::npos) res.push_back(p);
+        }
+    } else {
+        // short pattern: scan the name column instead of whole records
+        pipe_cols.live.forEach([&](uint32_t slot){
+            if (findSubstring(names[slot], pattern) != std::string_view::npos) res.push_back(&pipes.at(slot));
+        });
     }
-    logAction("Searched pipes by name=\"" + substring + "\" -> " + std::to_string(res.size()) + " found");
+    logAction("Searched pipes by name=\"", substring, ignoreCase ? "\" (ignore case) -> " : "\" -> ", res.size(), " found");
     return res;
 }
 
-std::vector<Pipe*> Manager::findPipesByRepairFlag(bool in_repair) {
-    std::vector<Pipe*> res;
-    for (auto &p : pipes) {
-        if (p.isInRepair() == in_repair) res.push_back(&p);
+std::vector<const Pipe*> Manager::findPipesByRepairFlag(bool in_repair) const {
+    MetricTimer timer(MetricOp::FindPipesByRepair);
+    std::vector<const Pipe*> res;
+    if (in_repair) {
+        res.reserve(pipe_cols.repair.count());
+        pipe_cols.repair.forEach([&](uint32_t slot){ res.push_back(&pipes.at(slot)); });
+    } else {
+        res.reserve(pipe_cols.live.count() - pipe_cols.repair.count());
+        pipe_cols.live.forEachAndNot(pipe_cols.repair, [&](uint32_t slot){ res.push_back(&pipes.at(slot)); });
     }
-    logAction("Searched pipes by in_repair=" + std::string(in_repair ? "1":"0") + " -> " + std::to_string(res.size()) + " found");
+    logAction("Searched pipes by in_repair=", in_repair ? "1":"0", " -> ", res.size(), " found");
     return res;
 }
 
-const std::vector<Pipe>& Manager::getPipes() const { return pipes; }
+std::vector<const Pipe*> Manager::findPipesByDiameterRange(double minDiameter, double maxDiameter) const {
+    MetricTimer timer(MetricOp::FindPipesByDiameter);
+    std::vector<uint32_t> sel;
+    selectDiameterRange(pipe_cols, minDiameter, maxDiameter, sel);
+    std::vector<const Pipe*> res;
+    res.reserve(sel.size());
+    for (uint32_t slot : sel) res.push_back(&pipes.at(slot));
+    logAction("Searched pipes by diameter in [", minDiameter, ", ", maxDiameter, "] -> ", res.size(), " found");
+    return res;
+}
+
+size_t Manager::countPipesInRepair() const { return pipe_cols.repair.count(); }
+
+const SlotMap<Pipe>& Manager::getPipes() const { return pipes; }
 
 // === Stations
 uint64_t Manager::addStation(const std::string& name, int total, int working, const std::string& classification) {
+    MetricTimer timer(MetricOp::AddStation);
     uint64_t id = makeId();
-    stations.emplace_back(id, name, total, working, classification);
-    logAction("Added station id=" + std::to_string(id) + " name=\"" + name + "\" total=" + std::to_string(total) + " working=" + std::to_string(working));
+    insertStation(CompressorStation(id, name, total, working, classification));
+    logAction("Added station id=", id, " name=\"", name, "\" total=", total, " working=", working);
     return id;
 }
 
 bool Manager::removeStationById(uint64_t id) {
-    auto it = std::find_if(stations.begin(), stations.end(), [id](const CompressorStation& s){ return s.getId() == id; });
-    if (it == stations.end()) return false;
-    logAction("Removed station id=" + std::to_string(it->getId()) + " name=\"" + it->getName() + "\"");
-    stations.erase(it);
+    MetricTimer timer(MetricOp::RemoveStation);
+    auto it = station_slots.find(id);
+    if (it == station_slots.end()) return timer.result(false);
+    const CompressorStation* s = stations.get(it->second);
+    logAction("Removed station id=", s->getId(), " name=\"", s->getName(), "\"");
+    return timer.result(eraseStation(id));
+}
+
+const CompressorStation* Manager::findStationById(uint64_t id) const {
+    MetricTimer timer(MetricOp::FindStation);
+    return timer.result(getStation(findStationHandle(id)));
+}
+
+SlotHandle Manager::findStationHandle(uint64_t id) const {
+    auto it = station_slots.find(id);
+    return it == station_slots.end() ? SlotHandle{} : it->second;
+}
+
+const CompressorStation* Manager::getStation(SlotHandle h) const {
+    return stations.get(h);
+}
+
+bool Manager::setStationName(uint64_t id, const std::string& name) {
+    MetricTimer timer(MetricOp::SetStationName);
+    return timer.result(editStation(id, [&](CompressorStation& s){ s.setName(name); }));
+}
+
+bool Manager::setStationTotalWorkshops(uint64_t id, int total) {
+    MetricTimer timer(MetricOp::SetStationTotal);
+    return timer.result(editStation(id, [&](CompressorStation& s){ s.setTotalWorkshops(total); }));
+}
+
+bool Manager::setStationWorkingWorkshops(uint64_t id, int working) {
+    MetricTimer timer(MetricOp::SetStationWorking);
+    return timer.result(editStation(id, [&](CompressorStation& s){ s.setWorkingWorkshops(working); }));
+}
+
+bool Manager::setStationClassification(uint64_t id, const std::string& classification) {
+    MetricTimer timer(MetricOp::SetStationClassification);
+    return timer.result(editStation(id, [&](CompressorStation& s){ s.setClassification(classification); }));
+}
+
+std::vector<const CompressorStation*> Manager::findStationsByName(const std::string& substring, NameMatch match) const {
+    MetricTimer timer(MetricOp::FindStationsByName);
+    std::vector<const CompressorStation*> res;
+    bool ignoreCase = match == NameMatch::IgnoreCase;
+    std::string folded;
+    bool indexable = foldCase(substring, folded) || ignoreCase;
+    std::string_view pattern = ignoreCase ? std::string_view(folded) : std::string_view(substring);
+    const std::vector<InternedString>& names = ignoreCase ? station_cols.folded : station_cols.name;
+    std::vector<uint64_t> candidates;
+    if (indexable && stationNames().lookup(folded, candidates)) {
+        res.reserve(candidates.size());
+        for (uint64_t id : candidates) {
+            SlotHandle h = findStationHandle(id);
+            const CompressorStation* s = getStation(h);
+            if (s && findSubstring(names[h.index], pattern) != std::string_view::npos) res.push_back(s);
+        }
+    } else {
+        station_cols.live.forEach([&](uint32_t slot){
+            if (findSubstring(names[slot], pattern) != std::string_view::npos) res.push_back(&stations.at(slot));
+        });
+    }
+    logAction("Searched stations by name=\"", substring, ignoreCase ? "\" (ignore case) -> " : "\" -> ", res.size(), " found");
+    return res;
+}
+
+std::vector<const CompressorStation*> Manager::findStationsByIdlePercent(double minIdlePercent) const {
+    MetricTimer timer(MetricOp::FindStationsByIdle);
+    std::vector<const CompressorStation*> res;
+    // station_idle is ordered by (percentIdle, id): everything from lower_bound on qualifies
+    for (auto it = station_idle.lower_bound(std::make_pair(minIdlePercent, uint64_t(0))); it != station_idle.end(); ++it) {
+        res.push_back(getStation(findStationHandle(it->second)));
+    }
+    logAction("Searched stations by minIdlePercent=", minIdlePercent, " -> ", res.size(), " found");
+    return res;
+}
+
+std::vector<const CompressorStation*> Manager::findStationsByIdleRange(double minIdlePercent, double maxIdlePercent) const {
+    MetricTimer timer(MetricOp::FindStationsByIdleRange);
+    std::vector<const CompressorStation*> res;
+    auto it = station_idle.lower_bound(std::make_pair(minIdlePercent, uint64_t(0)));
+    for (; it != station_idle.end() && it->first <= maxIdlePercent; ++it) {
+        res.push_back(getStation(findStationHandle(it->second)));
+    }
+    logAction("Searched stations by idlePercent in [", minIdlePercent, ", ", maxIdlePercent, "] -> ", res.size(), " found");
+    return res;
+}
+
+const SlotMap<CompressorStation>& Manager::getStations() const { return stations; }
+
+// === network
+bool Manager::connectPipe(uint64_t pipeId, uint64_t inputStationId, uint64_t outputStationId) {
+    MetricTimer timer(MetricOp::ConnectPipe);
+    if (inputStationId == outputStationId || !station_slots.count(inputStationId) || !station_slots.count(outputStationId)) {
+        logAction("Failed to connect pipe id=", pipeId, ": stations ", inputStationId, " -> ", outputStationId, " not found or equal");
+        return timer.result(false);
+    }
+    if (!editPipe(pipeId, [&](Pipe& p){ p.connect(inputStationId, outputStationId); })) return timer.result(false);
+    logAction("Connected pipe id=", pipeId, " station ", inputStationId, " -> station ", outputStationId);
+    return true;
+}
+
+bool Manager::disconnectPipe(uint64_t pipeId) {
+    MetricTimer timer(MetricOp::DisconnectPipe);
+    const Pipe* p = getPipe(findPipeHandle(pipeId));
+    if (!p || !p->isConnected()) return timer.result(false);
+    editPipe(pipeId, [](Pipe& q){ q.disconnect(); });
+    logAction("Disconnected pipe id=", pipeId);
     return true;
 }
 
-CompressorStation* Manager::findStationById(uint64_t id) {
-    for (auto &s : stations) if (s.getId() == id) return &s;
-    return nullptr;
+std::vector<const Pipe*> Manager::findPipesByStation(uint64_t stationId) const {
+    MetricTimer timer(MetricOp::FindPipesByStation);
+    std::vector<const Pipe*> res;
+    SlotHandle h = findStationHandle(stationId);
+    if (stations.contains(h)) {
+        uint32_t v = h.index;
+        for (size_t i = 0; i < topology.outDegree(v); ++i) res.push_back(&pipes.at(topology.outEdges(v)[i]));
+        for (size_t i = 0; i < topology.inDegree(v); ++i) res.push_back(&pipes.at(topology.inEdges(v)[i]));
+        std::sort(res.begin(), res.end(), [](const Pipe* a, const Pipe* b){ return a->getId() < b->getId(); });
+        res.erase(std::unique(res.begin(), res.end()), res.end());
+    }
+    logAction("Searched pipes by station id=", stationId, " -> ", res.size(), " found");
+    return res;
+}
+
+// relative throughput: the pipe's cross-section area
+double Manager::pipeCapacity(double diameter) {
+    return diameter > 0.0 ? 0.78539816339744831 * diameter * diameter : 0.0;
+}
+
+FlowResult Manager::maxFlow(uint64_t sourceStationId, uint64_t sinkStationId) const {
+    MetricTimer timer(MetricOp::MaxFlow);
+    SlotHandle s = findStationHandle(sourceStationId), t = findStationHandle(sinkStationId);
+    FlowResult res;
+    if (stations.contains(s) && stations.contains(t)) {
+        std::vector<double> capacity(topology.edgeBound(), 0.0);
+        for (uint32_t e = 0; e < topology.edgeBound(); ++e) {
+            if (topology.connected(e) && !pipe_cols.repair.test(e)) capacity[e] = pipeCapacity(pipe_cols.diameter[e]);
+        }
+        res = ::maxFlow(topology, capacity, s.index, t.index);
+        for (uint64_t& e : res.cut) e = pipes.at(uint32_t(e)).getId();
+        std::sort(res.cut.begin(), res.cut.end());
+    }
+    logAction("Max flow station ", sourceStationId, " -> station ", sinkStationId, " = ", res.flow, " cut=", res.cut.size(), " pipes");
+    return res;
+}
+
+const Topology& Manager::getTopology() const { return topology; }
+
+bool Manager::stationsConnected(uint64_t stationA, uint64_t stationB) const {
+    MetricTimer timer(MetricOp::StationsConnected);
+    SlotHandle a = findStationHandle(stationA), b = findStationHandle(stationB);
+    if (!stations.contains(a) || !stations.contains(b)) return timer.result(false);
+    return timer.result(inService().connected(a.index, b.index));
+}
+
+std::vector<const CompressorStation*> Manager::findIsolatedStations() const {
+    MetricTimer timer(MetricOp::FindIsolatedStations);
+    std::vector<const CompressorStation*> res;
+    const std::vector<uint32_t>& isolated = inService().isolated();
+    res.reserve(isolated.size());
+    for (uint32_t slot : isolated) res.push_back(&stations.at(slot));
+    std::sort(res.begin(), res.end(), [](const CompressorStation* a, const CompressorStation* b){ return a->getId() < b->getId(); });
+    logAction("Searched isolated stations -> ", res.size(), " found");
+    return res;
+}
+
+std::vector<const CompressorStation*> Manager::findConnectedStations(uint64_t stationId) const {
+    MetricTimer timer(MetricOp::FindConnectedStations);
+    std::vector<const CompressorStation*> res;
+    SlotHandle h = findStationHandle(stationId);
+    if (stations.contains(h)) {
+        std::vector<uint32_t> slots;
+        inService().component(h.index, slots);
+        res.reserve(slots.size());
+        for (uint32_t slot : slots) res.push_back(&stations.at(slot));
+        std::sort(res.begin(), res.end(), [](const CompressorStation* a, const CompressorStation* b){ return a->getId() < b->getId(); });
+    }
+    logAction("Searched stations connected to id=", stationId, " -> ", res.size(), " found");
+    return res;
+}
+
+size_t Manager::countNetworkComponents() const { return inService().components(); }
+
+// === statistics
+NetworkStats Manager::getStats() const {
+    MetricTimer timer(MetricOp::GetStats);
+    NetworkStats res = aggregates.snapshot();
+    logAction("Network stats: ", res.toString());
+    return res;
+}
+
+// === utilization history
+UtilizationStats Manager::stationUtilization(uint64_t stationId, int64_t fromMs, int64_t toMs) const {
+    MetricTimer timer(MetricOp::StationUtilization);
+    UtilizationStats res = history.stats(stationId, fromMs, std::min(toMs, nowMs()));
+    logAction("Station utilization: id=", stationId, " ", res.toString());
+    return res;
+}
+
+const StationHistory& Manager::getStationHistory() const { return history; }
+
+const PipeColumns& Manager::getPipeColumns() const { return pipe_cols; }
+const StationColumns& Manager::getStationColumns() const { return station_cols; }
+
+void Manager::reserve(size_t pipeCount, size_t stationCount) {
+    MetricTimer timer(MetricOp::Reserve);
+    pipes.reserve(pipeCount);
+    stations.reserve(stationCount);
+    pipe_slots.reserve(pipeCount);
+    station_slots.reserve(stationCount);
+    refreshGauges();
+}
+
+void Manager::beginBulk() {
+    bulk = true;
+}
+
+void Manager::endBulk(const std::string& summary) {
+    if (!bulk) return;
+    bulk = false;
+    if (names_stale) rebuildNames();
+    if (service_stale) rebuildService();
+    logAction("Bulk run: ", summary, " pipes=", pipes.size(), " stations=", stations.size());
+    refreshGauges();
+}
+
+bool Manager::inBulk() const { return bulk; }
+
+// === queries
+namespace {
+
+// candidate source costs are in "rows touched"; an index candidate costs a
+// random access plus verification, a scanned row is a few SIMD lanes
+const double kIndexRowCost = 3.0;
+
+// Calls match(w, mask) for every live word (cand == nullptr) or for the words
+// holding the sorted candidate slots, then emit(slot) for each match until
+// emit returns false.
+template <typename Match, typename Emit>
+void forEachMatch(const SlotBitmap& live, const std::vector<uint32_t>* cand, Match match, Emit emit) {
+    auto drain = [&](uint64_t bits, size_t w) {
+        for (; bits; bits &= bits - 1) {
+            if (!emit(uint32_t(w * 64 + __builtin_ctzll(bits)))) return false;
+        }
+        return true;
+    };
+    if (!cand) {
+        for (size_t w = 0; w < live.wordCount(); ++w) {
+            uint64_t m = live.word(w);
+            if (m && !drain(match(w, m), w)) return;
+        }
+        return;
+    }
+    for (size_t i = 0; i < cand->size();) {
+        size_t w = (*cand)[i] >> 6;
+        uint64_t m = 0;
+        for (; i < cand->size() && ((*cand)[i] >> 6) == w; ++i) m |= uint64_t(1) << ((*cand)[i] & 63);
+        m &= live.word(w);
+        if (m && !drain(match(w, m), w)) return;
+    }
+}
+
+// streams matches directly, or collects and (partially) sorts them when an order is requested
+// Borrows a scratch vector for one query and hands it back afterwards, so its
+// capacity survives; a nested query simply starts from an empty one.
+class ScratchSlots {
+public:
+    explicit ScratchSlots(std::vector<uint32_t>& home_) : home(home_) { slots.swap(home); slots.clear(); }
+    ~ScratchSlots() { if (slots.capacity() > home.capacity()) slots.swap(home); }
+    ScratchSlots(const ScratchSlots&) = delete;
+    ScratchSlots& operator=(const ScratchSlots&) = delete;
+    std::vector<uint32_t> slots;
+private:
+    std::vector<uint32_t>& home;
+};
+
+template <typename Match, typename Less, typename Visit>
+size_t runQuery(const SlotBitmap& live, const std::vector<uint32_t>* cand, const QueryOptions& opt,
+                std::vector<uint32_t>& sel, Match match, Less less, Visit visit) {
+    if (opt.limit == 0) return 0;
+    size_t n = 0;
+    if (opt.order == QueryOrder::None || opt.count_only) {
+        forEachMatch(live, cand, match, [&](uint32_t slot){
+            ++n;
+            if (!opt.count_only) visit(slot);
+            return n < opt.limit;
+        });
+        return n;
+    }
+    forEachMatch(live, cand, match, [&](uint32_t slot){ sel.push_back(slot); return true; });
+    auto cmp = [&](uint32_t a, uint32_t b){ return opt.descending ? less(b, a) : less(a, b); };
+    size_t k = std::min(opt.limit, sel.size());
+    if (k < sel.size()) std::partial_sort(sel.begin(), sel.begin() + k, sel.end(), cmp);
+    else std::sort(sel.begin(), sel.end(), cmp);
+    for (size_t i = 0; i < k; ++i) visit(sel[i]);
+    return k;
+}
+
+// key order with id as the tie breaker, so results are deterministic
+template <typename Key, typename Id>
+auto byKey(Key key, Id id) {
+    return [key, id](uint32_t a, uint32_t b) {
+        auto ka = key(a), kb = key(b);
+        if (ka < kb) return true;
+        if (kb < ka) return false;
+        return id(a) < id(b);
+    };
+}
+
+template <typename T>
+void sortUnique(std::vector<T>& v) {
+    std::sort(v.begin(), v.end());
+    v.erase(std::unique(v.begin(), v.end()), v.end());
+}
+
+}
+
+// cheapest candidate source for p; a Scan plan means "no index beats scanning"
+QueryPlan Manager::pipeAccess(const Predicate& p) const {
+    QueryPlan best;
+    best.cost = double(pipes.size());
+    switch (p.kind()) {
+        case Predicate::Kind::NameContains: {
+            size_t est = pipeNames().estimate(p.foldedText());
+            if (est != SIZE_MAX && est * kIndexRowCost < best.cost) {
+                best.source = QueryPlan::Source::NameIndex;
+                best.term = &p;
+                best.cost = est * kIndexRowCost;
+            }
+            break;
+        }
+        case Predicate::Kind::InRepair: {
+            size_t n = p.flag() ? pipe_cols.repair.count() : pipe_cols.live.count() - pipe_cols.repair.count();
+            double cost = double(n) + double(pipe_cols.live.wordCount());
+            if (cost < best.cost) {
+                best.source = QueryPlan::Source::RepairBitmap;
+                best.term = &p;
+                best.cost = cost;
+            }
+            break;
+        }
+        case Predicate::Kind::And:
+            for (const auto& c : p.children()) {
+                QueryPlan sub = pipeAccess(c);
+                if (sub.source != QueryPlan::Source::Scan && sub.cost < best.cost) best = std::move(sub);
+            }
+            break;
+        case Predicate::Kind::Or: {
+            QueryPlan u;
+            u.source = QueryPlan::Source::Union;
+            for (const auto& c : p.children()) {
+                QueryPlan sub = pipeAccess(c);
+                if (sub.source == QueryPlan::Source::Scan) return best;
+                u.cost += sub.cost;
+                u.parts.push_back(std::move(sub));
+            }
+            if (u.cost < best.cost) best = std::move(u);
+            break;
+        }
+        default:
+            break;
+    }
+    return best;
+}
+
+QueryPlan Manager::stationAccess(const Predicate& p) const {
+    QueryPlan best;
+    best.cost = double(stations.size());
+    switch (p.kind()) {
+        case Predicate::Kind::NameContains: {
+            size_t est = stationNames().estimate(p.foldedText());
+            if (est != SIZE_MAX && est * kIndexRowCost < best.cost) {
+                best.source = QueryPlan::Source::NameIndex;
+                best.term = &p;
+                best.cost = est * kIndexRowCost;
+            }
+            break;
+        }
+        case Predicate::Kind::IdlePercent: {
+            // count the range in the ordered set, giving up once it is clearly too wide
+            size_t cap = size_t(best.cost / kIndexRowCost) + 1, n = 0;
+            auto it = station_idle.lower_bound(std::make_pair(p.lo(), uint64_t(0)));
+            for (; it != station_idle.end() && it->first <= p.hi() && n <= cap; ++it) ++n;
+            if (n * kIndexRowCost < best.cost) {
+                best.source = QueryPlan::Source::IdleIndex;
+                best.term = &p;
+                best.cost = n * kIndexRowCost;
+            }
+            break;
+        }
+        case Predicate::Kind::And:
+            for (const auto& c : p.children()) {
+                QueryPlan sub = stationAccess(c);
+                if (sub.source != QueryPlan::Source::Scan && sub.cost < best.cost) best = std::move(sub);
+            }
+            break;
+        case Predicate::Kind::Or: {
+            QueryPlan u;
+            u.source = QueryPlan::Source::Union;
+            for (const auto& c : p.children()) {
+                QueryPlan sub = stationAccess(c);
+                if (sub.source == QueryPlan::Source::Scan) return best;
+                u.cost += sub.cost;
+                u.parts.push_back(std::move(sub));
+            }
+            if (u.cost < best.cost) best = std::move(u);
+            break;
+        }
+        default:
+            break;
+    }
+    return best;
+}
+
+void Manager::pipeCandidates(const QueryPlan& plan, std::vector<uint32_t>& slots) const {
+    switch (plan.source) {
+        case QueryPlan::Source::NameIndex: {
+            std::vector<uint64_t> ids;
+            pipeNames().lookup(plan.term->foldedText(), ids);
+            for (uint64_t id : ids) {
+                auto it = pipe_slots.find(id);
+                if (it != pipe_slots.end()) slots.push_back(it->second.index);
+            }
+            break;
+        }
+        case QueryPlan::Source::RepairBitmap:
+            if (plan.term->flag()) pipe_cols.repair.forEach([&](uint32_t slot){ slots.push_back(slot); });
+            else pipe_cols.live.forEachAndNot(pipe_cols.repair, [&](uint32_t slot){ slots.push_back(slot); });
+            break;
+        case QueryPlan::Source::Union:
+            for (const auto& part : plan.parts) pipeCandidates(part, slots);
+            break;
+        default:
+            break;
+    }
+}
+
+void Manager::stationCandidates(const QueryPlan& plan, std::vector<uint32_t>& slots) const {
+    switch (plan.source) {
+        case QueryPlan::Source::NameIndex: {
+            std::vector<uint64_t> ids;
+            stationNames().lookup(plan.term->foldedText(), ids);
+            for (uint64_t id : ids) {
+                auto it = station_slots.find(id);
+                if (it != station_slots.end()) slots.push_back(it->second.index);
+            }
+            break;
+        }
+        case QueryPlan::Source::IdleIndex: {
+            auto it = station_idle.lower_bound(std::make_pair(plan.term->lo(), uint64_t(0)));
+            for (; it != station_idle.end() && it->first <= plan.term->hi(); ++it) {
+                slots.push_back(station_slots.find(it->second)->second.index);
+            }
+            break;
+        }
+        case QueryPlan::Source::Union:
+            for (const auto& part : plan.parts) stationCandidates(part, slots);
+            break;
+        default:
+            break;
+    }
+}
+
+QueryPlan Manager::planPipeQuery(const Predicate& where) const {
+    if (!where.appliesToPipes()) throw std::invalid_argument("queryPipes: station field in " + where.toString());
+    return pipeAccess(where);
 }
 
-std::vector<CompressorStation*> Manager::findStationsByName(const std::string& substring) {
-    std::vector<CompressorStation*> res;
-    for (auto &s : stations) {
-        if (s.getName().find(substring) != std::string::npos) res.push_back(&s);
+QueryPlan Manager::planStationQuery(const Predicate& where) const {
+    if (!where.appliesToStations()) throw std::invalid_argument("queryStations: pipe field in " + where.toString());
+    return stationAccess(where);
+}
+
+size_t Manager::queryPipes(const Predicate& where, const QueryOptions& opts,
+                           const std::function<void(const Pipe&)>& out) const {
+    MetricTimer timer(MetricOp::QueryPipes);
+    QueryOptions options = opts;
+    options.count_only = options.count_only || !out;
+    QueryPlan plan = planPipeQuery(where);
+    auto id = [this](uint32_t slot){ return pipes.at(slot).getId(); };
+    std::function<bool(uint32_t, uint32_t)> less;
+    switch (options.order) {
+        case QueryOrder::None: break;
+        case QueryOrder::Id: less = [id](uint32_t a, uint32_t b){ return id(a) < id(b); }; break;
+        case QueryOrder::Name: less = byKey([this](uint32_t s){ return pipe_cols.name[s].view(); }, id); break;
+        case QueryOrder::Diameter: less = byKey([this](uint32_t s){ return pipe_cols.diameter[s]; }, id); break;
+        default: throw std::invalid_argument("queryPipes: order does not apply to pipes");
     }
-    logAction("Searched stations by name=\"" + substring + "\" -> " + std::to_string(res.size()) + " found");
+
+    size_t n;
+    if (options.count_only && plan.source == QueryPlan::Source::RepairBitmap && plan.term == &where) {
+        // a lone repair flag is answered by the bitmap population count
+        n = std::min(options.limit, where.flag() ? pipe_cols.repair.count() : pipe_cols.live.count() - pipe_cols.repair.count());
+    } else {
+        ScratchSlots cand(query_candidates), sel(query_selected);
+        if (plan.source != QueryPlan::Source::Scan) {
+            pipeCandidates(plan, cand.slots);
+            sortUnique(cand.slots);
+        }
+        n = runQuery(pipe_cols.live, plan.source == QueryPlan::Source::Scan ? nullptr : &cand.slots, options, sel.slots,
+                     [&](size_t w, uint64_t m){ return matchPipeWord(where, pipe_cols, w, m); },
+                     less, [&](uint32_t slot){ out(pipes.at(slot)); });
+    }
+    logAction("Queried pipes ", where, " via ", plan, " -> ", n, " found");
+    return n;
+}
+
+size_t Manager::queryStations(const Predicate& where, const QueryOptions& opts,
+                              const std::function<void(const CompressorStation&)>& out) const {
+    MetricTimer timer(MetricOp::QueryStations);
+    QueryOptions options = opts;
+    options.count_only = options.count_only || !out;
+    QueryPlan plan = planStationQuery(where);
+    auto id = [this](uint32_t slot){ return stations.at(slot).getId(); };
+    std::function<bool(uint32_t, uint32_t)> less;
+    switch (options.order) {
+        case QueryOrder::None: break;
+        case QueryOrder::Id: less = [id](uint32_t a, uint32_t b){ return id(a) < id(b); }; break;
+        case QueryOrder::Name: less = byKey([this](uint32_t s){ return station_cols.name[s].view(); }, id); break;
+        case QueryOrder::TotalWorkshops: less = byKey([this](uint32_t s){ return station_cols.total[s]; }, id); break;
+        case QueryOrder::WorkingWorkshops: less = byKey([this](uint32_t s){ return station_cols.working[s]; }, id); break;
+        case QueryOrder::IdlePercent: less = byKey([this](uint32_t s){ return stations.at(s).percentIdle(); }, id); break;
+        default: throw std::invalid_argument("queryStations: order does not apply to stations");
+    }
+
+    ScratchSlots cand(query_candidates), sel(query_selected);
+    if (plan.source != QueryPlan::Source::Scan) {
+        stationCandidates(plan, cand.slots);
+        sortUnique(cand.slots);
+    }
+    size_t n = runQuery(station_cols.live, plan.source == QueryPlan::Source::Scan ? nullptr : &cand.slots, options, sel.slots,
+                        [&](size_t w, uint64_t m){ return matchStationWord(where, station_cols, w, m); },
+                        less, [&](uint32_t slot){ out(stations.at(slot)); });
+    logAction("Queried stations ", where, " via ", plan, " -> ", n, " found");
+    return n;
+}
+
+// === export
+namespace {
+
+const char* exportFormatName(ExportFormat f) {
+    return f == ExportFormat::Csv ? "csv" : f == ExportFormat::JsonLines ? "jsonl" : "text";
+}
+
+// hands out the page [offset, offset + limit) of a SlotMap, in storage order
+template <typename T>
+std::function<size_t(std::vector<const T*>&, size_t)> pageSource(const SlotMap<T>& items, const ExportOptions& o) {
+    auto it = items.begin();
+    size_t skip = o.offset, left = o.limit;
+    return [&items, it, skip, left](std::vector<const T*>& batch, size_t max) mutable {
+        for (; skip && it != items.end(); --skip) ++it;
+        size_t n = 0;
+        for (; n < max && left && it != items.end(); ++it, ++n, --left) batch.push_back(&*it);
+        return n;
+    };
+}
+
+// the same over the matches of a query, collected up front
+template <typename T>
+std::function<size_t(std::vector<const T*>&, size_t)> listSource(std::vector<const T*> matches, size_t offset) {
+    size_t at = std::min(offset, matches.size());
+    return [matches = std::move(matches), at](std::vector<const T*>& batch, size_t max) mutable {
+        size_t n = std::min(max, matches.size() - at);
+        batch.insert(batch.end(), matches.begin() + at, matches.begin() + at + n);
+        at += n;
+        return n;
+    };
+}
+
+QueryOptions pageQuery(const ExportOptions& o) {
+    QueryOptions q;
+    q.limit = o.limit > std::numeric_limits<size_t>::max() - o.offset ? std::numeric_limits<size_t>::max() : o.offset + o.limit;
+    return q;
+}
+
+}
+
+ExportResult Manager::exportPipes(ExportSink& sink, const ExportOptions& options, const Predicate* where) const {
+    MetricTimer timer(MetricOp::ExportPipes);
+    ExportResult res;
+    if (where) {
+        std::vector<const Pipe*> matches;
+        queryPipes(*where, pageQuery(options), [&](const Pipe& p){ matches.push_back(&p); });
+        res = exportRecords(sink, options, listSource(std::move(matches), options.offset));
+    } else {
+        res = exportRecords(sink, options, pageSource(pipes, options));
+    }
+    logAction("Exported pipes format=", exportFormatName(options.format), where ? " where " : "", where ? *where : Predicate::all(),
+              " -> ", res.records, " records, ", res.bytes, " bytes", res.ok ? "" : " error: ", res.error);
+    timer.result(res.ok);
     return res;
 }
 
-std::vector<CompressorStation*> Manager::findStationsByIdlePercent(double minIdlePercent) {
-    std::vector<CompressorStation*> res;
-    for (auto &s : stations) { 
-        if (s.percentIdle() >= minIdlePercent) res.push_back(&s);
+ExportResult Manager::exportStations(ExportSink& sink, const ExportOptions& options, const Predicate* where) const {
+    MetricTimer timer(MetricOp::ExportStations);
+    ExportResult res;
+    if (where) {
+        std::vector<const CompressorStation*> matches;
+        queryStations(*where, pageQuery(options), [&](const CompressorStation& s){ matches.push_back(&s); });
+        res = exportRecords(sink, options, listSource(std::move(matches), options.offset));
+    } else {
+        res = exportRecords(sink, options, pageSource(stations, options));
     }
-    std::ostringstream oss;
-    oss << "Searched stations by minIdlePercent=" << minIdlePercent << " -> " << res.size() << " found";
-    logAction(oss.str());
+    logAction("Exported stations format=", exportFormatName(options.format), where ? " where " : "", where ? *where : Predicate::all(),
+              " -> ", res.records, " records, ", res.bytes, " bytes", res.ok ? "" : " error: ", res.error);
+    timer.result(res.ok);
     return res;
 }
 
-const std::vector<CompressorStation>& Manager::getStations() const { return stations; }
+// === bulk updates
+namespace {
+
+// Runs f(begin, end) over [0, slots.size()) on several threads. Cut points are
+// moved to 64-slot word boundaries so no two threads write the same column
+// word or cache line.
+template <typename F>
+void parallelChunks(const std::vector<uint32_t>& slots, F f) {
+    const size_t kMinPerThread = 1 << 15;
+    size_t n = slots.size();
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, n / kMinPerThread));
+    if (threads <= 1) { f(size_t(0), n); return; }
+    std::vector<size_t> cuts{ 0 };
+    for (unsigned t = 1; t < threads; ++t) {
+        size_t c = std::max(cuts.back(), n * t / threads);
+        while (c > 0 && c < n && (slots[c] >> 6) == (slots[c - 1] >> 6)) ++c;
+        cuts.push_back(c);
+    }
+    cuts.push_back(n);
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(f, cuts[t], cuts[t + 1]);
+    f(cuts[0], cuts[1]);
+    for (auto &t : pool) t.join();
+}
+
+}
+
+void Manager::selectPipeSlots(const Predicate& where, std::vector<uint32_t>& slots) const {
+    QueryPlan plan = planPipeQuery(where);
+    std::vector<uint32_t> cand;
+    if (plan.source != QueryPlan::Source::Scan) {
+        pipeCandidates(plan, cand);
+        sortUnique(cand);
+    }
+    forEachMatch(pipe_cols.live, plan.source == QueryPlan::Source::Scan ? nullptr : &cand,
+                 [&](size_t w, uint64_t m){ return matchPipeWord(where, pipe_cols, w, m); },
+                 [&](uint32_t slot){ slots.push_back(slot); return true; });
+}
+
+void Manager::selectStationSlots(const Predicate& where, std::vector<uint32_t>& slots) const {
+    QueryPlan plan = planStationQuery(where);
+    std::vector<uint32_t> cand;
+    if (plan.source != QueryPlan::Source::Scan) {
+        stationCandidates(plan, cand);
+        sortUnique(cand);
+    }
+    forEachMatch(station_cols.live, plan.source == QueryPlan::Source::Scan ? nullptr : &cand,
+                 [&](size_t w, uint64_t m){ return matchStationWord(where, station_cols, w, m); },
+                 [&](uint32_t slot){ slots.push_back(slot); return true; });
+}
+
+// Applies u to the pipes in slots (ascending, unique). Entity fields and
+// per-slot columns are edited in parallel; the trigram index, repair bitmap
+// and journal are updated once for the whole batch.
+size_t Manager::applyPipeUpdate(const std::vector<uint32_t>& slots, const PipeUpdate& u) {
+    if (slots.empty() || u.empty()) return 0;
+    std::vector<uint64_t> ids(slots.size());
+    for (size_t i = 0; i < slots.size(); ++i) ids[i] = pipes.at(slots[i]).getId();
+
+    bool rename = u.name_op == FieldOp::Set;
+    InternedString folded;
+    if (rename) {
+        if (bulk) names_stale = true;
+        if (!names_stale) for (size_t i = 0; i < slots.size(); ++i) pipe_names.erase(ids[i], pipe_cols.folded[slots[i]]);
+        folded = foldedName(u.name);
+    }
+    bool counted = u.diameter_op != FieldOp::Keep || u.repair_op != FieldOp::Keep;
+    if (counted) {
+        for (uint32_t slot : slots) aggregates.removePipe(pipes.at(slot));
+    }
+    parallelChunks(slots, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            uint32_t slot = slots[i];
+            Pipe& p = pipes.at(slot);
+            u.apply(p);
+            pipe_cols.diameter[slot] = p.getDiameter();
+            if (rename) {
+                pipe_cols.name[slot] = p.getInternedName();
+                pipe_cols.folded[slot] = folded;
+            }
+        }
+    });
+    if (counted) {
+        for (uint32_t slot : slots) aggregates.addPipe(pipes.at(slot));
+    }
+    if (u.repair_op != FieldOp::Keep) {
+        for (size_t i = 0; i < slots.size();) {
+            size_t w = slots[i] >> 6;
+            uint64_t mask = 0;
+            for (; i < slots.size() && (slots[i] >> 6) == w; ++i) mask |= uint64_t(1) << (slots[i] & 63);
+            uint64_t bits = pipe_cols.repair.word(w);
+            if (u.repair_op == FieldOp::Toggle) bits ^= mask;
+            else bits = u.in_repair ? (bits | mask) : (bits & ~mask);
+            pipe_cols.repair.assignWord(w, bits);
+        }
+        // a large batch is cheaper to rebuild than to apply pipe by pipe
+        std::vector<uint32_t> changed;
+        for (uint32_t slot : slots) {
+            if (topology.connected(slot) && service.contains(slot) == pipe_cols.repair.test(slot)) changed.push_back(slot);
+        }
+        if (!bulk && changed.size() > service.edgeCount() / 4 + 64) rebuildService();
+        else for (uint32_t slot : changed) syncService(slot);
+    }
+    if (rename && !names_stale) {
+        std::vector<uint64_t> sorted(ids);
+        std::sort(sorted.begin(), sorted.end());
+        pipe_names.insertMany(sorted, folded.view());
+        if (pipe_names.needsRebuild()) rebuildPipeNames();
+    }
+    if (track_versions) dirty_pipes.insert(dirty_pipes.end(), ids.begin(), ids.end());
+    if (journal) { journal->updatePipes(ids, u); maybeCheckpoint(); }
+    refreshGauges();
+    return slots.size();
+}
+
+size_t Manager::applyStationUpdate(const std::vector<uint32_t>& slots, const StationUpdate& u) {
+    if (slots.empty() || u.empty()) return 0;
+    std::vector<uint64_t> ids(slots.size());
+    for (size_t i = 0; i < slots.size(); ++i) ids[i] = stations.at(slots[i]).getId();
+
+    bool rename = u.name_op == FieldOp::Set;
+    bool workshops = u.touchesWorkshops();
+    bool counted = workshops || u.class_op != FieldOp::Keep;
+    InternedString folded = rename ? foldedName(u.name) : InternedString();
+    if (rename && bulk) names_stale = true;
+    for (size_t i = 0; i < slots.size(); ++i) {
+        const CompressorStation& s = stations.at(slots[i]);
+        if (rename && !names_stale) station_names.erase(ids[i], station_cols.folded[slots[i]]);
+        if (workshops) station_idle.erase(std::make_pair(s.percentIdle(), ids[i]));
+        if (counted) aggregates.removeStation(s);
+    }
+    parallelChunks(slots, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            uint32_t slot = slots[i];
+            CompressorStation& s = stations.at(slot);
+            u.apply(s);
+            station_cols.total[slot] = s.getTotalWorkshops();
+            station_cols.working[slot] = s.getWorkingWorkshops();
+            if (rename) {
+                station_cols.name[slot] = s.getInternedName();
+                station_cols.folded[slot] = folded;
+            }
+            if (u.class_op == FieldOp::Set) station_cols.class_code[slot] = u.class_code;
+        }
+    });
+    if (workshops) {
+        for (size_t i = 0; i < slots.size(); ++i) station_idle.emplace(stations.at(slots[i]).percentIdle(), ids[i]);
+        if (record_history) {
+            int64_t now = nowMs();
+            for (uint32_t slot : slots) {
+                const CompressorStation& s = stations.at(slot);
+                history.record(s.getId(), now, s.getWorkingWorkshops(), s.getTotalWorkshops());
+            }
+        }
+    }
+    if (counted) {
+        for (uint32_t slot : slots) aggregates.addStation(stations.at(slot));
+    }
+    if (rename && !names_stale) {
+        std::vector<uint64_t> sorted(ids);
+        std::sort(sorted.begin(), sorted.end());
+        station_names.insertMany(sorted, folded.view());
+        if (station_names.needsRebuild()) rebuildStationNames();
+    }
+    if (track_versions) dirty_stations.insert(dirty_stations.end(), ids.begin(), ids.end());
+    if (journal) { journal->updateStations(ids, u); maybeCheckpoint(); }
+    refreshGauges();
+    return slots.size();
+}
+
+size_t Manager::updatePipes(const std::vector<uint64_t>& ids, const PipeUpdate& update) {
+    MetricTimer timer(MetricOp::UpdatePipes);
+    std::vector<uint32_t> slots;
+    slots.reserve(ids.size());
+    for (uint64_t id : ids) {
+        auto it = pipe_slots.find(id);
+        if (it != pipe_slots.end()) slots.push_back(it->second.index);
+    }
+    size_t missing = ids.size() - slots.size();
+    sortUnique(slots);
+    size_t before = service.components();
+    size_t n = applyPipeUpdate(slots, update);
+    logAction("Bulk updated pipes ", update.toString(), " ids=", ids.size(), " -> ", n, " updated", (missing ? ", " + std::to_string(missing) + " not found" : ""));
+    logComponents(before);
+    return n;
+}
+
+size_t Manager::updatePipes(const Predicate& where, const PipeUpdate& update) {
+    MetricTimer timer(MetricOp::UpdatePipes);
+    std::vector<uint32_t> slots;
+    selectPipeSlots(where, slots);
+    size_t before = service.components();
+    size_t n = applyPipeUpdate(slots, update);
+    logAction("Bulk updated pipes ", update.toString(), " where ", where, " -> ", n, " updated");
+    logComponents(before);
+    return n;
+}
+
+size_t Manager::updateStations(const std::vector<uint64_t>& ids, const StationUpdate& update) {
+    MetricTimer timer(MetricOp::UpdateStations);
+    std::vector<uint32_t> slots;
+    slots.reserve(ids.size());
+    for (uint64_t id : ids) {
+        auto it = station_slots.find(id);
+        if (it != station_slots.end()) slots.push_back(it->second.index);
+    }
+    size_t missing = ids.size() - slots.size();
+    sortUnique(slots);
+    size_t n = applyStationUpdate(slots, update);
+    logAction("Bulk updated stations ", update.toString(), " ids=", ids.size(), " -> ", n, " updated", (missing ? ", " + std::to_string(missing) + " not found" : ""));
+    return n;
+}
+
+size_t Manager::updateStations(const Predicate& where, const StationUpdate& update) {
+    MetricTimer timer(MetricOp::UpdateStations);
+    std::vector<uint32_t> slots;
+    selectStationSlots(where, slots);
+    size_t n = applyStationUpdate(slots, update);
+    logAction("Bulk updated stations ", update.toString(), " where ", where, " -> ", n, " updated");
+    return n;
+}
+
+// === published versions
+uint64_t Manager::publish() {
+    MetricTimer timer(MetricOp::Publish);
+    if (restage_all) {
+        // first publish, or the data was replaced by a load
+        versions.stageClear();
+        for (const auto& p : pipes) versions.stagePipe(p.getId(), &p);
+        for (const auto& s : stations) versions.stageStation(s.getId(), &s);
+        restage_all = false;
+    } else {
+        sortUnique(dirty_pipes);
+        sortUnique(dirty_stations);
+        for (uint64_t id : dirty_pipes) versions.stagePipe(id, getPipe(findPipeHandle(id)));
+        for (uint64_t id : dirty_stations) versions.stageStation(id, getStation(findStationHandle(id)));
+    }
+    size_t changes = dirty_pipes.size() + dirty_stations.size();
+    dirty_pipes.clear();
+    dirty_stations.clear();
+    track_versions = true;
+    uint64_t v = versions.publish();
+    logAction("Published version ", v, " changes=", changes);
+    return v;
+}
+
+const VersionStore& Manager::getVersions() const { return versions; }
 
 // === save / load
-bool Manager::saveToFile(const std::string& filename) {
-    std::ofstream os(filename);
-    if (!os) {
-        logAction("Failed to save to file: " + filename);
+bool Manager::saveToFile(const std::string& filename, SaveFormat format) {
+    MetricTimer timer(MetricOp::Save);
+    bool ok = format == SaveFormat::Binary ? saveSnapshot(filename) : saveText(filename);
+    if (Metrics::enabled()) gauges.set(Gauge::LastSaveSeconds, timer.seconds());
+    return timer.result(ok);
+}
+
+bool Manager::saveInBackground(const std::string& filename, SaveFormat format) {
+    MetricTimer timer(MetricOp::SaveInBackground);
+    if (background_save && !background_save->finished()) {
+        logAction("Background save refused, still writing: ", background_save->status().toString());
+        return timer.result(false);
+    }
+    background_save.reset();
+    publish();
+    std::shared_ptr<Logger> log = logger;
+    GaugeSet* g = &gauges;
+    background_save = std::make_unique<BackgroundSave>(versions, filename, format, next_id, [log, g](const SaveStatus& s) {
+        log->log("Background save " + s.toString());
+        if (Metrics::enabled()) g->set(Gauge::LastBackgroundSaveSeconds, s.seconds);
+    });
+    logAction("Background save started: ", filename, " version=", versions.publishedVersion());
+    return timer.result(true);
+}
+
+SaveStatus Manager::backgroundSaveStatus() const {
+    return background_save ? background_save->status() : SaveStatus();
+}
+
+bool Manager::waitForBackgroundSave() {
+    return background_save && background_save->wait();
+}
+
+bool Manager::saveText(const std::string& filename) {
+    std::FILE* f = std::fopen(filename.c_str(), "wb");
+    if (!f) {
+        logAction("Failed to save to file: ", filename);
         return false;
     }
+    // lines are appended to one buffer that is written out whenever it fills
+    const size_t kFlushBytes = size_t(1) << 16;
+    std::string buf;
+    buf.reserve(kFlushBytes + 4096);
+    bool ok = true;
+    auto line = [&](const auto& item) {
+        item.serializeTo(buf);
+        buf += '\n';
+        if (buf.size() >= kFlushBytes) {
+            ok = ok && std::fwrite(buf.data(), 1, buf.size(), f) == buf.size();
+            buf.clear();
+        }
+    };
     // header: next_id
-    os << "NEXT_ID|" << next_id << "\n";
-    os << "#PIPES\n";
-    for (const auto &p : pipes) os << p.serialize() << "\n";
-    os << "#STATIONS\n";
-    for (const auto &s : stations) os << s.serialize() << "\n";
-    os.close();
-    logAction("Saved to file: " + filename + " pipes=" + std::to_string(pipes.size()) + " stations=" + std::to_string(stations.size()));
+    char num[24];
+    buf += "NEXT_ID|";
+    buf.append(num, std::to_chars(num, num + sizeof(num), next_id).ptr);
+    buf += "\n#PIPES\n";
+    for (const auto &p : pipes) line(p);
+    buf += "#STATIONS\n";
+    for (const auto &s : stations) line(s);
+    ok = ok && std::fwrite(buf.data(), 1, buf.size(), f) == buf.size();
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok) {
+        logAction("Failed to save to file: ", filename);
+        return false;
+    }
+    logAction("Saved to file: ", filename, " pipes=", pipes.size(), " stations=", stations.size());
     return true;
 }
 
-bool Manager::loadFromFile(const std::string& filename) {
-    std::ifstream is(filename);
-    if (!is) {
-        logAction("Failed to load from file: " + filename);
-        return false;
-    }
+void Manager::clearAll() {
     pipes.clear();
     stations.clear();
-    std::string line;
-    enum Section { NONE, PIPES, STATIONS } section = NONE;
-    uint64_t loaded_next_id = 1;
-    while (std::getline(is, line)) {
-        if (line.size() == 0) continue;
-        if (line.rfind("NEXT_ID|",0) == 0) {
-            try { loaded_next_id = std::stoull(line.substr(8)); }
-            catch(...) { loaded_next_id = 1; }
-            continue;
-        }
-        if (line == "#PIPES") { section = PIPES; continue; }
-        if (line == "#STATIONS") { section = STATIONS; continue; }
-        try {
-            if (section == PIPES) {
-                Pipe p = Pipe::deserialize(line);
-                pipes.push_back(p);
-            } else if (section == STATIONS) {
-                CompressorStation s = CompressorStation::deserialize(line);
-                stations.push_back(s);
-            } else {
-                // unknown lines ignored
-            }
-        } catch (const std::exception &e) {
-            // ignore malformed line but log
-            logAction(std::string("Warning: failed to parse line during load: ") + e.what() + " line=[" + line + "]");
+    pipe_slots.clear();
+    station_slots.clear();
+    history.clear();
+    // the next publish() stages the reloaded network from scratch
+    restage_all = true;
+    track_versions = false;
+    dirty_pipes.clear();
+    dirty_stations.clear();
+}
+
+// A loaded file or a replayed journal can name stations that are not there;
+// such pipes have no edge in the topology, so they are disconnected outright.
+void Manager::disconnectDangling() {
+    for (auto it = pipes.begin(); it != pipes.end(); ++it) {
+        Pipe& p = *it;
+        if (p.isConnected() && (!station_slots.count(p.getInputStation()) || !station_slots.count(p.getOutputStation()))) {
+            logAction("Warning: pipe id=", p.getId(), " refers to a missing station, disconnected");
+            unindexPipe(it.slotIndex(), p);
+            p.disconnect();
+            indexPipe(it.slotIndex(), p);
         }
     }
-    is.close();
+}
+
+// shared tail of every load path
+void Manager::finishLoad(const std::string& filename, uint64_t loaded_next_id) {
+    rebuildIndexes();
+    disconnectDangling();
     // ensure next_id is greater than any id found
     uint64_t maxid = 0;
     for (const auto &p : pipes) if (p.getId() > maxid) maxid = p.getId();
     for (const auto &s : stations) if (s.getId() > maxid) maxid = s.getId();
     next_id = std::max(loaded_next_id, maxid + 1);
-    logAction("Loaded from file: " + filename + " pipes=" + std::to_string(pipes.size()) + " stations=" + std::to_string(stations.size()) + " next_id=" + std::to_string(next_id));
+    alignNextId();
+    logAction("Loaded from file: ", filename, " pipes=", pipes.size(), " stations=", stations.size(), " next_id=", next_id);
+    // the journal describes the previous dataset; start it over from the loaded one
+    if (journal) checkpoint();
+    refreshGauges();
+}
+
+// written beside the target and renamed over it, as checkpoint() does, so a
+// crash mid-save leaves the previous snapshot whole
+bool Manager::saveSnapshot(const std::string& filename) {
+    std::string tmp = filename + ".tmp";
+    std::string error;
+    uint64_t checksum = 0;
+    if (!writeSnapshot(tmp, next_id, pipes, stations, error, &checksum)) {
+        std::remove(tmp.c_str());
+        logAction("Failed to save to file: ", filename, " (", error, ")");
+        return false;
+    }
+    if (!saveHistory(tmp + ".history", checksum)) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    if (std::rename(tmp.c_str(), filename.c_str()) != 0) {
+        logAction("Failed to save to file: ", filename, " (cannot rename ", tmp, ")");
+        return false;
+    }
+    // a crash in between leaves a history that does not match the snapshot
+    // and is ignored on load
+    if (std::rename((tmp + ".history").c_str(), (filename + ".history").c_str()) != 0) {
+        logAction("Failed to save to file: ", filename, " (cannot rename ", tmp, ".history)");
+        return false;
+    }
+    logAction("Saved binary snapshot: ", filename, " pipes=", pipes.size(), " stations=", stations.size());
+    return true;
+}
+
+bool Manager::loadSnapshot(const std::string& filename) {
+    SnapshotView view;
+    std::string error;
+    if (!view.open(filename, error)) {
+        logAction("Failed to load from file: ", filename, " (", error, ")");
+        return false;
+    }
+    if (!view.verify()) {
+        logAction("Failed to load from file: ", filename, " (checksum mismatch)");
+        return false;
+    }
+    clearAll();
+    reserve(view.pipeCount(), view.stationCount());
+    for (size_t i = 0; i < view.pipeCount(); ++i) {
+        uint64_t id = view.pipe(i).id;
+        if (pipe_slots.count(id)) { logAction("Warning: duplicate pipe id in snapshot: ", id); continue; }
+        pipe_slots.emplace(id, pipes.insert(view.materializePipe(i)));
+    }
+    for (size_t i = 0; i < view.stationCount(); ++i) {
+        uint64_t id = view.station(i).id;
+        if (station_slots.count(id)) { logAction("Warning: duplicate station id in snapshot: ", id); continue; }
+        station_slots.emplace(id, stations.insert(view.materializeStation(i)));
+    }
+    // before finishLoad, whose index rebuild records what changed since
+    loadHistory(filename + ".history", view.checksum());
+    finishLoad(filename, view.nextId());
+    return true;
+}
+
+// A missing sidecar is no error: the history starts with the loaded state.
+void Manager::loadHistory(const std::string& filename, uint64_t snapshot_checksum) {
+    std::FILE* f = std::fopen(filename.c_str(), "rb");
+    if (!f) return;
+    std::fclose(f);
+    std::string error;
+    if (!history.load(filename, snapshot_checksum, error)) {
+        logAction("Warning: station history ", filename, " ignored (", error, ")");
+    }
+}
+
+bool Manager::saveHistory(const std::string& filename, uint64_t snapshot_checksum) {
+    std::string error;
+    if (!history.save(filename, snapshot_checksum, error)) {
+        logAction("Failed to save station history: ", filename, " (", error, ")");
+        return false;
+    }
+    return true;
+}
+
+bool Manager::loadFromFile(const std::string& filename) {
+    MetricTimer timer(MetricOp::Load);
+    bool ok = isBinarySnapshot(filename) ? loadSnapshot(filename) : loadText(filename);
+    if (Metrics::enabled()) gauges.set(Gauge::LastLoadSeconds, timer.seconds());
+    return timer.result(ok);
+}
+
+bool Manager::loadText(const std::string& filename) {
+    TextLoadResult loaded;
+    if (!loadTextFile(filename, loaded)) {
+        logAction("Failed to load from file: ", filename);
+        return false;
+    }
+    clearAll();
+    reserve(loaded.pipes.size(), loaded.stations.size());
+    for (const auto &is : loaded.issues) {
+        // ignore malformed line but log
+        logAction("Warning: failed to parse line during load: ", is.entity, "::deserialize: ", parseStatusText(is.status), " line=[", is.line, "]");
+    }
+    for (auto &p : loaded.pipes) {
+        uint64_t id = p.getId();
+        if (pipe_slots.count(id)) {
+            logAction("Warning: failed to parse line during load: duplicate pipe id line=[", p.serialize(), "]");
+            continue;
+        }
+        pipe_slots.emplace(id, pipes.insert(std::move(p)));
+    }
+    for (auto &s : loaded.stations) {
+        uint64_t id = s.getId();
+        if (station_slots.count(id)) {
+            logAction("Warning: failed to parse line during load: duplicate station id line=[", s.serialize(), "]");
+            continue;
+        }
+        station_slots.emplace(id, stations.insert(std::move(s)));
+    }
+    finishLoad(filename, loaded.next_id);
     return true;
 }
 
 // === batch edit pipes
 void Manager::batchEditPipes(const std::vector<uint64_t>& ids, const std::string& newName, double newDiameter, int changeRepairFlag) {
-    std::ostringstream oss;
-    oss << "Batch edit pipes count=" << ids.size() << " newName=\"" << newName << "\" newDiameter=" << newDiameter << " changeRepair=" << changeRepairFlag;
-    logAction(oss.str());
-    for (uint64_t id : ids) {
-        Pipe* p = findPipeById(id);
-        if (!p) {
-            logAction("Batch edit: cannot find pipe id=" + std::to_string(id));
-            continue;
+    PipeUpdate u;
+    if (!newName.empty()) u.setName(newName);
+    if (newDiameter > 0.0) u.setDiameter(newDiameter);
+    if (changeRepairFlag == 0 || changeRepairFlag == 1) u.setInRepair(changeRepairFlag == 1);
+    updatePipes(ids, u);
+}
+
+// === journal
+bool Manager::openJournal(const std::string& base) {
+    MetricTimer timer(MetricOp::OpenJournal);
+    return timer.result(openJournalAt(base));
+}
+
+bool Manager::openJournalAt(const std::string& base) {
+    closeJournal();
+    std::string snap = base + ".snap", wal = base + ".wal";
+    bool has_snap = fileExists(snap);
+    if (!has_snap && !fileExists(wal)) {
+        // a new base has nothing to recover: the data in memory becomes its
+        // first checkpoint, under an empty journal
+        if (!startJournal(base, 0, 0)) return false;
+        if (!checkpoint()) {
+            // no half-made base is left behind to be "recovered" as empty next time
+            closeJournal();
+            std::remove(wal.c_str());
+            logAction("Failed to open journal: ", base, " (first checkpoint failed)");
+            return false;
+        }
+        logAction("Journal started: ", wal, " pipes=", pipes.size(), " stations=", stations.size());
+        return true;
+    }
+    uint64_t snap_checksum = 0;
+    if (has_snap) {
+        if (!isBinarySnapshot(snap)) {
+            logAction("Failed to open journal: ", snap, " is not a binary snapshot");
+            return false;
+        }
+        SnapshotView view;
+        std::string error;
+        if (!view.open(snap, error) || !view.verify()) {
+            logAction("Failed to open journal: snapshot ", snap, " is unreadable");
+            return false;
+        }
+        snap_checksum = view.checksum();
+        view.close();
+        if (!loadSnapshot(snap)) return false;
+    } else {
+        clearAll();
+        rebuildIndexes();
+        next_id = 1;
+    }
+
+    uint64_t maxid = 0;
+    uint64_t valid_end = 0;
+    // the journal does not say when its edits were made: the history goes on
+    // from the checkpoint with the recovered state, sampled now
+    record_history = false;
+    size_t replayed = replayJournal(base + ".wal", snap_checksum, [&](const JournalEntry& e) {
+        maxid = std::max(maxid, e.id);
+        switch (e.op) {
+            case JournalOp::PutPipe:
+                if (!editPipe(e.id, [&](Pipe& p){
+                        p.setName(e.name); p.setDiameter(e.diameter); p.setInRepair(e.in_repair);
+                        p.connect(e.input_station, e.output_station); })) {
+                    Pipe p(e.id, e.name, e.diameter, e.in_repair);
+                    p.connect(e.input_station, e.output_station);
+                    insertPipe(std::move(p));
+                }
+                break;
+            case JournalOp::PutStation:
+                if (!editStation(e.id, [&](CompressorStation& s){
+                        s.setName(e.name); s.setTotalWorkshops(e.total_workshops);
+                        s.setWorkingWorkshops(e.working_workshops); s.setClassification(e.classification); }))
+                    insertStation(CompressorStation(e.id, e.name, e.total_workshops, e.working_workshops, e.classification));
+                break;
+            case JournalOp::DelPipe: erasePipe(e.id); break;
+            case JournalOp::DelStation: eraseStation(e.id); break;
+            case JournalOp::UpdatePipes: {
+                std::vector<uint32_t> slots;
+                for (uint64_t id : e.ids) {
+                    auto it = pipe_slots.find(id);
+                    if (it != pipe_slots.end()) slots.push_back(it->second.index);
+                }
+                sortUnique(slots);
+                applyPipeUpdate(slots, e.pipe_update);
+                break;
+            }
+            case JournalOp::UpdateStations: {
+                std::vector<uint32_t> slots;
+                for (uint64_t id : e.ids) {
+                    auto it = station_slots.find(id);
+                    if (it != station_slots.end()) slots.push_back(it->second.index);
+                }
+                sortUnique(slots);
+                applyStationUpdate(slots, e.station_update);
+                break;
+            }
         }
-        if (!newName.empty()) p->setName(newName);
-        if (newDiameter > 0.0) p->setDiameter(newDiameter);
-        if (changeRepairFlag == 0) p->setInRepair(false);
-        if (changeRepairFlag == 1) p->setInRepair(true);
-        logAction("Batch edited pipe id=" + std::to_string(id));
+    }, valid_end);
+    disconnectDangling();
+    record_history = true;
+    int64_t now = nowMs();
+    for (const auto& s : stations) history.record(s.getId(), now, s.getWorkingWorkshops(), s.getTotalWorkshops());
+    next_id = std::max(next_id, maxid + 1);
+    alignNextId();
+
+    if (!startJournal(base, snap_checksum, valid_end)) return false;
+    logAction("Journal opened: ", wal, " replayed=", replayed, " pipes=", pipes.size(), " stations=", stations.size());
+    refreshGauges();
+    return true;
+}
+
+bool Manager::startJournal(const std::string& base, uint64_t snap_checksum, uint64_t valid_end) {
+    journal.reset(new Journal());
+    journal->setGroupCommit(group_interval_ms, group_bytes);
+    std::string error;
+    if (!journal->open(base + ".wal", snap_checksum, valid_end, error)) {
+        journal.reset();
+        logAction("Failed to open journal: ", base, ".wal (", error, ")");
+        return false;
+    }
+    journal_base = base;
+    return true;
+}
+
+void Manager::closeJournal() {
+    if (!journal) return;
+    if (!journal->close()) logAction("Warning: journal ", journal_base, ".wal closed with unwritten changes");
+    journal.reset();
+    journal_failing = false;
+    gauges.set(Gauge::JournalFailing, 0.0);
+}
+
+bool Manager::checkpoint() {
+    MetricTimer timer(MetricOp::Checkpoint);
+    if (!journal) return timer.result(false);
+    journal->commit();
+    std::string snap = journal_base + ".snap";
+    std::string tmp = snap + ".tmp";
+    std::string error;
+    uint64_t checksum = 0;
+    if (!writeSnapshot(tmp, next_id, pipes, stations, error, &checksum)) {
+        logAction("Checkpoint failed: ", tmp, " (", error, ")");
+        return timer.result(false);
+    }
+    if (!saveHistory(tmp + ".history", checksum)) return timer.result(false);
+    if (std::rename(tmp.c_str(), snap.c_str()) != 0) {
+        logAction("Checkpoint failed: cannot rename ", tmp);
+        return timer.result(false);
+    }
+    // a crash in between leaves a history that does not match the snapshot
+    // and is ignored on recovery
+    if (std::rename((tmp + ".history").c_str(), (snap + ".history").c_str()) != 0) {
+        logAction("Checkpoint failed: cannot rename ", tmp, ".history");
+        return timer.result(false);
     }
-}
\ No newline at end of file
+    // a crash before this point leaves the old journal, which no longer matches
+    // the new snapshot's checksum and is discarded on recovery
+    journal->reset(checksum);
+    logAction("Checkpoint written: ", snap, " pipes=", pipes.size(), " stations=", stations.size());
+    refreshGauges();
+    return true;
+}
+
+void Manager::setJournalGroupCommit(unsigned intervalMs, size_t maxGroupBytes, size_t checkpointBytes) {
+    group_interval_ms = intervalMs;
+    group_bytes = maxGroupBytes;
+    checkpoint_bytes = checkpointBytes;
+    if (journal) journal->setGroupCommit(intervalMs, maxGroupBytes);
+}
+
+// Called after every journaled change: a journal that stopped accepting
+// writes is reported once, when it starts and when it stops failing; its
+// records stay pending and go out with the next commit or checkpoint.
+void Manager::maybeCheckpoint() {
+    if (checkpoint_bytes && journal->size() > checkpoint_bytes) checkpoint();
+    bool failing = journal->failing();
+    if (failing == journal_failing) return;
+    journal_failing = failing;
+    gauges.set(Gauge::JournalFailing, failing ? 1.0 : 0.0);
+    // logged even in bulk runs
+    if (failing) logger->logParts("Warning: journal ", journal_base, ".wal cannot be written; changes are not durable until a commit or checkpoint succeeds");
+    else logger->logParts("Journal ", journal_base, ".wal writable again");
+}
+
+// === metrics
+void Manager::registerMetrics() {
+    Metrics::global().addGauges(&gauges, std::to_string(manager_seq.fetch_add(1)));
+}
+
+// Counts plus container capacities; node sizes are the usual 64-bit layouts.
+// Names live in the process-wide StringPool and are reported there.
+size_t Manager::memoryFootprint() const {
+    const size_t kHashNode = 32; // next pointer + (id, SlotHandle), malloc-rounded
+    const size_t kTreeNode = 48; // rb-tree header + (percentIdle, id)
+    size_t bytes = pipes.memoryBytes() + stations.memoryBytes();
+    bytes += (pipe_slots.size() + station_slots.size()) * kHashNode;
+    bytes += (pipe_slots.bucket_count() + station_slots.bucket_count()) * sizeof(void*);
+    bytes += pipe_names.memoryBytes() + station_names.memoryBytes();
+    bytes += pipe_cols.memoryBytes() + station_cols.memoryBytes();
+    bytes += station_idle.size() * kTreeNode;
+    bytes += topology.memoryBytes();
+    bytes += service.memoryBytes();
+    bytes += aggregates.memoryBytes();
+    bytes += history.memoryBytes();
+    return bytes;
+}
+
+void Manager::refreshGauges() {
+    if (bulk) return;
+    gauges.set(Gauge::Pipes, double(pipes.size()));
+    gauges.set(Gauge::Stations, double(stations.size()));
+    gauges.set(Gauge::MemoryBytes, double(memoryFootprint()));
+    gauges.set(Gauge::JournalBytes, journal ? double(journal->size()) : 0.0);
+}
+
+void Manager::setMetricsLabel(const std::string& label) {
+    Metrics::global().addGauges(&gauges, label);
+}
+
+bool Manager::writeMetrics(const std::string& filename, MetricsFormat format) const {
+    bool ok = Metrics::global().dumpToFile(filename, format);
+    logAction(ok ? "Metrics written: " : "Failed to write metrics: ", filename);
+    return ok;
+}
+
+void Manager::setMetricsDump(const std::string& filename, MetricsFormat format, unsigned intervalMs) {
+    metrics_dumper.reset();
+    if (filename.empty() || intervalMs == 0) return;
+    metrics_dumper.reset(new MetricsDumper(filename, format, intervalMs));
+    logAction("Metrics dump every ", intervalMs, " ms to ", filename);
+}
@@ -3,52 +3,312 @@
 
 #include "Pipe.h"
 #include "CompressorStation.h"
+#include "Logger.h"
+#include "SlotMap.h"
+#include "TrigramIndex.h"
+#include "Journal.h"
+#include "Columns.h"
+#include "Query.h"
+#include "BulkUpdate.h"
+#include "VersionStore.h"
+#include "Metrics.h"
+#include "Topology.h"
+#include "MaxFlow.h"
+#include "Connectivity.h"
+#include "NetworkStats.h"
+#include "BackgroundSave.h"
+#include "Export.h"
+#include "StationHistory.h"
 #include <vector>
 #include <string>
+#include <unordered_map>
+#include <set>
+#include <memory_resource>
+#include <memory>
+#include <functional>
+#include <utility>
 
+// Manager itself is single-threaded: all calls come from one writer thread.
+// Other threads read through getVersions() (see publish()).
 class Manager {
 private:
-    std::vector<Pipe> pipes;
-    std::vector<CompressorStation> stations;
+    SlotMap<Pipe> pipes;
+    SlotMap<CompressorStation> stations;
+    // id -> slot, maintained alongside makeId() on every insert / erase
+    std::unordered_map<uint64_t, SlotHandle> pipe_slots;
+    std::unordered_map<uint64_t, SlotHandle> station_slots;
+    // secondary indexes, kept in sync by the index*/unindex* hooks below
+    // trigrams of the folded names: candidates for exact and case-insensitive search;
+    // bulk runs and rebuildIndexes() (every load) leave them stale and the
+    // next name lookup rebuilds both
+    mutable TrigramIndex pipe_names;
+    mutable TrigramIndex station_names;
+    mutable bool names_stale = false;
+    PipeColumns pipe_cols;       // columnar mirror with live / in_repair bitmaps
+    StationColumns station_cols;
+    // (percentIdle, id); nodes are recycled so workshop edits do not allocate
+    std::pmr::unsynchronized_pool_resource idle_nodes;
+    std::pmr::set<std::pair<double, uint64_t>> station_idle{&idle_nodes};
+    NetworkAggregates aggregates; // counts, sums, min / max, histograms
+    // workshop utilization over time, one sample per change of a station
+    StationHistory history;
+    bool record_history = true; // off while the journal is replayed
+    // station slots joined by connected pipes (edge = pipe slot); a pipe whose
+    // stations are not both present stays out of the graph
+    Topology topology;
+    // the same graph undirected, without pipes in repair: what is in service;
+    // bulk edits leave it stale and the next connectivity query rebuilds it
+    mutable Connectivity service;
+    mutable bool service_stale = false;
+    bool rebuilding = false; // rebuildIndexes() builds service in one pass
+    bool bulk = false;       // between beginBulk() and endBulk()
+    // slot lists of queryPipes / queryStations, kept between calls for their capacity
+    mutable std::vector<uint32_t> query_candidates;
+    mutable std::vector<uint32_t> query_selected;
     uint64_t next_id;
+    uint64_t id_stride = 1;  // makeId() hands out next_id, next_id + stride, ...
+    uint64_t id_residue = 0;
     std::string log_filename;
+    std::shared_ptr<Logger> logger; // may be shared between managers
+    // write-ahead journal, null unless openJournal() was called
+    std::unique_ptr<Journal> journal;
+    std::string journal_base;
+    unsigned group_interval_ms = 2;
+    size_t group_bytes = 1 << 20;
+    size_t checkpoint_bytes;
+    bool journal_failing = false; // last reported Journal::failing()
+    // MVCC read versions; ids touched since the last publish()
+    VersionStore versions;
+    bool track_versions = false; // set by the first publish()
+    bool restage_all = true;     // the whole network must be staged again
+    std::vector<uint64_t> dirty_pipes;
+    std::vector<uint64_t> dirty_stations;
+    // metrics: gauges read by dumps on other threads
+    GaugeSet gauges;
+    std::unique_ptr<MetricsDumper> metrics_dumper;
+    // last saveInBackground(); declared after versions and gauges, which it uses
+    std::unique_ptr<BackgroundSave> background_save;
 
-    void logAction(const std::string& msg);
+    // parts are concatenated only if logging is on (see Logger::logParts);
+    // file I/O happens on the logger's writer thread; nothing in bulk mode
+    template <typename... Parts>
+    void logAction(const Parts&... parts) const { if (!bulk) logger->logParts(parts...); }
+    void alignNextId();
+
+    // every mutation path calls unindex* before and index* after changing an entity
+    void indexPipe(uint32_t slot, const Pipe& p);
+    void unindexPipe(uint32_t slot, const Pipe& p);
+    void indexStation(uint32_t slot, const CompressorStation& s);
+    void unindexStation(uint32_t slot, const CompressorStation& s);
+    void rebuildIndexes();
+    void syncService(uint32_t slot);
+    void rebuildService() const;
+    const Connectivity& inService() const;
+    void rebuildNames() const;
+    void rebuildPipeNames() const;
+    void rebuildStationNames() const;
+    const TrigramIndex& pipeNames() const;
+    const TrigramIndex& stationNames() const;
+    void logComponents(size_t before) const;
+    void disconnectDangling();
+    SlotHandle insertPipe(Pipe p);
+    bool erasePipe(uint64_t id);
+    SlotHandle insertStation(CompressorStation s);
+    bool eraseStation(uint64_t id);
+    void maybeCheckpoint();
+    void clearAll();
+    void finishLoad(const std::string& filename, uint64_t loaded_next_id);
+    bool saveText(const std::string& filename);
+    bool saveSnapshot(const std::string& filename);
+    bool loadText(const std::string& filename);
+    bool loadSnapshot(const std::string& filename);
+    bool openJournalAt(const std::string& base);
+    bool startJournal(const std::string& base, uint64_t snap_checksum, uint64_t valid_end);
+    void loadHistory(const std::string& filename, uint64_t snapshot_checksum);
+    bool saveHistory(const std::string& filename, uint64_t snapshot_checksum);
+    void registerMetrics();
+    void refreshGauges();
+    QueryPlan pipeAccess(const Predicate& p) const;
+    QueryPlan stationAccess(const Predicate& p) const;
+    void pipeCandidates(const QueryPlan& plan, std::vector<uint32_t>& slots) const;
+    void stationCandidates(const QueryPlan& plan, std::vector<uint32_t>& slots) const;
+    void selectPipeSlots(const Predicate& where, std::vector<uint32_t>& slots) const;
+    void selectStationSlots(const Predicate& where, std::vector<uint32_t>& slots) const;
+    size_t applyPipeUpdate(const std::vector<uint32_t>& slots, const PipeUpdate& u);
+    size_t applyStationUpdate(const std::vector<uint32_t>& slots, const StationUpdate& u);
+    template <typename F> bool editPipe(uint64_t id, F edit);
+    template <typename F> bool editStation(uint64_t id, F edit);
 
 public:
     Manager();
     Manager(const std::string& logFile);
+    // log through a logger owned elsewhere (e.g. one log for all shards)
+    explicit Manager(std::shared_ptr<Logger> sharedLogger);
+    ~Manager();
 
     // public logging wrapper (was private logAction)
-    void writeLog(const std::string& msg);
+    void writeLog(const std::string& msg) const;
 
     uint64_t makeId();
+    // allocate ids first, first + stride, ... (ids of one shard out of stride)
+    void setIdSequence(uint64_t first, uint64_t stride);
 
     // pipes operations
     uint64_t addPipe(const std::string& name, double diameter, bool in_repair);
     bool removePipeById(uint64_t id);
-    Pipe* findPipeById(uint64_t id);
-    std::vector<Pipe*> findPipesByName(const std::string& substring);
-    std::vector<Pipe*> findPipesByRepairFlag(bool in_repair);
-    const std::vector<Pipe>& getPipes() const;
+    // entities are read-only from outside; edits go through the setters below
+    // so that every index stays consistent
+    const Pipe* findPipeById(uint64_t id) const;
+    // generational handle: stays detectably stale after the pipe is removed
+    SlotHandle findPipeHandle(uint64_t id) const;
+    const Pipe* getPipe(SlotHandle h) const;
+    bool setPipeName(uint64_t id, const std::string& name);
+    bool setPipeDiameter(uint64_t id, double diameter);
+    bool setPipeInRepair(uint64_t id, bool in_repair);
+    // IgnoreCase compares case-folded names (see CaseFold.h) as fast as Exact
+    std::vector<const Pipe*> findPipesByName(const std::string& substring, NameMatch match = NameMatch::Exact) const;
+    std::vector<const Pipe*> findPipesByRepairFlag(bool in_repair) const;
+    std::vector<const Pipe*> findPipesByDiameterRange(double minDiameter, double maxDiameter) const;
+    size_t countPipesInRepair() const;
+    const SlotMap<Pipe>& getPipes() const;
 
     // compressor stations operations
     uint64_t addStation(const std::string& name, int total, int working, const std::string& classification);
     bool removeStationById(uint64_t id);
-    CompressorStation* findStationById(uint64_t id);
-    std::vector<CompressorStation*> findStationsByName(const std::string& substring);
-    std::vector<CompressorStation*> findStationsByIdlePercent(double minIdlePercent);
-    const std::vector<CompressorStation>& getStations() const;
+    const CompressorStation* findStationById(uint64_t id) const;
+    SlotHandle findStationHandle(uint64_t id) const;
+    const CompressorStation* getStation(SlotHandle h) const;
+    bool setStationName(uint64_t id, const std::string& name);
+    bool setStationTotalWorkshops(uint64_t id, int total);
+    bool setStationWorkingWorkshops(uint64_t id, int working);
+    bool setStationClassification(uint64_t id, const std::string& classification);
+    std::vector<const CompressorStation*> findStationsByName(const std::string& substring, NameMatch match = NameMatch::Exact) const;
+    std::vector<const CompressorStation*> findStationsByIdlePercent(double minIdlePercent) const;
+    std::vector<const CompressorStation*> findStationsByIdleRange(double minIdlePercent, double maxIdlePercent) const;
+    const SlotMap<CompressorStation>& getStations() const;
+
+    // Network: a pipe may run from an input station to an output station (gas
+    // flows that way). Removing a station disconnects every pipe at it.
+    bool connectPipe(uint64_t pipeId, uint64_t inputStationId, uint64_t outputStationId);
+    bool disconnectPipe(uint64_t pipeId);
+    std::vector<const Pipe*> findPipesByStation(uint64_t stationId) const; // entering or leaving
+    // Maximum throughput from source to sink station. A pipe carries up to
+    // pipeCapacity(diameter); pipes in repair carry nothing. result.cut holds
+    // the ids of the pipes of a minimum cut (the bottleneck). Unknown stations
+    // give an empty result.
+    FlowResult maxFlow(uint64_t sourceStationId, uint64_t sinkStationId) const;
+    static double pipeCapacity(double diameter);
+    // graph by slot number: vertices are station slots, edges pipe slots
+    const Topology& getTopology() const;
+    // In-service network: connected pipes that are not in repair, regardless
+    // of direction. Kept up to date on every edit (polylogarithmic per pipe),
+    // so these answer without a graph search; edits that change the number of
+    // components log it.
+    bool stationsConnected(uint64_t stationA, uint64_t stationB) const;
+    std::vector<const CompressorStation*> findIsolatedStations() const; // no pipe in service
+    std::vector<const CompressorStation*> findConnectedStations(uint64_t stationId) const; // its component, itself included
+    size_t countNetworkComponents() const;
+
+    // Network-wide statistics from running aggregates: O(histogram buckets +
+    // classifications) whatever the network size.
+    NetworkStats getStats() const;
+
+    // Utilization history: every change of a station's working / total
+    // workshops is recorded with the time it was made (see StationHistory).
+    // Statistics over [fromMs, toMs) in milliseconds since the epoch, toMs
+    // clamped to now; only the rollups and blocks under the range are read.
+    // Binary snapshots and checkpoints keep the history in FILE.history.
+    UtilizationStats stationUtilization(uint64_t stationId, int64_t fromMs, int64_t toMs) const;
+    const StationHistory& getStationHistory() const;
+
+    // Composite queries. The planner either runs one fused pass over the
+    // columns or takes candidates from the trigram / repair / idle indexes and
+    // checks the whole predicate on those; matches are streamed to out (slot
+    // order unless options.order is set; a null out only counts). Returns the
+    // number of matches.
+    size_t queryPipes(const Predicate& where, const QueryOptions& options,
+                      const std::function<void(const Pipe&)>& out) const;
+    size_t queryStations(const Predicate& where, const QueryOptions& options,
+                         const std::function<void(const CompressorStation&)>& out) const;
+    QueryPlan planPipeQuery(const Predicate& where) const;
+    QueryPlan planStationQuery(const Predicate& where) const;
+
+    // Streaming export (see Export.h) of every pipe / station in storage
+    // order, or of the matches of where. options.offset / limit select a page;
+    // records before it are skipped without being formatted.
+    ExportResult exportPipes(ExportSink& sink, const ExportOptions& options, const Predicate* where = nullptr) const;
+    ExportResult exportStations(ExportSink& sink, const ExportOptions& options, const Predicate* where = nullptr) const;
+
+    // Concurrent reads: publish() makes every change so far visible as a new
+    // immutable version; any thread may then open
+    //   VersionStore::ReadView view(manager.getVersions());
+    // and read a consistent state without locks while this thread keeps writing.
+    uint64_t publish();
+    const VersionStore& getVersions() const;
 
-    // save/load
-    bool saveToFile(const std::string& filename);
+    // columnar views indexed by slot number, for scans and filter kernels
+    const PipeColumns& getPipeColumns() const;
+    const StationColumns& getStationColumns() const;
+
+    // pre-size storage and id indexes for bulk inserts
+    void reserve(size_t pipeCount, size_t stationCount);
+
+    // Bulk ingestion (app --script, see Script.h). Between beginBulk() and
+    // endBulk() operations write no action log line, leave the gauges alone
+    // and maintain neither the name indexes nor the in-service connectivity;
+    // those are rebuilt in one pass by the next query that needs them or by
+    // endBulk(). endBulk() also refreshes the gauges and logs summary as the
+    // only line of the run.
+    void beginBulk();
+    void endBulk(const std::string& summary);
+    bool inBulk() const;
+
+    // save/load; loading detects the format from the file's magic number
+    bool saveToFile(const std::string& filename, SaveFormat format = SaveFormat::Text);
     bool loadFromFile(const std::string& filename);
+    // Save without holding up edits: publishes, then writes that version on a
+    // background thread (see BackgroundSave). False if a save is still running.
+    bool saveInBackground(const std::string& filename, SaveFormat format = SaveFormat::Binary);
+    SaveStatus backgroundSaveStatus() const;
+    // block until the last background save ends; true if it wrote its file
+    bool waitForBackgroundSave();
 
-    // batch edit pipes by IDs (setter functions)
+    // Bulk edits: targets come from an id list or a predicate (resolved in one
+    // pass), entities are edited in parallel chunks, and each call writes one
+    // log line and one journal record. Returns the number of entities updated.
+    size_t updatePipes(const std::vector<uint64_t>& ids, const PipeUpdate& update);
+    size_t updatePipes(const Predicate& where, const PipeUpdate& update);
+    size_t updateStations(const std::vector<uint64_t>& ids, const StationUpdate& update);
+    size_t updateStations(const Predicate& where, const StationUpdate& update);
+
+    // batch edit pipes by IDs, console-menu form of updatePipes
     void batchEditPipes(const std::vector<uint64_t>& ids, const std::string& newName, double newDiameter, int changeRepairFlag); // changeRepairFlag: -1 - no change, 0 - set false, 1 - set true
 
+    // Durability: every mutation is appended to <base>.wal; checkpoints compact it
+    // into <base>.snap. Opening a base that has either file replaces the current
+    // data with the recovered state; opening a new base keeps the data and
+    // writes it as the base's first checkpoint.
+    bool openJournal(const std::string& base);
+    bool checkpoint();
+    void closeJournal();
+    // intervalMs = 0 syncs every record; checkpointBytes = 0 disables automatic checkpoints
+    void setJournalGroupCommit(unsigned intervalMs, size_t maxGroupBytes, size_t checkpointBytes);
+
     // logging filename change
     void setLogFilename(const std::string& filename);
+    void setLogDurability(LogDurability policy, size_t fsyncEvery = 64);
+    // wait until queued log records reach the file
+    void flushLog();
+
+    // Metrics: every public operation above records its latency into the
+    // process-wide Metrics registry; this manager's entity counts, memory
+    // footprint and save/load durations appear in dumps under
+    // manager="<label>" (construction order by default).
+    void setMetricsLabel(const std::string& label);
+    size_t memoryFootprint() const; // estimated heap bytes of entities and indexes
+    bool writeMetrics(const std::string& filename, MetricsFormat format = MetricsFormat::Prometheus) const;
+    // rewrite filename every intervalMs on a background thread; "" or 0 stops
+    void setMetricsDump(const std::string& filename, MetricsFormat format, unsigned intervalMs);
 };
 
 #endif // MANAGER_H
\ No newline at end of file
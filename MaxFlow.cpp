@@ -0,0 +1,212 @@
+#include "MaxFlow.h"
+#include <algorithm>
+
+namespace {
+
+// Residual network in CSR form: the arcs of vertex v are [first[v], first[v + 1]);
+// every edge becomes a forward arc and a zero-capacity reverse arc (its twin).
+struct Residual {
+    std::vector<uint32_t> first;
+    std::vector<uint32_t> head; // arc -> vertex it enters
+    std::vector<uint32_t> twin;
+    std::vector<double> cap;    // remaining capacity
+    std::vector<uint32_t> edges; // edges that take part
+    double max_cap = 0.0;
+
+    void build(const Topology& g, const std::vector<double>& capacity) {
+        uint32_t n = g.vertexBound();
+        uint32_t bound = std::min<uint32_t>(g.edgeBound(), uint32_t(capacity.size()));
+        for (uint32_t e = 0; e < bound; ++e) {
+            if (g.connected(e) && capacity[e] > 0.0 && g.source(e) != g.target(e)) edges.push_back(e);
+        }
+        first.assign(size_t(n) + 1, 0);
+        for (uint32_t e : edges) {
+            ++first[g.source(e) + 1];
+            ++first[g.target(e) + 1];
+        }
+        for (uint32_t v = 0; v < n; ++v) first[v + 1] += first[v];
+        std::vector<uint32_t> fill(first.begin(), first.end() - 1);
+        size_t arcs = edges.size() * 2;
+        head.resize(arcs);
+        twin.resize(arcs);
+        cap.resize(arcs);
+        for (size_t i = 0; i < edges.size(); ++i) {
+            uint32_t e = edges[i];
+            uint32_t u = g.source(e), v = g.target(e);
+            uint32_t a = fill[u]++, b = fill[v]++;
+            head[a] = v; twin[a] = b; cap[a] = capacity[e];
+            head[b] = u; twin[b] = a; cap[b] = 0.0;
+            max_cap = std::max(max_cap, capacity[e]);
+        }
+    }
+};
+
+const uint32_t kNil = UINT32_MAX;
+
+// Highest-label push-relabel, first phase only. Every vertex with a height
+// below n sits in a doubly linked list per height (to find gaps); active
+// vertices (with excess) are also on a singly linked stack per height.
+class PushRelabel {
+public:
+    PushRelabel(Residual& r_, uint32_t n_, uint32_t s_, uint32_t t_, double eps_)
+        : r(r_), n(n_), s(s_), t(t_), eps(eps_),
+          height(n_, n_), cur(n_), excess(n_, 0.0),
+          active_head(n_, kNil), active_next(n_, kNil),
+          bucket_head(n_, kNil), bucket_next(n_, kNil), bucket_prev(n_, kNil) {}
+
+    // returns the flow value; height() < n afterwards marks the sink side of a minimum cut
+    double run(size_t& relabels) {
+        for (uint32_t a = r.first[s]; a < r.first[s + 1]; ++a) {
+            double c = r.cap[a];
+            excess[r.head[a]] += c;
+            r.cap[r.twin[a]] += c;
+            r.cap[a] = 0.0;
+        }
+        globalRelabel();
+        size_t limit = size_t(6) * n + r.head.size() / 2;
+        while (max_active >= 0) {
+            uint32_t h = uint32_t(max_active);
+            uint32_t u = active_head[h];
+            if (u == kNil) { --max_active; continue; }
+            active_head[h] = active_next[u];
+            if (height[u] != h) continue; // lifted to n by a gap
+            discharge(u);
+            if (work > limit) globalRelabel();
+        }
+        globalRelabel();
+        relabels = relabel_count;
+        return excess[t];
+    }
+
+    bool sinkSide(uint32_t v) const { return height[v] < n; }
+
+private:
+    Residual& r;
+    uint32_t n, s, t;
+    double eps;
+    std::vector<uint32_t> height, cur;
+    std::vector<double> excess;
+    std::vector<uint32_t> active_head, active_next;
+    std::vector<uint32_t> bucket_head, bucket_next, bucket_prev;
+    int64_t max_active = -1;
+    uint32_t max_height = 0;
+    size_t work = 0;
+    size_t relabel_count = 0;
+
+    void activate(uint32_t v) {
+        uint32_t h = height[v];
+        active_next[v] = active_head[h];
+        active_head[h] = v;
+        if (int64_t(h) > max_active) max_active = h;
+    }
+
+    void bucketAdd(uint32_t v) {
+        uint32_t h = height[v];
+        bucket_prev[v] = kNil;
+        bucket_next[v] = bucket_head[h];
+        if (bucket_head[h] != kNil) bucket_prev[bucket_head[h]] = v;
+        bucket_head[h] = v;
+        if (h > max_height) max_height = h;
+    }
+
+    void bucketRemove(uint32_t v) {
+        if (bucket_prev[v] != kNil) bucket_next[bucket_prev[v]] = bucket_next[v];
+        else bucket_head[height[v]] = bucket_next[v];
+        if (bucket_next[v] != kNil) bucket_prev[bucket_next[v]] = bucket_prev[v];
+    }
+
+    // exact distances to t in the residual network (BFS backwards from t)
+    void globalRelabel() {
+        std::fill(height.begin(), height.end(), n);
+        std::fill(active_head.begin(), active_head.end(), kNil);
+        std::fill(bucket_head.begin(), bucket_head.end(), kNil);
+        max_active = -1;
+        max_height = 0;
+        std::vector<uint32_t> queue;
+        queue.push_back(t);
+        height[t] = 0;
+        for (size_t qi = 0; qi < queue.size(); ++qi) {
+            uint32_t v = queue[qi];
+            bucketAdd(v);
+            if (v != t && excess[v] > eps) activate(v);
+            for (uint32_t a = r.first[v]; a < r.first[v + 1]; ++a) {
+                uint32_t w = r.head[a];
+                if (height[w] == n && w != s && r.cap[r.twin[a]] > eps) {
+                    height[w] = height[v] + 1;
+                    queue.push_back(w);
+                }
+            }
+        }
+        std::copy(r.first.begin(), r.first.end() - 1, cur.begin());
+        work = 0;
+        ++relabel_count;
+    }
+
+    void relabel(uint32_t u) {
+        uint32_t old = height[u];
+        work += r.first[u + 1] - r.first[u] + 12;
+        ++relabel_count;
+        if (bucket_head[old] == u && bucket_next[u] == kNil) {
+            // gap: u was the last vertex at its height, so nothing at or
+            // above it can reach t any more
+            for (uint32_t h = old; h <= max_height; ++h) {
+                for (uint32_t v = bucket_head[h]; v != kNil; v = bucket_next[v]) height[v] = n;
+                bucket_head[h] = kNil;
+            }
+            max_height = old - 1;
+            return;
+        }
+        uint32_t lowest = n;
+        uint32_t best = r.first[u];
+        for (uint32_t a = r.first[u]; a < r.first[u + 1]; ++a) {
+            if (r.cap[a] > eps && height[r.head[a]] + 1 < lowest) {
+                lowest = height[r.head[a]] + 1;
+                best = a;
+            }
+        }
+        bucketRemove(u);
+        height[u] = lowest;
+        cur[u] = best;
+        if (lowest < n) bucketAdd(u);
+    }
+
+    void discharge(uint32_t u) {
+        while (excess[u] > eps) {
+            if (cur[u] == r.first[u + 1]) {
+                relabel(u);
+                if (height[u] >= n) return;
+                continue;
+            }
+            uint32_t a = cur[u];
+            uint32_t v = r.head[a];
+            if (r.cap[a] > eps && height[u] == height[v] + 1) {
+                double d = std::min(excess[u], r.cap[a]);
+                if (v != t && excess[v] <= eps) activate(v);
+                r.cap[a] -= d;
+                r.cap[r.twin[a]] += d;
+                excess[u] -= d;
+                excess[v] += d;
+            } else {
+                ++cur[u];
+            }
+        }
+    }
+};
+
+}
+
+FlowResult maxFlow(const Topology& g, const std::vector<double>& capacity, uint32_t source, uint32_t target) {
+    FlowResult res;
+    uint32_t n = g.vertexBound();
+    if (source == target || source >= n || target >= n) return res;
+    Residual r;
+    r.build(g, capacity);
+    // what is left of a saturated arc after floating-point subtraction
+    double eps = r.max_cap * 1e-12;
+    PushRelabel pr(r, n, source, target, eps);
+    res.flow = pr.run(res.relabels);
+    for (uint32_t e : r.edges) {
+        if (!pr.sinkSide(g.source(e)) && pr.sinkSide(g.target(e))) res.cut.push_back(e);
+    }
+    return res;
+}
@@ -0,0 +1,26 @@
+#ifndef MAXFLOW_H
+#define MAXFLOW_H
+
+#include "Topology.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+struct FlowResult {
+    double flow = 0.0;
+    // edges of a minimum cut: saturated, from the source side to the sink side
+    std::vector<uint64_t> cut;
+    size_t relabels = 0; // vertex relabels, including global ones
+};
+
+// Maximum source -> target flow over the connected edges of g: highest-label
+// push-relabel with global relabelling and the gap heuristic. Edge e may carry
+// capacity[e] (indexed by edge slot; edges past the end or with capacity <= 0
+// are left out). The residual network is laid out as its own CSR once per
+// call, so capacities may change freely between calls. Only the maximum
+// preflow is computed: its value and a minimum cut are all that is reported,
+// so the second phase (returning excess to the source) is skipped.
+// cut holds edge slots.
+FlowResult maxFlow(const Topology& g, const std::vector<double>& capacity, uint32_t source, uint32_t target);
+
+#endif // MAXFLOW_H
@@ -0,0 +1,384 @@
+#include "Metrics.h"
+#include "StringPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char* const kOpNames[] = {
+    "add_pipe", "remove_pipe", "find_pipe", "set_pipe_name", "set_pipe_diameter", "set_pipe_in_repair",
+    "find_pipes_by_name", "find_pipes_by_repair", "find_pipes_by_diameter",
+    "add_station", "remove_station", "find_station", "set_station_name", "set_station_total",
+    "set_station_working", "set_station_classification",
+    "find_stations_by_name", "find_stations_by_idle", "find_stations_by_idle_range",
+    "connect_pipe", "disconnect_pipe", "find_pipes_by_station", "max_flow",
+    "stations_connected", "find_isolated_stations", "find_connected_stations", "get_stats", "station_utilization",
+    "query_pipes", "query_stations", "export_pipes", "export_stations", "update_pipes", "update_stations",
+    "publish", "reserve", "save", "save_in_background", "load", "open_journal", "checkpoint",
+};
+static_assert(sizeof(kOpNames) / sizeof(kOpNames[0]) == size_t(MetricOp::Count), "every MetricOp needs a name");
+
+const char* const kGaugeNames[] = {
+    "pipes", "stations", "memory_bytes", "journal_bytes", "journal_failing", "last_save_seconds", "last_load_seconds",
+    "last_background_save_seconds",
+};
+static_assert(sizeof(kGaugeNames) / sizeof(kGaugeNames[0]) == size_t(Gauge::Count), "every Gauge needs a name");
+
+const char* const kGaugeHelp[] = {
+    "Pipes currently stored.",
+    "Compressor stations currently stored.",
+    "Estimated heap footprint of entities and indexes.",
+    "Bytes in the write-ahead journal since the last checkpoint.",
+    "1 while journal writes fail; changes since then are not yet durable.",
+    "Duration of the last saveToFile call.",
+    "Duration of the last loadFromFile call.",
+    "Duration of the last saveInBackground write, from start to rename.",
+};
+
+const double kQuantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+
+// resident set size of the process, 0 where unknown
+uint64_t residentBytes() {
+#ifdef __linux__
+    std::FILE* f = std::fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    unsigned long long size = 0, resident = 0;
+    int n = std::fscanf(f, "%llu %llu", &size, &resident);
+    std::fclose(f);
+    if (n != 2) return 0;
+    return uint64_t(resident) * uint64_t(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
+
+std::string escapeLabel(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') { out += '\\'; out += c; }
+        else if (c == '\n') out += "\\n";
+        else out += c;
+    }
+    return out;
+}
+
+}
+
+const char* metricOpName(MetricOp op) {
+    return size_t(op) < size_t(MetricOp::Count) ? kOpNames[size_t(op)] : "unknown";
+}
+
+GaugeSet::GaugeSet() {
+    for (auto& v : values) v.store(0.0, std::memory_order_relaxed);
+}
+
+// === histogram math
+uint64_t OpStats::bucketHigh(size_t b) {
+    if (b < kSub) return b;
+    unsigned e = unsigned(b / kSub) + kSubBits - 1;
+    uint64_t low = uint64_t(kSub + b % kSub) << (e - kSubBits);
+    return low + (uint64_t(1) << (e - kSubBits)) - 1;
+}
+
+uint64_t OpStats::quantile(double q) const {
+    if (count == 0 || buckets.empty()) return 0;
+    uint64_t rank = uint64_t(std::ceil(std::min(1.0, std::max(0.0, q)) * double(count)));
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < buckets.size(); ++b) {
+        seen += buckets[b];
+        if (seen >= rank) return std::min(bucketHigh(b), max_ns);
+    }
+    return max_ns;
+}
+
+// === registry
+std::atomic<bool> Metrics::on{true};
+
+Metrics::Cells::Cells() {
+    for (auto& b : buckets) b.store(0, std::memory_order_relaxed);
+}
+
+Metrics::Block::Block() {
+    for (auto& p : ops) p.store(nullptr, std::memory_order_relaxed);
+}
+
+Metrics::Block::~Block() {
+    for (auto& p : ops) delete p.load(std::memory_order_relaxed);
+}
+
+// Attaches a block to the thread on first use and hands it back when the
+// thread exits.
+class Metrics::ThreadHandle {
+public:
+    Block& block() {
+        if (!b) b = Metrics::global().attach();
+        return *b;
+    }
+    ~ThreadHandle() {
+        if (b) Metrics::global().detach(b);
+    }
+
+private:
+    Block* b = nullptr;
+};
+
+Metrics& Metrics::global() {
+    // never destroyed: thread_local handles may detach during static destruction
+    static Metrics* instance = new Metrics();
+    return *instance;
+}
+
+Metrics::Cells& Metrics::cells(Block& b, size_t op) {
+    Cells* c = b.ops[op].load(std::memory_order_acquire);
+    if (!c) {
+        c = new Cells();
+        b.ops[op].store(c, std::memory_order_release);
+    }
+    return *c;
+}
+
+void Metrics::record(MetricOp op, uint64_t ns, bool failed) {
+    thread_local ThreadHandle handle;
+    Cells& c = cells(handle.block(), size_t(op));
+    // this thread is the only writer of its cells: plain load + store, no
+    // locked instructions; relaxed atomics only keep concurrent dumps defined
+    auto bump = [](std::atomic<uint64_t>& a, uint64_t d) {
+        a.store(a.load(std::memory_order_relaxed) + d, std::memory_order_relaxed);
+    };
+    bump(c.count, 1);
+    if (failed) bump(c.failures, 1);
+    bump(c.sum, ns);
+    if (ns > c.max.load(std::memory_order_relaxed)) c.max.store(ns, std::memory_order_relaxed);
+    bump(c.buckets[OpStats::bucketOf(ns)], 1);
+}
+
+Metrics::Block* Metrics::attach() {
+    std::lock_guard<std::mutex> lk(mtx);
+    Block* b;
+    if (!spare.empty()) {
+        b = spare.back();
+        spare.pop_back();
+    } else {
+        b = new Block();
+    }
+    live.push_back(b);
+    return b;
+}
+
+void Metrics::detach(Block* b) {
+    std::lock_guard<std::mutex> lk(mtx);
+    for (size_t op = 0; op < size_t(MetricOp::Count); ++op) {
+        Cells* c = b->ops[op].load(std::memory_order_acquire);
+        if (c) moveInto(cells(retired, op), *c);
+    }
+    live.erase(std::find(live.begin(), live.end(), b));
+    spare.push_back(b);
+}
+
+void Metrics::moveInto(Cells& to, Cells& from) {
+    auto move = [](std::atomic<uint64_t>& t, std::atomic<uint64_t>& f) {
+        t.store(t.load(std::memory_order_relaxed) + f.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        f.store(0, std::memory_order_relaxed);
+    };
+    move(to.count, from.count);
+    move(to.failures, from.failures);
+    move(to.sum, from.sum);
+    to.max.store(std::max(to.max.load(std::memory_order_relaxed), from.max.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+    from.max.store(0, std::memory_order_relaxed);
+    for (size_t i = 0; i < OpStats::kBuckets; ++i) move(to.buckets[i], from.buckets[i]);
+}
+
+void Metrics::addInto(OpStats& s, const Cells& c) {
+    s.count += c.count.load(std::memory_order_relaxed);
+    s.failures += c.failures.load(std::memory_order_relaxed);
+    s.sum_ns += c.sum.load(std::memory_order_relaxed);
+    s.max_ns = std::max(s.max_ns, c.max.load(std::memory_order_relaxed));
+    for (size_t i = 0; i < OpStats::kBuckets; ++i) s.buckets[i] += c.buckets[i].load(std::memory_order_relaxed);
+}
+
+void Metrics::addGauges(const GaugeSet* g, const std::string& label) {
+    std::lock_guard<std::mutex> lk(mtx);
+    for (auto& e : gauges) {
+        if (e.gauges == g) { e.label = label; return; }
+    }
+    gauges.push_back(GaugeEntry{ g, label });
+}
+
+void Metrics::removeGauges(const GaugeSet* g) {
+    std::lock_guard<std::mutex> lk(mtx);
+    gauges.erase(std::remove_if(gauges.begin(), gauges.end(), [g](const GaugeEntry& e){ return e.gauges == g; }), gauges.end());
+}
+
+OpStats Metrics::stats(MetricOp op) const {
+    std::lock_guard<std::mutex> lk(mtx);
+    OpStats s;
+    s.buckets.assign(OpStats::kBuckets, 0);
+    auto add = [&](const Block& b) {
+        const Cells* c = b.ops[size_t(op)].load(std::memory_order_acquire);
+        if (c) addInto(s, *c);
+    };
+    add(retired);
+    for (const Block* b : live) add(*b);
+    return s;
+}
+
+void Metrics::reset() {
+    std::lock_guard<std::mutex> lk(mtx);
+    Cells scratch;
+    auto clear = [&](Block& b) {
+        for (auto& p : b.ops) {
+            Cells* c = p.load(std::memory_order_acquire);
+            if (c) moveInto(scratch, *c);
+        }
+    };
+    clear(retired);
+    for (Block* b : live) clear(*b);
+}
+
+void Metrics::collect(std::vector<OpStats>& ops, std::vector<GaugeValues>& values) const {
+    ops.clear();
+    for (size_t op = 0; op < size_t(MetricOp::Count); ++op) ops.push_back(stats(MetricOp(op)));
+    std::lock_guard<std::mutex> lk(mtx);
+    values.clear();
+    for (const auto& e : gauges) {
+        GaugeValues v;
+        v.label = e.label;
+        for (size_t g = 0; g < size_t(Gauge::Count); ++g) v.values[g] = e.gauges->get(Gauge(g));
+        values.push_back(v);
+    }
+}
+
+// === output
+void Metrics::writePrometheus(std::ostream& os) const {
+    std::vector<OpStats> ops;
+    std::vector<GaugeValues> values;
+    collect(ops, values);
+    std::streamsize precision = os.precision(12);
+
+    os << "# HELP gtn_op_duration_seconds Latency of Manager operations.\n";
+    os << "# TYPE gtn_op_duration_seconds summary\n";
+    for (size_t op = 0; op < ops.size(); ++op) {
+        const OpStats& s = ops[op];
+        if (!s.count) continue;
+        const char* name = kOpNames[op];
+        for (double q : kQuantiles) {
+            os << "gtn_op_duration_seconds{op=\"" << name << "\",quantile=\"" << q << "\"} " << double(s.quantile(q)) * 1e-9 << "\n";
+        }
+        os << "gtn_op_duration_seconds_sum{op=\"" << name << "\"} " << double(s.sum_ns) * 1e-9 << "\n";
+        os << "gtn_op_duration_seconds_count{op=\"" << name << "\"} " << s.count << "\n";
+    }
+    os << "# HELP gtn_op_duration_max_seconds Slowest call of each operation.\n";
+    os << "# TYPE gtn_op_duration_max_seconds gauge\n";
+    for (size_t op = 0; op < ops.size(); ++op) {
+        if (ops[op].count) os << "gtn_op_duration_max_seconds{op=\"" << kOpNames[op] << "\"} " << double(ops[op].max_ns) * 1e-9 << "\n";
+    }
+    os << "# HELP gtn_op_failures_total Calls that found nothing or failed.\n";
+    os << "# TYPE gtn_op_failures_total counter\n";
+    for (size_t op = 0; op < ops.size(); ++op) {
+        if (ops[op].count) os << "gtn_op_failures_total{op=\"" << kOpNames[op] << "\"} " << ops[op].failures << "\n";
+    }
+
+    for (size_t g = 0; g < size_t(Gauge::Count); ++g) {
+        if (values.empty()) break;
+        os << "# HELP gtn_" << kGaugeNames[g] << " " << kGaugeHelp[g] << "\n";
+        os << "# TYPE gtn_" << kGaugeNames[g] << " gauge\n";
+        for (const auto& v : values) {
+            os << "gtn_" << kGaugeNames[g] << "{manager=\"" << escapeLabel(v.label) << "\"} " << v.values[g] << "\n";
+        }
+    }
+
+    uint64_t rss = residentBytes();
+    if (rss) {
+        os << "# HELP gtn_process_resident_bytes Resident set size of the process.\n";
+        os << "# TYPE gtn_process_resident_bytes gauge\n";
+        os << "gtn_process_resident_bytes " << rss << "\n";
+    }
+    // interned names and classifications are shared by all managers
+    os << "# HELP gtn_string_pool_bytes Bytes held by the process string pool.\n";
+    os << "# TYPE gtn_string_pool_bytes gauge\n";
+    os << "gtn_string_pool_bytes " << StringPool::global().bytes() << "\n";
+    os << "# HELP gtn_string_pool_strings Distinct strings in the process string pool.\n";
+    os << "# TYPE gtn_string_pool_strings gauge\n";
+    os << "gtn_string_pool_strings " << StringPool::global().count() << "\n";
+    os << "# HELP gtn_classification_codes Distinct station classifications.\n";
+    os << "# TYPE gtn_classification_codes gauge\n";
+    os << "gtn_classification_codes " << Dictionary::classifications().size() << "\n";
+    os.precision(precision);
+}
+
+void Metrics::writeJson(std::ostream& os) const {
+    std::vector<OpStats> ops;
+    std::vector<GaugeValues> values;
+    collect(ops, values);
+    std::streamsize precision = os.precision(12);
+
+    os << "{\n  \"ops\": {";
+    bool first = true;
+    for (size_t op = 0; op < ops.size(); ++op) {
+        const OpStats& s = ops[op];
+        if (!s.count) continue;
+        os << (first ? "\n" : ",\n");
+        first = false;
+        os << "    \"" << kOpNames[op] << "\": { \"count\": " << s.count << ", \"failures\": " << s.failures
+           << ", \"sum_ns\": " << s.sum_ns << ", \"max_ns\": " << s.max_ns
+           << ", \"p50_ns\": " << s.quantile(0.5) << ", \"p90_ns\": " << s.quantile(0.9)
+           << ", \"p99_ns\": " << s.quantile(0.99) << ", \"p999_ns\": " << s.quantile(0.999) << " }";
+    }
+    os << (first ? "},\n" : "\n  },\n");
+    os << "  \"managers\": [";
+    for (size_t i = 0; i < values.size(); ++i) {
+        os << (i ? ",\n" : "\n") << "    { \"label\": \"" << escapeLabel(values[i].label) << "\"";
+        for (size_t g = 0; g < size_t(Gauge::Count); ++g) os << ", \"" << kGaugeNames[g] << "\": " << values[i].values[g];
+        os << " }";
+    }
+    os << (values.empty() ? "],\n" : "\n  ],\n");
+    os << "  \"string_pool_bytes\": " << StringPool::global().bytes() << ",\n";
+    os << "  \"string_pool_strings\": " << StringPool::global().count() << ",\n";
+    os << "  \"classification_codes\": " << Dictionary::classifications().size() << ",\n";
+    os << "  \"process_resident_bytes\": " << residentBytes() << "\n}\n";
+    os.precision(precision);
+}
+
+bool Metrics::dumpToFile(const std::string& filename, MetricsFormat format) const {
+    std::string tmp = filename + ".tmp";
+    {
+        std::ofstream os(tmp);
+        if (!os) return false;
+        if (format == MetricsFormat::Json) writeJson(os);
+        else writePrometheus(os);
+        os.close();
+        if (!os) return false;
+    }
+    return std::rename(tmp.c_str(), filename.c_str()) == 0;
+}
+
+// === periodic dumps
+MetricsDumper::MetricsDumper(const std::string& filename_, MetricsFormat format_, unsigned intervalMs)
+    : filename(filename_), format(format_), interval(intervalMs ? intervalMs : 1), stop(false) {
+    worker = std::thread(&MetricsDumper::run, this);
+}
+
+MetricsDumper::~MetricsDumper() {
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        stop = true;
+    }
+    cv.notify_one();
+    if (worker.joinable()) worker.join();
+    Metrics::global().dumpToFile(filename, format);
+}
+
+void MetricsDumper::run() {
+    std::unique_lock<std::mutex> lk(mtx);
+    while (!cv.wait_for(lk, interval, [this]{ return stop; })) {
+        lk.unlock();
+        Metrics::global().dumpToFile(filename, format);
+        lk.lock();
+    }
+}
@@ -0,0 +1,200 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Operations timed by the built-in metrics, one per public Manager call.
+enum class MetricOp : uint8_t {
+    AddPipe, RemovePipe, FindPipe, SetPipeName, SetPipeDiameter, SetPipeInRepair,
+    FindPipesByName, FindPipesByRepair, FindPipesByDiameter,
+    AddStation, RemoveStation, FindStation, SetStationName, SetStationTotal,
+    SetStationWorking, SetStationClassification,
+    FindStationsByName, FindStationsByIdle, FindStationsByIdleRange,
+    ConnectPipe, DisconnectPipe, FindPipesByStation, MaxFlow,
+    StationsConnected, FindIsolatedStations, FindConnectedStations, GetStats, StationUtilization,
+    QueryPipes, QueryStations, ExportPipes, ExportStations, UpdatePipes, UpdateStations,
+    Publish, Reserve, Save, SaveInBackground, Load, OpenJournal, Checkpoint,
+    Count
+};
+
+// snake_case name used as the "op" label, e.g. "find_pipes_by_name"
+const char* metricOpName(MetricOp op);
+
+// Per-instance gauges, published by the owning Manager with relaxed stores
+// so a dump from another thread never touches the Manager itself.
+enum class Gauge : uint8_t { Pipes, Stations, MemoryBytes, JournalBytes, JournalFailing, LastSaveSeconds,
+                           LastLoadSeconds, LastBackgroundSaveSeconds, Count };
+
+enum class MetricsFormat { Prometheus, Json };
+
+class GaugeSet {
+public:
+    GaugeSet();
+    void set(Gauge g, double v) { values[size_t(g)].store(v, std::memory_order_relaxed); }
+    double get(Gauge g) const { return values[size_t(g)].load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> values[size_t(Gauge::Count)];
+};
+
+// Merged view of one operation's histogram.
+//
+// Buckets are log-linear (HDR style): exact below 16 ns, then 16 linear
+// sub-buckets per power of two, so any recorded latency is within 1/16
+// (6.25%) of its bucket's bounds. Values past ~68 s land in the last bucket.
+struct OpStats {
+    static constexpr unsigned kSubBits = 4;
+    static constexpr size_t kSub = size_t(1) << kSubBits;
+    static constexpr unsigned kMaxExp = 35;
+    static constexpr size_t kBuckets = (kMaxExp - kSubBits + 2) * kSub;
+
+    uint64_t count = 0;
+    uint64_t failures = 0; // calls that found nothing / returned false
+    uint64_t sum_ns = 0;
+    uint64_t max_ns = 0;
+    std::vector<uint64_t> buckets;
+
+    static size_t bucketOf(uint64_t ns) {
+        if (ns < kSub) return size_t(ns);
+        unsigned e = 63u - unsigned(__builtin_clzll(ns));
+        if (e > kMaxExp) return kBuckets - 1;
+        return (e - kSubBits + 1) * kSub + size_t((ns >> (e - kSubBits)) & (kSub - 1));
+    }
+    // largest value that maps to bucket b
+    static uint64_t bucketHigh(size_t b);
+
+    // latency (ns) at quantile q in [0, 1]; 0 when nothing was recorded
+    uint64_t quantile(double q) const;
+};
+
+// Process-wide registry of operation histograms and gauge sets.
+//
+// record() is called on the hot path of every instrumented call. Each thread
+// writes only its own block (allocated on first use, cache-line aligned per
+// operation), so there are no shared atomics or locks on that path; a dump
+// merges all blocks under the registry mutex. Blocks of exited threads are
+// folded into a retired total and reused by later threads.
+class Metrics {
+public:
+    static Metrics& global();
+
+    static bool enabled() { return on.load(std::memory_order_relaxed); }
+    static void setEnabled(bool enable) { on.store(enable, std::memory_order_relaxed); }
+
+    void record(MetricOp op, uint64_t ns, bool failed);
+
+    // gauge sets show up in dumps under label manager="<label>" until removed
+    void addGauges(const GaugeSet* g, const std::string& label);
+    void removeGauges(const GaugeSet* g);
+
+    OpStats stats(MetricOp op) const;
+    void reset();
+
+    void writePrometheus(std::ostream& os) const;
+    void writeJson(std::ostream& os) const;
+    // writes to <filename>.tmp and renames, so readers never see half a dump
+    bool dumpToFile(const std::string& filename, MetricsFormat format) const;
+
+private:
+    struct alignas(64) Cells {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> failures{0};
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> max{0};
+        std::atomic<uint64_t> buckets[OpStats::kBuckets];
+        Cells();
+    };
+    struct Block {
+        std::atomic<Cells*> ops[size_t(MetricOp::Count)];
+        Block();
+        ~Block();
+    };
+    struct GaugeEntry {
+        const GaugeSet* gauges;
+        std::string label;
+    };
+    struct GaugeValues {
+        std::string label;
+        double values[size_t(Gauge::Count)];
+    };
+    class ThreadHandle;
+    friend class ThreadHandle;
+
+    static std::atomic<bool> on;
+
+    mutable std::mutex mtx;
+    std::vector<Block*> live;  // blocks owned by running threads
+    std::vector<Block*> spare; // blocks of exited threads, zeroed, ready for reuse
+    Block retired;             // totals of exited threads
+    std::vector<GaugeEntry> gauges;
+
+    Metrics() = default;
+    Block* attach();
+    void detach(Block* b);
+    static Cells& cells(Block& b, size_t op);
+    static void addInto(OpStats& s, const Cells& c);
+    static void moveInto(Cells& to, Cells& from);
+    void collect(std::vector<OpStats>& ops, std::vector<GaugeValues>& values) const;
+};
+
+// Times one call from construction to destruction. Costs two clock reads
+// when metrics are enabled and one relaxed load when they are not.
+class MetricTimer {
+public:
+    explicit MetricTimer(MetricOp o)
+        : op(o), active(Metrics::enabled()), ok(true),
+          start(active ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point()) {}
+    ~MetricTimer() {
+        if (active) Metrics::global().record(op, uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()), !ok);
+    }
+    MetricTimer(const MetricTimer&) = delete;
+    MetricTimer& operator=(const MetricTimer&) = delete;
+
+    // passes r through, counting the call as a failure when r is false / null
+    template <typename T>
+    T result(T r) { ok = static_cast<bool>(r); return r; }
+
+    // time since construction; 0 while metrics are disabled
+    double seconds() const {
+        return active ? std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() : 0.0;
+    }
+
+private:
+    MetricOp op;
+    bool active;
+    bool ok;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Rewrites a metrics file every interval on a background thread, plus once
+// more on destruction so the file ends with the final numbers.
+class MetricsDumper {
+public:
+    MetricsDumper(const std::string& filename, MetricsFormat format, unsigned intervalMs);
+    ~MetricsDumper();
+
+    MetricsDumper(const MetricsDumper&) = delete;
+    MetricsDumper& operator=(const MetricsDumper&) = delete;
+
+private:
+    std::string filename;
+    MetricsFormat format;
+    std::chrono::milliseconds interval;
+    bool stop;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::thread worker;
+
+    void run();
+};
+
+#endif // METRICS_H
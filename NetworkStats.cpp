@@ -0,0 +1,123 @@
+#include "NetworkStats.h"
+#include "StringPool.h"
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+// one occurrence of value more (sign > 0) or less in a value -> count map
+void adjust(std::pmr::map<double, size_t>& values, double value, int sign) {
+    if (sign > 0) {
+        ++values[value];
+        return;
+    }
+    auto it = values.find(value);
+    if (it != values.end() && --it->second == 0) values.erase(it);
+}
+
+}
+
+// === NetworkStats
+void NetworkStats::merge(const NetworkStats& o) {
+    if (o.pipes) {
+        min_diameter = pipes ? std::min(min_diameter, o.min_diameter) : o.min_diameter;
+        max_diameter = pipes ? std::max(max_diameter, o.max_diameter) : o.max_diameter;
+    }
+    if (o.stations) {
+        min_idle_percent = stations ? std::min(min_idle_percent, o.min_idle_percent) : o.min_idle_percent;
+        max_idle_percent = stations ? std::max(max_idle_percent, o.max_idle_percent) : o.max_idle_percent;
+    }
+    pipes += o.pipes;
+    pipes_in_repair += o.pipes_in_repair;
+    diameter_sum += o.diameter_sum;
+    for (size_t i = 0; i < kDiameterBuckets; ++i) diameter_histogram[i] += o.diameter_histogram[i];
+    stations += o.stations;
+    total_workshops += o.total_workshops;
+    working_workshops += o.working_workshops;
+    idle_percent_sum += o.idle_percent_sum;
+    for (size_t i = 0; i < kIdleBuckets; ++i) idle_histogram[i] += o.idle_histogram[i];
+    // both lists are sorted by classification
+    std::vector<std::pair<std::string, size_t>> merged;
+    merged.reserve(stations_by_class.size() + o.stations_by_class.size());
+    auto a = stations_by_class.cbegin();
+    auto b = o.stations_by_class.cbegin();
+    while (a != stations_by_class.cend() || b != o.stations_by_class.cend()) {
+        if (b == o.stations_by_class.cend() || (a != stations_by_class.cend() && a->first < b->first)) merged.push_back(*a++);
+        else if (a == stations_by_class.cend() || b->first < a->first) merged.push_back(*b++);
+        else { merged.emplace_back(a->first, a->second + b->second); ++a; ++b; }
+    }
+    stations_by_class.swap(merged);
+}
+
+std::string NetworkStats::toString() const {
+    std::ostringstream oss;
+    oss << "pipes=" << pipes << " in_repair=" << pipes_in_repair << " avg_diameter=" << averageDiameter()
+        << " stations=" << stations << " overall_idle=" << overallIdlePercent() << "%";
+    return oss.str();
+}
+
+// === NetworkAggregates
+size_t NetworkAggregates::diameterBucket(double diameter) {
+    const double* bounds = NetworkStats::kDiameterBounds;
+    return size_t(std::upper_bound(bounds, bounds + NetworkStats::kDiameterBuckets - 1, diameter) - bounds);
+}
+
+size_t NetworkAggregates::idleBucket(double percent) {
+    if (!(percent > 0.0)) return 0;
+    return std::min(NetworkStats::kIdleBuckets - 1, size_t(percent / 10.0));
+}
+
+void NetworkAggregates::pipe(const Pipe& p, int sign) {
+    NetworkStats& t = totals;
+    t.pipes += sign;
+    if (p.isInRepair()) t.pipes_in_repair += sign;
+    t.diameter_histogram[diameterBucket(p.getDiameter())] += sign;
+    // the sum would otherwise keep the rounding error of everything removed
+    t.diameter_sum = t.pipes ? t.diameter_sum + sign * p.getDiameter() : 0.0;
+    adjust(diameters, p.getDiameter(), sign);
+}
+
+void NetworkAggregates::station(const CompressorStation& s, int sign) {
+    NetworkStats& t = totals;
+    double idle_percent = s.percentIdle();
+    t.stations += sign;
+    t.total_workshops += sign * s.getTotalWorkshops();
+    t.working_workshops += sign * s.getWorkingWorkshops();
+    t.idle_histogram[idleBucket(idle_percent)] += sign;
+    t.idle_percent_sum = t.stations ? t.idle_percent_sum + sign * idle_percent : 0.0;
+    adjust(idle, idle_percent, sign);
+    uint32_t code = s.getClassCode();
+    if (code >= class_counts.size()) class_counts.resize(size_t(code) + 1, 0);
+    class_counts[code] += sign;
+}
+
+void NetworkAggregates::clear() {
+    totals = NetworkStats();
+    diameters.clear();
+    idle.clear();
+    nodes.release();
+    class_counts.clear();
+}
+
+NetworkStats NetworkAggregates::snapshot() const {
+    NetworkStats res = totals;
+    if (!diameters.empty()) {
+        res.min_diameter = diameters.begin()->first;
+        res.max_diameter = diameters.rbegin()->first;
+    }
+    if (!idle.empty()) {
+        res.min_idle_percent = idle.begin()->first;
+        res.max_idle_percent = idle.rbegin()->first;
+    }
+    const Dictionary& dict = Dictionary::classifications();
+    for (size_t code = 0; code < class_counts.size(); ++code) {
+        if (class_counts[code]) res.stations_by_class.emplace_back(std::string(dict.text(uint32_t(code))), class_counts[code]);
+    }
+    std::sort(res.stations_by_class.begin(), res.stations_by_class.end());
+    return res;
+}
+
+size_t NetworkAggregates::memoryBytes() const {
+    const size_t kTreeNode = 48; // rb-tree header + (value, count)
+    return (diameters.size() + idle.size()) * kTreeNode + class_counts.capacity() * sizeof(size_t);
+}
@@ -0,0 +1,83 @@
+#ifndef NETWORKSTATS_H
+#define NETWORKSTATS_H
+
+#include "Pipe.h"
+#include "CompressorStation.h"
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Network-wide summary as returned by Manager::getStats(). Min / max / average
+// fields are 0 when there is nothing to aggregate.
+struct NetworkStats {
+    // histogram bucket i counts diameters below kDiameterBounds[i] (and at
+    // least the previous bound); the last bucket holds everything larger
+    static constexpr size_t kDiameterBuckets = 8;
+    static constexpr double kDiameterBounds[kDiameterBuckets - 1] = { 200, 400, 600, 800, 1000, 1200, 1400 };
+    // idle percent in steps of 10: [0, 10), ..., [90, 100]; values outside
+    // 0..100 land in the first or last bucket
+    static constexpr size_t kIdleBuckets = 10;
+
+    size_t pipes = 0;
+    size_t pipes_in_repair = 0;
+    double diameter_sum = 0.0;
+    double min_diameter = 0.0;
+    double max_diameter = 0.0;
+    size_t diameter_histogram[kDiameterBuckets] = {};
+
+    size_t stations = 0;
+    int64_t total_workshops = 0;
+    int64_t working_workshops = 0;
+    double min_idle_percent = 0.0;
+    double max_idle_percent = 0.0;
+    double idle_percent_sum = 0.0; // of percentIdle() per station
+    size_t idle_histogram[kIdleBuckets] = {};
+    std::vector<std::pair<std::string, size_t>> stations_by_class; // by classification
+
+    double averageDiameter() const { return pipes ? diameter_sum / double(pipes) : 0.0; }
+    double averageIdlePercent() const { return stations ? idle_percent_sum / double(stations) : 0.0; }
+    // idle workshops over all workshops of the network
+    double overallIdlePercent() const {
+        return total_workshops > 0 ? 100.0 * double(total_workshops - working_workshops) / double(total_workshops) : 0.0;
+    }
+    // fold in another part of the network (e.g. a shard)
+    void merge(const NetworkStats& other);
+    std::string toString() const;
+};
+
+// Running aggregates behind NetworkStats. Every entity is added once when it
+// is indexed and removed with the same field values before it changes, so each
+// update is O(1) apart from the min / max multisets (O(log distinct values)).
+class NetworkAggregates {
+public:
+    void addPipe(const Pipe& p) { pipe(p, +1); }
+    void removePipe(const Pipe& p) { pipe(p, -1); }
+    void addStation(const CompressorStation& s) { station(s, +1); }
+    void removeStation(const CompressorStation& s) { station(s, -1); }
+    void clear();
+
+    // O(buckets + classifications)
+    NetworkStats snapshot() const;
+    size_t memoryBytes() const;
+
+    static size_t diameterBucket(double diameter);
+    static size_t idleBucket(double percent);
+
+private:
+    NetworkStats totals; // everything but min / max and stations_by_class
+    // map nodes are recycled, so edits that replace one value by another
+    // do not allocate once the maps have reached their size
+    std::pmr::unsynchronized_pool_resource nodes;
+    std::pmr::map<double, size_t> diameters{&nodes}; // value -> pipes with it
+    std::pmr::map<double, size_t> idle{&nodes};      // value -> stations with it
+    std::vector<size_t> class_counts;     // by Dictionary::classifications() code
+
+    void pipe(const Pipe& p, int sign);
+    void station(const CompressorStation& s, int sign);
+};
+
+#endif // NETWORKSTATS_H
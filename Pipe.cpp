@@ -1,40 +1,77 @@
 #include "Pipe.h"
+#include <charconv>
 #include <stdexcept>
-#include <vector>
 
-Pipe::Pipe() : id(0), name(""), diameter(0.0), in_repair(false) {}
-Pipe::Pipe(uint64_t id_, const std::string& name_, double diameter_, bool in_repair_)
-    : id(id_), name(name_), diameter(diameter_), in_repair(in_repair_) {}
+Pipe::Pipe() : id(0), diameter(0.0), in_repair(false), input_station(0), output_station(0) {}
+Pipe::Pipe(uint64_t id_, std::string_view name_, double diameter_, bool in_repair_)
+    : id(id_), name(intern(name_)), diameter(diameter_), in_repair(in_repair_), input_station(0), output_station(0) {}
 
 uint64_t Pipe::getId() const { return id; }
-std::string Pipe::getName() const { return name; }
+std::string_view Pipe::getName() const { return name.view(); }
+InternedString Pipe::getInternedName() const { return name; }
 double Pipe::getDiameter() const { return diameter; }
 bool Pipe::isInRepair() const { return in_repair; }
+uint64_t Pipe::getInputStation() const { return input_station; }
+uint64_t Pipe::getOutputStation() const { return output_station; }
+bool Pipe::isConnected() const { return input_station != 0; }
 
-void Pipe::setName(const std::string& n) { name = n; }
+void Pipe::setName(std::string_view n) { name = intern(n); }
+void Pipe::setName(InternedString n) { name = n; }
 void Pipe::setDiameter(double d) { diameter = d; }
 void Pipe::setInRepair(bool r) { in_repair = r; }
+void Pipe::connect(uint64_t input, uint64_t output) {
+    // both or neither: a half-connected pipe is not connected
+    bool ok = input != 0 && output != 0;
+    input_station = ok ? input : 0;
+    output_station = ok ? output : 0;
+}
+void Pipe::disconnect() { input_station = output_station = 0; }
 
 std::string Pipe::serialize() const {
-    std::ostringstream os;
-    // id|name|diameter|in_repair
-    os << id << '|' << name << '|' << diameter << '|' << (in_repair ? 1 : 0);
-    return os.str();
+    std::string out;
+    serializeTo(out);
+    return out;
+}
+
+void Pipe::serializeTo(std::string& out) const {
+    // id|name|diameter|in_repair[|input_station|output_station]
+    // diameter as an ostream prints it (%g, 6 significant digits)
+    char buf[32];
+    out.append(buf, std::to_chars(buf, buf + sizeof(buf), id).ptr);
+    out += '|';
+    out.append(name.view());
+    out += '|';
+    out.append(buf, std::to_chars(buf, buf + sizeof(buf), diameter, std::chars_format::general, 6).ptr);
+    out += in_repair ? "|1" : "|0";
+    if (isConnected()) {
+        out += '|';
+        out.append(buf, std::to_chars(buf, buf + sizeof(buf), input_station).ptr);
+        out += '|';
+        out.append(buf, std::to_chars(buf, buf + sizeof(buf), output_station).ptr);
+    }
 }
 
 Pipe Pipe::deserialize(const std::string& line) {
-    // split by '|'
-    std::vector<std::string> parts;
-    std::string cur;
-    for (char c : line) {
-        if (c == '|') { parts.push_back(cur); cur.clear(); }
-        else cur.push_back(c);
+    Pipe p;
+    ParseStatus st = parse(line, p);
+    if (st != ParseStatus::Ok) throw std::runtime_error(std::string("Pipe::deserialize: ") + parseStatusText(st));
+    return p;
+}
+
+ParseStatus Pipe::parse(std::string_view line, Pipe& out) {
+    // id|name|diameter|in_repair, plus the two station ids for a connected pipe
+    std::string_view f[6];
+    size_t n = splitFields(line, f, 6);
+    if (n != 4 && n != 6) return ParseStatus::WrongFormat;
+    if (!parseField(f[0], out.id)) return ParseStatus::BadId;
+    if (!parseField(f[2], out.diameter)) return ParseStatus::BadNumber;
+    out.input_station = out.output_station = 0;
+    if (n == 6) {
+        uint64_t input, output;
+        if (!parseField(f[4], input) || !parseField(f[5], output)) return ParseStatus::BadId;
+        out.connect(input, output);
     }
-    parts.push_back(cur);
-    if (parts.size() != 4) throw std::runtime_error("Pipe::deserialize: wrong format");
-    uint64_t id = std::stoull(parts[0]);
-    std::string name = parts[1];
-    double diameter = std::stod(parts[2]);
-    bool in_repair = (parts[3] != "0");
-    return Pipe(id, name, diameter, in_repair);
+    out.name = intern(f[1]);
+    out.in_repair = (f[3] != "0");
+    return ParseStatus::Ok;
 }
\ No newline at end of file
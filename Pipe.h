@@ -2,33 +2,50 @@
 #define PIPE_H
 
 #include <string>
+#include <string_view>
 #include <cstdint>
 #include <sstream>
+#include "TextFields.h"
+#include "StringPool.h"
 
 class Pipe {
 private:
     uint64_t id;
-    std::string name;
+    InternedString name; // shared text in the StringPool
     double diameter; // mm or chosen unit
     bool in_repair;
+    // stations the pipe runs between (gas flows input -> output), 0 = not connected
+    uint64_t input_station;
+    uint64_t output_station;
 
 public:
     Pipe();
-    Pipe(uint64_t id_, const std::string& name_, double diameter_, bool in_repair_);
+    Pipe(uint64_t id_, std::string_view name_, double diameter_, bool in_repair_);
 
     // getters / setters
     uint64_t getId() const;
-    std::string getName() const;
+    std::string_view getName() const;
+    InternedString getInternedName() const;
     double getDiameter() const;
     bool isInRepair() const;
+    uint64_t getInputStation() const;
+    uint64_t getOutputStation() const;
+    bool isConnected() const;
 
-    void setName(const std::string& n);
+    void setName(std::string_view n);
+    void setName(InternedString n); // no pool lookup
     void setDiameter(double d);
     void setInRepair(bool r);
+    void connect(uint64_t input, uint64_t output);
+    void disconnect();
 
     // serialization to single line (safe, '|' as separator)
     std::string serialize() const;
+    // the same line appended to out, without temporaries
+    void serializeTo(std::string& out) const;
     static Pipe deserialize(const std::string& line);
+    // non-throwing parser
+    static ParseStatus parse(std::string_view line, Pipe& out);
 };
 
 #endif // PIPE_H
\ No newline at end of file
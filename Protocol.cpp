@@ -0,0 +1,211 @@
+#include "Protocol.h"
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+#include <cstdint>
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#endif
+
+// === FrameWriter
+void FrameWriter::end() {
+    uint32_t n = uint32_t(out.size() - start - 4);
+    std::memcpy(&out[start], &n, 4);
+}
+
+FrameWriter& FrameWriter::str(std::string_view s) {
+    u32(uint32_t(s.size()));
+    out.append(s);
+    return *this;
+}
+
+FrameWriter& FrameWriter::ids(const std::vector<uint64_t>& v) {
+    u32(uint32_t(v.size()));
+    raw(v.data(), v.size() * 8);
+    return *this;
+}
+
+FrameWriter& FrameWriter::pipe(const Pipe& p) {
+    return u64(p.getId()).str(p.getName()).f64(p.getDiameter()).u8(p.isInRepair())
+          .u64(p.getInputStation()).u64(p.getOutputStation());
+}
+
+FrameWriter& FrameWriter::station(const CompressorStation& s) {
+    return u64(s.getId()).str(s.getName()).i32(s.getTotalWorkshops()).i32(s.getWorkingWorkshops())
+          .str(s.getClassification());
+}
+
+// === FrameReader
+void FrameReader::raw(void* dst, size_t n) {
+    if (size_t(end - p) < n) { ok = false; p = end; return; }
+    std::memcpy(dst, p, n);
+    p += n;
+}
+
+std::string_view FrameReader::str() {
+    uint32_t n = u32();
+    if (!ok || size_t(end - p) < n) { ok = false; p = end; return std::string_view(); }
+    std::string_view s(p, n);
+    p += n;
+    return s;
+}
+
+void FrameReader::ids(std::vector<uint64_t>& out) {
+    uint32_t n = u32();
+    if (!ok || size_t(end - p) / 8 < n) { ok = false; p = end; out.clear(); return; }
+    out.resize(n);
+    raw(out.data(), size_t(n) * 8);
+}
+
+bool FrameReader::pipe(Pipe& out) {
+    uint64_t id = u64();
+    std::string_view name = str();
+    double diameter = f64();
+    bool in_repair = u8() != 0;
+    uint64_t in = u64(), outStation = u64();
+    if (!ok) return false;
+    out = Pipe(id, name, diameter, in_repair);
+    out.connect(in, outStation);
+    return true;
+}
+
+bool FrameReader::station(CompressorStation& out) {
+    uint64_t id = u64();
+    std::string_view name = str();
+    int32_t total = i32(), working = i32();
+    std::string_view classification = str();
+    if (!ok) return false;
+    out = CompressorStation(id, name, total, working, classification);
+    return true;
+}
+
+size_t frameLength(const char* buf, size_t n) {
+    if (n < 4) return 0;
+    uint32_t len;
+    std::memcpy(&len, buf, 4);
+    if (len > kMaxFrameBytes) return SIZE_MAX;
+    return n - 4 >= len ? size_t(len) + 4 : 0;
+}
+
+bool parseServerAddress(const std::string& text, ServerAddress& out, std::string& error) {
+    out = ServerAddress();
+    if (text.compare(0, 5, "unix:") == 0) {
+        out.unix_socket = true;
+        out.path = text.substr(5);
+#ifndef _WIN32
+        if (out.path.empty() || out.path.size() >= sizeof(sockaddr_un::sun_path)) {
+            error = "bad unix socket path: " + text;
+            return false;
+        }
+#endif
+        return true;
+    }
+    if (text.compare(0, 4, "tcp:") == 0) {
+        std::string rest = text.substr(4);
+        size_t colon = rest.rfind(':');
+        if (colon != std::string::npos) {
+            out.host = rest.substr(0, colon);
+            rest = rest.substr(colon + 1);
+        }
+        char* endp = nullptr;
+        unsigned long port = std::strtoul(rest.c_str(), &endp, 10);
+        if (rest.empty() || *endp || port == 0 || port > 65535) {
+            error = "bad tcp port: " + text;
+            return false;
+        }
+        out.port = uint16_t(port);
+        return true;
+    }
+    error = "address must be unix:PATH or tcp:[HOST:]PORT, got: " + text;
+    return false;
+}
+
+// === ServerClient
+ServerClient::~ServerClient() { close(); }
+
+#ifndef _WIN32
+bool ServerClient::connect(const std::string& address, std::string& error) {
+    close();
+    ServerAddress a;
+    if (!parseServerAddress(address, a, error)) return false;
+    int rc;
+    if (a.unix_socket) {
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un sa{};
+        sa.sun_family = AF_UNIX;
+        std::memcpy(sa.sun_path, a.path.c_str(), a.path.size() + 1);
+        rc = fd < 0 ? -1 : ::connect(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa));
+    } else {
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in sa{};
+        sa.sin_family = AF_INET;
+        sa.sin_port = htons(a.port);
+        if (inet_pton(AF_INET, a.host.c_str(), &sa.sin_addr) != 1) {
+            error = "bad tcp host: " + a.host;
+            close();
+            return false;
+        }
+        rc = fd < 0 ? -1 : ::connect(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa));
+        int one = 1;
+        if (rc == 0) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    if (rc != 0) {
+        error = "cannot connect to " + address + ": " + std::strerror(errno);
+        close();
+        return false;
+    }
+    return true;
+}
+
+void ServerClient::close() {
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+    in.clear();
+    in_pos = 0;
+}
+
+bool ServerClient::send(const std::string& frames) {
+    size_t done = 0;
+    while (done < frames.size()) {
+        ssize_t n = ::send(fd, frames.data() + done, frames.size() - done, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += size_t(n);
+    }
+    return true;
+}
+
+bool ServerClient::receive(std::string& body) {
+    while (true) {
+        size_t len = frameLength(in.data() + in_pos, in.size() - in_pos);
+        if (len == SIZE_MAX) return false;
+        if (len) {
+            body.assign(in, in_pos + 4, len - 4);
+            in_pos += len;
+            return true;
+        }
+        if (in_pos) {
+            in.erase(0, in_pos);
+            in_pos = 0;
+        }
+        char buf[1 << 16];
+        ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        in.append(buf, size_t(n));
+    }
+}
+#else
+bool ServerClient::connect(const std::string&, std::string& error) {
+    error = "server client needs POSIX sockets";
+    return false;
+}
+void ServerClient::close() {}
+bool ServerClient::send(const std::string&) { return false; }
+bool ServerClient::receive(std::string&) { return false; }
+#endif
@@ -0,0 +1,155 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include "Pipe.h"
+#include "CompressorStation.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Wire protocol of the server mode (see Server.h).
+//
+// Every message is a frame: u32 body length, then the body. Integers and
+// doubles are little-endian; a string is u32 length + bytes; an id list is
+// u32 count + u64 ids.
+//   request body:  u8 ServerOp,     u32 tag, operands
+//   response body: u8 ServerStatus, u32 tag, results (only with Ok)
+// The tag is chosen by the client and echoed back. A client may send any
+// number of requests without waiting for replies; the replies of one
+// connection come back in request order.
+//
+// Operands -> results (pipe = u64 id, str name, f64 diameter, u8 in_repair,
+// u64 input station, u64 output station; station = u64 id, str name,
+// i32 total, i32 working, str classification):
+//   Ping                 -> -
+//   AddPipe              str name, f64 diameter, u8 in_repair -> u64 id
+//   AddStation           str name, i32 total, i32 working, str classification -> u64 id
+//   RemovePipe           u64 id -> -
+//   RemoveStation        u64 id -> -
+//   GetPipe              u64 id -> pipe
+//   GetStation           u64 id -> station
+//   ListPipes            u64 after_id, u32 limit -> u32 n, n pipes (ascending ids > after_id)
+//   ListStations         u64 after_id, u32 limit -> u32 n, n stations
+//   SetPipeName          u64 id, str name -> -
+//   SetPipeDiameter      u64 id, f64 diameter -> -
+//   SetPipeInRepair      u64 id, u8 in_repair -> -
+//   SetStationTotal      u64 id, i32 total -> -
+//   SetStationWorking    u64 id, i32 working -> -
+//   ConnectPipe          u64 id, u64 input, u64 output (input 0 disconnects) -> -
+//   UpdatePipesRepair    ids, u8 in_repair -> u64 updated
+//   FindPipesByName      str substring [, u8 ignore_case] -> ids
+//   FindStationsByName   str substring [, u8 ignore_case] -> ids
+//   StationsConnected    u64 a, u64 b -> u8
+//   FindIsolatedStations -> ids
+//   GetStats             -> u64 pipes, u64 in_repair, f64 avg / min / max diameter,
+//                           u64 stations, i64 total, i64 working, f64 overall idle %
+//   MaxFlow              u64 source, u64 sink -> f64 flow, ids (minimum cut)
+//   Save                 str filename, u8 binary -> -
+enum class ServerOp : uint8_t {
+    Ping = 1,
+    AddPipe, AddStation, RemovePipe, RemoveStation,
+    GetPipe, GetStation, ListPipes, ListStations,
+    SetPipeName, SetPipeDiameter, SetPipeInRepair, SetStationTotal, SetStationWorking,
+    ConnectPipe, UpdatePipesRepair,
+    FindPipesByName, FindStationsByName, StationsConnected, FindIsolatedStations,
+    GetStats, MaxFlow, Save,
+    Count
+};
+
+enum class ServerStatus : uint8_t { Ok = 0, NotFound = 1, BadRequest = 2, Failed = 3 };
+
+// Appends frames to a buffer: begin(), the fields, end() patches the length.
+class FrameWriter {
+public:
+    explicit FrameWriter(std::string& out_) : out(out_) {}
+
+    void begin() { start = out.size(); raw("\0\0\0\0", 4); }
+    void end();
+    FrameWriter& u8(uint8_t v) { out.push_back(char(v)); return *this; }
+    FrameWriter& u32(uint32_t v) { raw(&v, 4); return *this; }
+    FrameWriter& u64(uint64_t v) { raw(&v, 8); return *this; }
+    FrameWriter& i32(int32_t v) { raw(&v, 4); return *this; }
+    FrameWriter& i64(int64_t v) { raw(&v, 8); return *this; }
+    FrameWriter& f64(double v) { raw(&v, 8); return *this; }
+    FrameWriter& str(std::string_view s);
+    FrameWriter& ids(const std::vector<uint64_t>& v);
+    FrameWriter& pipe(const Pipe& p);
+    FrameWriter& station(const CompressorStation& s);
+
+    // the usual frame heads
+    FrameWriter& request(ServerOp op, uint32_t tag) { begin(); return u8(uint8_t(op)).u32(tag); }
+    FrameWriter& response(ServerStatus status, uint32_t tag) { begin(); return u8(uint8_t(status)).u32(tag); }
+
+private:
+    std::string& out;
+    size_t start = 0;
+
+    void raw(const void* p, size_t n) { out.append(static_cast<const char*>(p), n); }
+};
+
+// Reads the fields of one frame body; any overrun clears ok and yields zeros.
+class FrameReader {
+public:
+    FrameReader(const char* p_, size_t n) : p(p_), end(p_ + n) {}
+
+    bool ok = true;
+    bool atEnd() const { return p == end; }
+
+    uint8_t u8() { uint8_t v = 0; raw(&v, 1); return v; }
+    uint32_t u32() { uint32_t v = 0; raw(&v, 4); return v; }
+    uint64_t u64() { uint64_t v = 0; raw(&v, 8); return v; }
+    int32_t i32() { int32_t v = 0; raw(&v, 4); return v; }
+    int64_t i64() { int64_t v = 0; raw(&v, 8); return v; }
+    double f64() { double v = 0; raw(&v, 8); return v; }
+    std::string_view str();
+    void ids(std::vector<uint64_t>& out);
+    bool pipe(Pipe& out);
+    bool station(CompressorStation& out);
+
+private:
+    const char* p;
+    const char* end;
+
+    void raw(void* dst, size_t n);
+};
+
+// Frames larger than this are refused (the connection is dropped).
+constexpr size_t kMaxFrameBytes = size_t(16) << 20;
+
+// Length of the complete frame (header included) at the start of buf, 0 if
+// more bytes are needed; SIZE_MAX if the header announces an oversized frame.
+size_t frameLength(const char* buf, size_t n);
+
+// "unix:/path/to/socket", "tcp:PORT" or "tcp:HOST:PORT"
+struct ServerAddress {
+    bool unix_socket = false;
+    std::string path;                 // unix
+    std::string host = "127.0.0.1";   // tcp
+    uint16_t port = 0;
+};
+bool parseServerAddress(const std::string& text, ServerAddress& out, std::string& error);
+
+// Minimal blocking client, for scripts, benchmarks and tests: send any number
+// of request frames, then read replies one by one.
+class ServerClient {
+public:
+    ServerClient() = default;
+    ~ServerClient();
+    ServerClient(const ServerClient&) = delete;
+    ServerClient& operator=(const ServerClient&) = delete;
+
+    bool connect(const std::string& address, std::string& error);
+    void close();
+    bool send(const std::string& frames);
+    // next reply body (status, tag, results); false when the connection is gone
+    bool receive(std::string& body);
+
+private:
+    int fd = -1;
+    std::string in;
+    size_t in_pos = 0;
+};
+
+#endif // PROTOCOL_H
@@ -0,0 +1,293 @@
+#include "Query.h"
+#include "FilterKernels.h"
+#include <charconv>
+#include <utility>
+
+namespace {
+
+// what std::ostream prints by default (%g, 6 significant digits)
+void appendNumber(std::string& out, double v) {
+    char buf[32];
+    out.append(buf, std::to_chars(buf, buf + sizeof(buf), v, std::chars_format::general, 6).ptr);
+}
+
+}
+
+// === Predicate
+Predicate Predicate::all() {
+    return Predicate();
+}
+
+Predicate Predicate::nameContains(const std::string& substring, NameMatch match) {
+    Predicate p;
+    p.k = Kind::NameContains;
+    p.str = substring;
+    p.low = match == NameMatch::IgnoreCase ? 1.0 : 0.0;
+    if (!foldCase(substring, p.folded) && !p.flag()) p.folded.clear();
+    return p;
+}
+
+Predicate Predicate::diameter(double lo, double hi) {
+    Predicate p;
+    p.k = Kind::Diameter;
+    p.low = lo;
+    p.high = hi;
+    return p;
+}
+
+Predicate Predicate::inRepair(bool in_repair) {
+    Predicate p;
+    p.k = Kind::InRepair;
+    p.low = in_repair ? 1.0 : 0.0;
+    return p;
+}
+
+Predicate Predicate::totalWorkshops(int lo, int hi) {
+    Predicate p;
+    p.k = Kind::TotalWorkshops;
+    p.low = lo;
+    p.high = hi;
+    return p;
+}
+
+Predicate Predicate::workingWorkshops(int lo, int hi) {
+    Predicate p;
+    p.k = Kind::WorkingWorkshops;
+    p.low = lo;
+    p.high = hi;
+    return p;
+}
+
+Predicate Predicate::idlePercent(double lo, double hi) {
+    Predicate p;
+    p.k = Kind::IdlePercent;
+    p.low = lo;
+    p.high = hi;
+    return p;
+}
+
+Predicate Predicate::classification(const std::string& value) {
+    Predicate p;
+    p.k = Kind::Classification;
+    p.str = value;
+    // a value no station has ever had matches nothing
+    p.low = Dictionary::classifications().find(value);
+    return p;
+}
+
+// flattens nested AND / OR so the planner sees one level of conjuncts
+Predicate Predicate::combine(Kind kind, Predicate a, Predicate b) {
+    Predicate p;
+    p.k = kind;
+    for (Predicate* x : { &a, &b }) {
+        if (x->k == kind) {
+            for (auto& c : x->args) p.args.push_back(std::move(c));
+        } else {
+            p.args.push_back(std::move(*x));
+        }
+    }
+    return p;
+}
+
+Predicate operator&&(Predicate a, Predicate b) {
+    if (a.k == Predicate::Kind::All) return b;
+    if (b.k == Predicate::Kind::All) return a;
+    return Predicate::combine(Predicate::Kind::And, std::move(a), std::move(b));
+}
+
+Predicate operator||(Predicate a, Predicate b) {
+    if (a.k == Predicate::Kind::All) return a;
+    if (b.k == Predicate::Kind::All) return b;
+    return Predicate::combine(Predicate::Kind::Or, std::move(a), std::move(b));
+}
+
+Predicate operator!(Predicate a) {
+    if (a.k == Predicate::Kind::Not) return std::move(a.args.front());
+    Predicate p;
+    p.k = Predicate::Kind::Not;
+    p.args.push_back(std::move(a));
+    return p;
+}
+
+bool Predicate::appliesToPipes() const {
+    switch (k) {
+        case Kind::All: case Kind::NameContains: case Kind::Diameter: case Kind::InRepair:
+            return true;
+        case Kind::And: case Kind::Or: case Kind::Not:
+            for (const auto& c : args) if (!c.appliesToPipes()) return false;
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool Predicate::appliesToStations() const {
+    switch (k) {
+        case Kind::Diameter: case Kind::InRepair:
+            return false;
+        case Kind::And: case Kind::Or: case Kind::Not:
+            for (const auto& c : args) if (!c.appliesToStations()) return false;
+            return true;
+        default:
+            return true;
+    }
+}
+
+std::string Predicate::toString() const {
+    std::string out;
+    appendTo(out);
+    return out;
+}
+
+void Predicate::appendTo(std::string& out) const {
+    auto range = [&](const char* field) {
+        out += field;
+        out += " in [";
+        appendNumber(out, low);
+        out += ", ";
+        appendNumber(out, high);
+        out += ']';
+    };
+    switch (k) {
+        case Kind::All: out += "all"; break;
+        case Kind::NameContains: out += flag() ? "name~*\"" : "name~\""; out += str; out += '"'; break;
+        case Kind::Diameter: range("diameter"); break;
+        case Kind::InRepair: out += flag() ? "in_repair=1" : "in_repair=0"; break;
+        case Kind::TotalWorkshops: range("total"); break;
+        case Kind::WorkingWorkshops: range("working"); break;
+        case Kind::IdlePercent: range("idle%"); break;
+        case Kind::Classification: out += "class=\""; out += str; out += '"'; break;
+        case Kind::Not: out += "NOT "; args.front().appendTo(out); break;
+        case Kind::And:
+        case Kind::Or:
+            out += '(';
+            for (size_t i = 0; i < args.size(); ++i) {
+                if (i) out += k == Kind::And ? " AND " : " OR ";
+                args[i].appendTo(out);
+            }
+            out += ')';
+            break;
+    }
+}
+
+// === QueryPlan
+std::string QueryPlan::toString() const {
+    std::string out;
+    appendTo(out);
+    return out;
+}
+
+void QueryPlan::appendTo(std::string& out) const {
+    auto index = [&](const char* name) {
+        out += name;
+        out += '(';
+        term->appendTo(out);
+        out += ')';
+    };
+    switch (source) {
+        case Source::Scan: out += "scan"; break;
+        case Source::NameIndex: index("trigram"); break;
+        case Source::RepairBitmap: index("bitmap"); break;
+        case Source::IdleIndex: index("idle-index"); break;
+        case Source::Union:
+            out += "union(";
+            for (size_t i = 0; i < parts.size(); ++i) {
+                if (i) out += ", ";
+                parts[i].appendTo(out);
+            }
+            out += ')';
+            break;
+    }
+    char buf[24];
+    out += " cost=";
+    out.append(buf, std::to_chars(buf, buf + sizeof(buf), static_cast<uint64_t>(cost)).ptr);
+}
+
+// === fused evaluation
+namespace {
+
+template <typename Test>
+uint64_t eachBit(uint64_t cand, size_t w, Test test) {
+    uint64_t res = 0;
+    for (uint64_t bits = cand; bits; bits &= bits - 1) {
+        int b = __builtin_ctzll(bits);
+        if (test(uint32_t(w * 64 + b))) res |= uint64_t(1) << b;
+    }
+    return res;
+}
+
+template <typename Leaf>
+uint64_t matchWord(const Predicate& p, size_t w, uint64_t cand, Leaf leaf) {
+    if (!cand) return 0;
+    switch (p.kind()) {
+        case Predicate::Kind::All:
+            return cand;
+        case Predicate::Kind::And:
+            for (const auto& c : p.children()) {
+                cand = matchWord(c, w, cand, leaf);
+                if (!cand) break;
+            }
+            return cand;
+        case Predicate::Kind::Or: {
+            uint64_t res = 0;
+            for (const auto& c : p.children()) {
+                res |= matchWord(c, w, cand & ~res, leaf);
+                if (res == cand) break;
+            }
+            return res;
+        }
+        case Predicate::Kind::Not:
+            return cand & ~matchWord(p.children().front(), w, cand, leaf);
+        default:
+            return leaf(p, w, cand);
+    }
+}
+
+uint64_t nameMask(const std::vector<InternedString>& name, const std::vector<InternedString>& folded,
+                  const Predicate& t, size_t w, uint64_t cand) {
+    const std::vector<InternedString>& col = t.flag() ? folded : name;
+    std::string_view pattern = t.flag() ? std::string_view(t.foldedText()) : std::string_view(t.text());
+    return eachBit(cand, w, [&](uint32_t s){ return findSubstring(col[s], pattern) != std::string_view::npos; });
+}
+
+int32_t clampInt(double v) {
+    if (v <= double(INT32_MIN)) return INT32_MIN;
+    if (v >= double(INT32_MAX)) return INT32_MAX;
+    return int32_t(v);
+}
+
+}
+
+uint64_t matchPipeWord(const Predicate& p, const PipeColumns& c, size_t w, uint64_t cand) {
+    return matchWord(p, w, cand, [&c](const Predicate& t, size_t w, uint64_t cand) -> uint64_t {
+        switch (t.kind()) {
+            case Predicate::Kind::NameContains:
+                return nameMask(c.name, c.folded, t, w, cand);
+            case Predicate::Kind::Diameter:
+                return cand & diameterRangeMask(c, w, t.lo(), t.hi());
+            case Predicate::Kind::InRepair:
+                return cand & (t.flag() ? c.repair.word(w) : ~c.repair.word(w));
+            default:
+                return 0;
+        }
+    });
+}
+
+uint64_t matchStationWord(const Predicate& p, const StationColumns& c, size_t w, uint64_t cand) {
+    return matchWord(p, w, cand, [&c](const Predicate& t, size_t w, uint64_t cand) -> uint64_t {
+        switch (t.kind()) {
+            case Predicate::Kind::NameContains:
+                return nameMask(c.name, c.folded, t, w, cand);
+            case Predicate::Kind::TotalWorkshops:
+                return cand & int32RangeMask(c.total, w, clampInt(t.lo()), clampInt(t.hi()));
+            case Predicate::Kind::WorkingWorkshops:
+                return cand & int32RangeMask(c.working, w, clampInt(t.lo()), clampInt(t.hi()));
+            case Predicate::Kind::IdlePercent:
+                return cand & idleRangeMask(c, w, t.lo(), t.hi());
+            case Predicate::Kind::Classification:
+                return cand & codeEqMask(c.class_code, w, t.code());
+            default:
+                return 0;
+        }
+    });
+}
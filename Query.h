@@ -0,0 +1,94 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include "Columns.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+
+// Composable filter over pipes or stations:
+//   Predicate::nameContains("Main") && Predicate::diameter(500, 1000) && !Predicate::inRepair(true)
+// Pipe queries accept name / diameter / repair terms, station queries accept
+// name / workshop counts / idle percent / classification terms; Manager throws
+// std::invalid_argument for a term that does not apply to the entity.
+class Predicate {
+public:
+    enum class Kind {
+        All, And, Or, Not,
+        NameContains, Diameter, InRepair,
+        TotalWorkshops, WorkingWorkshops, IdlePercent, Classification
+    };
+
+    static Predicate all();
+    static Predicate nameContains(const std::string& substring, NameMatch match = NameMatch::Exact);
+    static Predicate diameter(double lo, double hi);
+    static Predicate inRepair(bool in_repair);
+    static Predicate totalWorkshops(int lo, int hi);
+    static Predicate workingWorkshops(int lo, int hi);
+    static Predicate idlePercent(double lo, double hi);
+    // exact match, compared by dictionary code; the code is looked up here,
+    // so build the predicate after the stations it should match exist
+    static Predicate classification(const std::string& value);
+
+    friend Predicate operator&&(Predicate a, Predicate b);
+    friend Predicate operator||(Predicate a, Predicate b);
+    friend Predicate operator!(Predicate a);
+
+    Kind kind() const { return k; }
+    const std::string& text() const { return str; }
+    // NameContains: the case-folded pattern the name index is probed with;
+    // empty when an exact pattern is not well-formed UTF-8 and must be scanned
+    const std::string& foldedText() const { return folded; }
+    double lo() const { return low; }
+    double hi() const { return high; }
+    bool flag() const { return low != 0.0; } // InRepair: the flag, NameContains: ignore case
+    uint32_t code() const { return uint32_t(low); } // Classification: dictionary code
+    const std::vector<Predicate>& children() const { return args; }
+
+    bool appliesToPipes() const;
+    bool appliesToStations() const;
+    std::string toString() const;
+    void appendTo(std::string& out) const; // toString() without the temporary
+
+private:
+    Kind k = Kind::All;
+    std::string str;
+    std::string folded;
+    double low = 0.0;
+    double high = 0.0;
+    std::vector<Predicate> args;
+
+    static Predicate combine(Kind kind, Predicate a, Predicate b);
+};
+
+enum class QueryOrder { None, Id, Name, Diameter, TotalWorkshops, WorkingWorkshops, IdlePercent };
+
+struct QueryOptions {
+    QueryOrder order = QueryOrder::None;
+    bool descending = false;
+    size_t limit = std::numeric_limits<size_t>::max();
+    bool count_only = false; // skip the callback, only return the number of matches
+};
+
+// Access path chosen by the planner: where candidate slots come from before
+// the whole predicate is checked against the columns.
+struct QueryPlan {
+    enum class Source { Scan, NameIndex, RepairBitmap, IdleIndex, Union };
+    Source source = Source::Scan;
+    const Predicate* term = nullptr; // leaf the index source reads
+    double cost = 0.0;               // estimated rows touched
+    std::vector<QueryPlan> parts;    // Union: one plan per OR branch
+
+    std::string toString() const;
+    void appendTo(std::string& out) const;
+};
+
+// Fused evaluation of a whole predicate over one 64-slot word: returns the
+// subset of cand (bit i = slot w * 64 + i) that matches. AND narrows the
+// candidate mask child by child, OR only tests what earlier branches missed.
+uint64_t matchPipeWord(const Predicate& p, const PipeColumns& c, size_t w, uint64_t cand);
+uint64_t matchStationWord(const Predicate& p, const StationColumns& c, size_t w, uint64_t cand);
+
+#endif // QUERY_H
@@ -0,0 +1,469 @@
+#include "Script.h"
+#include "TextFields.h"
+#include "Export.h"
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// input read per chunk; a chunk ends at the last newline it holds
+const size_t kChunkBytes = 1 << 20;
+// chunks alive at once: parsed ahead of execution plus the one executing
+const size_t kChunksInFlight = 4;
+// errors reported one by one; the rest are only counted
+const size_t kErrorsShown = 100;
+// largest reserve operand; reserve allocates the slot pages up front
+const uint64_t kMaxReserve = uint64_t(1) << 24;
+
+enum class Op : uint8_t {
+    Invalid, Reserve, AddPipe, AddStation, EditPipe, EditStation,
+    RemovePipe, RemoveStation, Connect, Disconnect, FindPipes, FindStations, Save
+};
+
+enum class Field : uint8_t { Name, Diameter, Repair, Total, Working, Class };
+
+// one parsed line; views point into the chunk's text
+struct Command {
+    Op op = Op::Invalid;
+    Field field = Field::Name;
+    bool flag = false;        // in repair / ignore case / text format
+    int total = 0, working = 0;
+    uint64_t id = 0, a = 0, b = 0;
+    double number = 0.0;
+    std::string_view text;    // name, search text, file name or new text value
+    std::string_view extra;   // classification of a new station
+    const char* error = nullptr;
+    uint64_t line = 0;
+};
+
+struct Chunk {
+    std::string data;
+    std::vector<Command> commands;
+    uint64_t first_line = 0; // number of the line before the chunk's first
+    uint64_t lines = 0;
+    bool last = false;       // nothing follows
+};
+
+bool parseFlag(std::string_view f, bool& v) {
+    if (f == "0") { v = false; return true; }
+    if (f == "1") { v = true; return true; }
+    return false;
+}
+
+const char* parseCommand(std::string_view line, Command& c) {
+    std::string_view f[6];
+    size_t n = splitFields(line, f, 6);
+    std::string_view op = f[0];
+    auto fields = [&](size_t want) { return n == want; };
+    if (op == "ap") {
+        c.op = Op::AddPipe;
+        if (!fields(4)) return "wrong number of fields";
+        c.text = f[1];
+        if (c.text.empty()) return "empty name";
+        if (!parseField(f[2], c.number) || !(c.number > 0.0)) return "bad diameter";
+        if (!parseFlag(f[3], c.flag)) return "bad repair flag";
+    } else if (op == "as") {
+        c.op = Op::AddStation;
+        if (!fields(5)) return "wrong number of fields";
+        c.text = f[1];
+        if (c.text.empty()) return "empty name";
+        if (!parseField(f[2], c.total) || c.total < 0) return "bad total";
+        if (!parseField(f[3], c.working) || c.working < 0 || c.working > c.total) return "bad working";
+        c.extra = f[4];
+    } else if (op == "ep" || op == "es") {
+        bool pipe = op == "ep";
+        c.op = pipe ? Op::EditPipe : Op::EditStation;
+        if (!fields(4)) return "wrong number of fields";
+        if (!parseField(f[1], c.id)) return "bad id";
+        std::string_view field = f[2], value = f[3];
+        c.text = value;
+        if (field == "name") {
+            c.field = Field::Name;
+            if (value.empty()) return "empty name";
+        } else if (pipe && field == "diameter") {
+            c.field = Field::Diameter;
+            if (!parseField(value, c.number) || !(c.number > 0.0)) return "bad diameter";
+        } else if (pipe && field == "repair") {
+            c.field = Field::Repair;
+            if (!parseFlag(value, c.flag)) return "bad repair flag";
+        } else if (!pipe && (field == "total" || field == "working")) {
+            c.field = field == "total" ? Field::Total : Field::Working;
+            int& v = c.field == Field::Total ? c.total : c.working;
+            if (!parseField(value, v) || v < 0) return "bad number";
+        } else if (!pipe && field == "class") {
+            c.field = Field::Class;
+        } else {
+            return "unknown field";
+        }
+    } else if (op == "rp" || op == "rs" || op == "dp") {
+        c.op = op == "rp" ? Op::RemovePipe : op == "rs" ? Op::RemoveStation : Op::Disconnect;
+        if (!fields(2)) return "wrong number of fields";
+        if (!parseField(f[1], c.id)) return "bad id";
+    } else if (op == "cp") {
+        c.op = Op::Connect;
+        if (!fields(4)) return "wrong number of fields";
+        if (!parseField(f[1], c.id) || !parseField(f[2], c.a) || !parseField(f[3], c.b)) return "bad id";
+    } else if (op == "fp" || op == "fs") {
+        c.op = op == "fp" ? Op::FindPipes : Op::FindStations;
+        if (!fields(2) && !fields(3)) return "wrong number of fields";
+        c.text = f[1];
+        if (n == 3 && f[2] != "i") return "bad search flag";
+        c.flag = n == 3;
+    } else if (op == "save") {
+        c.op = Op::Save;
+        if (!fields(2) && !fields(3)) return "wrong number of fields";
+        c.text = f[1];
+        if (c.text.empty()) return "empty file name";
+        if (n == 3 && f[2] != "text" && f[2] != "binary") return "bad format";
+        c.flag = n == 3 && f[2] == "text";
+    } else if (op == "reserve") {
+        c.op = Op::Reserve;
+        if (!fields(3)) return "wrong number of fields";
+        if (!parseField(f[1], c.a) || !parseField(f[2], c.b)) return "bad number";
+        if (c.a > kMaxReserve || c.b > kMaxReserve) return "reserve over 16777216";
+    } else {
+        return "unknown command";
+    }
+    return nullptr;
+}
+
+void parseChunk(Chunk& chunk) {
+    chunk.commands.clear();
+    const char* p = chunk.data.data();
+    const char* end = p + chunk.data.size();
+    uint64_t line = chunk.first_line;
+    while (p < end) {
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', size_t(end - p)));
+        const char* stop = nl ? nl : end;
+        std::string_view text(p, size_t(stop - p));
+        p = nl ? nl + 1 : end;
+        ++line;
+        if (!text.empty() && text.back() == '\r') text.remove_suffix(1);
+        if (text.empty() || text[0] == '#') continue;
+        Command c;
+        c.line = line;
+        c.error = parseCommand(text, c);
+        if (c.error) c.op = Op::Invalid;
+        chunk.commands.push_back(c);
+    }
+    chunk.lines = line - chunk.first_line;
+}
+
+// Chunks go round between the reader (free -> ready) and the executor
+// (ready -> free); the reader waits when all of them are ahead of execution.
+// stop() ends the round early: the reader gets no more free chunks.
+class ChunkPipe {
+public:
+    ChunkPipe() {
+        for (auto& c : chunks) {
+            c = std::make_unique<Chunk>();
+            free_list[free_count++] = c.get();
+        }
+    }
+
+    // null once stopped
+    Chunk* takeFree() {
+        std::unique_lock<std::mutex> lk(lock);
+        free_cv.wait(lk, [&]{ return free_count > 0 || stopped; });
+        if (stopped) return nullptr;
+        return free_list[--free_count];
+    }
+
+    void putFree(Chunk* c) {
+        {
+            std::lock_guard<std::mutex> lk(lock);
+            free_list[free_count++] = c;
+        }
+        free_cv.notify_one();
+    }
+
+    // ready chunks leave in input order
+    Chunk* takeReady() {
+        std::unique_lock<std::mutex> lk(lock);
+        ready_cv.wait(lk, [&]{ return ready_count > 0; });
+        Chunk* c = ready[ready_head];
+        ready_head = (ready_head + 1) % kChunksInFlight;
+        --ready_count;
+        return c;
+    }
+
+    void putReady(Chunk* c) {
+        {
+            std::lock_guard<std::mutex> lk(lock);
+            ready[(ready_head + ready_count++) % kChunksInFlight] = c;
+        }
+        ready_cv.notify_one();
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lk(lock);
+            stopped = true;
+        }
+        free_cv.notify_one();
+    }
+
+private:
+    std::unique_ptr<Chunk> chunks[kChunksInFlight];
+    std::mutex lock;
+    std::condition_variable free_cv, ready_cv;
+    Chunk* free_list[kChunksInFlight];
+    size_t free_count = 0;
+    Chunk* ready[kChunksInFlight];
+    size_t ready_head = 0, ready_count = 0;
+    bool stopped = false;
+};
+
+// c is the chunk in hand, null between chunks
+void readLoop(std::FILE* in, ChunkPipe& pipe, uint64_t& bytes, bool& read_ok, Chunk*& c) {
+    std::string carry; // a line started at the end of the previous chunk
+    uint64_t line = 0;
+    bool eof = false;
+    while (!eof) {
+        c = pipe.takeFree();
+        if (!c) return;
+        c->data.assign(carry);
+        carry.clear();
+        while (true) {
+            size_t have = c->data.size();
+            c->data.resize(have + kChunkBytes);
+            size_t got = std::fread(&c->data[have], 1, kChunkBytes, in);
+            c->data.resize(have + got);
+            bytes += got;
+            if (got < kChunkBytes) {
+                eof = true;
+                read_ok = !std::ferror(in);
+                break;
+            }
+            size_t nl = c->data.rfind('\n');
+            if (nl != std::string::npos) {
+                carry.assign(c->data, nl + 1, std::string::npos);
+                c->data.resize(nl + 1);
+                break;
+            }
+        }
+        c->first_line = line;
+        parseChunk(*c);
+        line += c->lines;
+        c->last = eof;
+        pipe.putReady(c);
+        c = nullptr;
+    }
+}
+
+// Reader thread: fill, parse and hand over chunks until the input ends or
+// the pipe is stopped. A failure (no memory for an overlong line) ends the
+// input early: the chunk in hand goes out empty and marked last.
+void readChunks(std::FILE* in, ChunkPipe& pipe, uint64_t& bytes, bool& read_ok) {
+    Chunk* c = nullptr;
+    try {
+        readLoop(in, pipe, bytes, read_ok, c);
+    } catch (const std::exception&) {
+        read_ok = false;
+        if (!c) c = pipe.takeFree();
+        if (c) {
+            c->data.clear();
+            c->commands.clear();
+            c->lines = 0;
+            c->last = true;
+            pipe.putReady(c);
+        }
+    }
+}
+
+// Owns the reader thread and stops and joins it on every way out of
+// runScript. A reader blocked on a pipe or a terminal finishes its read first.
+class Reader {
+public:
+    Reader(std::FILE* in, ChunkPipe& pipe_, uint64_t& bytes, bool& read_ok)
+        : pipe(pipe_), thread(readChunks, in, std::ref(pipe_), std::ref(bytes), std::ref(read_ok)) {}
+    ~Reader() { join(); }
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    void join() {
+        if (!thread.joinable()) return;
+        pipe.stop();
+        thread.join();
+    }
+
+private:
+    ChunkPipe& pipe;
+    std::thread thread;
+};
+
+class Executor {
+public:
+    Executor(Manager& m_, std::FILE* out_, std::FILE* err_, ScriptSummary& sum_)
+        : m(m_), out(out_), err(err_), sum(sum_) {}
+
+    // a command that throws (out of memory, say) counts as failed
+    void run(const Command& c) {
+        sum.commands++;
+        try {
+            apply(c);
+        } catch (const std::exception& e) {
+            fail(c, e.what());
+        }
+    }
+
+private:
+    Manager& m;
+    std::FILE* out;
+    std::FILE* err;
+    ScriptSummary& sum;
+    // reused for every command
+    std::string name, extra, buf;
+
+    void apply(const Command& c) {
+        switch (c.op) {
+            case Op::Invalid: fail(c, c.error); break;
+            case Op::Reserve:
+                m.reserve(m.getPipes().size() + size_t(c.a), m.getStations().size() + size_t(c.b));
+                break;
+            case Op::AddPipe:
+                name.assign(c.text);
+                m.addPipe(name, c.number, c.flag);
+                sum.pipes_added++;
+                break;
+            case Op::AddStation:
+                name.assign(c.text);
+                extra.assign(c.extra);
+                m.addStation(name, c.total, c.working, extra);
+                sum.stations_added++;
+                break;
+            case Op::EditPipe: editPipe(c); break;
+            case Op::EditStation: editStation(c); break;
+            case Op::RemovePipe:
+                sum.removals++;
+                if (!m.removePipeById(c.id)) fail(c, "no such pipe");
+                break;
+            case Op::RemoveStation:
+                sum.removals++;
+                if (!m.removeStationById(c.id)) fail(c, "no such station");
+                break;
+            case Op::Connect:
+                sum.edits++;
+                if (!m.connectPipe(c.id, c.a, c.b)) fail(c, "cannot connect: unknown pipe or stations, or stations equal");
+                break;
+            case Op::Disconnect:
+                sum.edits++;
+                if (!m.disconnectPipe(c.id)) fail(c, "no such connected pipe");
+                break;
+            case Op::FindPipes:
+            case Op::FindStations: find(c); break;
+            case Op::Save:
+                sum.saves++;
+                name.assign(c.text);
+                if (!m.saveToFile(name, c.flag ? SaveFormat::Text : SaveFormat::Binary)) fail(c, "save failed");
+                break;
+        }
+    }
+
+    void fail(const Command& c, const char* what) {
+        if (sum.errors++ < kErrorsShown)
+            std::fprintf(err, "line %llu: %s\n", static_cast<unsigned long long>(c.line), what);
+        else if (sum.errors == kErrorsShown + 1)
+            std::fprintf(err, "further errors are only counted\n");
+    }
+
+    void editPipe(const Command& c) {
+        sum.edits++;
+        bool ok = false;
+        switch (c.field) {
+            case Field::Name: name.assign(c.text); ok = m.setPipeName(c.id, name); break;
+            case Field::Diameter: ok = m.setPipeDiameter(c.id, c.number); break;
+            case Field::Repair: ok = m.setPipeInRepair(c.id, c.flag); break;
+            default: break;
+        }
+        if (!ok) fail(c, "no such pipe");
+    }
+
+    void editStation(const Command& c) {
+        sum.edits++;
+        bool ok = false;
+        switch (c.field) {
+            case Field::Name: name.assign(c.text); ok = m.setStationName(c.id, name); break;
+            case Field::Total: ok = m.setStationTotalWorkshops(c.id, c.total); break;
+            case Field::Working: ok = m.setStationWorkingWorkshops(c.id, c.working); break;
+            case Field::Class: name.assign(c.text); ok = m.setStationClassification(c.id, name); break;
+            default: break;
+        }
+        if (!ok) fail(c, "no such station");
+    }
+
+    // "line N: K found" and the matches in the console layout
+    void find(const Command& c) {
+        sum.searches++;
+        name.assign(c.text);
+        NameMatch match = c.flag ? NameMatch::IgnoreCase : NameMatch::Exact;
+        buf.clear();
+        char num[24];
+        buf += "line ";
+        buf.append(num, std::to_chars(num, num + sizeof(num), c.line).ptr);
+        buf += ": ";
+        if (c.op == Op::FindPipes) {
+            std::vector<const Pipe*> res = m.findPipesByName(name, match);
+            buf.append(num, std::to_chars(num, num + sizeof(num), res.size()).ptr);
+            buf += " found\n";
+            for (const Pipe* p : res) formatRecord(buf, *p, ExportFormat::Text);
+        } else {
+            std::vector<const CompressorStation*> res = m.findStationsByName(name, match);
+            buf.append(num, std::to_chars(num, num + sizeof(num), res.size()).ptr);
+            buf += " found\n";
+            for (const CompressorStation* s : res) formatRecord(buf, *s, ExportFormat::Text);
+        }
+        std::fwrite(buf.data(), 1, buf.size(), out);
+    }
+};
+
+}
+
+std::string ScriptSummary::toString() const {
+    std::ostringstream oss;
+    oss << "lines=" << lines << " commands=" << commands << " errors=" << errors
+        << " pipes_added=" << pipes_added << " stations_added=" << stations_added
+        << " edits=" << edits << " removals=" << removals << " searches=" << searches << " saves=" << saves
+        << " bytes=" << bytes << " seconds=" << seconds << " commands_per_second=" << commandsPerSecond();
+    if (!read_ok) oss << " (input read failed)";
+    return oss.str();
+}
+
+ScriptSummary runScript(Manager& manager, std::FILE* in, std::FILE* out, std::FILE* err) {
+    using Clock = std::chrono::steady_clock;
+    ScriptSummary sum;
+    Clock::time_point start = Clock::now();
+    auto elapsed = [&]{ return std::chrono::duration<double>(Clock::now() - start).count(); };
+    ChunkPipe pipe;
+    uint64_t bytes = 0;
+    bool read_ok = true;
+    Reader reader(in, pipe, bytes, read_ok);
+
+    manager.beginBulk();
+    Executor exec(manager, out, err, sum);
+    while (true) {
+        Chunk* c = pipe.takeReady();
+        for (const Command& cmd : c->commands) exec.run(cmd);
+        sum.lines += c->lines;
+        bool last = c->last;
+        pipe.putFree(c);
+        if (last) break;
+    }
+    reader.join();
+    sum.bytes = bytes;
+    sum.read_ok = read_ok;
+    sum.seconds = elapsed();
+    manager.endBulk(sum.toString());
+    // the index rebuilds in endBulk() are part of the run
+    sum.seconds = elapsed();
+    std::fflush(out);
+    return sum;
+}
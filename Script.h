@@ -0,0 +1,57 @@
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include "Manager.h"
+#include <cstdio>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Batch mode: a command stream applied to one Manager (app --script FILE).
+//
+// One command per line, fields separated by '|' as in the text save format
+// (so names cannot contain '|'); blank lines and lines starting with '#' are
+// skipped.
+//   reserve|PIPES|STATIONS         pre-size storage for that many more
+//                                  (at most 2^24 each)
+//   ap|NAME|DIAMETER|REPAIR        add a pipe (REPAIR 0 or 1)
+//   as|NAME|TOTAL|WORKING|CLASS    add a station
+//   ep|ID|FIELD|VALUE              edit a pipe: name, diameter, repair
+//   es|ID|FIELD|VALUE              edit a station: name, total, working, class
+//   rp|ID  rs|ID                   remove a pipe / a station
+//   cp|PIPE|IN|OUT  dp|PIPE        connect / disconnect a pipe
+//   fp|TEXT[|i]  fs|TEXT[|i]       pipes / stations whose name contains TEXT
+//                                  (i: ignoring case), listed on out
+//   save|FILE[|text|binary]        save (binary unless text is given)
+// New ids are handed out in order from the manager's next id (1, 2, ... in
+// an empty network), so a script can refer to what it added.
+//
+// A reader thread cuts the input into line-aligned chunks and parses them
+// while the calling thread executes the chunks parsed before; chunks and
+// their command arrays are recycled, so the pipeline allocates nothing once
+// it is full. The run is one Manager bulk run (see Manager::beginBulk): no
+// log line per command, and the name indexes and connectivity are rebuilt
+// once at the end. A command that cannot be parsed, fails or throws is
+// reported on err with its line number and skipped.
+struct ScriptSummary {
+    size_t lines = 0;
+    size_t commands = 0;     // executed, failed ones included
+    size_t errors = 0;
+    size_t pipes_added = 0;
+    size_t stations_added = 0;
+    size_t edits = 0;        // edits, connects and disconnects
+    size_t removals = 0;
+    size_t searches = 0;
+    size_t saves = 0;
+    uint64_t bytes = 0;      // of input
+    double seconds = 0.0;
+    bool read_ok = true;     // false if the input could not be read to the end
+
+    double commandsPerSecond() const { return seconds > 0 ? double(commands) / seconds : 0.0; }
+    std::string toString() const;
+};
+
+// runs every command of in (not closed); search results go to out
+ScriptSummary runScript(Manager& manager, std::FILE* in, std::FILE* out, std::FILE* err);
+
+#endif // SCRIPT_H
@@ -0,0 +1,602 @@
+#include "Server.h"
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// below this many reads per batch the loop serves them itself
+const size_t kParallelReads = 256;
+// stop reading from a connection while this much output is unsent
+const size_t kMaxUnsent = size_t(4) << 20;
+const uint32_t kMaxListed = 10000;
+
+}
+
+Server::Server(Manager& manager_, size_t workers_)
+    : manager(manager_),
+      worker_count(workers_ ? workers_ : std::max(1u, std::thread::hardware_concurrency())) {
+#ifdef __linux__
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+}
+
+Server::~Server() {
+    shutdown();
+}
+
+#ifdef __linux__
+bool Server::listen(const std::string& address, std::string& error) {
+    ServerAddress a;
+    if (!parseServerAddress(address, a, error)) return false;
+    if (epoll_fd < 0 || wake_fd < 0) {
+        error = std::string("epoll: ") + std::strerror(errno);
+        return false;
+    }
+    int fd;
+    int rc;
+    if (a.unix_socket) {
+        fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        sockaddr_un sa{};
+        sa.sun_family = AF_UNIX;
+        std::memcpy(sa.sun_path, a.path.c_str(), a.path.size() + 1);
+        ::unlink(a.path.c_str());
+        rc = fd < 0 ? -1 : ::bind(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa));
+    } else {
+        fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        sockaddr_in sa{};
+        sa.sin_family = AF_INET;
+        sa.sin_port = htons(a.port);
+        if (inet_pton(AF_INET, a.host.c_str(), &sa.sin_addr) != 1) {
+            if (fd >= 0) ::close(fd);
+            error = "bad tcp host: " + a.host;
+            return false;
+        }
+        int one = 1;
+        if (fd >= 0) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        rc = fd < 0 ? -1 : ::bind(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa));
+    }
+    if (rc != 0 || ::listen(fd, SOMAXCONN) != 0) {
+        error = "cannot listen on " + address + ": " + std::strerror(errno);
+        if (fd >= 0) ::close(fd);
+        return false;
+    }
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.ptr = &listen_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+    listen_fd = fd;
+    if (a.unix_socket) unix_path = a.path;
+    manager.writeLog("Server listening on " + address + " workers=" + std::to_string(worker_count));
+    return true;
+}
+
+bool Server::run() {
+    if (listen_fd < 0) return false;
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.ptr = &wake_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev);
+    // workers read published versions only
+    manager.publish();
+    for (size_t i = 0; i < worker_count; ++i) workers.emplace_back([this]{ workerLoop(); });
+
+    std::vector<Connection*> touched;
+    epoll_event events[256];
+    while (!stopping.load(std::memory_order_acquire)) {
+        int n = epoll_wait(epoll_fd, events, 256, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            void* tag = events[i].data.ptr;
+            if (tag == &listen_fd) { acceptAll(); continue; }
+            if (tag == &wake_fd) {
+                uint64_t count;
+                while (::read(wake_fd, &count, 8) == 8) {}
+                collectDone();
+                continue;
+            }
+            Connection& c = *static_cast<Connection*>(tag);
+            if (c.closed) continue;
+            uint32_t e = events[i].events;
+            if (e & EPOLLIN) onReadable(c);
+            else if (e & (EPOLLERR | EPOLLHUP)) closeConnection(c);
+            if (!c.closed && (e & EPOLLOUT)) onWritable(c);
+        }
+        dispatchReads();
+        // every reply produced in this round leaves in one send per connection
+        touched.swap(dirty);
+        for (Connection* c : touched) {
+            c->dirty = false;
+            if (!c->closed) flush(*c);
+        }
+        touched.clear();
+        closing.erase(std::remove_if(closing.begin(), closing.end(),
+                                     [](const std::unique_ptr<Connection>& c){ return c->inflight == 0; }),
+                      closing.end());
+    }
+    shutdown();
+    return true;
+}
+
+void Server::stop() {
+    stopping.store(true, std::memory_order_release);
+    uint64_t one = 1;
+    if (wake_fd >= 0) {
+        ssize_t rc = ::write(wake_fd, &one, 8);
+        (void)rc;
+    }
+}
+
+void Server::acceptAll() {
+    while (true) {
+        int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            return; // EAGAIN, or out of descriptors until some close
+        }
+        if (unix_path.empty()) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        auto c = std::make_unique<Connection>();
+        c->fd = fd;
+        c->events = EPOLLIN;
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = c.get();
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+        connections[fd] = std::move(c);
+        stats.connections.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Server::onReadable(Connection& c) {
+    char buf[1 << 16];
+    for (int reads = 0; reads < 16; ++reads) {
+        ssize_t n = ::recv(c.fd, buf, sizeof(buf), 0);
+        if (n > 0) {
+            c.in.append(buf, size_t(n));
+            if (size_t(n) < sizeof(buf)) break;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        closeConnection(c); // EOF or error
+        return;
+    }
+    while (true) {
+        size_t len = frameLength(c.in.data() + c.in_pos, c.in.size() - c.in_pos);
+        if (len == 0) break;
+        if (len == SIZE_MAX) {
+            manager.writeLog("Server: oversized frame, connection dropped");
+            closeConnection(c);
+            return;
+        }
+        handle(c, c.in.data() + c.in_pos + 4, len - 4);
+        c.in_pos += len;
+    }
+    if (c.in_pos == c.in.size()) {
+        c.in.clear();
+        c.in_pos = 0;
+    } else if (c.in_pos > c.in.size() / 2) {
+        c.in.erase(0, c.in_pos);
+        c.in_pos = 0;
+    }
+    touch(c);
+}
+
+void Server::onWritable(Connection& c) {
+    flush(c);
+}
+
+// Reads of published data are queued for dispatchReads(); everything else
+// runs here, on the loop thread, in arrival order.
+void Server::handle(Connection& c, const char* body, size_t n) {
+    stats.requests.fetch_add(1, std::memory_order_relaxed);
+    FrameReader r(body, n);
+    uint8_t code = r.u8();
+    uint32_t tag = r.u32();
+    ServerOp op = ServerOp(code);
+    if (r.ok && (op == ServerOp::GetPipe || op == ServerOp::GetStation ||
+                 op == ServerOp::ListPipes || op == ServerOp::ListStations)) {
+        uint64_t id = r.u64();
+        uint32_t limit = (op == ServerOp::ListPipes || op == ServerOp::ListStations) ? r.u32() : 0;
+        if (r.ok && r.atEnd()) {
+            c.replies.emplace_back();
+            pending.push_back(ReadTask{ &c, &c.replies.back(), op, tag, id, std::min(limit, kMaxListed) });
+            ++c.inflight;
+            c.reading = true;
+            return;
+        }
+    }
+    // the reads queued before this request must not see it
+    if (c.reading) dispatchReads();
+    std::string* out = &c.out;
+    if (!c.replies.empty()) {
+        // queue behind the reads still in flight
+        c.replies.emplace_back();
+        c.replies.back().ready = true;
+        out = &c.replies.back().data;
+    }
+    if (!r.ok || code == 0 || code >= uint8_t(ServerOp::Count)) {
+        stats.bad_requests.fetch_add(1, std::memory_order_relaxed);
+        FrameWriter(*out).response(ServerStatus::BadRequest, tag).end();
+        return;
+    }
+    execute(op, tag, r, *out);
+}
+
+void Server::execute(ServerOp op, uint32_t tag, FrameReader& r, std::string& out) {
+    size_t start = out.size();
+    FrameWriter w(out);
+    auto status = [&](bool ok) { w.response(ok ? ServerStatus::Ok : ServerStatus::NotFound, tag); };
+    try {
+        switch (op) {
+            case ServerOp::Ping:
+                if (!r.atEnd()) break;
+                status(true);
+                w.end();
+                return;
+            case ServerOp::AddPipe: {
+                std::string name(r.str());
+                double diameter = r.f64();
+                bool in_repair = r.u8() != 0;
+                if (!r.ok || !r.atEnd()) break;
+                uint64_t id = manager.addPipe(name, diameter, in_repair);
+                unpublished = true;
+                status(true);
+                w.u64(id).end();
+                return;
+            }
+            case ServerOp::AddStation: {
+                std::string name(r.str());
+                int32_t total = r.i32(), working = r.i32();
+                std::string classification(r.str());
+                if (!r.ok || !r.atEnd()) break;
+                uint64_t id = manager.addStation(name, total, working, classification);
+                unpublished = true;
+                status(true);
+                w.u64(id).end();
+                return;
+            }
+            case ServerOp::RemovePipe:
+            case ServerOp::RemoveStation: {
+                uint64_t id = r.u64();
+                if (!r.ok || !r.atEnd()) break;
+                status(op == ServerOp::RemovePipe ? manager.removePipeById(id) : manager.removeStationById(id));
+                unpublished = true;
+                w.end();
+                return;
+            }
+            case ServerOp::SetPipeName: {
+                uint64_t id = r.u64();
+                std::string name(r.str());
+                if (!r.ok || !r.atEnd()) break;
+                status(manager.setPipeName(id, name));
+                unpublished = true;
+                w.end();
+                return;
+            }
+            case ServerOp::SetPipeDiameter: {
+                uint64_t id = r.u64();
+                double diameter = r.f64();
+                if (!r.ok || !r.atEnd()) break;
+                status(manager.setPipeDiameter(id, diameter));
+                unpublished = true;
+                w.end();
+                return;
+            }
+            case ServerOp::SetPipeInRepair: {
+                uint64_t id = r.u64();
+                bool in_repair = r.u8() != 0;
+                if (!r.ok || !r.atEnd()) break;
+                status(manager.setPipeInRepair(id, in_repair));
+                unpublished = true;
+                w.end();
+                return;
+            }
+            case ServerOp::SetStationTotal:
+            case ServerOp::SetStationWorking: {
+                uint64_t id = r.u64();
+                int32_t value = r.i32();
+                if (!r.ok || !r.atEnd()) break;
+                status(op == ServerOp::SetStationTotal ? manager.setStationTotalWorkshops(id, value)
+                                                       : manager.setStationWorkingWorkshops(id, value));
+                unpublished = true;
+                w.end();
+                return;
+            }
+            case ServerOp::ConnectPipe: {
+                uint64_t id = r.u64(), in = r.u64(), to = r.u64();
+                if (!r.ok || !r.atEnd()) break;
+                status(in == 0 ? manager.disconnectPipe(id) : manager.connectPipe(id, in, to));
+                unpublished = true;
+                w.end();
+                return;
+            }
+            case ServerOp::UpdatePipesRepair: {
+                std::vector<uint64_t> ids;
+                r.ids(ids);
+                bool in_repair = r.u8() != 0;
+                if (!r.ok || !r.atEnd()) break;
+                size_t n = manager.updatePipes(ids, PipeUpdate().setInRepair(in_repair));
+                unpublished = true;
+                status(true);
+                w.u64(n).end();
+                return;
+            }
+            case ServerOp::FindPipesByName:
+            case ServerOp::FindStationsByName: {
+                std::string substring(r.str());
+                NameMatch match = !r.atEnd() && r.u8() ? NameMatch::IgnoreCase : NameMatch::Exact;
+                if (!r.ok || !r.atEnd()) break;
+                std::vector<uint64_t> ids;
+                if (op == ServerOp::FindPipesByName) {
+                    for (const Pipe* p : manager.findPipesByName(substring, match)) ids.push_back(p->getId());
+                } else {
+                    for (const CompressorStation* s : manager.findStationsByName(substring, match)) ids.push_back(s->getId());
+                }
+                status(true);
+                w.ids(ids).end();
+                return;
+            }
+            case ServerOp::StationsConnected: {
+                uint64_t a = r.u64(), b = r.u64();
+                if (!r.ok || !r.atEnd()) break;
+                status(true);
+                w.u8(manager.stationsConnected(a, b)).end();
+                return;
+            }
+            case ServerOp::FindIsolatedStations: {
+                if (!r.atEnd()) break;
+                std::vector<uint64_t> ids;
+                for (const CompressorStation* s : manager.findIsolatedStations()) ids.push_back(s->getId());
+                status(true);
+                w.ids(ids).end();
+                return;
+            }
+            case ServerOp::GetStats: {
+                if (!r.atEnd()) break;
+                NetworkStats s = manager.getStats();
+                status(true);
+                w.u64(s.pipes).u64(s.pipes_in_repair).f64(s.averageDiameter()).f64(s.min_diameter).f64(s.max_diameter)
+                 .u64(s.stations).i64(s.total_workshops).i64(s.working_workshops).f64(s.overallIdlePercent()).end();
+                return;
+            }
+            case ServerOp::MaxFlow: {
+                uint64_t source = r.u64(), sink = r.u64();
+                if (!r.ok || !r.atEnd()) break;
+                FlowResult f = manager.maxFlow(source, sink);
+                status(true);
+                w.f64(f.flow).ids(f.cut).end();
+                return;
+            }
+            case ServerOp::Save: {
+                std::string filename(r.str());
+                bool binary = r.u8() != 0;
+                if (!r.ok || !r.atEnd()) break;
+                bool ok = manager.saveToFile(filename, binary ? SaveFormat::Binary : SaveFormat::Text);
+                w.response(ok ? ServerStatus::Ok : ServerStatus::Failed, tag).end();
+                return;
+            }
+            default:
+                break;
+        }
+    } catch (const std::exception& e) {
+        manager.writeLog(std::string("Server: request failed: ") + e.what());
+        out.resize(start);
+        FrameWriter(out).response(ServerStatus::Failed, tag).end();
+        return;
+    }
+    // malformed operands
+    stats.bad_requests.fetch_add(1, std::memory_order_relaxed);
+    out.resize(start);
+    FrameWriter(out).response(ServerStatus::BadRequest, tag).end();
+}
+
+void Server::executeRead(const VersionStore::ReadView& view, const ReadTask& t, std::string& out) {
+    FrameWriter w(out);
+    switch (t.op) {
+        case ServerOp::GetPipe:
+            if (const Pipe* p = view.findPipe(t.id)) w.response(ServerStatus::Ok, t.tag).pipe(*p);
+            else w.response(ServerStatus::NotFound, t.tag);
+            break;
+        case ServerOp::GetStation:
+            if (const CompressorStation* s = view.findStation(t.id)) w.response(ServerStatus::Ok, t.tag).station(*s);
+            else w.response(ServerStatus::NotFound, t.tag);
+            break;
+        default: {
+            // listings: the count is patched once known
+            w.response(ServerStatus::Ok, t.tag).u32(0);
+            size_t at = out.size() - 4;
+            uint32_t n = 0;
+            if (t.id != UINT64_MAX && t.limit) {
+                if (t.op == ServerOp::ListPipes) {
+                    view.scanPipes(t.id + 1, [&](const Pipe& p){ w.pipe(p); return ++n < t.limit; });
+                } else {
+                    view.scanStations(t.id + 1, [&](const CompressorStation& s){ w.station(s); return ++n < t.limit; });
+                }
+            }
+            std::memcpy(&out[at], &n, 4);
+            break;
+        }
+    }
+    w.end();
+}
+
+// Publishes the round's writes once, then serves the round's reads: inline
+// when there are few, otherwise in one chunk per worker.
+void Server::dispatchReads() {
+    if (pending.empty()) return;
+    if (unpublished) {
+        manager.publish();
+        unpublished = false;
+    }
+    for (const ReadTask& t : pending) t.conn->reading = false;
+    if (pending.size() < kParallelReads) {
+        VersionStore::ReadView view(manager.getVersions());
+        for (const ReadTask& t : pending) {
+            executeRead(view, t, t.reply->data);
+            t.reply->ready = true;
+            --t.conn->inflight;
+            touch(*t.conn);
+        }
+        pending.clear();
+        return;
+    }
+    stats.parallel_reads.fetch_add(pending.size(), std::memory_order_relaxed);
+    size_t chunks = std::min(worker_count, (pending.size() + kParallelReads / 2 - 1) / (kParallelReads / 2));
+    size_t per = (pending.size() + chunks - 1) / chunks;
+    auto view = std::make_shared<VersionStore::ReadView>(manager.getVersions());
+    {
+        std::lock_guard<std::mutex> lk(lock);
+        for (size_t begin = 0; begin < pending.size(); begin += per) {
+            auto job = std::make_unique<Job>();
+            job->view = view;
+            job->tasks.assign(pending.begin() + begin, pending.begin() + std::min(pending.size(), begin + per));
+            jobs.push_back(std::move(job));
+        }
+    }
+    cv.notify_all();
+    pending.clear();
+}
+
+void Server::collectDone() {
+    std::vector<std::unique_ptr<Job>> finished;
+    {
+        std::lock_guard<std::mutex> lk(lock);
+        finished.swap(done);
+    }
+    for (const auto& job : finished) {
+        for (const ReadTask& t : job->tasks) {
+            t.reply->ready = true;
+            --t.conn->inflight;
+            touch(*t.conn);
+        }
+    }
+}
+
+void Server::workerLoop() {
+    while (true) {
+        std::unique_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lk(lock);
+            cv.wait(lk, [&]{ return quit || !jobs.empty(); });
+            if (jobs.empty()) return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        for (const ReadTask& t : job->tasks) executeRead(*job->view, t, t.reply->data);
+        job->view.reset();
+        {
+            std::lock_guard<std::mutex> lk(lock);
+            done.push_back(std::move(job));
+        }
+        uint64_t one = 1;
+        ssize_t rc = ::write(wake_fd, &one, 8);
+        (void)rc;
+    }
+}
+
+void Server::touch(Connection& c) {
+    if (c.dirty) return;
+    c.dirty = true;
+    dirty.push_back(&c);
+}
+
+// moves the ready head of the reply queue to the output and sends what it can
+void Server::flush(Connection& c) {
+    while (!c.replies.empty() && c.replies.front().ready) {
+        c.out += c.replies.front().data;
+        c.replies.pop_front();
+    }
+    while (c.out_pos < c.out.size()) {
+        ssize_t n = ::send(c.fd, c.out.data() + c.out_pos, c.out.size() - c.out_pos, MSG_NOSIGNAL);
+        if (n > 0) { c.out_pos += size_t(n); continue; }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        closeConnection(c);
+        return;
+    }
+    if (c.out_pos == c.out.size()) {
+        c.out.clear();
+        c.out_pos = 0;
+    } else if (c.out_pos > (size_t(1) << 20)) {
+        c.out.erase(0, c.out_pos);
+        c.out_pos = 0;
+    }
+    updateInterest(c);
+}
+
+void Server::updateInterest(Connection& c) {
+    size_t unsent = c.out.size() - c.out_pos;
+    uint32_t events = (unsent < kMaxUnsent ? uint32_t(EPOLLIN) : 0u) | (unsent ? uint32_t(EPOLLOUT) : 0u);
+    if (events == c.events) return;
+    c.events = events;
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.ptr = &c;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c.fd, &ev);
+}
+
+// The fd goes now; the Connection stays until no worker is filling its replies.
+void Server::closeConnection(Connection& c) {
+    if (c.closed) return;
+    c.closed = true;
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c.fd, nullptr);
+    ::close(c.fd);
+    auto it = connections.find(c.fd);
+    if (it != connections.end()) {
+        closing.push_back(std::move(it->second));
+        connections.erase(it);
+    }
+}
+
+void Server::shutdown() {
+    {
+        std::lock_guard<std::mutex> lk(lock);
+        quit = true;
+    }
+    cv.notify_all();
+    for (std::thread& t : workers) t.join();
+    workers.clear();
+    for (auto& kv : connections) ::close(kv.second->fd);
+    connections.clear();
+    closing.clear();
+    pending.clear();
+    dirty.clear();
+    jobs.clear();
+    done.clear();
+    if (listen_fd >= 0) {
+        ::close(listen_fd);
+        listen_fd = -1;
+        if (!unix_path.empty()) ::unlink(unix_path.c_str());
+        manager.writeLog("Server stopped: connections=" + std::to_string(stats.connections.load())
+                         + " requests=" + std::to_string(stats.requests.load()));
+    }
+    if (epoll_fd >= 0) { ::close(epoll_fd); epoll_fd = -1; }
+    if (wake_fd >= 0) { ::close(wake_fd); wake_fd = -1; }
+}
+#else
+bool Server::listen(const std::string&, std::string& error) {
+    error = "server mode needs Linux (epoll)";
+    return false;
+}
+bool Server::run() { return false; }
+void Server::stop() { stopping.store(true); }
+void Server::shutdown() {}
+#endif
@@ -0,0 +1,128 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "Manager.h"
+#include "Protocol.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Local server mode: Manager operations over a Unix domain socket or
+// localhost TCP, in the frame protocol of Protocol.h (Linux only, epoll).
+//
+// One event-loop thread owns the Manager: it accepts connections, reads
+// whatever requests have arrived on every ready connection and runs the
+// writes and index queries (name search, connectivity, stats, max flow) in
+// arrival order. Id lookups and listings are read-only and go through
+// published versions instead (Manager::publish / VersionStore::ReadView):
+// the loop publishes once per batch of requests and hands the batch's reads
+// to a worker pool in chunks, so they run in parallel with each other and
+// with the next batch of writes. A read sees every write sent before it on
+// its connection and none sent after it: a request that follows reads on the
+// same connection first publishes and hands those reads off with a pinned
+// view. Replies are queued per connection in request order and leave in as
+// few sends as possible.
+class Server {
+public:
+    // workers = 0 picks one per hardware thread
+    explicit Server(Manager& manager, size_t workers = 0);
+    ~Server();
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    // bind and listen on "unix:PATH" or "tcp:[HOST:]PORT" (HOST defaults to
+    // 127.0.0.1); an existing socket file at PATH is replaced
+    bool listen(const std::string& address, std::string& error);
+    // serve until stop(); returns false if listen() was not called
+    bool run();
+    // safe from any thread and from signal handlers
+    void stop();
+
+    struct Counters {
+        std::atomic<uint64_t> connections{0};
+        std::atomic<uint64_t> requests{0};
+        std::atomic<uint64_t> parallel_reads{0}; // requests served by the worker pool
+        std::atomic<uint64_t> bad_requests{0};
+    };
+    const Counters& counters() const { return stats; }
+
+private:
+    struct Reply {
+        std::string data; // complete frame(s)
+        bool ready = false;
+    };
+    struct Connection {
+        int fd = -1;
+        std::string in;
+        size_t in_pos = 0;
+        std::string out;
+        size_t out_pos = 0;
+        std::deque<Reply> replies; // waiting for the worker pool, in request order
+        size_t inflight = 0;       // replies a worker is still filling
+        uint32_t events = 0;       // registered epoll interest
+        bool closed = false;
+        bool dirty = false;        // has replies to flush at the end of the round
+        bool reading = false;      // has reads in pending
+    };
+    // a read served from a published version
+    struct ReadTask {
+        Connection* conn;
+        Reply* reply;
+        ServerOp op;
+        uint32_t tag;
+        uint64_t id;
+        uint32_t limit;
+    };
+    struct Job {
+        std::shared_ptr<VersionStore::ReadView> view; // pinned when the reads were handed off
+        std::vector<ReadTask> tasks;
+    };
+
+    Manager& manager;
+    size_t worker_count;
+    int listen_fd = -1;
+    int epoll_fd = -1;
+    int wake_fd = -1; // eventfd: stop() and finished jobs
+    std::string unix_path;
+    std::atomic<bool> stopping{false};
+    Counters stats;
+
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
+    std::vector<std::unique_ptr<Connection>> closing; // closed, replies still in flight
+    std::vector<ReadTask> pending;  // reads of the current batch
+    std::vector<Connection*> dirty; // connections to flush at the end of the round
+    bool unpublished = false;       // writes since the last publish()
+
+    // worker pool
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable cv;
+    std::deque<std::unique_ptr<Job>> jobs;
+    std::vector<std::unique_ptr<Job>> done;
+    bool quit = false;
+
+    void acceptAll();
+    void onReadable(Connection& c);
+    void onWritable(Connection& c);
+    void handle(Connection& c, const char* body, size_t n);
+    void execute(ServerOp op, uint32_t tag, FrameReader& r, std::string& out);
+    static void executeRead(const VersionStore::ReadView& view, const ReadTask& t, std::string& out);
+    void dispatchReads();
+    void collectDone();
+    void touch(Connection& c);
+    void flush(Connection& c);
+    void updateInterest(Connection& c);
+    void closeConnection(Connection& c);
+    void workerLoop();
+    void shutdown();
+};
+
+#endif // SERVER_H
@@ -0,0 +1,257 @@
+#include "ShardedManager.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace {
+
+// same ordering as Manager::queryPipes / queryStations: key, then id
+bool pipeLess(QueryOrder order, const Pipe& a, const Pipe& b) {
+    switch (order) {
+        case QueryOrder::Name:
+            if (a.getName() != b.getName()) return a.getName() < b.getName();
+            break;
+        case QueryOrder::Diameter:
+            if (a.getDiameter() != b.getDiameter()) return a.getDiameter() < b.getDiameter();
+            break;
+        default:
+            break;
+    }
+    return a.getId() < b.getId();
+}
+
+bool stationLess(QueryOrder order, const CompressorStation& a, const CompressorStation& b) {
+    switch (order) {
+        case QueryOrder::Name:
+            if (a.getName() != b.getName()) return a.getName() < b.getName();
+            break;
+        case QueryOrder::TotalWorkshops:
+            if (a.getTotalWorkshops() != b.getTotalWorkshops()) return a.getTotalWorkshops() < b.getTotalWorkshops();
+            break;
+        case QueryOrder::WorkingWorkshops:
+            if (a.getWorkingWorkshops() != b.getWorkingWorkshops()) return a.getWorkingWorkshops() < b.getWorkingWorkshops();
+            break;
+        case QueryOrder::IdlePercent:
+            if (a.percentIdle() != b.percentIdle()) return a.percentIdle() < b.percentIdle();
+            break;
+        default:
+            break;
+    }
+    return a.getId() < b.getId();
+}
+
+// per-shard results are already sorted and limited; merge them into one list
+template <typename T, typename Less>
+size_t gather(std::vector<std::vector<T>>& parts, const QueryOptions& options, Less less,
+              const std::function<void(const T&)>& out) {
+    std::vector<T> all;
+    for (auto& p : parts) std::move(p.begin(), p.end(), std::back_inserter(all));
+    if (options.order != QueryOrder::None) {
+        auto cmp = [&](const T& a, const T& b){ return options.descending ? less(b, a) : less(a, b); };
+        std::sort(all.begin(), all.end(), cmp);
+    }
+    size_t n = std::min(options.limit, all.size());
+    if (out) for (size_t i = 0; i < n; ++i) out(all[i]);
+    return n;
+}
+
+}
+
+ShardedManager::ShardedManager(size_t count, const std::string& logFile)
+    : logger(std::make_shared<Logger>(logFile)) {
+    if (count == 0) count = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t k = 0; k < count; ++k) {
+        shards.emplace_back(new Shard());
+        shards.back()->manager.reset(new Manager(logger));
+        shards.back()->manager->setIdSequence(k + 1, count);
+        shards.back()->manager->setMetricsLabel("shard" + std::to_string(k));
+    }
+}
+
+size_t ShardedManager::homeShard() const {
+    // threads take homes in turn on their first call, so N writers spread over N shards
+    static std::atomic<size_t> next{0};
+    static thread_local size_t home = next.fetch_add(1, std::memory_order_relaxed);
+    return home % shards.size();
+}
+
+void ShardedManager::scatter(const std::function<void(size_t)>& f) const {
+    std::vector<std::thread> pool;
+    for (size_t k = 1; k < shards.size(); ++k) pool.emplace_back(f, k);
+    f(0);
+    for (auto &t : pool) t.join();
+}
+
+// === entities
+uint64_t ShardedManager::addPipe(const std::string& name, double diameter, bool in_repair) {
+    return withShard(homeShard(), [&](Manager& m){ return m.addPipe(name, diameter, in_repair); });
+}
+
+uint64_t ShardedManager::addStation(const std::string& name, int total, int working, const std::string& classification) {
+    return withShard(homeShard(), [&](Manager& m){ return m.addStation(name, total, working, classification); });
+}
+
+bool ShardedManager::removePipeById(uint64_t id) {
+    return onOwner(id, [&](Manager& m){ return m.removePipeById(id); });
+}
+
+bool ShardedManager::removeStationById(uint64_t id) {
+    return onOwner(id, [&](Manager& m){ return m.removeStationById(id); });
+}
+
+std::optional<Pipe> ShardedManager::findPipeById(uint64_t id) const {
+    return onOwner(id, [&](Manager& m) -> std::optional<Pipe> {
+        const Pipe* p = m.findPipeById(id);
+        if (!p) return std::nullopt;
+        return *p;
+    });
+}
+
+std::optional<CompressorStation> ShardedManager::findStationById(uint64_t id) const {
+    return onOwner(id, [&](Manager& m) -> std::optional<CompressorStation> {
+        const CompressorStation* s = m.findStationById(id);
+        if (!s) return std::nullopt;
+        return *s;
+    });
+}
+
+bool ShardedManager::setPipeName(uint64_t id, const std::string& name) {
+    return onOwner(id, [&](Manager& m){ return m.setPipeName(id, name); });
+}
+
+bool ShardedManager::setPipeDiameter(uint64_t id, double diameter) {
+    return onOwner(id, [&](Manager& m){ return m.setPipeDiameter(id, diameter); });
+}
+
+bool ShardedManager::setPipeInRepair(uint64_t id, bool in_repair) {
+    return onOwner(id, [&](Manager& m){ return m.setPipeInRepair(id, in_repair); });
+}
+
+bool ShardedManager::setStationName(uint64_t id, const std::string& name) {
+    return onOwner(id, [&](Manager& m){ return m.setStationName(id, name); });
+}
+
+bool ShardedManager::setStationTotalWorkshops(uint64_t id, int total) {
+    return onOwner(id, [&](Manager& m){ return m.setStationTotalWorkshops(id, total); });
+}
+
+bool ShardedManager::setStationWorkingWorkshops(uint64_t id, int working) {
+    return onOwner(id, [&](Manager& m){ return m.setStationWorkingWorkshops(id, working); });
+}
+
+bool ShardedManager::setStationClassification(uint64_t id, const std::string& classification) {
+    return onOwner(id, [&](Manager& m){ return m.setStationClassification(id, classification); });
+}
+
+UtilizationStats ShardedManager::stationUtilization(uint64_t id, int64_t fromMs, int64_t toMs) const {
+    return onOwner(id, [&](Manager& m){ return m.stationUtilization(id, fromMs, toMs); });
+}
+
+// === scatter-gather
+size_t ShardedManager::queryPipes(const Predicate& where, const QueryOptions& options,
+                                  const std::function<void(const Pipe&)>& out) const {
+    std::vector<size_t> counts(shards.size(), 0);
+    std::vector<std::vector<Pipe>> parts(shards.size());
+    QueryOptions local = options;
+    local.count_only = options.count_only || !out;
+    scatter([&](size_t k) {
+        std::lock_guard<std::mutex> lk(shards[k]->lock);
+        counts[k] = shards[k]->manager->queryPipes(where, local, [&](const Pipe& p){ parts[k].push_back(p); });
+    });
+    if (local.count_only) {
+        size_t n = 0;
+        for (size_t c : counts) n += c;
+        return std::min(n, options.limit);
+    }
+    return gather(parts, options, [&](const Pipe& a, const Pipe& b){ return pipeLess(options.order, a, b); }, out);
+}
+
+size_t ShardedManager::queryStations(const Predicate& where, const QueryOptions& options,
+                                     const std::function<void(const CompressorStation&)>& out) const {
+    std::vector<size_t> counts(shards.size(), 0);
+    std::vector<std::vector<CompressorStation>> parts(shards.size());
+    QueryOptions local = options;
+    local.count_only = options.count_only || !out;
+    scatter([&](size_t k) {
+        std::lock_guard<std::mutex> lk(shards[k]->lock);
+        counts[k] = shards[k]->manager->queryStations(where, local, [&](const CompressorStation& s){ parts[k].push_back(s); });
+    });
+    if (local.count_only) {
+        size_t n = 0;
+        for (size_t c : counts) n += c;
+        return std::min(n, options.limit);
+    }
+    return gather(parts, options, [&](const CompressorStation& a, const CompressorStation& b){ return stationLess(options.order, a, b); }, out);
+}
+
+size_t ShardedManager::updatePipes(const Predicate& where, const PipeUpdate& update) {
+    std::vector<size_t> counts(shards.size(), 0);
+    scatter([&](size_t k) {
+        std::lock_guard<std::mutex> lk(shards[k]->lock);
+        counts[k] = shards[k]->manager->updatePipes(where, update);
+    });
+    size_t n = 0;
+    for (size_t c : counts) n += c;
+    return n;
+}
+
+size_t ShardedManager::updateStations(const Predicate& where, const StationUpdate& update) {
+    std::vector<size_t> counts(shards.size(), 0);
+    scatter([&](size_t k) {
+        std::lock_guard<std::mutex> lk(shards[k]->lock);
+        counts[k] = shards[k]->manager->updateStations(where, update);
+    });
+    size_t n = 0;
+    for (size_t c : counts) n += c;
+    return n;
+}
+
+size_t ShardedManager::pipeCount() const {
+    size_t n = 0;
+    for (const auto& s : shards) {
+        std::lock_guard<std::mutex> lk(s->lock);
+        n += s->manager->getPipes().size();
+    }
+    return n;
+}
+
+size_t ShardedManager::stationCount() const {
+    size_t n = 0;
+    for (const auto& s : shards) {
+        std::lock_guard<std::mutex> lk(s->lock);
+        n += s->manager->getStations().size();
+    }
+    return n;
+}
+
+NetworkStats ShardedManager::getStats() const {
+    NetworkStats res;
+    for (const auto& s : shards) {
+        std::lock_guard<std::mutex> lk(s->lock);
+        res.merge(s->manager->getStats());
+    }
+    return res;
+}
+
+// === save / load
+bool ShardedManager::saveToFile(const std::string& filename, SaveFormat format) {
+    std::vector<char> ok(shards.size(), 0);
+    scatter([&](size_t k) {
+        std::lock_guard<std::mutex> lk(shards[k]->lock);
+        ok[k] = shards[k]->manager->saveToFile(filename + "." + std::to_string(k), format);
+    });
+    return std::all_of(ok.begin(), ok.end(), [](char c){ return c != 0; });
+}
+
+bool ShardedManager::loadFromFile(const std::string& filename) {
+    std::vector<char> ok(shards.size(), 0);
+    scatter([&](size_t k) {
+        std::lock_guard<std::mutex> lk(shards[k]->lock);
+        ok[k] = shards[k]->manager->loadFromFile(filename + "." + std::to_string(k));
+    });
+    return std::all_of(ok.begin(), ok.end(), [](char c){ return c != 0; });
+}
+
+void ShardedManager::flushLog() {
+    logger->flush();
+}
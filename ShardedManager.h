@@ -0,0 +1,100 @@
+#ifndef SHARDEDMANAGER_H
+#define SHARDEDMANAGER_H
+
+#include "Manager.h"
+#include "Logger.h"
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <functional>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+// Partitioned network for concurrent writers. Each shard is a full Manager
+// behind its own mutex and allocates ids from its own residue class
+// (shard k of N hands out k+1, k+1+N, ...), so the owning shard of any id is
+// (id - 1) % N and adds on different shards share nothing but the logger.
+// New entities go to the calling thread's home shard (threads are handed homes
+// round-robin on first use); searches scatter to all shards in parallel and
+// gather the results.
+class ShardedManager {
+public:
+    // shards = 0 picks one shard per hardware thread
+    explicit ShardedManager(size_t shards = 0, const std::string& logFile = "actions.log");
+
+    size_t shardCount() const { return shards.size(); }
+    size_t shardOf(uint64_t id) const { return id ? size_t((id - 1) % shards.size()) : 0; }
+
+    uint64_t addPipe(const std::string& name, double diameter, bool in_repair);
+    uint64_t addStation(const std::string& name, int total, int working, const std::string& classification);
+    bool removePipeById(uint64_t id);
+    bool removeStationById(uint64_t id);
+
+    // copies: a pointer into a shard would outlive the shard lock
+    std::optional<Pipe> findPipeById(uint64_t id) const;
+    std::optional<CompressorStation> findStationById(uint64_t id) const;
+
+    bool setPipeName(uint64_t id, const std::string& name);
+    bool setPipeDiameter(uint64_t id, double diameter);
+    bool setPipeInRepair(uint64_t id, bool in_repair);
+    bool setStationName(uint64_t id, const std::string& name);
+    bool setStationTotalWorkshops(uint64_t id, int total);
+    bool setStationWorkingWorkshops(uint64_t id, int working);
+    bool setStationClassification(uint64_t id, const std::string& classification);
+    // the owning shard keeps the station's history
+    UtilizationStats stationUtilization(uint64_t id, int64_t fromMs, int64_t toMs) const;
+
+    // scatter-gather: every shard runs the query in parallel, results are
+    // merged (and re-sorted / limited per options) before out is called on
+    // the calling thread
+    size_t queryPipes(const Predicate& where, const QueryOptions& options,
+                      const std::function<void(const Pipe&)>& out) const;
+    size_t queryStations(const Predicate& where, const QueryOptions& options,
+                         const std::function<void(const CompressorStation&)>& out) const;
+    size_t updatePipes(const Predicate& where, const PipeUpdate& update);
+    size_t updateStations(const Predicate& where, const StationUpdate& update);
+
+    size_t pipeCount() const;
+    size_t stationCount() const;
+    // every shard's aggregates merged
+    NetworkStats getStats() const;
+
+    // run f on one shard's Manager under its lock
+    template <typename F>
+    auto withShard(size_t shard, F f) -> decltype(f(std::declval<Manager&>())) {
+        Shard& s = *shards[shard];
+        std::lock_guard<std::mutex> lk(s.lock);
+        return f(*s.manager);
+    }
+
+    // one file per shard: <filename>.<k>; load with the same shard count
+    // that saved the files, since ids are routed by residue
+    bool saveToFile(const std::string& filename, SaveFormat format = SaveFormat::Text);
+    bool loadFromFile(const std::string& filename);
+
+    void flushLog();
+
+private:
+    struct alignas(64) Shard {
+        mutable std::mutex lock;
+        std::unique_ptr<Manager> manager;
+    };
+
+    std::shared_ptr<Logger> logger;
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    size_t homeShard() const;
+    // f(shard index) on one thread per shard, the caller runs shard 0
+    void scatter(const std::function<void(size_t)>& f) const;
+    template <typename F>
+    auto onOwner(uint64_t id, F f) const -> decltype(f(std::declval<Manager&>())) {
+        Shard& s = *shards[shardOf(id)];
+        std::lock_guard<std::mutex> lk(s.lock);
+        return f(*s.manager);
+    }
+};
+
+#endif // SHARDEDMANAGER_H
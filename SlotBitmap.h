@@ -0,0 +1,76 @@
+#ifndef SLOTBITMAP_H
+#define SLOTBITMAP_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// growable bitmap over slot indexes with a maintained population count
+class SlotBitmap {
+private:
+    std::vector<uint64_t> words;
+    size_t ones = 0;
+
+public:
+    void set(uint32_t index, bool value) {
+        size_t w = index >> 6;
+        if (w >= words.size()) {
+            if (!value) return;
+            words.resize(w + 1, 0);
+        }
+        uint64_t bit = uint64_t(1) << (index & 63);
+        bool old = (words[w] & bit) != 0;
+        if (old == value) return;
+        if (value) { words[w] |= bit; ++ones; }
+        else { words[w] &= ~bit; --ones; }
+    }
+
+    bool test(uint32_t index) const {
+        size_t w = index >> 6;
+        return w < words.size() && (words[w] >> (index & 63)) & 1;
+    }
+
+    size_t count() const { return ones; }
+    size_t wordCount() const { return words.size(); }
+    size_t memoryBytes() const { return words.capacity() * sizeof(uint64_t); }
+    uint64_t word(size_t w) const { return w < words.size() ? words[w] : 0; }
+    const uint64_t* data() const { return words.data(); }
+
+    // replace a whole 64-bit word, keeping the population count
+    void assignWord(size_t w, uint64_t bits) {
+        if (w >= words.size()) {
+            if (!bits) return;
+            words.resize(w + 1, 0);
+        }
+        ones = ones - size_t(__builtin_popcountll(words[w])) + size_t(__builtin_popcountll(bits));
+        words[w] = bits;
+    }
+
+    void clear() { words.clear(); ones = 0; }
+
+    // calls f(index) for every set bit, ascending
+    template <typename F>
+    void forEach(F f) const {
+        for (size_t w = 0; w < words.size(); ++w) {
+            uint64_t bits = words[w];
+            while (bits) {
+                f(uint32_t((w << 6) + __builtin_ctzll(bits)));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+    // calls f(index) for every bit set here and clear in other (this & ~other)
+    template <typename F>
+    void forEachAndNot(const SlotBitmap& other, F f) const {
+        for (size_t w = 0; w < words.size(); ++w) {
+            uint64_t bits = words[w] & ~other.word(w);
+            while (bits) {
+                f(uint32_t((w << 6) + __builtin_ctzll(bits)));
+                bits &= bits - 1;
+            }
+        }
+    }
+};
+
+#endif // SLOTBITMAP_H
@@ -0,0 +1,151 @@
+#ifndef SLOTMAP_H
+#define SLOTMAP_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <iterator>
+#include <type_traits>
+
+// handle into a SlotMap: slot index + generation of the slot when it was filled
+struct SlotHandle {
+    uint32_t index = 0;
+    uint32_t generation = 0; // 0 never refers to a live element
+
+    bool valid() const { return generation != 0; }
+    bool operator==(const SlotHandle& o) const { return index == o.index && generation == o.generation; }
+    bool operator!=(const SlotHandle& o) const { return !(*this == o); }
+};
+
+// Slot map with O(1) insert / lookup / erase.
+// Elements live in fixed-size pages that are never reallocated, so a pointer
+// to an element stays valid until that element is erased. Erasing bumps the
+// slot generation, which makes every outstanding handle to it stale.
+template <typename T>
+class SlotMap {
+public:
+    static constexpr uint32_t kPageBits = 10;
+    static constexpr uint32_t kPageSize = 1u << kPageBits;
+
+private:
+    struct Slot {
+        uint32_t generation = 1;
+        std::optional<T> value;
+    };
+
+    std::vector<std::unique_ptr<Slot[]>> pages;
+    std::vector<uint32_t> free_list;
+    uint32_t slot_count = 0; // slots ever handed out (high-water mark)
+    size_t live = 0;
+
+    Slot& slot(uint32_t index) { return pages[index >> kPageBits][index & (kPageSize - 1)]; }
+    const Slot& slot(uint32_t index) const { return pages[index >> kPageBits][index & (kPageSize - 1)]; }
+
+    uint32_t acquireSlot() {
+        if (!free_list.empty()) {
+            uint32_t index = free_list.back();
+            free_list.pop_back();
+            return index;
+        }
+        if ((slot_count >> kPageBits) == pages.size()) pages.emplace_back(new Slot[kPageSize]);
+        return slot_count++;
+    }
+
+public:
+    SlotMap() = default;
+    SlotMap(const SlotMap&) = delete;
+    SlotMap& operator=(const SlotMap&) = delete;
+
+    template <typename... Args>
+    SlotHandle emplace(Args&&... args) {
+        uint32_t index = acquireSlot();
+        Slot& s = slot(index);
+        s.value.emplace(std::forward<Args>(args)...);
+        ++live;
+        return SlotHandle{index, s.generation};
+    }
+
+    SlotHandle insert(T value) { return emplace(std::move(value)); }
+
+    bool erase(SlotHandle h) {
+        if (!contains(h)) return false;
+        Slot& s = slot(h.index);
+        s.value.reset();
+        if (++s.generation == 0) s.generation = 1;
+        free_list.push_back(h.index);
+        --live;
+        return true;
+    }
+
+    bool contains(SlotHandle h) const {
+        if (h.generation == 0 || h.index >= slot_count) return false;
+        const Slot& s = slot(h.index);
+        return s.generation == h.generation && s.value.has_value();
+    }
+
+    // nullptr when the handle is stale
+    T* get(SlotHandle h) { return contains(h) ? &*slot(h.index).value : nullptr; }
+    const T* get(SlotHandle h) const { return contains(h) ? &*slot(h.index).value : nullptr; }
+
+    // raw slot access for index structures keyed by slot number
+    bool alive(uint32_t index) const { return index < slot_count && slot(index).value.has_value(); }
+    T& at(uint32_t index) { return *slot(index).value; }
+    const T& at(uint32_t index) const { return *slot(index).value; }
+    SlotHandle handleAt(uint32_t index) const { return SlotHandle{index, slot(index).generation}; }
+
+    size_t size() const { return live; }
+    bool empty() const { return live == 0; }
+    uint32_t slotCount() const { return slot_count; }
+    // slot pages and bookkeeping (not heap owned by the elements themselves)
+    size_t memoryBytes() const {
+        return pages.size() * kPageSize * sizeof(Slot) + pages.capacity() * sizeof(pages[0]) + free_list.capacity() * sizeof(uint32_t);
+    }
+
+    void reserve(size_t n) {
+        size_t need = (n + kPageSize - 1) >> kPageBits;
+        pages.reserve(need);
+        while (pages.size() < need) pages.emplace_back(new Slot[kPageSize]);
+    }
+
+    void clear() {
+        pages.clear();
+        free_list.clear();
+        slot_count = 0;
+        live = 0;
+    }
+
+    // iteration over live elements in slot order
+    template <typename Ref, typename Map>
+    class basic_iterator {
+        Map* map;
+        uint32_t index;
+        void skip() { while (index < map->slot_count && !map->alive(index)) ++index; }
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::remove_reference_t<Ref>*;
+        using reference = Ref;
+
+        basic_iterator(Map* m, uint32_t i) : map(m), index(i) { skip(); }
+        Ref operator*() const { return map->at(index); }
+        pointer operator->() const { return &map->at(index); }
+        basic_iterator& operator++() { ++index; skip(); return *this; }
+        basic_iterator operator++(int) { basic_iterator t = *this; ++*this; return t; }
+        bool operator==(const basic_iterator& o) const { return index == o.index; }
+        bool operator!=(const basic_iterator& o) const { return index != o.index; }
+        uint32_t slotIndex() const { return index; }
+    };
+    using iterator = basic_iterator<T&, SlotMap>;
+    using const_iterator = basic_iterator<const T&, const SlotMap>;
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, slot_count); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, slot_count); }
+};
+
+#endif // SLOTMAP_H
@@ -0,0 +1,322 @@
+#include "Snapshot.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static inline uint64_t rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+uint64_t snapshotChecksum(const void* data, size_t size, uint64_t seed) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    uint64_t h = seed;
+    for (size_t i = 0; i + 8 <= size; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, p + i, 8);
+        h = rotl64(h ^ w, 29) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+bool isBinarySnapshot(const std::string& filename) {
+    std::FILE* f = std::fopen(filename.c_str(), "rb");
+    if (!f) return false;
+    char magic[sizeof(kSnapshotMagic)];
+    bool ok = std::fread(magic, 1, sizeof(magic), f) == sizeof(magic) && std::memcmp(magic, kSnapshotMagic, sizeof(magic)) == 0;
+    std::fclose(f);
+    return ok;
+}
+
+// === writer
+namespace {
+
+class StringHeap {
+public:
+    std::string data;
+
+    uint64_t add(std::string_view s) {
+        uint64_t off = data.size();
+        data.append(s);
+        return off;
+    }
+};
+
+// process dictionary codes -> dense file codes, in first-use order
+class FileDictionary {
+public:
+    std::vector<DictRecord> records;
+
+    uint32_t code(uint32_t process_code, StringHeap& heap) {
+        if (process_code >= file_code.size()) file_code.resize(size_t(process_code) + 1, kNone);
+        uint32_t& c = file_code[process_code];
+        if (c == kNone) {
+            std::string_view text = Dictionary::classifications().text(process_code);
+            DictRecord r;
+            std::memset(&r, 0, sizeof(r));
+            r.off = heap.add(text);
+            r.len = static_cast<uint32_t>(text.size());
+            c = static_cast<uint32_t>(records.size());
+            records.push_back(r);
+        }
+        return c;
+    }
+
+private:
+    static constexpr uint32_t kNone = UINT32_MAX;
+    std::vector<uint32_t> file_code;
+};
+
+template <typename Rec>
+bool flushRecords(std::FILE* f, std::vector<Rec>& buf, uint64_t& checksum) {
+    if (buf.empty()) return true;
+    size_t bytes = buf.size() * sizeof(Rec);
+    checksum = snapshotChecksum(buf.data(), bytes, checksum);
+    bool ok = std::fwrite(buf.data(), 1, bytes, f) == bytes;
+    buf.clear();
+    return ok;
+}
+
+// eachPipe(f) / eachStation(f) call f once per record, in file order
+template <typename EachPipe, typename EachStation>
+bool writeSnapshotRecords(const std::string& filename, uint64_t next_id, size_t pipe_count, size_t station_count,
+                          EachPipe eachPipe, EachStation eachStation, std::string& error,
+                          uint64_t* checksum_out, std::atomic<size_t>* progress) {
+    std::FILE* f = std::fopen(filename.c_str(), "wb");
+    if (!f) { error = "cannot open file"; return false; }
+    std::setvbuf(f, nullptr, _IOFBF, 1 << 20);
+
+    SnapshotHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, kSnapshotMagic, sizeof(h.magic));
+    h.version = kSnapshotVersion;
+    h.header_size = sizeof(SnapshotHeader);
+    h.next_id = next_id;
+    h.pipe_count = pipe_count;
+    h.station_count = station_count;
+    h.pipes_offset = sizeof(SnapshotHeader);
+    h.stations_offset = h.pipes_offset + h.pipe_count * sizeof(PipeRecord);
+    h.dict_offset = h.stations_offset + h.station_count * sizeof(StationRecord);
+
+    bool ok = std::fwrite(&h, 1, sizeof(h), f) == sizeof(h);
+    uint64_t checksum = 0x9e3779b97f4a7c15ull;
+    StringHeap heap;
+    FileDictionary dict;
+    const size_t chunk = 32768;
+    auto flush = [&](auto& buf) {
+        if (progress) progress->fetch_add(buf.size(), std::memory_order_relaxed);
+        ok = ok && flushRecords(f, buf, checksum);
+        buf.clear();
+    };
+
+    std::vector<PipeRecord> prec;
+    prec.reserve(chunk);
+    eachPipe([&](const Pipe& p) {
+        PipeRecord r;
+        std::memset(&r, 0, sizeof(r));
+        r.id = p.getId();
+        r.name_off = heap.add(p.getName());
+        r.name_len = static_cast<uint32_t>(p.getName().size());
+        r.in_repair = p.isInRepair() ? 1 : 0;
+        r.diameter = p.getDiameter();
+        r.input_station = p.getInputStation();
+        r.output_station = p.getOutputStation();
+        prec.push_back(r);
+        if (prec.size() == chunk) flush(prec);
+    });
+    flush(prec);
+
+    std::vector<StationRecord> srec;
+    srec.reserve(chunk);
+    eachStation([&](const CompressorStation& s) {
+        StationRecord r;
+        std::memset(&r, 0, sizeof(r));
+        r.id = s.getId();
+        r.name_off = heap.add(s.getName());
+        r.name_len = static_cast<uint32_t>(s.getName().size());
+        r.total_workshops = s.getTotalWorkshops();
+        r.working_workshops = s.getWorkingWorkshops();
+        r.class_code = dict.code(s.getClassCode(), heap);
+        srec.push_back(r);
+        if (srec.size() == chunk) flush(srec);
+    });
+    flush(srec);
+
+    h.dict_count = dict.records.size();
+    h.strings_offset = h.dict_offset + h.dict_count * sizeof(DictRecord);
+    ok = ok && flushRecords(f, dict.records, checksum);
+
+    heap.data.resize((heap.data.size() + 7) & ~size_t(7), '\0');
+    h.strings_size = heap.data.size();
+    checksum = snapshotChecksum(heap.data.data(), heap.data.size(), checksum);
+    ok = ok && std::fwrite(heap.data.data(), 1, heap.data.size(), f) == heap.data.size();
+
+    h.checksum = checksum;
+    ok = ok && std::fseek(f, 0, SEEK_SET) == 0 && std::fwrite(&h, 1, sizeof(h), f) == sizeof(h);
+#ifndef _WIN32
+    // the snapshot may replace a journal, so it has to be on disk before we return
+    ok = ok && std::fflush(f) == 0 && fsync(fileno(f)) == 0;
+#endif
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok) error = "write failed";
+    if (checksum_out) *checksum_out = checksum;
+    return ok;
+}
+
+}
+
+bool writeSnapshot(const std::string& filename, uint64_t next_id,
+                   const SlotMap<Pipe>& pipes, const SlotMap<CompressorStation>& stations,
+                   std::string& error, uint64_t* checksum_out) {
+    return writeSnapshotRecords(filename, next_id, pipes.size(), stations.size(),
+                                [&](auto f) { for (const auto& p : pipes) f(p); },
+                                [&](auto f) { for (const auto& s : stations) f(s); },
+                                error, checksum_out, nullptr);
+}
+
+bool writeSnapshot(const std::string& filename, uint64_t next_id, const VersionStore::ReadView& view,
+                   std::string& error, uint64_t* checksum_out, std::atomic<size_t>* progress) {
+    return writeSnapshotRecords(filename, next_id, view.pipeCount(), view.stationCount(),
+                                [&](auto f) { view.forEachPipe(f); },
+                                [&](auto f) { view.forEachStation(f); },
+                                error, checksum_out, progress);
+}
+
+// === reader
+SnapshotView::~SnapshotView() {
+    close();
+}
+
+void SnapshotView::close() {
+    if (!base) return;
+#ifndef _WIN32
+    if (mapped) munmap(const_cast<unsigned char*>(base), size);
+    else delete[] base;
+#else
+    delete[] base;
+#endif
+    base = nullptr;
+    size = 0;
+    mapped = false;
+    hdr = SnapshotHeader{};
+    class_map.clear();
+}
+
+bool SnapshotView::open(const std::string& filename, std::string& error) {
+    close();
+#ifndef _WIN32
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) { error = "cannot open file"; return false; }
+    struct stat st;
+    if (fstat(fd, &st) != 0) { ::close(fd); error = "cannot stat file"; return false; }
+    size = static_cast<size_t>(st.st_size);
+    if (size >= sizeof(SnapshotHeader)) {
+        void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            base = static_cast<const unsigned char*>(p);
+            mapped = true;
+        }
+    }
+    ::close(fd);
+    if (!base) { size = 0; error = "cannot map file"; return false; }
+#else
+    std::FILE* f = std::fopen(filename.c_str(), "rb");
+    if (!f) { error = "cannot open file"; return false; }
+    std::fseek(f, 0, SEEK_END);
+    size = static_cast<size_t>(std::ftell(f));
+    std::fseek(f, 0, SEEK_SET);
+    unsigned char* buf = new unsigned char[size ? size : 1];
+    if (std::fread(buf, 1, size, f) != size) { delete[] buf; std::fclose(f); size = 0; error = "read failed"; return false; }
+    std::fclose(f);
+    base = buf;
+#endif
+    if (size < kSnapshotHeaderV1Size || std::memcmp(base, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0) {
+        close(); error = "not a snapshot file"; return false;
+    }
+    std::memcpy(&hdr, base, kSnapshotHeaderV1Size);
+    bool v1 = hdr.version == 1 && hdr.header_size == kSnapshotHeaderV1Size;
+    bool v2 = (hdr.version == 2 || hdr.version == 3) && hdr.header_size == sizeof(SnapshotHeader) && size >= sizeof(SnapshotHeader);
+    if (!v1 && !v2) {
+        close(); error = "unsupported snapshot version"; return false;
+    }
+    if (v2) std::memcpy(&hdr, base, sizeof(SnapshotHeader));
+    size_t pipe_size = hdr.version < 3 ? sizeof(PipeRecordV2) : sizeof(PipeRecord);
+    size_t station_size = v1 ? sizeof(StationRecordV1) : sizeof(StationRecord);
+    uint64_t stations_end = hdr.stations_offset + hdr.station_count * station_size;
+    bool layout = hdr.pipes_offset == hdr.header_size
+        && hdr.pipe_count <= size / pipe_size
+        && hdr.stations_offset == hdr.pipes_offset + hdr.pipe_count * pipe_size
+        && hdr.station_count <= size / station_size
+        && (v1 ? hdr.strings_offset == stations_end
+               : hdr.dict_offset == stations_end && hdr.dict_count <= size / sizeof(DictRecord)
+                 && hdr.strings_offset == hdr.dict_offset + hdr.dict_count * sizeof(DictRecord))
+        && hdr.strings_offset <= size && hdr.strings_size == size - hdr.strings_offset;
+    if (!layout) { close(); error = "corrupt snapshot layout"; return false; }
+    if (v2 && !readDictionary()) { close(); error = "corrupt snapshot dictionary"; return false; }
+    return true;
+}
+
+// interns the file's dictionary once, so stations map codes without lookups
+bool SnapshotView::readDictionary() {
+    class_map.resize(hdr.dict_count);
+    for (size_t i = 0; i < hdr.dict_count; ++i) {
+        DictRecord r;
+        std::memcpy(&r, base + hdr.dict_offset + i * sizeof(DictRecord), sizeof(r));
+        if (r.off > hdr.strings_size || r.len > hdr.strings_size - r.off) return false;
+        class_map[i] = Dictionary::classifications().code(str(r.off, r.len));
+    }
+    return true;
+}
+
+bool SnapshotView::verify() const {
+    if (!base) return false;
+    return snapshotChecksum(base + hdr.header_size, size - hdr.header_size) == hdr.checksum;
+}
+
+std::string_view SnapshotView::str(uint64_t off, uint32_t len) const {
+    if (off > hdr.strings_size || len > hdr.strings_size - off) return std::string_view();
+    return std::string_view(reinterpret_cast<const char*>(base + hdr.strings_offset + off), len);
+}
+
+SnapshotView::PipeView SnapshotView::pipe(size_t i) const {
+    if (hdr.version < 3) {
+        PipeRecordV2 r;
+        std::memcpy(&r, base + hdr.pipes_offset + i * sizeof(PipeRecordV2), sizeof(r));
+        return PipeView{ r.id, str(r.name_off, r.name_len), r.diameter, r.in_repair != 0, 0, 0 };
+    }
+    PipeRecord r;
+    std::memcpy(&r, base + hdr.pipes_offset + i * sizeof(PipeRecord), sizeof(r));
+    return PipeView{ r.id, str(r.name_off, r.name_len), r.diameter, r.in_repair != 0, r.input_station, r.output_station };
+}
+
+SnapshotView::StationView SnapshotView::station(size_t i) const {
+    if (hdr.version == 1) {
+        StationRecordV1 r;
+        std::memcpy(&r, base + hdr.stations_offset + i * sizeof(StationRecordV1), sizeof(r));
+        std::string_view cls = str(r.class_off, r.class_len);
+        return StationView{ r.id, str(r.name_off, r.name_len), r.total_workshops, r.working_workshops, cls,
+                            Dictionary::classifications().code(cls) };
+    }
+    StationRecord r;
+    std::memcpy(&r, base + hdr.stations_offset + i * sizeof(StationRecord), sizeof(r));
+    uint32_t code = r.class_code < class_map.size() ? class_map[r.class_code] : 0;
+    return StationView{ r.id, str(r.name_off, r.name_len), r.total_workshops, r.working_workshops,
+                        Dictionary::classifications().text(code), code };
+}
+
+Pipe SnapshotView::materializePipe(size_t i) const {
+    PipeView v = pipe(i);
+    Pipe p(v.id, v.name, v.diameter, v.in_repair);
+    p.connect(v.input_station, v.output_station);
+    return p;
+}
+
+CompressorStation SnapshotView::materializeStation(size_t i) const {
+    StationView v = station(i);
+    CompressorStation s(v.id, v.name, v.total_workshops, v.working_workshops, std::string_view());
+    s.setClassCode(v.class_code);
+    return s;
+}
@@ -0,0 +1,170 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "Pipe.h"
+#include "CompressorStation.h"
+#include "SlotMap.h"
+#include "VersionStore.h"
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <atomic>
+
+// Binary snapshot layout (host byte order, little-endian in practice):
+//   SnapshotHeader
+//   PipeRecord    x pipe_count
+//   StationRecord x station_count
+//   DictRecord    x dict_count     (classification dictionary, version 2)
+//   string heap   (names and dictionary texts, padded to 8 bytes)
+// The checksum covers everything after the header. Stations store a code
+// into the file's own dictionary; loading maps it to the process dictionary.
+// Version 1 files (no dictionary, classification text per station) and
+// version 2 files (pipes without station endpoints) still load.
+
+enum class SaveFormat { Text, Binary };
+
+static const char kSnapshotMagic[8] = { 'G', 'T', 'N', 'S', 'N', 'A', 'P', '\x1a' };
+static const uint32_t kSnapshotVersion = 3;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t next_id;
+    uint64_t pipe_count;
+    uint64_t station_count;
+    uint64_t pipes_offset;
+    uint64_t stations_offset;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+    uint64_t checksum;
+    // version 2
+    uint64_t dict_offset;
+    uint64_t dict_count;
+};
+
+static const uint32_t kSnapshotHeaderV1Size = 80;
+
+struct PipeRecord {
+    uint64_t id;
+    uint64_t name_off;   // relative to the string heap
+    uint32_t name_len;
+    uint8_t in_repair;
+    uint8_t pad[3];
+    double diameter;
+    uint64_t input_station;  // 0 = not connected
+    uint64_t output_station;
+};
+
+struct PipeRecordV2 {
+    uint64_t id;
+    uint64_t name_off;
+    uint32_t name_len;
+    uint8_t in_repair;
+    uint8_t pad[3];
+    double diameter;
+};
+
+struct StationRecord {
+    uint64_t id;
+    uint64_t name_off;
+    uint32_t name_len;
+    int32_t total_workshops;
+    int32_t working_workshops;
+    uint32_t class_code; // index into the file's DictRecords
+};
+
+struct StationRecordV1 {
+    uint64_t id;
+    uint64_t name_off;
+    uint32_t name_len;
+    int32_t total_workshops;
+    int32_t working_workshops;
+    uint32_t class_len;
+    uint64_t class_off;
+};
+
+struct DictRecord {
+    uint64_t off; // relative to the string heap
+    uint32_t len;
+    uint32_t pad;
+};
+
+static_assert(sizeof(SnapshotHeader) == 96, "SnapshotHeader layout");
+static_assert(sizeof(PipeRecord) == 48, "PipeRecord layout");
+static_assert(sizeof(PipeRecordV2) == 32, "PipeRecordV2 layout");
+static_assert(sizeof(StationRecord) == 32, "StationRecord layout");
+static_assert(sizeof(StationRecordV1) == 40, "StationRecordV1 layout");
+static_assert(sizeof(DictRecord) == 16, "DictRecord layout");
+
+// word-at-a-time checksum; data size must be a multiple of 8
+uint64_t snapshotChecksum(const void* data, size_t size, uint64_t seed = 0x9e3779b97f4a7c15ull);
+
+// true if the file starts with the binary snapshot magic
+bool isBinarySnapshot(const std::string& filename);
+
+// checksum_out receives the body checksum (identifies the snapshot for the journal)
+bool writeSnapshot(const std::string& filename, uint64_t next_id,
+                   const SlotMap<Pipe>& pipes, const SlotMap<CompressorStation>& stations,
+                   std::string& error, uint64_t* checksum_out = nullptr);
+// same from a published version, on any thread; progress (if given) is
+// advanced by the number of records written as they are written
+bool writeSnapshot(const std::string& filename, uint64_t next_id, const VersionStore::ReadView& view,
+                   std::string& error, uint64_t* checksum_out = nullptr, std::atomic<size_t>* progress = nullptr);
+
+// Read-only, memory-mapped view of a snapshot. Records are decoded on access
+// straight from the mapping; names are string_views into it, nothing is copied
+// until the caller materializes an entity.
+class SnapshotView {
+public:
+    struct PipeView {
+        uint64_t id;
+        std::string_view name;
+        double diameter;
+        bool in_repair;
+        uint64_t input_station;
+        uint64_t output_station;
+    };
+    struct StationView {
+        uint64_t id;
+        std::string_view name;
+        int total_workshops;
+        int working_workshops;
+        std::string_view classification;
+        uint32_t class_code; // in Dictionary::classifications()
+    };
+
+    SnapshotView() = default;
+    ~SnapshotView();
+    SnapshotView(const SnapshotView&) = delete;
+    SnapshotView& operator=(const SnapshotView&) = delete;
+
+    bool open(const std::string& filename, std::string& error);
+    void close();
+    bool verify() const; // recompute the checksum
+
+    uint32_t version() const { return hdr.version; }
+    uint64_t nextId() const { return hdr.next_id; }
+    uint64_t checksum() const { return hdr.checksum; }
+    size_t pipeCount() const { return hdr.pipe_count; }
+    size_t stationCount() const { return hdr.station_count; }
+    PipeView pipe(size_t i) const;
+    StationView station(size_t i) const;
+
+    Pipe materializePipe(size_t i) const;
+    CompressorStation materializeStation(size_t i) const;
+
+private:
+    const unsigned char* base = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+    SnapshotHeader hdr{};            // copied; version 1 headers are shorter
+    std::vector<uint32_t> class_map; // file dictionary code -> process code
+
+    std::string_view str(uint64_t off, uint32_t len) const;
+    bool readDictionary();
+};
+
+#endif // SNAPSHOT_H
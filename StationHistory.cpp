@@ -0,0 +1,474 @@
+#include "StationHistory.h"
+#include "Snapshot.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char kHistoryMagic[8] = { 'G', 'T', 'N', 'H', 'I', 'S', 'T', '\x1a' };
+const uint32_t kHistoryVersion = 1;
+
+// History file layout (host byte order):
+//   HistoryHeader
+//   per series: SeriesRecord, then block_count blocks as kept in memory
+// The checksum covers everything after the header.
+struct HistoryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t series_count;
+    uint64_t block_count;
+    uint64_t checksum;
+    uint64_t snapshot_checksum; // of the snapshot the history belongs to
+};
+
+struct SeriesRecord {
+    uint64_t station;
+    uint64_t block_count;
+};
+
+static_assert(sizeof(HistoryHeader) == 48, "HistoryHeader layout");
+static_assert(sizeof(SeriesRecord) == 16, "SeriesRecord layout");
+
+inline uint64_t zigzag(int64_t v) { return (uint64_t(v) << 1) ^ uint64_t(v >> 63); }
+inline int64_t unzigzag(uint64_t u) { return int64_t((u >> 1) ^ (0 - (u & 1))); }
+
+inline size_t putVarint(uint8_t* out, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = uint8_t(v) | 0x80;
+        v >>= 7;
+    }
+    out[n++] = uint8_t(v);
+    return n;
+}
+
+inline bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t b = *p++;
+        v |= uint64_t(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+inline double idlePercent(int working, int total) {
+    // CompressorStation::percentIdle
+    if (total <= 0) return 0.0;
+    return (100.0 * (total - working)) / total;
+}
+
+// floor division for bucket starts
+inline int64_t bucketStart(int64_t ts, int64_t res) {
+    int64_t q = ts / res;
+    if (ts % res < 0) --q;
+    return q * res;
+}
+
+}
+
+const int64_t StationHistory::kResolution[StationHistory::kLevels] = { 3600 * 1000ll, 24 * 3600 * 1000ll };
+
+std::string UtilizationStats::toString() const {
+    std::ostringstream oss;
+    oss << "samples=" << samples << " covered=" << covered_ms / 3600000.0 << "h";
+    if (!empty())
+        oss << " avg_idle=" << avg_idle << "% min_idle=" << min_idle << "% max_idle=" << max_idle
+            << "% avg_working=" << avg_working;
+    return oss.str();
+}
+
+// === Agg
+void StationHistory::Agg::hold(int working, int total, int64_t ms) {
+    if (ms <= 0) return;
+    double idle = idlePercent(working, total);
+    idle_ms += idle * double(ms);
+    working_ms += double(working) * double(ms);
+    if (covered_ms == 0) {
+        min_idle = max_idle = idle;
+    } else {
+        min_idle = std::min(min_idle, idle);
+        max_idle = std::max(max_idle, idle);
+    }
+    covered_ms += ms;
+}
+
+void StationHistory::Agg::add(const Agg& o) {
+    samples += o.samples;
+    if (o.covered_ms == 0) return;
+    if (covered_ms == 0) {
+        min_idle = o.min_idle;
+        max_idle = o.max_idle;
+    } else {
+        min_idle = std::min(min_idle, o.min_idle);
+        max_idle = std::max(max_idle, o.max_idle);
+    }
+    covered_ms += o.covered_ms;
+    idle_ms += o.idle_ms;
+    working_ms += o.working_ms;
+}
+
+// === recording
+bool StationHistory::record(uint64_t station, int64_t ts, int working, int total) {
+    auto it = series.find(station);
+    if (it == series.end()) it = series.emplace(station, Series{}).first;
+    Series& s = it->second;
+    HistorySample x{ ts, working, total };
+    if (!s.blocks.empty()) {
+        const Block& last = s.blocks.back();
+        if (last.last_working == working && last.last_total == total) return false;
+        x.ts = std::max(ts, last.last_ts);
+        HistorySample prev{ last.last_ts, last.last_working, last.last_total };
+        rollup(s, &prev, x);
+    } else {
+        rollup(s, nullptr, x);
+    }
+    append(s, x);
+    return true;
+}
+
+void StationHistory::append(Series& s, const HistorySample& x) {
+    if (!s.blocks.empty()) {
+        Block& b = s.blocks.back();
+        int64_t delta = x.ts - b.last_ts;
+        uint8_t buf[30];
+        size_t n = putVarint(buf, zigzag(delta - b.last_delta));
+        n += putVarint(buf + n, zigzag(int64_t(x.working) - b.last_working));
+        n += putVarint(buf + n, zigzag(int64_t(x.total) - b.last_total));
+        if (b.used + n <= kBlockBytes) {
+            std::memcpy(b.data + b.used, buf, n);
+            b.used += uint32_t(n);
+            b.count++;
+            b.last_ts = x.ts;
+            b.last_delta = delta;
+            b.last_working = x.working;
+            b.last_total = x.total;
+            return;
+        }
+    }
+    Block b{};
+    b.first_ts = b.last_ts = x.ts;
+    b.first_working = b.last_working = x.working;
+    b.first_total = b.last_total = x.total;
+    b.count = 1;
+    s.blocks.push_back(b);
+    block_total++;
+}
+
+// x follows prev (if any) in the series: the interval in between goes into
+// every rollup, x is counted where it falls
+void StationHistory::rollup(Series& s, const HistorySample* prev, const HistorySample& x) {
+    if (prev) {
+        for (size_t level = 0; level < kLevels; ++level)
+            addInterval(s, level, prev->ts, x.ts, prev->working, prev->total);
+    }
+    for (size_t level = 0; level < kLevels; ++level) {
+        Bucket& b = bucketAt(s, level, bucketStart(x.ts, kResolution[level]), x.working, x.total);
+        b.samples++;
+        b.last_working = x.working;
+        b.last_total = x.total;
+    }
+    s.samples++;
+    s.tail_run = prev && prev->ts == x.ts ? s.tail_run + 1 : 1;
+}
+
+// buckets fully inside [from, to) are left implicit: they repeat the value
+// the bucket before them ends with
+void StationHistory::addInterval(Series& s, size_t level, int64_t from, int64_t to, int working, int total) {
+    if (to <= from) return;
+    int64_t res = kResolution[level];
+    int64_t first = bucketStart(from, res);
+    auto add = [&](int64_t start, int64_t begin, int64_t end) {
+        Bucket& b = bucketAt(s, level, start, working, total);
+        int64_t ms = end - begin;
+        double idle = idlePercent(working, total);
+        if (b.covered_ms == 0) {
+            b.min_idle = b.max_idle = idle;
+        } else {
+            b.min_idle = std::min(b.min_idle, idle);
+            b.max_idle = std::max(b.max_idle, idle);
+        }
+        b.covered_ms += ms;
+        b.idle_ms += idle * double(ms);
+        b.working_ms += double(working) * double(ms);
+    };
+    add(first, from, std::min(to, first + res));
+    int64_t last = bucketStart(to, res);
+    if (last > first && last < to) add(last, last, to);
+}
+
+StationHistory::Bucket& StationHistory::bucketAt(Series& s, size_t level, int64_t start, int working, int total) {
+    std::vector<Bucket>& r = s.rollup[level];
+    if (r.empty() || r.back().start != start) {
+        Bucket b{};
+        b.start = start;
+        b.last_working = working;
+        b.last_total = total;
+        r.push_back(b);
+        bucket_total++;
+    }
+    return r.back();
+}
+
+void StationHistory::erase(uint64_t station) {
+    auto it = series.find(station);
+    if (it == series.end()) return;
+    block_total -= it->second.blocks.size();
+    for (const auto& r : it->second.rollup) bucket_total -= r.size();
+    series.erase(it);
+}
+
+void StationHistory::clear() {
+    series.clear();
+    block_total = 0;
+    bucket_total = 0;
+}
+
+size_t StationHistory::sampleCount(uint64_t station) const {
+    auto it = series.find(station);
+    return it == series.end() ? 0 : it->second.samples;
+}
+
+size_t StationHistory::memoryBytes() const {
+    // map nodes: key, value and two pointers of bookkeeping
+    return series.size() * (sizeof(uint64_t) + sizeof(Series) + 2 * sizeof(void*))
+        + block_total * sizeof(Block) + bucket_total * sizeof(Bucket);
+}
+
+// === decoding
+template <typename Visit>
+void StationHistory::decode(const Series& s, size_t b, Visit visit) const {
+    for (; b < s.blocks.size(); ++b) {
+        const Block& blk = s.blocks[b];
+        decoded++;
+        HistorySample x{ blk.first_ts, blk.first_working, blk.first_total };
+        if (!visit(x)) return;
+        const uint8_t* p = blk.data;
+        const uint8_t* end = blk.data + std::min<size_t>(blk.used, kBlockBytes);
+        uint64_t delta = 0;
+        for (uint32_t i = 1; i < blk.count; ++i) {
+            uint64_t dod, dw, dt;
+            if (!getVarint(p, end, dod) || !getVarint(p, end, dw) || !getVarint(p, end, dt)) break;
+            // unsigned arithmetic: a damaged block decodes to nonsense, not to overflow
+            delta += uint64_t(unzigzag(dod));
+            x.ts = int64_t(uint64_t(x.ts) + delta);
+            x.working = int32_t(uint32_t(x.working) + uint32_t(unzigzag(dw)));
+            x.total = int32_t(uint32_t(x.total) + uint32_t(unzigzag(dt)));
+            if (!visit(x)) return;
+        }
+    }
+}
+
+// the block holding the last sample before ts (the first block if none)
+size_t StationHistory::blockFor(const Series& s, int64_t ts) const {
+    auto it = std::lower_bound(s.blocks.begin(), s.blocks.end(), ts,
+                               [](const Block& b, int64_t t) { return b.first_ts < t; });
+    size_t i = size_t(it - s.blocks.begin());
+    return i ? i - 1 : 0;
+}
+
+void StationHistory::samples(uint64_t station, int64_t from, int64_t to, std::vector<HistorySample>& out) const {
+    auto it = series.find(station);
+    if (it == series.end() || from >= to) return;
+    decode(it->second, blockFor(it->second, from), [&](const HistorySample& x) {
+        if (x.ts >= to) return false;
+        if (x.ts >= from) out.push_back(x);
+        return true;
+    });
+}
+
+// === range queries
+UtilizationStats StationHistory::stats(uint64_t station, int64_t from, int64_t to) const {
+    UtilizationStats res;
+    auto it = series.find(station);
+    if (it == series.end() || from >= to) return res;
+    const Series& s = it->second;
+    const Block& last = s.blocks.back();
+    // up to the last sample every value has an end; after it the last one holds
+    Agg agg;
+    int64_t closed = std::min(to, last.last_ts);
+    if (from < closed) agg = range(s, int(kLevels) - 1, from, closed);
+    if (to > last.last_ts) {
+        if (from <= last.last_ts) agg.samples += s.tail_run;
+        Agg tail;
+        tail.hold(last.last_working, last.last_total, to - std::max(from, last.last_ts));
+        agg.add(tail);
+    }
+    res.samples = agg.samples;
+    res.covered_ms = agg.covered_ms;
+    if (agg.covered_ms > 0) {
+        res.avg_idle = agg.idle_ms / double(agg.covered_ms);
+        res.avg_working = agg.working_ms / double(agg.covered_ms);
+        res.min_idle = agg.min_idle;
+        res.max_idle = agg.max_idle;
+    }
+    return res;
+}
+
+// whole buckets of this level, the rest from the finer levels and the blocks
+StationHistory::Agg StationHistory::range(const Series& s, int level, int64_t from, int64_t to) const {
+    if (from >= to) return Agg{};
+    if (level < 0) return raw(s, from, to);
+    int64_t res = kResolution[level];
+    int64_t a = bucketStart(from, res);
+    if (a < from) a += res;
+    int64_t b = bucketStart(to, res);
+    if (a >= b) return range(s, level - 1, from, to);
+    Agg agg = range(s, level - 1, from, a);
+    agg.add(buckets(s, size_t(level), a, b));
+    agg.add(range(s, level - 1, b, to));
+    return agg;
+}
+
+// [from, to) aligned to the level and closed (before the last sample)
+StationHistory::Agg StationHistory::buckets(const Series& s, size_t level, int64_t from, int64_t to) const {
+    Agg agg;
+    int64_t res = kResolution[level];
+    const std::vector<Bucket>& r = s.rollup[level];
+    auto it = std::lower_bound(r.begin(), r.end(), from,
+                               [](const Bucket& b, int64_t t) { return b.start < t; });
+    // implicit buckets repeat what the stored bucket before them ends with
+    bool held = it != r.begin();
+    int working = held ? std::prev(it)->last_working : 0;
+    int total = held ? std::prev(it)->last_total : 0;
+    int64_t cursor = from;
+    for (; it != r.end() && it->start < to; ++it) {
+        if (held) agg.hold(working, total, it->start - cursor);
+        Agg part;
+        part.samples = it->samples;
+        part.covered_ms = it->covered_ms;
+        part.idle_ms = it->idle_ms;
+        part.working_ms = it->working_ms;
+        part.min_idle = it->min_idle;
+        part.max_idle = it->max_idle;
+        agg.add(part);
+        held = true;
+        working = it->last_working;
+        total = it->last_total;
+        cursor = it->start + res;
+    }
+    if (held) agg.hold(working, total, to - cursor);
+    return agg;
+}
+
+// decodes the blocks under [from, to), which is closed
+StationHistory::Agg StationHistory::raw(const Series& s, int64_t from, int64_t to) const {
+    Agg agg;
+    bool held = false;
+    HistorySample prev{};
+    int64_t cursor = from;
+    decode(s, blockFor(s, from), [&](const HistorySample& x) {
+        if (x.ts < from) {
+            prev = x;
+            held = true;
+            return true;
+        }
+        int64_t end = std::min(x.ts, to);
+        if (held) agg.hold(prev.working, prev.total, end - cursor);
+        cursor = end;
+        if (x.ts >= to) return false;
+        agg.samples++;
+        prev = x;
+        held = true;
+        return true;
+    });
+    if (held && cursor < to) agg.hold(prev.working, prev.total, to - cursor);
+    return agg;
+}
+
+// === persistence
+bool StationHistory::save(const std::string& filename, uint64_t snapshot_checksum, std::string& error) const {
+    std::FILE* f = std::fopen(filename.c_str(), "wb");
+    if (!f) { error = "cannot open file"; return false; }
+    // stations in id order, so the same history gives the same file
+    std::vector<uint64_t> ids;
+    ids.reserve(series.size());
+    for (const auto& [id, s] : series) ids.push_back(id);
+    std::sort(ids.begin(), ids.end());
+
+    HistoryHeader h{};
+    std::memcpy(h.magic, kHistoryMagic, sizeof(h.magic));
+    h.version = kHistoryVersion;
+    h.header_size = sizeof(HistoryHeader);
+    h.series_count = ids.size();
+    h.block_count = block_total;
+    h.snapshot_checksum = snapshot_checksum;
+    bool ok = std::fwrite(&h, 1, sizeof(h), f) == sizeof(h);
+    uint64_t sum = snapshotChecksum(nullptr, 0);
+    for (uint64_t id : ids) {
+        const Series& s = series.at(id);
+        SeriesRecord rec{ id, s.blocks.size() };
+        size_t bytes = s.blocks.size() * sizeof(Block);
+        sum = snapshotChecksum(&rec, sizeof(rec), sum);
+        sum = snapshotChecksum(s.blocks.data(), bytes, sum);
+        ok = ok && std::fwrite(&rec, 1, sizeof(rec), f) == sizeof(rec);
+        ok = ok && std::fwrite(s.blocks.data(), 1, bytes, f) == bytes;
+    }
+    h.checksum = sum;
+    ok = ok && std::fseek(f, 0, SEEK_SET) == 0 && std::fwrite(&h, 1, sizeof(h), f) == sizeof(h);
+#ifndef _WIN32
+    ok = ok && std::fflush(f) == 0 && fsync(fileno(f)) == 0;
+#endif
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok) error = "write failed";
+    return ok;
+}
+
+bool StationHistory::load(const std::string& filename, uint64_t snapshot_checksum, std::string& error) {
+    clear();
+    std::FILE* f = std::fopen(filename.c_str(), "rb");
+    if (!f) { error = "cannot open file"; return false; }
+    std::vector<unsigned char> body;
+    HistoryHeader h{};
+    bool ok = std::fread(&h, 1, sizeof(h), f) == sizeof(h);
+    if (ok && std::fseek(f, 0, SEEK_END) == 0) {
+        long end = std::ftell(f);
+        ok = end >= long(sizeof(h)) && std::fseek(f, long(sizeof(h)), SEEK_SET) == 0;
+        if (ok) {
+            body.resize(size_t(end) - sizeof(h));
+            ok = std::fread(body.data(), 1, body.size(), f) == body.size();
+        }
+    }
+    std::fclose(f);
+    if (!ok) { error = "read failed"; return false; }
+    if (std::memcmp(h.magic, kHistoryMagic, sizeof(h.magic)) != 0) { error = "not a history file"; return false; }
+    if (h.version != kHistoryVersion || h.header_size != sizeof(h)) { error = "unsupported history version"; return false; }
+    if (h.snapshot_checksum != snapshot_checksum) { error = "history belongs to another snapshot"; return false; }
+    if (snapshotChecksum(body.data(), body.size()) != h.checksum) { error = "history checksum mismatch"; return false; }
+
+    size_t at = 0;
+    for (uint64_t i = 0; i < h.series_count; ++i) {
+        SeriesRecord rec;
+        if (body.size() - at < sizeof(rec)) { clear(); error = "corrupt history layout"; return false; }
+        std::memcpy(&rec, body.data() + at, sizeof(rec));
+        at += sizeof(rec);
+        if (rec.block_count == 0 || rec.block_count > (body.size() - at) / sizeof(Block) || series.count(rec.station)) {
+            clear();
+            error = "corrupt history layout";
+            return false;
+        }
+        Series& s = series[rec.station];
+        s.blocks.resize(size_t(rec.block_count));
+        std::memcpy(s.blocks.data(), body.data() + at, s.blocks.size() * sizeof(Block));
+        at += s.blocks.size() * sizeof(Block);
+        block_total += s.blocks.size();
+        // rollups are derived data: rebuilt from the samples
+        bool first = true;
+        HistorySample prev{};
+        decode(s, 0, [&](const HistorySample& x) {
+            rollup(s, first ? nullptr : &prev, x);
+            prev = x;
+            first = false;
+            return true;
+        });
+    }
+    decoded = 0;
+    if (at != body.size() || block_total != h.block_count) { clear(); error = "corrupt history layout"; return false; }
+    return true;
+}
@@ -0,0 +1,131 @@
+#ifndef STATIONHISTORY_H
+#define STATIONHISTORY_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Time-weighted utilization of one station over a time range. The value
+// recorded last before a moment is the one in effect at that moment.
+struct UtilizationStats {
+    size_t samples = 0;       // changes recorded inside the range
+    int64_t covered_ms = 0;   // part of the range after the first sample
+    double avg_idle = 0.0;    // percentIdle, weighted by time in effect
+    double min_idle = 0.0;
+    double max_idle = 0.0;
+    double avg_working = 0.0; // working workshops, weighted by time in effect
+
+    bool empty() const { return covered_ms == 0; }
+    std::string toString() const;
+};
+
+struct HistorySample {
+    int64_t ts; // milliseconds since the epoch
+    int32_t working;
+    int32_t total;
+};
+
+// Append-only history of (timestamp, working, total) per station.
+//
+// Samples are packed into fixed-size blocks. The first sample of a block
+// lives in its header, every further one is three zigzag varints: the
+// delta-of-delta of the timestamp and the deltas of working and total, so a
+// change costs 3-4 bytes. Rollups at hour and day resolution keep, for every
+// bucket that saw a change, the time-weighted sums and the minimum / maximum
+// of idle percent; a bucket without a change repeats the value in effect. A
+// range query takes whole buckets from the coarsest resolution that fits,
+// the ragged ends from the next finer one and decodes only the blocks under
+// what is left.
+//
+// Timestamps never go backwards within a series: an earlier one is recorded
+// as the series' last. One thread at a time.
+class StationHistory {
+public:
+    static constexpr size_t kBlockBytes = 128; // encoded samples per block
+
+    // false when working and total are what the series already ends with
+    bool record(uint64_t station, int64_t ts, int working, int total);
+    void erase(uint64_t station);
+    void clear();
+
+    bool has(uint64_t station) const { return series.count(station) != 0; }
+    size_t stationCount() const { return series.size(); }
+    size_t sampleCount(uint64_t station) const;
+    // samples with ts in [from, to), oldest first
+    void samples(uint64_t station, int64_t from, int64_t to, std::vector<HistorySample>& out) const;
+    // [from, to); the last sample holds until to
+    UtilizationStats stats(uint64_t station, int64_t from, int64_t to) const;
+    // blocks decoded by range queries so far
+    size_t blocksDecoded() const { return decoded; }
+
+    // Sidecar file of a snapshot: every block, tagged with the snapshot's
+    // checksum. Rollups are rebuilt on load.
+    bool save(const std::string& filename, uint64_t snapshot_checksum, std::string& error) const;
+    // fails (leaving the history empty) when the file belongs to another snapshot
+    bool load(const std::string& filename, uint64_t snapshot_checksum, std::string& error);
+
+    size_t memoryBytes() const;
+
+private:
+    // layout is also the file record (multiple of 8 bytes)
+    struct Block {
+        int64_t first_ts;
+        int64_t last_ts;
+        int64_t last_delta; // last_ts minus the timestamp before it, 0 for one sample
+        int32_t first_working, first_total;
+        int32_t last_working, last_total;
+        uint32_t count;     // samples, the header one included
+        uint32_t used;      // bytes of data
+        uint8_t data[kBlockBytes];
+    };
+    static_assert(sizeof(Block) % 8 == 0, "Block layout");
+    struct Bucket {
+        int64_t start;
+        double idle_ms;     // sum of percentIdle * ms
+        double working_ms;  // sum of working * ms
+        int64_t covered_ms;
+        double min_idle, max_idle;
+        int32_t last_working, last_total; // in effect at the end of the bucket
+        uint32_t samples;
+    };
+    static constexpr size_t kLevels = 2;
+    static const int64_t kResolution[kLevels]; // ms: hour, day
+
+    struct Series {
+        std::vector<Block> blocks;
+        std::vector<Bucket> rollup[kLevels];
+        size_t samples = 0;
+        size_t tail_run = 0; // samples sharing the last timestamp
+    };
+    // partial result of a range query
+    struct Agg {
+        size_t samples = 0;
+        int64_t covered_ms = 0;
+        double idle_ms = 0.0, working_ms = 0.0;
+        double min_idle = 0.0, max_idle = 0.0;
+
+        void hold(int working, int total, int64_t ms);
+        void add(const Agg& o);
+    };
+
+    std::unordered_map<uint64_t, Series> series;
+    size_t block_total = 0;
+    size_t bucket_total = 0;
+    mutable size_t decoded = 0;
+
+    void append(Series& s, const HistorySample& x);
+    void rollup(Series& s, const HistorySample* prev, const HistorySample& x);
+    void addInterval(Series& s, size_t level, int64_t from, int64_t to, int working, int total);
+    Bucket& bucketAt(Series& s, size_t level, int64_t start, int working, int total);
+    Agg range(const Series& s, int level, int64_t from, int64_t to) const;
+    Agg buckets(const Series& s, size_t level, int64_t from, int64_t to) const;
+    Agg raw(const Series& s, int64_t from, int64_t to) const;
+    // decodes blocks from index b on, calling visit(sample) until it returns false
+    template <typename Visit>
+    void decode(const Series& s, size_t b, Visit visit) const;
+    size_t blockFor(const Series& s, int64_t ts) const;
+};
+
+#endif // STATIONHISTORY_H
@@ -0,0 +1,225 @@
+#include "StringPool.h"
+#include <functional>
+#include <new>
+#include <stdexcept>
+
+// === StringPool
+StringPool& StringPool::global() {
+    // never destroyed: entities in static storage may outlive any destructor order
+    static StringPool* instance = new StringPool();
+    return *instance;
+}
+
+// copies s into a free block of its size class or the shard's arena as
+// [refs = 1][uint32 length][bytes][NUL]
+const char* StringPool::store(Shard& sh, std::string_view s) {
+    size_t need = blockSize(s.size());
+    char* at;
+    if (need > kLarge) {
+        // long strings get their own block so they don't waste a chunk tail
+        at = new char[need];
+        sh.bytes += need;
+    } else {
+        size_t cls = need / kAlign;
+        if (cls < sh.free_blocks.size() && sh.free_blocks[cls]) {
+            at = sh.free_blocks[cls];
+            std::memcpy(&sh.free_blocks[cls], at, sizeof(char*));
+        } else {
+            if (need > sh.left) {
+                sh.chunks.emplace_back(new char[kChunk]);
+                sh.cur = sh.chunks.back().get();
+                sh.left = kChunk;
+                sh.bytes += kChunk;
+            }
+            at = sh.cur;
+            sh.cur += need;
+            sh.left -= need;
+        }
+    }
+    new (at) std::atomic<uint32_t>(1);
+    uint32_t n = static_cast<uint32_t>(s.size());
+    std::memcpy(at + 4, &n, 4);
+    std::memcpy(at + kHeader, s.data(), s.size());
+    at[kHeader + s.size()] = '\0';
+    return at + kHeader;
+}
+
+namespace {
+
+std::string_view textAt(const char* p) {
+    uint32_t n;
+    std::memcpy(&n, p - 4, 4);
+    return std::string_view(p, n);
+}
+
+}
+
+void StringPool::grow(Shard& sh) {
+    std::vector<const char*> old;
+    old.swap(sh.table);
+    sh.table.assign(old.empty() ? 1024 : old.size() * 2, nullptr);
+    size_t mask = sh.table.size() - 1;
+    for (const char* p : old) {
+        if (!p) continue;
+        size_t i = std::hash<std::string_view>()(textAt(p)) & mask;
+        while (sh.table[i]) i = (i + 1) & mask;
+        sh.table[i] = p;
+    }
+}
+
+// removes p from the table, shifting later entries of its probe run back
+// so that lookups need no tombstones
+void StringPool::unlink(Shard& sh, const char* p) {
+    size_t mask = sh.table.size() - 1;
+    size_t i = std::hash<std::string_view>()(textAt(p)) & mask;
+    while (sh.table[i] != p) i = (i + 1) & mask;
+    for (size_t j = (i + 1) & mask; sh.table[j]; j = (j + 1) & mask) {
+        size_t home = std::hash<std::string_view>()(textAt(sh.table[j])) & mask;
+        // the entry at j may move to i unless its home lies in (i, j]
+        bool stays = i <= j ? (home > i && home <= j) : (home > i || home <= j);
+        if (stays) continue;
+        sh.table[i] = sh.table[j];
+        i = j;
+    }
+    sh.table[i] = nullptr;
+}
+
+InternedString StringPool::intern(std::string_view s) {
+    if (s.empty()) return InternedString();
+    size_t h = std::hash<std::string_view>()(s);
+    // top bits pick the shard, low bits the table slot
+    Shard& sh = shardFor(h);
+    std::lock_guard<std::mutex> lk(sh.lock);
+    if ((sh.used + 1) * 4 > sh.table.size() * 3) grow(sh);
+    size_t mask = sh.table.size() - 1;
+    size_t i = h & mask;
+    while (const char* p = sh.table[i]) {
+        std::string_view cand = textAt(p);
+        if (cand.size() == s.size() && std::memcmp(p, s.data(), s.size()) == 0) {
+            InternedString res(p);
+            res.refs().fetch_add(1, std::memory_order_relaxed);
+            return res;
+        }
+        i = (i + 1) & mask;
+    }
+    const char* p = store(sh, s);
+    sh.table[i] = p;
+    ++sh.used;
+    return InternedString(p);
+}
+
+void StringPool::drop(const char* p) {
+    std::string_view text = textAt(p);
+    Shard& sh = shardFor(std::hash<std::string_view>()(text));
+    std::lock_guard<std::mutex> lk(sh.lock);
+    auto& refs = *reinterpret_cast<std::atomic<uint32_t>*>(const_cast<char*>(p) - kHeader);
+    if (refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+    unlink(sh, p);
+    --sh.used;
+    size_t need = blockSize(text.size());
+    char* block = const_cast<char*>(p) - kHeader;
+    refs.~atomic();
+    if (need > kLarge) {
+        delete[] block;
+        sh.bytes -= need;
+        return;
+    }
+    size_t cls = need / kAlign;
+    if (cls >= sh.free_blocks.size()) sh.free_blocks.resize(kLarge / kAlign + 1, nullptr);
+    std::memcpy(block, &sh.free_blocks[cls], sizeof(char*));
+    sh.free_blocks[cls] = block;
+}
+
+size_t StringPool::bytes() const {
+    size_t n = 0;
+    for (const Shard& sh : shards) {
+        std::lock_guard<std::mutex> lk(sh.lock);
+        n += sh.bytes + sh.table.capacity() * sizeof(const char*);
+    }
+    return n;
+}
+
+size_t StringPool::count() const {
+    size_t n = 0;
+    for (const Shard& sh : shards) {
+        std::lock_guard<std::mutex> lk(sh.lock);
+        n += sh.used;
+    }
+    return n;
+}
+
+// === Dictionary
+Dictionary::Dictionary() : count(0) {
+    for (auto& p : pages) p.store(nullptr, std::memory_order_relaxed);
+    code(std::string_view());
+}
+
+Dictionary& Dictionary::classifications() {
+    static Dictionary* instance = new Dictionary();
+    return *instance;
+}
+
+void Dictionary::locate(uint32_t c, size_t& page, size_t& offset, size_t& page_size) {
+    uint64_t x = uint64_t(c) + (uint64_t(1) << kFirstPageBits);
+    unsigned top = 63 - unsigned(__builtin_clzll(x));
+    page = top - kFirstPageBits;
+    page_size = size_t(1) << top;
+    offset = size_t(x - page_size);
+}
+
+const InternedString& Dictionary::at(uint32_t c) const {
+    size_t page, offset, page_size;
+    locate(c, page, offset, page_size);
+    return pages[page].load(std::memory_order_acquire)[offset];
+}
+
+InternedString Dictionary::interned(uint32_t c) const {
+    if (c >= size()) return InternedString();
+    return at(c);
+}
+
+std::string_view Dictionary::text(uint32_t c) const {
+    if (c >= size()) return std::string_view();
+    return at(c).view();
+}
+
+uint32_t Dictionary::scan(std::string_view s, size_t n) const {
+    for (size_t c = 0; c < n; ++c) {
+        if (at(uint32_t(c)).view() == s) return uint32_t(c);
+    }
+    return kMissing;
+}
+
+uint32_t Dictionary::find(std::string_view s) const {
+    size_t n = size();
+    if (n <= kScan) return scan(s, n);
+    std::lock_guard<std::mutex> lk(lock);
+    auto it = codes.find(s);
+    return it == codes.end() ? kMissing : it->second;
+}
+
+uint32_t Dictionary::code(std::string_view s) {
+    size_t n = size();
+    if (n <= kScan && n > 0) {
+        uint32_t c = scan(s, n);
+        if (c != kMissing) return c;
+    }
+    std::lock_guard<std::mutex> lk(lock);
+    auto it = codes.find(s);
+    if (it != codes.end()) return it->second;
+    n = count.load(std::memory_order_relaxed);
+    if (n >= kMaxCodes) throw std::length_error("Dictionary: more than 2^32 - 1 distinct values");
+    InternedString text = StringPool::global().intern(s);
+    size_t p, offset, page_size;
+    locate(uint32_t(n), p, offset, page_size);
+    InternedString* page = pages[p].load(std::memory_order_relaxed);
+    if (!page) {
+        page = new InternedString[page_size];
+        pages[p].store(page, std::memory_order_release);
+    }
+    page[offset] = text;
+    codes.emplace(text.view(), uint32_t(n));
+    // publishes the entry to lock-free readers
+    count.store(n + 1, std::memory_order_release);
+    return uint32_t(n);
+}
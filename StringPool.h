@@ -0,0 +1,176 @@
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Handle to text interned in the StringPool: one pointer, with the length
+// stored in the four bytes before the text and a reference count before
+// that. Equal texts share one copy, so equality is a pointer compare. The
+// text is freed when its last handle goes; copies count, moves do not.
+class InternedString {
+public:
+    InternedString() : p(none()) {}
+    InternedString(const InternedString& o) : p(o.p) { retain(); }
+    InternedString(InternedString&& o) noexcept : p(o.p) { o.p = none(); }
+    InternedString& operator=(const InternedString& o) {
+        if (p != o.p) {
+            o.retain();
+            release();
+            p = o.p;
+        }
+        return *this;
+    }
+    InternedString& operator=(InternedString&& o) noexcept {
+        if (this != &o) {
+            release();
+            p = o.p;
+            o.p = none();
+        }
+        return *this;
+    }
+    ~InternedString() { release(); }
+
+    std::string_view view() const { return std::string_view(p, size()); }
+    operator std::string_view() const { return view(); }
+    const char* data() const { return p; } // NUL-terminated
+    size_t size() const {
+        uint32_t n;
+        std::memcpy(&n, p - 4, 4);
+        return n;
+    }
+    bool empty() const { return size() == 0; }
+
+    bool operator==(const InternedString& o) const { return p == o.p; }
+    bool operator!=(const InternedString& o) const { return p != o.p; }
+
+private:
+    friend class StringPool;
+    // adopts a reference the pool already counted
+    explicit InternedString(const char* text) : p(text) {}
+
+    alignas(8) static constexpr char kEmpty[16] = {};
+    static const char* none() { return kEmpty + 8; }
+    std::atomic<uint32_t>& refs() const {
+        return *reinterpret_cast<std::atomic<uint32_t>*>(const_cast<char*>(p) - 8);
+    }
+    void retain() const {
+        if (p != none()) refs().fetch_add(1, std::memory_order_relaxed);
+    }
+    inline void release();
+
+    const char* p;
+};
+
+// Process-wide string arena with deduplication. Text is packed into 64 KiB
+// chunks (no per-string allocation) and found again through an
+// open-addressing table of pointers. The pool is split into shards by hash,
+// each with its own lock, so parallel loaders rarely wait on each other.
+//
+// A string leaves the pool with its last handle, under its shard's lock
+// (intern() takes new references under the same lock, so a string cannot
+// come back while it is being dropped). Its block goes on a free list of
+// its size class and is reused by a later string of the same size, so
+// memory follows the strings alive, not every name ever set: renames and
+// removals through a long-running server do not accumulate.
+class StringPool {
+public:
+    static StringPool& global();
+
+    InternedString intern(std::string_view s);
+
+    size_t bytes() const; // arena bytes allocated, free blocks included
+    size_t count() const; // distinct strings alive
+
+private:
+    friend class InternedString;
+    static constexpr size_t kShards = 16;
+    static constexpr size_t kChunk = 64 * 1024;
+    static constexpr size_t kHeader = 8;  // [refs][length] before the text
+    static constexpr size_t kAlign = 8;   // block sizes, so headers stay aligned
+    static constexpr size_t kLarge = kChunk / 4; // blocks above this get their own allocation
+
+    struct alignas(64) Shard {
+        mutable std::mutex lock;
+        std::vector<std::unique_ptr<char[]>> chunks;
+        char* cur = nullptr;
+        size_t left = 0;
+        std::vector<char*> free_blocks; // by size class: head of a list linked through the blocks
+        std::vector<const char*> table; // power of two, nullptr = empty
+        size_t used = 0;
+        size_t bytes = 0;
+    };
+    Shard shards[kShards];
+
+    StringPool() = default;
+    Shard& shardFor(size_t hash) { return shards[(hash >> (sizeof(size_t) * 8 - 4)) % kShards]; }
+    static size_t blockSize(size_t length) { return (kHeader + length + 1 + kAlign - 1) / kAlign * kAlign; }
+    static const char* store(Shard& sh, std::string_view s);
+    static void grow(Shard& sh);
+    static void unlink(Shard& sh, const char* p);
+    // the last reference to p may be going
+    void drop(const char* p);
+};
+
+inline void InternedString::release() {
+    if (p == none()) return;
+    std::atomic<uint32_t>& r = refs();
+    uint32_t c = r.load(std::memory_order_relaxed);
+    while (c > 1) {
+        if (r.compare_exchange_weak(c, c - 1, std::memory_order_acq_rel, std::memory_order_relaxed)) return;
+    }
+    StringPool::global().drop(p);
+}
+
+inline InternedString intern(std::string_view s) { return StringPool::global().intern(s); }
+
+// Small integer codes for a low-cardinality field such as the station
+// classification. Code 0 is the empty string. text() is lock-free; code()
+// scans without a lock while the dictionary is small.
+//
+// Codes are 32-bit: the field is free text, so nothing bounds how many
+// distinct values a load or a client brings in.
+class Dictionary {
+public:
+    static constexpr uint32_t kMissing = 0xFFFFFFFF;
+    static constexpr size_t kMaxCodes = kMissing; // codes 0 .. kMissing - 1
+
+    static Dictionary& classifications();
+
+    // code for s, adding it if new; throws std::length_error when full
+    // (the pool runs out of memory long before)
+    uint32_t code(std::string_view s);
+    // code for s, or kMissing if s was never added
+    uint32_t find(std::string_view s) const;
+    InternedString interned(uint32_t code) const;
+    std::string_view text(uint32_t code) const; // the dictionary keeps it alive
+    size_t size() const { return count.load(std::memory_order_acquire); }
+
+private:
+    // page k holds codes [2^(k+8) - 256, 2^(k+9) - 256): each page doubles,
+    // so a fixed array of page pointers covers every code
+    static constexpr size_t kFirstPageBits = 8;
+    static constexpr size_t kPages = 33 - kFirstPageBits;
+    static constexpr size_t kScan = 16; // lock-free linear search up to this size
+
+    mutable std::mutex lock;
+    std::unordered_map<std::string_view, uint32_t> codes; // views into the pool
+    std::atomic<InternedString*> pages[kPages];
+    std::atomic<size_t> count;
+
+    Dictionary();
+    uint32_t scan(std::string_view s, size_t n) const;
+    // page and offset of code c
+    static void locate(uint32_t c, size_t& page, size_t& offset, size_t& page_size);
+    const InternedString& at(uint32_t c) const;
+};
+
+#endif // STRINGPOOL_H
@@ -0,0 +1,54 @@
+#ifndef TEXTFIELDS_H
+#define TEXTFIELDS_H
+
+#include <string_view>
+#include <charconv>
+#include <cstdint>
+#include <cstddef>
+#include <system_error>
+
+// result of parsing one record line of the text save format
+enum class ParseStatus { Ok, WrongFormat, BadId, BadNumber };
+
+inline const char* parseStatusText(ParseStatus s) {
+    switch (s) {
+        case ParseStatus::Ok: return "ok";
+        case ParseStatus::WrongFormat: return "wrong format";
+        case ParseStatus::BadId: return "bad id";
+        case ParseStatus::BadNumber: return "bad number";
+    }
+    return "unknown";
+}
+
+// Split line on '|' into at most maxFields views. Returns the real number of
+// fields, which is larger than maxFields when the line has too many.
+inline size_t splitFields(std::string_view line, std::string_view* out, size_t maxFields) {
+    size_t n = 0;
+    size_t start = 0;
+    while (true) {
+        size_t bar = line.find('|', start);
+        std::string_view field = line.substr(start, bar == std::string_view::npos ? std::string_view::npos : bar - start);
+        if (n < maxFields) out[n] = field;
+        ++n;
+        if (bar == std::string_view::npos) return n;
+        start = bar + 1;
+    }
+}
+
+// whole-field numeric conversions, no exceptions and no allocation
+inline bool parseField(std::string_view f, uint64_t& v) {
+    auto r = std::from_chars(f.data(), f.data() + f.size(), v);
+    return r.ec == std::errc() && r.ptr == f.data() + f.size();
+}
+
+inline bool parseField(std::string_view f, int& v) {
+    auto r = std::from_chars(f.data(), f.data() + f.size(), v);
+    return r.ec == std::errc() && r.ptr == f.data() + f.size();
+}
+
+inline bool parseField(std::string_view f, double& v) {
+    auto r = std::from_chars(f.data(), f.data() + f.size(), v);
+    return r.ec == std::errc() && r.ptr == f.data() + f.size();
+}
+
+#endif // TEXTFIELDS_H
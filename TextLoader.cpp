@@ -0,0 +1,158 @@
+#include "TextLoader.h"
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+enum class Section { None, Pipes, Stations };
+
+struct Chunk {
+    Section section;
+    size_t begin;
+    size_t end;
+};
+
+struct ChunkResult {
+    bool has_next_id = false;
+    uint64_t next_id = 1;
+    std::vector<Pipe> pipes;
+    std::vector<CompressorStation> stations;
+    std::vector<TextLoadIssue> issues;
+};
+
+const size_t kBlockSize = 4 << 20;
+const size_t kChunkSize = 1 << 20;
+
+bool readWholeFile(const std::string& filename, std::string& buf) {
+    std::FILE* f = std::fopen(filename.c_str(), "rb");
+    if (!f) return false;
+    if (std::fseek(f, 0, SEEK_END) == 0) {
+        long sz = std::ftell(f);
+        if (sz > 0) buf.reserve(static_cast<size_t>(sz));
+        std::fseek(f, 0, SEEK_SET);
+    }
+    size_t have = 0;
+    while (true) {
+        buf.resize(have + kBlockSize);
+        size_t got = std::fread(&buf[have], 1, kBlockSize, f);
+        have += got;
+        if (got < kBlockSize) break;
+    }
+    buf.resize(have);
+    bool ok = !std::ferror(f);
+    std::fclose(f);
+    return ok;
+}
+
+std::string_view lineAt(const std::string& buf, size_t begin, size_t end, size_t& next) {
+    const char* nl = static_cast<const char*>(std::memchr(buf.data() + begin, '\n', end - begin));
+    size_t stop = nl ? static_cast<size_t>(nl - buf.data()) : end;
+    next = nl ? stop + 1 : end;
+    std::string_view line(buf.data() + begin, stop - begin);
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    return line;
+}
+
+// cut [begin, end) of one section into line-aligned chunks
+void addChunks(const std::string& buf, Section section, size_t begin, size_t end, std::vector<Chunk>& chunks) {
+    while (begin < end) {
+        size_t stop = std::min(end, begin + kChunkSize);
+        if (stop < end) {
+            const char* nl = static_cast<const char*>(std::memchr(buf.data() + stop, '\n', end - stop));
+            stop = nl ? static_cast<size_t>(nl - buf.data()) + 1 : end;
+        }
+        chunks.push_back(Chunk{ section, begin, stop });
+        begin = stop;
+    }
+}
+
+// section markers are the only lines that start with '#', so only '#' bytes need a closer look
+std::vector<Chunk> splitSections(const std::string& buf) {
+    std::vector<Chunk> chunks;
+    Section section = Section::None;
+    size_t seg = 0;
+    size_t pos = 0;
+    while (pos < buf.size()) {
+        const char* hash = static_cast<const char*>(std::memchr(buf.data() + pos, '#', buf.size() - pos));
+        if (!hash) break;
+        size_t at = static_cast<size_t>(hash - buf.data());
+        pos = at + 1;
+        if (at != 0 && buf[at - 1] != '\n') continue;
+        size_t next;
+        std::string_view line = lineAt(buf, at, buf.size(), next);
+        Section marker;
+        if (line == "#PIPES") marker = Section::Pipes;
+        else if (line == "#STATIONS") marker = Section::Stations;
+        else continue;
+        addChunks(buf, section, seg, at, chunks);
+        section = marker;
+        seg = next;
+        pos = next;
+    }
+    addChunks(buf, section, seg, buf.size(), chunks);
+    return chunks;
+}
+
+void parseChunk(const std::string& buf, const Chunk& c, ChunkResult& r) {
+    Pipe p;
+    CompressorStation s;
+    size_t pos = c.begin;
+    while (pos < c.end) {
+        std::string_view line = lineAt(buf, pos, c.end, pos);
+        if (line.empty()) continue;
+        if (line.substr(0, 8) == "NEXT_ID|") {
+            r.has_next_id = true;
+            if (!parseField(line.substr(8), r.next_id)) r.next_id = 1;
+            continue;
+        }
+        if (c.section == Section::Pipes) {
+            ParseStatus st = Pipe::parse(line, p);
+            if (st == ParseStatus::Ok) r.pipes.push_back(std::move(p));
+            else r.issues.push_back(TextLoadIssue{ "Pipe", st, std::string(line) });
+        } else if (c.section == Section::Stations) {
+            ParseStatus st = CompressorStation::parse(line, s);
+            if (st == ParseStatus::Ok) r.stations.push_back(std::move(s));
+            else r.issues.push_back(TextLoadIssue{ "CompressorStation", st, std::string(line) });
+        }
+        // lines outside any section are ignored
+    }
+}
+
+}
+
+bool loadTextFile(const std::string& filename, TextLoadResult& out, unsigned threads) {
+    std::string buf;
+    if (!readWholeFile(filename, buf)) return false;
+
+    std::vector<Chunk> chunks = splitSections(buf);
+    std::vector<ChunkResult> results(chunks.size());
+
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, chunks.size()));
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < chunks.size(); i = next++) parseChunk(buf, chunks[i], results[i]);
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto &t : pool) t.join();
+
+    size_t np = 0, ns = 0;
+    for (const auto &r : results) { np += r.pipes.size(); ns += r.stations.size(); }
+    out = TextLoadResult();
+    out.pipes.reserve(np);
+    out.stations.reserve(ns);
+    for (auto &r : results) {
+        if (r.has_next_id) out.next_id = r.next_id;
+        std::move(r.pipes.begin(), r.pipes.end(), std::back_inserter(out.pipes));
+        std::move(r.stations.begin(), r.stations.end(), std::back_inserter(out.stations));
+        std::move(r.issues.begin(), r.issues.end(), std::back_inserter(out.issues));
+    }
+    return true;
+}
@@ -0,0 +1,31 @@
+#ifndef TEXTLOADER_H
+#define TEXTLOADER_H
+
+#include "Pipe.h"
+#include "CompressorStation.h"
+#include "TextFields.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// malformed record line found while loading
+struct TextLoadIssue {
+    const char* entity; // "Pipe" or "CompressorStation"
+    ParseStatus status;
+    std::string line;
+};
+
+struct TextLoadResult {
+    uint64_t next_id = 1; // value of the last NEXT_ID| line, 1 if absent or unreadable
+    std::vector<Pipe> pipes;
+    std::vector<CompressorStation> stations;
+    std::vector<TextLoadIssue> issues; // in file order
+};
+
+// Parse a text save file. The file is read in large blocks, the #PIPES and
+// #STATIONS sections are cut into line-aligned chunks and the chunks are
+// parsed on up to `threads` workers (0 = hardware concurrency). Records keep
+// file order. Returns false only if the file cannot be read.
+bool loadTextFile(const std::string& filename, TextLoadResult& out, unsigned threads = 0);
+
+#endif // TEXTLOADER_H
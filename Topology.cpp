@@ -0,0 +1,116 @@
+#include "Topology.h"
+#include <algorithm>
+
+// === Adjacency
+void Topology::Adjacency::grow(uint32_t vertices) {
+    if (vertices <= degree.size()) return;
+    begin.resize(vertices, uint32_t(edges.size()));
+    degree.resize(vertices, 0);
+    capacity.resize(vertices, 0);
+}
+
+void Topology::Adjacency::add(uint32_t v, uint32_t e, std::vector<uint32_t>& pos) {
+    if (degree[v] == capacity[v]) {
+        // segment full: move it to the end with twice the room
+        uint32_t cap = std::max<uint32_t>(4, capacity[v] * 2);
+        uint32_t at = uint32_t(edges.size());
+        edges.resize(edges.size() + cap);
+        for (uint32_t i = 0; i < degree[v]; ++i) {
+            uint32_t moved = edges[begin[v] + i];
+            edges[at + i] = moved;
+            pos[moved] = at + i;
+        }
+        abandoned += capacity[v];
+        begin[v] = at;
+        capacity[v] = cap;
+    }
+    uint32_t at = begin[v] + degree[v]++;
+    edges[at] = e;
+    pos[e] = at;
+    if (abandoned > edges.size() / 2) compact(pos);
+}
+
+void Topology::Adjacency::remove(uint32_t v, uint32_t e, std::vector<uint32_t>& pos) {
+    // the last entry of the segment takes the removed one's place
+    uint32_t last = begin[v] + --degree[v];
+    uint32_t at = pos[e];
+    edges[at] = edges[last];
+    pos[edges[at]] = at;
+}
+
+void Topology::Adjacency::compact(std::vector<uint32_t>& pos) {
+    size_t total = 0;
+    for (size_t v = 0; v < degree.size(); ++v) total += degree[v] + (degree[v] + 3) / 4;
+    std::vector<uint32_t> packed(total);
+    uint32_t at = 0;
+    for (size_t v = 0; v < degree.size(); ++v) {
+        for (uint32_t i = 0; i < degree[v]; ++i) {
+            uint32_t e = edges[begin[v] + i];
+            packed[at + i] = e;
+            pos[e] = at + i;
+        }
+        begin[v] = at;
+        capacity[v] = degree[v] + (degree[v] + 3) / 4; // a quarter spare
+        at += capacity[v];
+    }
+    edges.swap(packed);
+    abandoned = 0;
+}
+
+void Topology::Adjacency::clear() {
+    begin.clear();
+    degree.clear();
+    capacity.clear();
+    edges.clear();
+    abandoned = 0;
+}
+
+size_t Topology::Adjacency::memoryBytes() const {
+    return (begin.capacity() + degree.capacity() + capacity.capacity() + edges.capacity()) * sizeof(uint32_t);
+}
+
+// === Topology
+void Topology::connect(uint32_t edge, uint32_t source, uint32_t target) {
+    if (edge >= src.size()) {
+        src.resize(size_t(edge) + 1, kNone);
+        dst.resize(size_t(edge) + 1, kNone);
+        out_pos.resize(size_t(edge) + 1, 0);
+        in_pos.resize(size_t(edge) + 1, 0);
+    }
+    uint32_t vertices = std::max(source, target) + 1;
+    out.grow(vertices);
+    in.grow(vertices);
+    src[edge] = source;
+    dst[edge] = target;
+    out.add(source, edge, out_pos);
+    in.add(target, edge, in_pos);
+    ++edge_count;
+}
+
+void Topology::disconnect(uint32_t edge) {
+    if (!connected(edge)) return;
+    out.remove(src[edge], edge, out_pos);
+    in.remove(dst[edge], edge, in_pos);
+    src[edge] = dst[edge] = kNone;
+    --edge_count;
+}
+
+void Topology::compact() {
+    out.compact(out_pos);
+    in.compact(in_pos);
+}
+
+void Topology::clear() {
+    src.clear();
+    dst.clear();
+    out_pos.clear();
+    in_pos.clear();
+    out.clear();
+    in.clear();
+    edge_count = 0;
+}
+
+size_t Topology::memoryBytes() const {
+    return (src.capacity() + dst.capacity() + out_pos.capacity() + in_pos.capacity()) * sizeof(uint32_t)
+         + out.memoryBytes() + in.memoryBytes();
+}
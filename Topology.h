@@ -0,0 +1,63 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Directed multigraph of the pipeline network: vertices are station slots,
+// edges are pipe slots running source -> target. Out- and in-edges are kept
+// in compressed sparse row form with slack after each vertex's segment, so
+// connect / disconnect are O(1): a full segment moves to the end of the
+// array with twice the room, and the array is compacted back into vertex
+// order once more than half of it is abandoned segments.
+class Topology {
+public:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    // edge must not be connected already
+    void connect(uint32_t edge, uint32_t source, uint32_t target);
+    // no-op for an edge that is not connected
+    void disconnect(uint32_t edge);
+
+    bool connected(uint32_t edge) const { return edge < src.size() && src[edge] != kNone; }
+    uint32_t source(uint32_t edge) const { return src[edge]; }
+    uint32_t target(uint32_t edge) const { return dst[edge]; }
+    size_t edgeCount() const { return edge_count; }
+    uint32_t edgeBound() const { return uint32_t(src.size()); }      // one past the highest edge slot
+    uint32_t vertexBound() const { return uint32_t(out.degree.size()); } // one past the highest vertex slot
+
+    size_t outDegree(uint32_t v) const { return v < out.degree.size() ? out.degree[v] : 0; }
+    size_t inDegree(uint32_t v) const { return v < in.degree.size() ? in.degree[v] : 0; }
+    // edges leaving / entering v, in no particular order
+    const uint32_t* outEdges(uint32_t v) const { return out.edges.data() + (v < out.begin.size() ? out.begin[v] : 0); }
+    const uint32_t* inEdges(uint32_t v) const { return in.edges.data() + (v < in.begin.size() ? in.begin[v] : 0); }
+
+    // lay every segment out again in vertex order (after bulk connects)
+    void compact();
+    void clear();
+    size_t memoryBytes() const;
+
+private:
+    struct Adjacency {
+        std::vector<uint32_t> begin;    // per vertex: segment start in edges
+        std::vector<uint32_t> degree;   // per vertex: used entries
+        std::vector<uint32_t> capacity; // per vertex: segment length
+        std::vector<uint32_t> edges;
+        size_t abandoned = 0;           // entries in segments no vertex owns any more
+
+        void add(uint32_t v, uint32_t e, std::vector<uint32_t>& pos);
+        void remove(uint32_t v, uint32_t e, std::vector<uint32_t>& pos);
+        void grow(uint32_t vertices);
+        void compact(std::vector<uint32_t>& pos);
+        void clear();
+        size_t memoryBytes() const;
+    };
+
+    std::vector<uint32_t> src, dst;         // per edge, kNone when not connected
+    std::vector<uint32_t> out_pos, in_pos;  // per edge: index in out.edges / in.edges
+    Adjacency out, in;
+    size_t edge_count = 0;
+};
+
+#endif // TOPOLOGY_H
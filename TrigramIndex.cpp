@@ -0,0 +1,115 @@
+#include "TrigramIndex.h"
+#include <algorithm>
+#include <iterator>
+#include <cstdint>
+
+uint32_t TrigramIndex::key(const char* p) {
+    return (uint32_t(uint8_t(p[0])) << 16) | (uint32_t(uint8_t(p[1])) << 8) | uint32_t(uint8_t(p[2]));
+}
+
+// distinct trigrams of text, sorted
+void TrigramIndex::grams(std::string_view text, std::vector<uint32_t>& out) {
+    out.clear();
+    if (text.size() < kGram) return;
+    out.reserve(text.size() - kGram + 1);
+    for (size_t i = 0; i + kGram <= text.size(); ++i) out.push_back(key(text.data() + i));
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+void TrigramIndex::insert(uint64_t id, std::string_view text) {
+    std::vector<uint32_t>& gs = scratch;
+    grams(text, gs);
+    live_entries += gs.size();
+    for (uint32_t g : gs) {
+        auto& list = postings[g];
+        // ids come from a counter, so appending is the common case
+        if (list.empty() || list.back() < id) { list.push_back(id); ++total_entries; continue; }
+        auto it = std::lower_bound(list.begin(), list.end(), id);
+        if (it == list.end() || *it != id) { list.insert(it, id); ++total_entries; }
+    }
+}
+
+void TrigramIndex::insertMany(const std::vector<uint64_t>& ids, std::string_view text) {
+    if (ids.empty()) return;
+    std::vector<uint32_t>& gs = scratch;
+    grams(text, gs);
+    live_entries += gs.size() * ids.size();
+    std::vector<uint64_t> merged;
+    for (uint32_t g : gs) {
+        auto& list = postings[g];
+        size_t before = list.size();
+        if (list.empty() || list.back() < ids.front()) {
+            list.insert(list.end(), ids.begin(), ids.end());
+        } else {
+            merged.clear();
+            merged.reserve(list.size() + ids.size());
+            std::set_union(list.begin(), list.end(), ids.begin(), ids.end(), std::back_inserter(merged));
+            list.swap(merged);
+        }
+        total_entries += list.size() - before;
+    }
+}
+
+void TrigramIndex::erase(uint64_t, std::string_view text) {
+    std::vector<uint32_t>& gs = scratch;
+    grams(text, gs);
+    live_entries -= gs.size();
+}
+
+void TrigramIndex::clear() {
+    postings.clear();
+    total_entries = 0;
+    live_entries = 0;
+}
+
+size_t TrigramIndex::memoryBytes() const {
+    // node: next pointer, key, vector header
+    const size_t kNode = sizeof(void*) + sizeof(uint32_t) + sizeof(std::vector<uint64_t>) + 4;
+    return total_entries * sizeof(uint64_t) + postings.size() * kNode + postings.bucket_count() * sizeof(void*);
+}
+
+bool TrigramIndex::needsRebuild() const {
+    size_t stale = total_entries - live_entries;
+    return stale > 65536 && stale > live_entries;
+}
+
+std::vector<const std::vector<uint64_t>*> TrigramIndex::lists(const std::string& pattern) const {
+    std::vector<uint32_t> gs;
+    grams(pattern, gs);
+    std::vector<const std::vector<uint64_t>*> res;
+    res.reserve(gs.size());
+    static const std::vector<uint64_t> empty;
+    for (uint32_t g : gs) {
+        auto it = postings.find(g);
+        if (it == postings.end()) return { &empty };
+        res.push_back(&it->second);
+    }
+    std::sort(res.begin(), res.end(), [](auto a, auto b){ return a->size() < b->size(); });
+    return res;
+}
+
+size_t TrigramIndex::estimate(const std::string& pattern) const {
+    if (pattern.size() < kGram) return SIZE_MAX;
+    return lists(pattern).front()->size();
+}
+
+bool TrigramIndex::lookup(const std::string& pattern, std::vector<uint64_t>& out) const {
+    out.clear();
+    if (pattern.size() < kGram) return false;
+    auto ls = lists(pattern);
+    out = *ls.front();
+    // intersect shortest-first; gallop through long lists instead of merging
+    for (size_t i = 1; i < ls.size() && !out.empty(); ++i) {
+        const auto& other = *ls[i];
+        size_t w = 0;
+        auto from = other.begin();
+        for (uint64_t id : out) {
+            from = std::lower_bound(from, other.end(), id);
+            if (from == other.end()) break;
+            if (*from == id) out[w++] = id;
+        }
+        out.resize(w);
+    }
+    return true;
+}
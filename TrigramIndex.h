@@ -0,0 +1,52 @@
+#ifndef TRIGRAMINDEX_H
+#define TRIGRAMINDEX_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+
+// Inverted index from byte trigrams of a name to the sorted list of ids whose
+// name contains that trigram. Works on raw bytes, so UTF-8 names need no
+// special handling (a Cyrillic letter is two bytes).
+//
+// Removals are lazy: posting lists keep the old id and lookups return a
+// superset that the caller must verify against the current name. Once stale
+// entries outnumber live ones the owner rebuilds the index from scratch.
+class TrigramIndex {
+public:
+    static constexpr size_t kGram = 3;
+
+    void insert(uint64_t id, std::string_view text);
+    void erase(uint64_t id, std::string_view text);
+    // insert the same text for many ids (ascending): one merge per posting list
+    void insertMany(const std::vector<uint64_t>& ids, std::string_view text);
+    void clear();
+
+    // true when enough stale entries piled up that a rebuild pays off
+    bool needsRebuild() const;
+
+    // Candidate ids (ascending) for names that may contain pattern.
+    // Returns false when the pattern is too short to use the index.
+    bool lookup(const std::string& pattern, std::vector<uint64_t>& out) const;
+
+    // size of the shortest posting list for pattern, or SIZE_MAX if unusable
+    size_t estimate(const std::string& pattern) const;
+
+    // approximate heap bytes: posting entries plus one hash node per trigram
+    size_t memoryBytes() const;
+
+private:
+    std::unordered_map<uint32_t, std::vector<uint64_t>> postings;
+    size_t total_entries = 0; // postings actually stored
+    size_t live_entries = 0;  // postings the current names need
+    std::vector<uint32_t> scratch;
+
+    static uint32_t key(const char* p);
+    static void grams(std::string_view text, std::vector<uint32_t>& out);
+    std::vector<const std::vector<uint64_t>*> lists(const std::string& pattern) const;
+};
+
+#endif // TRIGRAMINDEX_H
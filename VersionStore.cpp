@@ -0,0 +1,103 @@
+#include "VersionStore.h"
+
+// === ReadView
+VersionStore::ReadView::ReadView(const VersionStore& store)
+    : guard(store.epochs.pin()), v(store.current.load(std::memory_order_acquire)) {}
+
+// === VersionStore
+VersionStore::VersionStore() : current(new Version()), next(nullptr) {}
+
+VersionStore::~VersionStore() {
+    // publishing first leaves every live record reachable from exactly one version
+    publish();
+    const Version* v = current.load();
+    retireAll(v->pipes);
+    retireAll(v->stations);
+    delete v;
+    // ~EpochManager frees everything retired
+}
+
+uint64_t VersionStore::publishedVersion() const {
+    return current.load(std::memory_order_acquire)->number;
+}
+
+void VersionStore::beginStage() {
+    if (next) return;
+    next = new Version(*current.load(std::memory_order_relaxed));
+    next->number += 1;
+    pipe_owned.assign(next->pipes.size(), false);
+    station_owned.assign(next->stations.size(), false);
+}
+
+template <typename T>
+void VersionStore::stage(std::vector<const Chunk<T>*>& chunks, std::vector<bool>& owned, size_t& count,
+                         uint64_t id, const T* cur) {
+    size_t c = size_t(id >> kChunkBits);
+    if (c >= chunks.size()) {
+        if (!cur) return;
+        chunks.resize(c + 1, nullptr);
+        owned.resize(c + 1, false);
+    }
+    if (!owned[c]) {
+        // first change to this chunk in this round: copy it, the old one goes
+        // away once readers of the current version are done
+        Chunk<T>* copy = chunks[c] ? new Chunk<T>(*chunks[c]) : new Chunk<T>();
+        epochs.retire(chunks[c]);
+        chunks[c] = copy;
+        owned[c] = true;
+    }
+    Chunk<T>* chunk = const_cast<Chunk<T>*>(chunks[c]);
+    const T*& item = chunk->items[id & (kChunkSize - 1)];
+    if (item) {
+        // the record may still be in the published version, or only staged
+        epochs.retire(item);
+        --count;
+    }
+    item = cur ? new T(*cur) : nullptr;
+    if (item) ++count;
+}
+
+void VersionStore::stagePipe(uint64_t id, const Pipe* cur) {
+    beginStage();
+    stage(next->pipes, pipe_owned, next->pipe_count, id, cur);
+}
+
+void VersionStore::stageStation(uint64_t id, const CompressorStation* cur) {
+    beginStage();
+    stage(next->stations, station_owned, next->station_count, id, cur);
+}
+
+template <typename T>
+void VersionStore::retireAll(const std::vector<const Chunk<T>*>& chunks) {
+    for (const Chunk<T>* c : chunks) {
+        if (!c) continue;
+        for (const T* item : c->items) epochs.retire(item);
+        epochs.retire(c);
+    }
+}
+
+void VersionStore::stageClear() {
+    beginStage();
+    // each record and chunk is reachable from exactly one slot of next, so
+    // retiring them all here never frees anything twice
+    retireAll(next->pipes);
+    retireAll(next->stations);
+    next->pipes.clear();
+    next->stations.clear();
+    next->pipe_count = 0;
+    next->station_count = 0;
+    pipe_owned.clear();
+    station_owned.clear();
+}
+
+uint64_t VersionStore::publish() {
+    if (!next) return publishedVersion();
+    const Version* old = current.exchange(next, std::memory_order_acq_rel);
+    epochs.retire(old);
+    uint64_t number = next->number;
+    next = nullptr;
+    pipe_owned.clear();
+    station_owned.clear();
+    epochs.advance();
+    return number;
+}
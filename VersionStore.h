@@ -0,0 +1,123 @@
+#ifndef VERSIONSTORE_H
+#define VERSIONSTORE_H
+
+#include "Pipe.h"
+#include "CompressorStation.h"
+#include "Epoch.h"
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Immutable, published versions of the network for concurrent readers.
+//
+// A version maps id -> record through fixed-size chunks of record pointers.
+// Publishing copies only the chunks that hold changed ids and the small
+// top-level chunk table; everything else is shared with the previous version.
+// Replaced records, chunks and versions are reclaimed through EpochManager.
+class VersionStore {
+public:
+    static constexpr size_t kChunkBits = 10;
+    static constexpr size_t kChunkSize = size_t(1) << kChunkBits;
+
+    template <typename T>
+    struct Chunk {
+        const T* items[kChunkSize] = {};
+    };
+
+    struct Version {
+        uint64_t number = 0;
+        std::vector<const Chunk<Pipe>*> pipes;
+        std::vector<const Chunk<CompressorStation>*> stations;
+        size_t pipe_count = 0;
+        size_t station_count = 0;
+    };
+
+    // Consistent read-only view of the latest published version. Holding a
+    // ReadView never blocks the writer; it only delays freeing what the view
+    // can still see. Keep views short-lived; threads may share one for reading.
+    class ReadView {
+    public:
+        explicit ReadView(const VersionStore& store);
+        ReadView(const ReadView&) = delete;
+        ReadView& operator=(const ReadView&) = delete;
+
+        uint64_t version() const { return v->number; }
+        size_t pipeCount() const { return v->pipe_count; }
+        size_t stationCount() const { return v->station_count; }
+        const Pipe* findPipe(uint64_t id) const { return lookup(v->pipes, id); }
+        const CompressorStation* findStation(uint64_t id) const { return lookup(v->stations, id); }
+
+        // ascending id order
+        template <typename F>
+        void forEachPipe(F f) const { each(v->pipes, f); }
+        template <typename F>
+        void forEachStation(F f) const { each(v->stations, f); }
+        // ascending ids from first on, while f returns true
+        template <typename F>
+        void scanPipes(uint64_t first, F f) const { scan(v->pipes, first, f); }
+        template <typename F>
+        void scanStations(uint64_t first, F f) const { scan(v->stations, first, f); }
+
+    private:
+        EpochManager::Guard guard;
+        const Version* v;
+
+        template <typename T>
+        static const T* lookup(const std::vector<const Chunk<T>*>& chunks, uint64_t id) {
+            uint64_t c = id >> kChunkBits;
+            if (c >= chunks.size() || !chunks[c]) return nullptr;
+            return chunks[c]->items[id & (kChunkSize - 1)];
+        }
+        template <typename T, typename F>
+        static void each(const std::vector<const Chunk<T>*>& chunks, F& f) {
+            for (const Chunk<T>* c : chunks) {
+                if (!c) continue;
+                for (const T* item : c->items) if (item) f(*item);
+            }
+        }
+        template <typename T, typename F>
+        static void scan(const std::vector<const Chunk<T>*>& chunks, uint64_t first, F& f) {
+            for (uint64_t c = first >> kChunkBits; c < chunks.size(); ++c) {
+                if (!chunks[c]) continue;
+                size_t i = c == (first >> kChunkBits) ? size_t(first & (kChunkSize - 1)) : 0;
+                for (; i < kChunkSize; ++i) {
+                    const T* item = chunks[c]->items[i];
+                    if (item && !f(*item)) return;
+                }
+            }
+        }
+    };
+
+    VersionStore();
+    ~VersionStore();
+    VersionStore(const VersionStore&) = delete;
+    VersionStore& operator=(const VersionStore&) = delete;
+
+    // --- writer side (the thread that owns the Manager)
+    // stage the current state of an id; nullptr stages a removal
+    void stagePipe(uint64_t id, const Pipe* current);
+    void stageStation(uint64_t id, const CompressorStation* current);
+    // stage removal of everything (before restaging a reloaded network)
+    void stageClear();
+    // atomically make the staged changes visible; returns the new version number
+    uint64_t publish();
+    bool hasStaged() const { return next != nullptr; }
+    uint64_t publishedVersion() const;
+
+private:
+    std::atomic<const Version*> current;
+    Version* next;                  // staged version, copy-on-write from current
+    std::vector<bool> pipe_owned;   // chunks of next already copied in this round
+    std::vector<bool> station_owned;
+    EpochManager epochs;
+
+    void beginStage();
+    template <typename T>
+    void stage(std::vector<const Chunk<T>*>& chunks, std::vector<bool>& owned, size_t& count,
+               uint64_t id, const T* current);
+    template <typename T>
+    void retireAll(const std::vector<const Chunk<T>*>& chunks);
+};
+
+#endif // VERSIONSTORE_H
@@ -0,0 +1,122 @@
+#ifndef GENERATORS_H
+#define GENERATORS_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+// Deterministic synthetic network data for benchmarks. The same seed and
+// config always produce the same sequence on every platform (no <random>
+// distributions, whose output is implementation defined).
+
+struct NetworkConfig {
+    size_t pipes = 100000;
+    size_t stations = 10000;
+    double repair_ratio = 0.1;   // share of pipes created in repair
+    double cyrillic_ratio = 0.3; // share of names built from Cyrillic words
+    uint64_t seed = 42;
+};
+
+// splitmix64
+class BenchRng {
+public:
+    explicit BenchRng(uint64_t seed) : state(seed) {}
+    uint64_t next() {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+    uint64_t below(uint64_t n) { return n ? next() % n : 0; }
+    double unit() { return double(next() >> 11) * (1.0 / 9007199254740992.0); }
+    bool chance(double p) { return unit() < p; }
+
+private:
+    uint64_t state;
+};
+
+struct PipeSpec {
+    std::string name;
+    double diameter;
+    bool in_repair;
+};
+
+struct StationSpec {
+    std::string name;
+    int total;
+    int working;
+    std::string classification;
+};
+
+class NetworkGenerator {
+public:
+    explicit NetworkGenerator(const NetworkConfig& c) : cfg(c), rng(c.seed) {}
+
+    // Names look like "Магистраль-Северная-1234" or "MainLine-East-77": a
+    // skewed choice of base word (a few words dominate, like real networks)
+    // plus a region and a number.
+    std::string name() {
+        static const char* latin[] = { "MainLine", "Feeder", "Bypass", "Loop", "Branch", "Collector", "Header", "Spur" };
+        static const char* cyrillic[] = { "Магистраль", "Отвод", "Перемычка", "Лупинг", "Коллектор", "Газопровод", "Ветка", "Байпас" };
+        static const char* latin_region[] = { "North", "South", "East", "West", "Central" };
+        static const char* cyrillic_region[] = { "Северная", "Южная", "Восточная", "Западная", "Центральная" };
+        bool cyr = rng.chance(cfg.cyrillic_ratio);
+        // min of two uniforms skews towards the first words
+        size_t w = std::min(rng.below(8), rng.below(8));
+        std::string s = cyr ? cyrillic[w] : latin[w];
+        s += '-';
+        s += cyr ? cyrillic_region[rng.below(5)] : latin_region[rng.below(5)];
+        s += '-';
+        s += std::to_string(rng.below(100000));
+        return s;
+    }
+
+    PipeSpec pipe() {
+        static const double sizes[] = { 219, 325, 426, 530, 720, 820, 1020, 1220, 1420 };
+        PipeSpec p;
+        p.name = name();
+        p.diameter = sizes[rng.below(9)];
+        p.in_repair = rng.chance(cfg.repair_ratio);
+        return p;
+    }
+
+    StationSpec station() {
+        static const char* classes[] = { "A", "A+", "B", "C" };
+        StationSpec s;
+        s.name = "КС-" + name();
+        s.total = 1 + int(rng.below(16));
+        s.working = int(rng.below(uint64_t(s.total) + 1));
+        s.classification = classes[rng.below(4)];
+        return s;
+    }
+
+    std::vector<PipeSpec> pipes() {
+        std::vector<PipeSpec> v;
+        v.reserve(cfg.pipes);
+        for (size_t i = 0; i < cfg.pipes; ++i) v.push_back(pipe());
+        return v;
+    }
+
+    std::vector<StationSpec> stations() {
+        std::vector<StationSpec> v;
+        v.reserve(cfg.stations);
+        for (size_t i = 0; i < cfg.stations; ++i) v.push_back(station());
+        return v;
+    }
+
+    // search patterns drawn from the same vocabulary as the names
+    std::string namePattern() {
+        static const char* patterns[] = { "Main", "Feeder-North", "Магистраль", "Отвод-Юж", "-12", "Loop", "Ветка-Центральная", "Header-W" };
+        return patterns[rng.below(8)];
+    }
+
+    BenchRng& random() { return rng; }
+
+private:
+    NetworkConfig cfg;
+    BenchRng rng;
+};
+
+#endif // GENERATORS_H
@@ -0,0 +1,550 @@
+// Manager benchmark: builds a synthetic network and times every public
+// operation. Prints a table and optionally writes JSON for comparing commits.
+//
+//   manager_bench --pipes 1000000 --stations 100000 --json results.json --label $(git rev-parse --short HEAD)
+
+#include "Manager.h"
+#include "Generators.h"
+#include "Server.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+// === allocation counting
+// Every operator new is counted per thread, so the "alloc" stage sees only
+// what the Manager's own thread allocates (not the logger or journal threads).
+namespace {
+thread_local size_t t_allocations = 0;
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+// malloc/free pairs seen through inlined std::allocator look mismatched to GCC
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void* operator new(std::size_t n) {
+    ++t_allocations;
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { ::operator delete(p); }
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// peak resident set size of the process so far, in KiB (0 where unsupported)
+long peakRssKb() {
+#ifndef _WIN32
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+#ifdef __APPLE__
+    return ru.ru_maxrss / 1024;
+#else
+    return ru.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+}
+
+struct Result {
+    std::string name;
+    size_t ops = 0;
+    double seconds = 0.0;
+    double p50_ns = 0.0;
+    double p99_ns = 0.0;
+    long peak_rss_kb = 0;
+};
+
+// Times ops calls of f(i) one by one. Latencies are kept for at most
+// kMaxSamples evenly spaced calls so 1e7-op runs stay cheap.
+class Recorder {
+public:
+    static const size_t kMaxSamples = 1 << 20;
+
+    template <typename F>
+    const Result& run(const std::string& name, size_t ops, F f) {
+        Result r;
+        r.name = name;
+        r.ops = ops;
+        std::vector<uint64_t> lat;
+        size_t stride = ops / kMaxSamples + 1;
+        lat.reserve(ops / stride + 1);
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < ops; ++i) {
+            Clock::time_point t0 = Clock::now();
+            f(i);
+            if (i % stride == 0) lat.push_back(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count()));
+        }
+        r.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if (!lat.empty()) {
+            std::sort(lat.begin(), lat.end());
+            r.p50_ns = double(lat[lat.size() / 2]);
+            r.p99_ns = double(lat[std::min(lat.size() - 1, lat.size() * 99 / 100)]);
+        }
+        r.peak_rss_kb = peakRssKb();
+        results.push_back(r);
+        print(r);
+        return results.back();
+    }
+
+    const std::vector<Result>& all() const { return results; }
+
+private:
+    std::vector<Result> results;
+
+    static void print(const Result& r) {
+        double rate = r.seconds > 0 ? r.ops / r.seconds : 0.0;
+        std::printf("%-24s %10zu ops %14.1f ops/s  p50 %10.0f ns  p99 %10.0f ns  rss %8ld KiB\n",
+                    r.name.c_str(), r.ops, rate, r.p50_ns, r.p99_ns, r.peak_rss_kb);
+        std::fflush(stdout);
+    }
+};
+
+struct Options {
+    NetworkConfig net;
+    std::string json;
+    std::string label;
+    std::string dir = ".";
+    std::string only; // comma separated stage names, empty = all
+    std::string metrics; // Prometheus dump of the built-in metrics after the run
+#ifdef _WIN32
+    std::string log = "NUL";
+#else
+    std::string log = "/dev/null";
+#endif
+};
+
+void usage() {
+    std::cout << "usage: manager_bench [--pipes N] [--stations N] [--repair-ratio R] [--cyrillic-ratio R]\n"
+                 "                     [--seed S] [--json FILE] [--label TEXT] [--dir TMPDIR] [--log FILE] [--metrics FILE]\n"
+                 "                     [--only add,find,search,batch,flow,alloc,server,export,history,save,load,remove]\n";
+}
+
+bool parseArgs(int argc, char** argv, Options& o) {
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--help" || a == "-h") { usage(); std::exit(0); }
+        if (i + 1 >= argc) { std::cerr << "missing value for " << a << "\n"; return false; }
+        std::string v = argv[++i];
+        if (a == "--pipes") o.net.pipes = std::stoull(v);
+        else if (a == "--stations") o.net.stations = std::stoull(v);
+        else if (a == "--repair-ratio") o.net.repair_ratio = std::stod(v);
+        else if (a == "--cyrillic-ratio") o.net.cyrillic_ratio = std::stod(v);
+        else if (a == "--seed") o.net.seed = std::stoull(v);
+        else if (a == "--json") o.json = v;
+        else if (a == "--label") o.label = v;
+        else if (a == "--dir") o.dir = v;
+        else if (a == "--log") o.log = v;
+        else if (a == "--only") o.only = v;
+        else if (a == "--metrics") o.metrics = v;
+        else { std::cerr << "unknown option " << a << "\n"; return false; }
+    }
+    return true;
+}
+
+// Allocation budgets of steady-state Manager operations: op(i) runs warmup
+// times unmeasured, then every further call may allocate at most budget times.
+// The warmup lets capacity-kept structures reach their working size (log ring
+// slots, connectivity levels, trigram postings, query scratch).
+struct AllocCheck {
+    const char* name;
+    size_t budget;
+    size_t warmup;
+    std::function<void(size_t)> op;
+};
+
+bool checkAllocations(const std::vector<AllocCheck>& checks, size_t runs) {
+    bool ok = true;
+    for (const AllocCheck& c : checks) {
+        for (size_t i = 0; i < c.warmup; ++i) c.op(i);
+        size_t worst = 0, total = 0;
+        for (size_t i = 0; i < runs; ++i) {
+            size_t before = t_allocations;
+            c.op(c.warmup + i);
+            size_t n = t_allocations - before;
+            worst = std::max(worst, n);
+            total += n;
+        }
+        bool pass = worst <= c.budget;
+        ok = ok && pass;
+        std::printf("alloc %-27s worst %6zu  avg %8.2f  budget %4zu  %s\n", c.name, worst, double(total) / double(runs),
+                    c.budget, pass ? "ok" : "OVER BUDGET");
+    }
+    std::fflush(stdout);
+    return ok;
+}
+
+bool enabled(const Options& o, const char* stage) {
+    if (o.only.empty()) return true;
+    std::string list = "," + o.only + ",";
+    return list.find("," + std::string(stage) + ",") != std::string::npos;
+}
+
+std::string jsonEscape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') { out += '\\'; out += c; }
+        else if (static_cast<unsigned char>(c) < 0x20) { char buf[8]; std::snprintf(buf, sizeof(buf), "\\u%04x", c); out += buf; }
+        else out += c;
+    }
+    return out;
+}
+
+bool writeJson(const Options& o, const std::vector<Result>& results) {
+    std::ofstream os(o.json);
+    if (!os) return false;
+    os << "{\n";
+    os << "  \"label\": \"" << jsonEscape(o.label) << "\",\n";
+    os << "  \"config\": { \"pipes\": " << o.net.pipes << ", \"stations\": " << o.net.stations
+       << ", \"repair_ratio\": " << o.net.repair_ratio << ", \"cyrillic_ratio\": " << o.net.cyrillic_ratio
+       << ", \"seed\": " << o.net.seed << " },\n";
+    os << "  \"peak_rss_kb\": " << peakRssKb() << ",\n";
+    os << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        double rate = r.seconds > 0 ? r.ops / r.seconds : 0.0;
+        os << "    { \"name\": \"" << jsonEscape(r.name) << "\", \"ops\": " << r.ops
+           << ", \"seconds\": " << r.seconds << ", \"ops_per_sec\": " << rate
+           << ", \"p50_ns\": " << r.p50_ns << ", \"p99_ns\": " << r.p99_ns
+           << ", \"peak_rss_kb\": " << r.peak_rss_kb << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    os << "  ]\n}\n";
+    return bool(os);
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options o;
+    if (!parseArgs(argc, argv, o)) { usage(); return 2; }
+
+    NetworkGenerator gen(o.net);
+    std::vector<PipeSpec> pipeSpecs = gen.pipes();
+    std::vector<StationSpec> stationSpecs = gen.stations();
+    std::printf("network: %zu pipes, %zu stations, repair %.2f, cyrillic %.2f, seed %llu\n",
+                o.net.pipes, o.net.stations, o.net.repair_ratio, o.net.cyrillic_ratio,
+                static_cast<unsigned long long>(o.net.seed));
+
+    Recorder rec;
+    Manager m(o.log);
+    std::vector<uint64_t> pipeIds, stationIds;
+    pipeIds.reserve(pipeSpecs.size());
+    stationIds.reserve(stationSpecs.size());
+
+    // the network is always built; "add" only controls whether it is reported
+    auto addPipes = [&](size_t i) {
+        const PipeSpec& p = pipeSpecs[i];
+        pipeIds.push_back(m.addPipe(p.name, p.diameter, p.in_repair));
+    };
+    auto addStations = [&](size_t i) {
+        const StationSpec& s = stationSpecs[i];
+        stationIds.push_back(m.addStation(s.name, s.total, s.working, s.classification));
+    };
+    if (enabled(o, "add")) {
+        rec.run("add_pipe", pipeSpecs.size(), addPipes);
+        rec.run("add_station", stationSpecs.size(), addStations);
+    } else {
+        for (size_t i = 0; i < pipeSpecs.size(); ++i) addPipes(i);
+        for (size_t i = 0; i < stationSpecs.size(); ++i) addStations(i);
+    }
+    pipeSpecs.clear();
+    pipeSpecs.shrink_to_fit();
+
+    BenchRng& rng = gen.random();
+    size_t sink = 0; // keeps results alive so nothing is optimized away
+
+    if (enabled(o, "find") && !pipeIds.empty()) {
+        size_t n = std::min<size_t>(pipeIds.size(), 1000000);
+        rec.run("find_pipe_by_id", n, [&](size_t) {
+            sink += m.findPipeById(pipeIds[rng.below(pipeIds.size())]) != nullptr;
+        });
+    }
+
+    if (enabled(o, "search")) {
+        rec.run("search_pipes_by_name", 200, [&](size_t) { sink += m.findPipesByName(gen.namePattern()).size(); });
+        rec.run("search_pipes_by_repair", 20, [&](size_t i) { sink += m.findPipesByRepairFlag(i % 2 == 0).size(); });
+        rec.run("search_stations_by_name", 200, [&](size_t) { sink += m.findStationsByName(gen.namePattern()).size(); });
+        rec.run("search_pipes_by_name_icase", 200, [&](size_t) {
+            sink += m.findPipesByName(gen.namePattern(), NameMatch::IgnoreCase).size();
+        });
+        rec.run("search_stations_by_name_icase", 200, [&](size_t) {
+            sink += m.findStationsByName(gen.namePattern(), NameMatch::IgnoreCase).size();
+        });
+        rec.run("search_stations_by_idle", 200, [&](size_t) { sink += m.findStationsByIdlePercent(double(rng.below(101))).size(); });
+        rec.run("network_stats", 1000, [&](size_t) { sink += m.getStats().pipes_in_repair; });
+    }
+
+    if (enabled(o, "batch") && !pipeIds.empty()) {
+        const size_t batch = 1000;
+        size_t batches = std::max<size_t>(1, std::min<size_t>(200, pipeIds.size() / batch));
+        std::vector<uint64_t> ids(std::min(batch, pipeIds.size()));
+        rec.run("batch_edit_1000", batches, [&](size_t i) {
+            for (auto& id : ids) id = pipeIds[rng.below(pipeIds.size())];
+            m.batchEditPipes(ids, "", 500.0 + double(i), -1);
+        });
+    }
+
+    if (enabled(o, "flow") && stationIds.size() >= 2) {
+        // every pipe joins two random distinct stations
+        rec.run("connect_pipe", pipeIds.size(), [&](size_t i) {
+            size_t a = rng.below(stationIds.size());
+            size_t b = (a + 1 + rng.below(stationIds.size() - 1)) % stationIds.size();
+            sink += m.connectPipe(pipeIds[i], stationIds[a], stationIds[b]);
+        });
+        rec.run("max_flow", 5, [&](size_t) {
+            sink += size_t(m.maxFlow(stationIds[rng.below(stationIds.size())], stationIds[rng.below(stationIds.size())]).flow);
+        });
+        // repair flips keep the in-service connectivity up to date
+        rec.run("set_in_repair_connected", std::min<size_t>(pipeIds.size(), 100000), [&](size_t) {
+            sink += m.setPipeInRepair(pipeIds[rng.below(pipeIds.size())], rng.below(4) == 0);
+        });
+        rec.run("stations_connected", std::min<size_t>(stationIds.size() * 10, 1000000), [&](size_t) {
+            sink += m.stationsConnected(stationIds[rng.below(stationIds.size())], stationIds[rng.below(stationIds.size())]);
+        });
+    }
+
+    bool allocationsOk = true;
+    if (enabled(o, "alloc") && pipeIds.size() >= 2 && stationIds.size() >= 2) {
+        std::string saveFile = o.dir + "/bench_alloc.txt";
+        auto pipeId = [&](size_t i) { return pipeIds[(i * 7919) % pipeIds.size()]; };
+        auto stationId = [&](size_t i) { return stationIds[(i * 7919) % stationIds.size()]; };
+        std::vector<std::string> names = { "alloc-north", "alloc-south", "alloc-east" };
+        Predicate where = Predicate::diameter(500.0, 700.0) && Predicate::inRepair(false);
+        Predicate stationWhere = Predicate::classification("A") && Predicate::idlePercent(25.0, 100.0);
+        QueryOptions first10;
+        first10.limit = 10;
+        // patterns with a handful of matches each
+        std::vector<std::string> patterns = { "Feeder-North-1", "магистраль-сев", "Spur-East-9", "КС-Loop-West" };
+        std::vector<std::string> classes = { "A", "B" };
+        std::vector<uint64_t> batchIds(100);
+        auto someIds = [&](const std::function<uint64_t(size_t)>& id, size_t i) -> const std::vector<uint64_t>& {
+            for (size_t k = 0; k < batchIds.size(); ++k) batchIds[k] = id(i * batchIds.size() + k);
+            return batchIds;
+        };
+        std::string exportFile = o.dir + "/bench_alloc.csv", exportError;
+        ExportSink exportSink;
+        if (!exportSink.open(exportFile, exportError)) std::cerr << exportError << "\n";
+        // edits warm up over every pipe / station twice; a log ring slot keeps
+        // its capacity only after a line as long as the op's went through it,
+        // so ops with long log lines warm up over a whole lap of the ring
+        const size_t kLogRingLap = 8192;
+        size_t pipeLaps = 2 * pipeIds.size(), stationLaps = 2 * stationIds.size();
+        std::vector<AllocCheck> checks = {
+            { "find_pipe", 0, 64, [&](size_t i) { sink += m.findPipeById(pipeId(i)) != nullptr; } },
+            { "set_pipe_diameter", 0, pipeLaps, [&](size_t i) { sink += m.setPipeDiameter(pipeId(i), double(300 + i % 4 * 100)); } },
+            { "set_pipe_in_repair", 0, pipeLaps, [&](size_t i) { sink += m.setPipeInRepair(pipeId(i), i % 2 == 0); } },
+            { "set_pipe_name", 0, pipeLaps, [&](size_t i) { sink += m.setPipeName(pipeId(i), names[i % names.size()]); } },
+            // a history block or rollup bucket now and then (StationHistory)
+            { "set_station_working", 3, stationLaps, [&](size_t i) { sink += m.setStationWorkingWorkshops(stationId(i), int(i % 3)); } },
+            { "stations_connected", 0, 64, [&](size_t i) { sink += m.stationsConnected(stationId(i), stationId(i + 1)); } },
+            { "query_pipes", 0, kLogRingLap, [&](size_t) { sink += m.queryPipes(where, first10, [&](const Pipe& p) { sink += p.getId(); }); } },
+            { "query_stations", 0, kLogRingLap, [&](size_t) {
+                sink += m.queryStations(stationWhere, first10, [&](const CompressorStation& s) { sink += s.getId(); });
+            } },
+            // pattern trigrams, posting lists, candidates, the result and a folded pattern past SSO size
+            { "find_pipes_by_name", 5, 64, [&](size_t i) { sink += m.findPipesByName(patterns[i % patterns.size()]).size(); } },
+            { "find_pipes_by_name_icase", 5, 64, [&](size_t i) {
+                sink += m.findPipesByName(patterns[i % patterns.size()], NameMatch::IgnoreCase).size();
+            } },
+            { "find_stations_by_name", 5, 64, [&](size_t i) { sink += m.findStationsByName(patterns[i % patterns.size()]).size(); } },
+            { "find_stations_by_name_icase", 5, 64, [&](size_t i) {
+                sink += m.findStationsByName(patterns[i % patterns.size()], NameMatch::IgnoreCase).size();
+            } },
+            { "set_station_name", 0, stationLaps, [&](size_t i) { sink += m.setStationName(stationId(i), names[i % names.size()]); } },
+            { "set_station_class", 0, stationLaps, [&](size_t i) {
+                sink += m.setStationClassification(stationId(i), classes[i % classes.size()]);
+            } },
+            // the slot list and the update's description for the log
+            { "update_pipes_100", 2, kLogRingLap, [&](size_t i) {
+                sink += m.updatePipes(someIds(pipeId, i), PipeUpdate().setDiameter(double(300 + i % 4 * 100)));
+            } },
+            { "update_stations_100", 2, kLogRingLap, [&](size_t i) {
+                sink += m.updateStations(someIds(stationId, i), StationUpdate().setClassification(classes[i % classes.size()]));
+            } },
+            // the record source, batch, chunk buffer and writev list of one export
+            { "export_pipes_100", 6, 16, [&](size_t i) {
+                ExportOptions page;
+                page.offset = i % 1000;
+                page.limit = 100;
+                page.threads = 1;
+                sink += m.exportPipes(exportSink, page).records;
+            } },
+            // the write buffer and the log line
+            { "save_text", 2, 4, [&](size_t) { sink += m.saveToFile(saveFile, SaveFormat::Text); } },
+        };
+        allocationsOk = checkAllocations(checks, 256);
+        exportSink.close();
+        std::remove(saveFile.c_str());
+        std::remove(exportFile.c_str());
+    }
+
+#ifdef __linux__
+    if (enabled(o, "server") && !pipeIds.empty()) {
+        // one client pipelining windows of kWindow requests; the server owns m meanwhile
+        const size_t kWindow = 256;
+        std::string address = "unix:" + o.dir + "/bench_server.sock";
+        Server server(m);
+        std::string error;
+        ServerClient client;
+        if (!server.listen(address, error) || !client.connect(address, error)) {
+            std::cerr << error << "\n";
+            return 1;
+        }
+        std::thread loop([&]{ server.run(); });
+        std::string frames, reply;
+        FrameWriter w(frames);
+        auto roundTrip = [&]{
+            client.send(frames);
+            for (size_t k = 0; k < kWindow; ++k) sink += client.receive(reply) ? reply.size() : 0;
+            frames.clear();
+        };
+        size_t windows = std::min<size_t>(pipeIds.size() / 16 + 1, 4000);
+        rec.run("server_get_pipe_x256", windows, [&](size_t) {
+            for (size_t k = 0; k < kWindow; ++k) {
+                w.request(ServerOp::GetPipe, uint32_t(k)).u64(pipeIds[rng.below(pipeIds.size())]);
+                w.end();
+            }
+            roundTrip();
+        });
+        // half writes, then half reads of the same window
+        rec.run("server_mixed_x256", windows, [&](size_t) {
+            for (size_t k = 0; k < kWindow / 2; ++k) {
+                w.request(ServerOp::SetPipeDiameter, uint32_t(k)).u64(pipeIds[rng.below(pipeIds.size())]).f64(double(200 + rng.below(1200)));
+                w.end();
+            }
+            for (size_t k = kWindow / 2; k < kWindow; ++k) {
+                w.request(ServerOp::GetPipe, uint32_t(k)).u64(pipeIds[rng.below(pipeIds.size())]);
+                w.end();
+            }
+            roundTrip();
+        });
+        client.close();
+        server.stop();
+        loop.join();
+    }
+#endif
+
+    if (enabled(o, "export")) {
+        std::string exportFile = o.dir + "/bench_export";
+        auto exportRun = [&](const char* name, ExportFormat format, bool stations) {
+            rec.run(name, 3, [&](size_t) {
+                ExportSink out;
+                std::string error;
+                if (!out.open(exportFile, error)) return;
+                ExportOptions eo;
+                eo.format = format;
+                sink += (stations ? m.exportStations(out, eo) : m.exportPipes(out, eo)).bytes;
+            });
+        };
+        exportRun("export_pipes_csv", ExportFormat::Csv, false);
+        exportRun("export_pipes_jsonl", ExportFormat::JsonLines, false);
+        exportRun("export_stations_csv", ExportFormat::Csv, true);
+        // one console page deep into the list
+        rec.run("export_page_50", 100, [&](size_t i) {
+            ExportSink out;
+            std::string error;
+            if (!out.open(exportFile, error)) return;
+            ExportOptions eo;
+            eo.format = ExportFormat::Text;
+            eo.offset = m.getPipes().size() / 100 * i;
+            eo.limit = 50;
+            sink += m.exportPipes(out, eo).records;
+        });
+        std::remove(exportFile.c_str());
+    }
+
+    if (enabled(o, "history")) {
+        // 90 days of a change every 1-10 minutes on a few stations, kept
+        // apart from m (whose history only knows the wall clock)
+        const size_t kSeries = 64;
+        const int64_t kDay = 86400000, kStart = 1700000000000;
+        const size_t perSeries = size_t(90 * kDay / 330000);
+        StationHistory h;
+        std::vector<int64_t> clock(kSeries, kStart);
+        rec.run("history_record", kSeries * perSeries, [&](size_t i) {
+            size_t st = i % kSeries;
+            clock[st] += int64_t(60000 + rng.below(540000));
+            sink += h.record(st + 1, clock[st], int(rng.below(9)), 8);
+        });
+        int64_t end = *std::min_element(clock.begin(), clock.end());
+        auto statsRun = [&](const char* name, int64_t span) {
+            size_t before = h.blocksDecoded();
+            const Result& r = rec.run(name, 10000, [&](size_t) {
+                int64_t to = end - int64_t(rng.below(uint64_t(end - kStart - span)));
+                sink += size_t(h.stats(1 + rng.below(kSeries), to - span, to).avg_idle);
+            });
+            std::printf("  %.1f blocks decoded per query\n", double(h.blocksDecoded() - before) / double(r.ops));
+        };
+        statsRun("history_stats_30d", 30 * kDay);
+        statsRun("history_stats_1d", kDay);
+        std::printf("history: %zu samples, %zu KiB\n", kSeries * perSeries, h.memoryBytes() / 1024);
+    }
+
+    std::string textFile = o.dir + "/bench_network.txt";
+    std::string binFile = o.dir + "/bench_network.snap";
+    if (enabled(o, "save")) {
+        rec.run("save_text", 3, [&](size_t) { sink += m.saveToFile(textFile, SaveFormat::Text); });
+        rec.run("save_binary", 3, [&](size_t) { sink += m.saveToFile(binFile, SaveFormat::Binary); });
+        // the caller only pays for publishing; edits go on while the file is written
+        rec.run("save_in_background", 1, [&](size_t) { sink += m.saveInBackground(binFile, SaveFormat::Binary); });
+        if (!pipeIds.empty()) {
+            rec.run("edit_during_save", std::min<size_t>(pipeIds.size(), 100000), [&](size_t) {
+                sink += m.setPipeDiameter(pipeIds[rng.below(pipeIds.size())], double(200 + rng.below(1200)));
+            });
+        }
+        sink += m.waitForBackgroundSave();
+        std::printf("background save: %s\n", m.backgroundSaveStatus().toString().c_str());
+    }
+    if (enabled(o, "load")) {
+        if (!enabled(o, "save")) {
+            m.saveToFile(textFile, SaveFormat::Text);
+            m.saveToFile(binFile, SaveFormat::Binary);
+        }
+        rec.run("load_text", 3, [&](size_t) { sink += m.loadFromFile(textFile); });
+        rec.run("load_binary", 3, [&](size_t) { sink += m.loadFromFile(binFile); });
+        // a load leaves the name indexes to the first lookup, which builds them
+        rec.run("search_after_load", 1, [&](size_t) { sink += m.findPipesByName(gen.namePattern()).size(); });
+    }
+    std::remove(textFile.c_str());
+    std::remove(binFile.c_str());
+    std::remove((binFile + ".history").c_str());
+
+    if (enabled(o, "remove") && !pipeIds.empty()) {
+        // remove a deterministic 10% of the pipes in random order
+        std::vector<uint64_t> victims(pipeIds);
+        for (size_t i = victims.size(); i > 1; --i) std::swap(victims[i - 1], victims[rng.below(i)]);
+        victims.resize(std::max<size_t>(1, victims.size() / 10));
+        rec.run("remove_pipe", victims.size(), [&](size_t i) { sink += m.removePipeById(victims[i]); });
+    }
+
+    m.flushLog();
+    if (!o.metrics.empty() && !m.writeMetrics(o.metrics)) {
+        std::cerr << "cannot write " << o.metrics << "\n";
+        return 1;
+    }
+    std::printf("peak rss %ld KiB (checksum %zu)\n", peakRssKb(), sink);
+    if (!allocationsOk) {
+        std::cerr << "allocation budget exceeded\n";
+        return 1;
+    }
+    if (!o.json.empty() && !writeJson(o, rec.all())) {
+        std::cerr << "cannot write " << o.json << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -4,7 +4,12 @@
 #include <vector>
 #include <algorithm>
 #include <sstream> // <- обязательно для istringstream
+#include <csignal>
+#include <cstdlib>
+#include <chrono>
 #include "Manager.h"
+#include "Server.h"
+#include "Script.h"
 
 // helper input functions
 static void ignoreLine() {
@@ -33,6 +38,12 @@ static int inputInt(const std::string& prompt) {
     }
 }
 
+// name searches ignore letter case unless asked otherwise
+static NameMatch inputNameMatch() {
+    std::string a = inputLine("Учитывать регистр букв? (y/n, Enter = нет): ");
+    return (a.size() > 0 && (a[0] == 'y' || a[0] == 'Y')) ? NameMatch::Exact : NameMatch::IgnoreCase;
+}
+
 static double inputDouble(const std::string& prompt) {
     while (true) {
         std::cout << prompt;
@@ -50,8 +61,9 @@ void showPipe(const Pipe& p) {
     std::cout << "ID=" << p.getId()
               << " | Name=\"" << p.getName() << "\""
               << " | Diameter=" << p.getDiameter()
-              << " | InRepair=" << (p.isInRepair() ? "YES":"NO")
-              << "\n";
+              << " | InRepair=" << (p.isInRepair() ? "YES":"NO");
+    if (p.isConnected()) std::cout << " | KS " << p.getInputStation() << " -> KS " << p.getOutputStation();
+    std::cout << "\n";
 }
 
 void showStation(const CompressorStation& s) {
@@ -64,6 +76,25 @@ void showStation(const CompressorStation& s) {
               << "\n";
 }
 
+// console listings go through the export pipeline one page at a time
+static const size_t kListPage = 50;
+
+template <typename F>
+static void listPaged(size_t total, F exportPage) {
+    ExportSink out(1);
+    ExportOptions o;
+    o.format = ExportFormat::Text;
+    o.limit = kListPage;
+    for (o.offset = 0; o.offset < total; o.offset += kListPage) {
+        std::cout.flush();
+        exportPage(out, o);
+        if (o.offset + kListPage >= total) break;
+        std::string more = inputLine("-- показано " + std::to_string(o.offset + kListPage) + " из " + std::to_string(total)
+                                     + "; Enter — дальше, q — выход: ");
+        if (!more.empty() && (more[0] == 'q' || more[0] == 'Q')) break;
+    }
+}
+
 void addSampleData(Manager& m) {
     m.addPipe("MainLine-1", 500.0, false);
     m.addPipe("Feeder-A", 250.0, true);
@@ -73,7 +104,89 @@ void addSampleData(Manager& m) {
     m.addStation("CS-East", 12, 12, "A+");
 }
 
-int main() {
+// === server mode: app --serve ADDRESS [--load FILE] [--workers N]
+static Server* g_server = nullptr;
+
+static void stopServer(int) {
+    if (g_server) g_server->stop();
+}
+
+static int serveMain(int argc, char** argv) {
+    std::string address, loadFile;
+    size_t workers = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--serve" && hasValue) address = argv[++i];
+        else if (arg == "--load" && hasValue) loadFile = argv[++i];
+        else if (arg == "--workers" && hasValue) workers = size_t(std::strtoul(argv[++i], nullptr, 10));
+        else {
+            std::cerr << "usage: " << argv[0] << " --serve unix:PATH|tcp:[HOST:]PORT [--load FILE] [--workers N]\n"
+                      << "       " << argv[0] << " --script FILE|- [--load FILE]\n";
+            return 2;
+        }
+    }
+    Manager manager;
+    if (!loadFile.empty() && !manager.loadFromFile(loadFile)) {
+        std::cerr << "Не удалось загрузить " << loadFile << "\n";
+        return 1;
+    }
+    Server server(manager, workers);
+    std::string error;
+    if (!server.listen(address, error)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+    g_server = &server;
+    std::signal(SIGINT, stopServer);
+    std::signal(SIGTERM, stopServer);
+    std::cout << "Сервер слушает " << address << " (Ctrl+C — остановка)\n";
+    server.run();
+    g_server = nullptr;
+    const Server::Counters& c = server.counters();
+    std::cout << "Соединений: " << c.connections << ", запросов: " << c.requests << "\n";
+    return 0;
+}
+
+// === batch mode: app --script FILE|- [--load FILE] (commands: see Script.h)
+static int scriptMain(int argc, char** argv) {
+    std::string scriptFile, loadFile;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--script" && hasValue) scriptFile = argv[++i];
+        else if (arg == "--load" && hasValue) loadFile = argv[++i];
+        else {
+            std::cerr << "usage: " << argv[0] << " --script FILE|- [--load FILE]\n";
+            return 2;
+        }
+    }
+    Manager manager;
+    if (!loadFile.empty() && !manager.loadFromFile(loadFile)) {
+        std::cerr << "Не удалось загрузить " << loadFile << "\n";
+        return 1;
+    }
+    std::FILE* in = scriptFile == "-" ? stdin : std::fopen(scriptFile.c_str(), "rb");
+    if (!in) {
+        std::cerr << "Не удалось открыть " << scriptFile << "\n";
+        return 1;
+    }
+    ScriptSummary sum = runScript(manager, in, stdout, stderr);
+    if (in != stdin) std::fclose(in);
+    std::cerr << "Строк: " << sum.lines << ", команд: " << sum.commands << ", ошибок: " << sum.errors << "\n"
+              << "Добавлено труб: " << sum.pipes_added << ", КС: " << sum.stations_added << "; изменений: " << sum.edits
+              << ", удалений: " << sum.removals << ", поисков: " << sum.searches << ", сохранений: " << sum.saves << "\n"
+              << "Время: " << sum.seconds << " с, " << sum.commandsPerSecond() << " команд/с, "
+              << sum.bytes / 1048576.0 / (sum.seconds > 0 ? sum.seconds : 1.0) << " МиБ/с\n";
+    if (!sum.read_ok) std::cerr << "Ошибка чтения " << scriptFile << "\n";
+    return sum.errors == 0 && sum.read_ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        for (int i = 1; i < argc; ++i) if (std::string(argv[i]) == "--script") return scriptMain(argc, argv);
+        return serveMain(argc, argv);
+    }
     Manager manager;
     std::cout << "=== Менеджер труб и компрессорных станций ===\n";
     std::string logf = inputLine("Введите имя файла для логов (или Enter для actions.log): ");
@@ -96,6 +209,16 @@ int main() {
         std::cout << "12) Сохранить в файл\n";
         std::cout << "13) Загрузить из файла\n";
         std::cout << "14) Добавить демонстрационные данные\n";
+        std::cout << "15) Включить журнал изменений (с восстановлением)\n";
+        std::cout << "16) Контрольная точка журнала\n";
+        std::cout << "17) Выгрузить метрики\n";
+        std::cout << "18) Соединить КС трубой\n";
+        std::cout << "19) Максимальный поток между КС\n";
+        std::cout << "20) Связность сети (без труб в ремонте)\n";
+        std::cout << "21) Сводная статистика\n";
+        std::cout << "22) Фоновое сохранение (запуск / ход выполнения)\n";
+        std::cout << "23) Экспорт в CSV / JSON Lines\n";
+        std::cout << "24) Загрузка КС за период\n";
         std::cout << "0) Выход\n";
         int choice = inputInt("Выберите пункт: ");
         switch (choice) {
@@ -110,19 +233,19 @@ int main() {
             }
             case 2: {
                 uint64_t id = (uint64_t) inputInt("ID трубы для редактирования: ");
-                Pipe* p = manager.findPipeById(id);
+                const Pipe* p = manager.findPipeById(id);
                 if (!p) { std::cout << "Труба с таким ID не найдена\n"; break; }
                 std::cout << "Текущие данные:\n"; showPipe(*p);
                 std::string newName = inputLine("Новое имя (Enter = без изменений): ");
                 std::string dstr = inputLine("Новый диаметр (Enter = без изменений): ");
-                if (!newName.empty()) p->setName(newName);
+                if (!newName.empty()) manager.setPipeName(id, newName);
                 if (!dstr.empty()) {
-                    try { double d = std::stod(dstr); p->setDiameter(d); } catch(...) { std::cout << "Диаметр не изменён: неверный ввод\n"; }
+                    try { double d = std::stod(dstr); manager.setPipeDiameter(id, d); } catch(...) { std::cout << "Диаметр не изменён: неверный ввод\n"; }
                 }
                 std::string rep = inputLine("В ремонте? (y/n/Enter = без изменений): ");
                 if (!rep.empty()) {
                     bool inrep = (rep[0]=='y' || rep[0]=='Y');
-                    p->setInRepair(inrep);
+                    manager.setPipeInRepair(id, inrep);
                 }
                 // Вместо обращения к приватному logAction используем публичный writeLog
                 manager.writeLog("Edited pipe id=" + std::to_string(p->getId()));
@@ -135,11 +258,11 @@ int main() {
                 break;
             }
             case 4: {
-                std::cout << "Поиск труб: 1) по имени 2) по признаку 'в ремонте'\n";
+                std::cout << "Поиск труб: 1) по имени 2) по признаку 'в ремонте' 3) по нескольким условиям\n";
                 int m = inputInt("Выберите фильтр: ");
                 if (m == 1) {
                     std::string q = inputLine("Введите подстроку имени: ");
-                    auto res = manager.findPipesByName(q);
+                    auto res = manager.findPipesByName(q, inputNameMatch());
                     std::cout << "Найдено " << res.size() << " труб:\n";
                     for (auto p : res) showPipe(*p);
                 } else if (m == 2) {
@@ -148,6 +271,22 @@ int main() {
                     auto res = manager.findPipesByRepairFlag(flag);
                     std::cout << "Найдено " << res.size() << " труб:\n";
                     for (auto p : res) showPipe(*p);
+                } else if (m == 3) {
+                    Predicate where = Predicate::all();
+                    std::string q = inputLine("Подстрока имени (Enter = любая): ");
+                    if (!q.empty()) where = where && Predicate::nameContains(q, inputNameMatch());
+                    std::string lo = inputLine("Минимальный диаметр (Enter = любой): ");
+                    std::string hi = inputLine("Максимальный диаметр (Enter = любой): ");
+                    try {
+                        if (!lo.empty() || !hi.empty())
+                            where = where && Predicate::diameter(lo.empty() ? -1e300 : std::stod(lo), hi.empty() ? 1e300 : std::stod(hi));
+                    } catch(...) { std::cout << "Диаметр не распознан, условие пропущено.\n"; }
+                    std::string rep = inputLine("В ремонте? (y/n, Enter = не важно): ");
+                    if (!rep.empty()) where = where && Predicate::inRepair(rep[0]=='y' || rep[0]=='Y');
+                    QueryOptions opts;
+                    opts.order = QueryOrder::Id;
+                    size_t n = manager.queryPipes(where, opts, [](const Pipe& p){ showPipe(p); });
+                    std::cout << "Найдено " << n << " труб.\n";
                 } else std::cout << "Неверно.\n";
                 break;
             }
@@ -189,9 +328,9 @@ int main() {
                 break;
             }
             case 6: {
-                auto &ps = manager.getPipes();
-                std::cout << "Всего труб: " << ps.size() << "\n";
-                for (const auto& p : ps) showPipe(p);
+                size_t total = manager.getPipes().size();
+                std::cout << "Всего труб: " << total << "\n";
+                listPaged(total, [&](ExportSink& out, const ExportOptions& o){ manager.exportPipes(out, o); });
                 break;
             }
             case 7: {
@@ -205,17 +344,17 @@ int main() {
             }
             case 8: {
                 uint64_t id = (uint64_t) inputInt("ID КС для редактирования: ");
-                CompressorStation* s = manager.findStationById(id);
+                const CompressorStation* s = manager.findStationById(id);
                 if (!s) { std::cout << "Не найдено.\n"; break; }
                 showStation(*s);
                 std::string n = inputLine("Новое имя (Enter = без изменений): ");
                 std::string tot = inputLine("Новый total (Enter = без изменений): ");
                 std::string work = inputLine("Новый working (Enter = без изменений): ");
                 std::string cls = inputLine("Новая классификация (Enter = без изменений): ");
-                if (!n.empty()) s->setName(n);
-                if (!tot.empty()) { try { s->setTotalWorkshops(std::stoi(tot)); } catch(...) { } }
-                if (!work.empty()) { try { s->setWorkingWorkshops(std::stoi(work)); } catch(...) { } }
-                if (!cls.empty()) s->setClassification(cls);
+                if (!n.empty()) manager.setStationName(id, n);
+                if (!tot.empty()) { try { manager.setStationTotalWorkshops(id, std::stoi(tot)); } catch(...) { } }
+                if (!work.empty()) { try { manager.setStationWorkingWorkshops(id, std::stoi(work)); } catch(...) { } }
+                if (!cls.empty()) manager.setStationClassification(id, cls);
                 manager.writeLog("Edited station id=" + std::to_string(s->getId()));
                 std::cout << "Изменено.\n";
                 break;
@@ -226,11 +365,11 @@ int main() {
                 break;
             }
             case 10: {
-                std::cout << "Поиск КС: 1) по имени  2) по проценту незадействованных цехов (>=)\n";
+                std::cout << "Поиск КС: 1) по имени  2) по проценту незадействованных цехов (>=)  3) по нескольким условиям\n";
                 int m = inputInt("Выбор: ");
                 if (m == 1) {
                     std::string q = inputLine("Подстрока имени: ");
-                    auto res = manager.findStationsByName(q);
+                    auto res = manager.findStationsByName(q, inputNameMatch());
                     std::cout << "Найдено " << res.size() << ":\n";
                     for (auto s : res) showStation(*s);
                 } else if (m == 2) {
@@ -238,19 +377,38 @@ int main() {
                     auto res = manager.findStationsByIdlePercent(thr);
                     std::cout << "Найдено " << res.size() << ":\n";
                     for (auto s : res) showStation(*s);
+                } else if (m == 3) {
+                    Predicate where = Predicate::all();
+                    std::string q = inputLine("Подстрока имени (Enter = любая): ");
+                    if (!q.empty()) where = where && Predicate::nameContains(q, inputNameMatch());
+                    std::string cls = inputLine("Классификация (Enter = любая): ");
+                    if (!cls.empty()) where = where && Predicate::classification(cls);
+                    std::string lo = inputLine("Минимальный процент незадействованных цехов (Enter = любой): ");
+                    std::string hi = inputLine("Максимальный процент незадействованных цехов (Enter = любой): ");
+                    try {
+                        if (!lo.empty() || !hi.empty())
+                            where = where && Predicate::idlePercent(lo.empty() ? -1e300 : std::stod(lo), hi.empty() ? 1e300 : std::stod(hi));
+                    } catch(...) { std::cout << "Процент не распознан, условие пропущено.\n"; }
+                    QueryOptions opts;
+                    opts.order = QueryOrder::IdlePercent;
+                    opts.descending = true;
+                    size_t n = manager.queryStations(where, opts, [](const CompressorStation& s){ showStation(s); });
+                    std::cout << "Найдено " << n << ".\n";
                 } else std::cout << "Неверно.\n";
                 break;
             }
             case 11: {
-                auto &ss = manager.getStations();
-                std::cout << "Всего КС: " << ss.size() << "\n";
-                for (const auto& s : ss) showStation(s);
+                size_t total = manager.getStations().size();
+                std::cout << "Всего КС: " << total << "\n";
+                listPaged(total, [&](ExportSink& out, const ExportOptions& o){ manager.exportStations(out, o); });
                 break;
             }
             case 12: {
                 std::string fname = inputLine("Введите имя файла для сохранения: ");
                 if (fname.empty()) { std::cout << "Имя не задано.\n"; break; }
-                if (manager.saveToFile(fname)) std::cout << "Сохранено в " << fname << "\n";
+                int fmt = inputInt("Формат: 1) текстовый  2) бинарный снимок: ");
+                SaveFormat format = (fmt == 2) ? SaveFormat::Binary : SaveFormat::Text;
+                if (manager.saveToFile(fname, format)) std::cout << "Сохранено в " << fname << "\n";
                 else std::cout << "Ошибка сохранения.\n";
                 break;
             }
@@ -266,6 +424,141 @@ int main() {
                 std::cout << "Демо-данные добавлены.\n";
                 break;
             }
+            case 15: {
+                std::string base = inputLine("Базовое имя файлов журнала (<имя>.wal / <имя>.snap): ");
+                if (base.empty()) { std::cout << "Имя не задано.\n"; break; }
+                if (manager.openJournal(base)) std::cout << "Журнал включён: труб " << manager.getPipes().size() << ", КС " << manager.getStations().size() << "\n";
+                else std::cout << "Не удалось открыть журнал.\n";
+                break;
+            }
+            case 16: {
+                if (manager.checkpoint()) std::cout << "Контрольная точка записана.\n";
+                else std::cout << "Журнал не включён или запись не удалась.\n";
+                break;
+            }
+            case 17: {
+                std::string fname = inputLine("Введите имя файла для метрик: ");
+                if (fname.empty()) { std::cout << "Имя не задано.\n"; break; }
+                int fmt = inputInt("Формат: 1) Prometheus  2) JSON: ");
+                MetricsFormat format = (fmt == 2) ? MetricsFormat::Json : MetricsFormat::Prometheus;
+                if (manager.writeMetrics(fname, format)) std::cout << "Метрики записаны в " << fname << "\n";
+                else std::cout << "Ошибка записи метрик.\n";
+                break;
+            }
+            case 18: {
+                uint64_t pid = (uint64_t) inputInt("ID трубы: ");
+                uint64_t from = (uint64_t) inputInt("ID КС на входе (0 = отсоединить трубу): ");
+                if (from == 0) {
+                    if (manager.disconnectPipe(pid)) std::cout << "Труба отсоединена.\n"; else std::cout << "Труба не найдена или не соединена.\n";
+                    break;
+                }
+                uint64_t to = (uint64_t) inputInt("ID КС на выходе: ");
+                if (manager.connectPipe(pid, from, to)) std::cout << "Соединено.\n";
+                else std::cout << "Не удалось: труба или КС не найдены, либо КС совпадают.\n";
+                break;
+            }
+            case 19: {
+                uint64_t from = (uint64_t) inputInt("ID КС-источника: ");
+                uint64_t to = (uint64_t) inputInt("ID КС-стока: ");
+                FlowResult r = manager.maxFlow(from, to);
+                std::cout << "Максимальный поток (по площади сечения): " << r.flow << "\n";
+                if (!r.cut.empty()) {
+                    std::cout << "Узкое место (минимальный разрез):\n";
+                    for (uint64_t id : r.cut) showPipe(*manager.findPipeById(id));
+                }
+                break;
+            }
+            case 20: {
+                std::cout << "Компонент связности: " << manager.countNetworkComponents() << "\n";
+                std::cout << "1) Связаны ли две КС  2) Изолированные КС  3) КС, связанные с данной\n";
+                int m = inputInt("Выбор: ");
+                if (m == 1) {
+                    uint64_t a = (uint64_t) inputInt("ID первой КС: ");
+                    uint64_t b = (uint64_t) inputInt("ID второй КС: ");
+                    std::cout << (manager.stationsConnected(a, b) ? "Связаны.\n" : "Не связаны (или КС не найдены).\n");
+                } else if (m == 2) {
+                    auto res = manager.findIsolatedStations();
+                    std::cout << "Найдено " << res.size() << ":\n";
+                    for (auto s : res) showStation(*s);
+                } else if (m == 3) {
+                    uint64_t id = (uint64_t) inputInt("ID КС: ");
+                    auto res = manager.findConnectedStations(id);
+                    std::cout << "Найдено " << res.size() << ":\n";
+                    for (auto s : res) showStation(*s);
+                } else std::cout << "Неверно.\n";
+                break;
+            }
+            case 21: {
+                NetworkStats st = manager.getStats();
+                std::cout << "Труб: " << st.pipes << " (в ремонте: " << st.pipes_in_repair << ")\n";
+                std::cout << "Диаметр: средний " << st.averageDiameter() << ", мин " << st.min_diameter
+                          << ", макс " << st.max_diameter << "\n";
+                std::cout << "Распределение по диаметру:\n";
+                for (size_t i = 0; i < NetworkStats::kDiameterBuckets; ++i) {
+                    if (i + 1 < NetworkStats::kDiameterBuckets) std::cout << "  < " << NetworkStats::kDiameterBounds[i];
+                    else std::cout << "  >= " << NetworkStats::kDiameterBounds[i - 1];
+                    std::cout << ": " << st.diameter_histogram[i] << "\n";
+                }
+                std::cout << "КС: " << st.stations << ", цехов " << st.total_workshops << " (работает " << st.working_workshops
+                          << "), незадействовано " << st.overallIdlePercent() << "%\n";
+                std::cout << "Процент незадействованных цехов: средний " << st.averageIdlePercent() << ", мин "
+                          << st.min_idle_percent << ", макс " << st.max_idle_percent << "\n";
+                std::cout << "Распределение по проценту незадействованных цехов:\n";
+                for (size_t i = 0; i < NetworkStats::kIdleBuckets; ++i)
+                    std::cout << "  " << i * 10 << "-" << (i + 1) * 10 << "%: " << st.idle_histogram[i] << "\n";
+                std::cout << "КС по классификации:\n";
+                for (const auto& c : st.stations_by_class) std::cout << "  \"" << c.first << "\": " << c.second << "\n";
+                break;
+            }
+            case 22: {
+                SaveStatus st = manager.backgroundSaveStatus();
+                if (st.state == SaveStatus::State::Running) {
+                    std::cout << "Идёт сохранение " << st.filename << ": " << st.records_done << " из " << st.records_total
+                              << " записей (" << int(st.fraction() * 100.0) << "%), " << st.seconds << " с\n";
+                    break;
+                }
+                if (st.state == SaveStatus::State::Done) std::cout << "Последнее сохранение: " << st.filename << ", " << st.seconds << " с\n";
+                if (st.state == SaveStatus::State::Failed) std::cout << "Последнее сохранение не удалось: " << st.error << "\n";
+                std::string fname = inputLine("Имя файла для фонового сохранения (Enter = отмена): ");
+                if (fname.empty()) break;
+                int fmt = inputInt("Формат: 1) текстовый  2) бинарный снимок: ");
+                SaveFormat format = (fmt == 1) ? SaveFormat::Text : SaveFormat::Binary;
+                if (manager.saveInBackground(fname, format)) std::cout << "Сохранение запущено, работу можно продолжать.\n";
+                else std::cout << "Ошибка запуска сохранения.\n";
+                break;
+            }
+            case 23: {
+                int what = inputInt("Экспортировать: 1) трубы  2) КС: ");
+                int fmt = inputInt("Формат: 1) CSV  2) JSON Lines: ");
+                std::string fname = inputLine("Имя файла: ");
+                if (fname.empty()) { std::cout << "Имя не задано.\n"; break; }
+                std::string q = inputLine("Подстрока имени (Enter = все записи): ");
+                ExportOptions o;
+                o.format = fmt == 2 ? ExportFormat::JsonLines : ExportFormat::Csv;
+                ExportSink out;
+                std::string error;
+                if (!out.open(fname, error)) { std::cout << error << "\n"; break; }
+                Predicate where = Predicate::nameContains(q);
+                const Predicate* filter = q.empty() ? nullptr : &where;
+                ExportResult r = what == 2 ? manager.exportStations(out, o, filter) : manager.exportPipes(out, o, filter);
+                if (out.close() && r.ok) std::cout << "Записано " << r.records << " записей (" << r.bytes << " байт) в " << fname << "\n";
+                else std::cout << "Ошибка экспорта: " << r.error << "\n";
+                break;
+            }
+            case 24: {
+                uint64_t id = (uint64_t) inputInt("ID КС: ");
+                int days = inputInt("За сколько последних суток: ");
+                if (days <= 0) { std::cout << "Неверно.\n"; break; }
+                int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count();
+                UtilizationStats st = manager.stationUtilization(id, now - int64_t(days) * 86400000, now);
+                if (st.empty()) { std::cout << "Нет истории за этот период.\n"; break; }
+                std::cout << "Изменений: " << st.samples << ", охвачено " << st.covered_ms / 3600000.0 << " ч\n";
+                std::cout << "Процент незадействованных цехов: средний " << st.avg_idle << ", мин " << st.min_idle
+                          << ", макс " << st.max_idle << "\n";
+                std::cout << "Работающих цехов в среднем: " << st.avg_working << "\n";
+                break;
+            }
             case 0: {
                 running = false; break;
             }
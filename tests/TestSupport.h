@@ -0,0 +1,64 @@
+#ifndef TEST_SUPPORT_H
+#define TEST_SUPPORT_H
+
+#include "Manager.h"
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Minimal checks for the test programs: a failed CHECK prints where and what,
+// and the program carries on so one run reports every failure; main returns
+// testResult(), which is nonzero after any failure.
+namespace test {
+
+inline int& failures() {
+    static int n = 0;
+    return n;
+}
+
+inline void fail(const char* file, int line, const std::string& what) {
+    ++failures();
+    std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what.c_str());
+}
+
+template <typename A, typename B>
+void checkEqual(const A& a, const B& b, const char* expr, const char* file, int line) {
+    if (a == b) return;
+    std::ostringstream os;
+    os << expr << " (" << a << " vs " << b << ")";
+    fail(file, line, os.str());
+}
+
+// every pipe and station of m as one line each, ordered by id
+inline std::vector<std::string> describe(const Manager& m) {
+    std::vector<std::string> out;
+    for (const Pipe& p : m.getPipes()) {
+        std::ostringstream os;
+        os << "P " << p.getId() << '|' << p.getName() << '|' << p.getDiameter() << '|' << p.isInRepair()
+           << '|' << p.getInputStation() << '|' << p.getOutputStation();
+        out.push_back(os.str());
+    }
+    for (const CompressorStation& s : m.getStations()) {
+        std::ostringstream os;
+        os << "S " << s.getId() << '|' << s.getName() << '|' << s.getTotalWorkshops() << '|'
+           << s.getWorkingWorkshops() << '|' << s.getClassification();
+        out.push_back(os.str());
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+inline int testResult(const char* name) {
+    if (failures()) std::fprintf(stderr, "%s: %d check(s) failed\n", name, failures());
+    else std::printf("%s: ok\n", name);
+    return failures() ? 1 : 0;
+}
+
+}
+
+#define CHECK(cond) ((cond) ? void() : test::fail(__FILE__, __LINE__, #cond))
+#define CHECK_EQ(a, b) test::checkEqual((a), (b), #a " == " #b, __FILE__, __LINE__)
+
+#endif // TEST_SUPPORT_H
@@ -0,0 +1,154 @@
+// In-service connectivity and max flow on random networks under random edits,
+// checked against a union-find and an Edmonds-Karp oracle built from scratch
+// out of the pipes' current state.
+
+#include "TestSupport.h"
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct UnionFind {
+    std::vector<size_t> parent;
+    explicit UnionFind(size_t n) : parent(n) { for (size_t i = 0; i < n; ++i) parent[i] = i; }
+    size_t find(size_t x) {
+        while (parent[x] != x) x = parent[x] = parent[parent[x]];
+        return x;
+    }
+    void join(size_t a, size_t b) { parent[find(a)] = find(b); }
+};
+
+// stations renumbered 0..n-1 in id order
+std::map<uint64_t, size_t> stationIndex(const Manager& m) {
+    std::map<uint64_t, size_t> index;
+    for (const CompressorStation& s : m.getStations()) index.emplace(s.getId(), 0);
+    size_t i = 0;
+    for (auto& e : index) e.second = i++;
+    return index;
+}
+
+bool inService(const Pipe& p) { return p.isConnected() && !p.isInRepair(); }
+
+void checkConnectivity(const Manager& m) {
+    std::map<uint64_t, size_t> index = stationIndex(m);
+    UnionFind uf(index.size());
+    for (const Pipe& p : m.getPipes()) {
+        if (inService(p)) uf.join(index.at(p.getInputStation()), index.at(p.getOutputStation()));
+    }
+    for (const auto& a : index) {
+        for (const auto& b : index) {
+            bool expect = uf.find(a.second) == uf.find(b.second);
+            if (m.stationsConnected(a.first, b.first) != expect) {
+                CHECK_EQ(m.stationsConnected(a.first, b.first), expect);
+                return;
+            }
+        }
+        size_t size = 0;
+        for (const auto& b : index) size += uf.find(a.second) == uf.find(b.second);
+        CHECK_EQ(m.findConnectedStations(a.first).size(), size);
+    }
+}
+
+// Edmonds-Karp: shortest augmenting paths over a dense residual matrix
+double edmondsKarp(const Manager& m, uint64_t source, uint64_t sink) {
+    std::map<uint64_t, size_t> index = stationIndex(m);
+    size_t n = index.size(), s = index.at(source), t = index.at(sink);
+    if (s == t) return 0.0;
+    std::vector<std::vector<double>> residual(n, std::vector<double>(n, 0.0));
+    for (const Pipe& p : m.getPipes()) {
+        if (inService(p) && p.getInputStation() != p.getOutputStation()) {
+            residual[index.at(p.getInputStation())][index.at(p.getOutputStation())] += Manager::pipeCapacity(p.getDiameter());
+        }
+    }
+    double flow = 0.0;
+    while (true) {
+        std::vector<size_t> from(n, SIZE_MAX);
+        from[s] = s;
+        std::deque<size_t> queue{ s };
+        while (!queue.empty() && from[t] == SIZE_MAX) {
+            size_t u = queue.front();
+            queue.pop_front();
+            for (size_t v = 0; v < n; ++v) {
+                if (from[v] == SIZE_MAX && residual[u][v] > 1e-12) { from[v] = u; queue.push_back(v); }
+            }
+        }
+        if (from[t] == SIZE_MAX) return flow;
+        double push = std::numeric_limits<double>::infinity();
+        for (size_t v = t; v != s; v = from[v]) push = std::min(push, residual[from[v]][v]);
+        for (size_t v = t; v != s; v = from[v]) {
+            residual[from[v]][v] -= push;
+            residual[v][from[v]] += push;
+        }
+        flow += push;
+    }
+}
+
+bool close(double a, double b) { return std::fabs(a - b) <= 1e-9 * std::max(1.0, std::fabs(b)); }
+
+void checkFlow(const Manager& m, uint64_t source, uint64_t sink) {
+    FlowResult r = m.maxFlow(source, sink);
+    double expect = edmondsKarp(m, source, sink);
+    if (!close(r.flow, expect)) CHECK_EQ(r.flow, expect);
+    // the cut pipes are saturated by the maximum flow: their capacities add up to it
+    double cut = 0.0;
+    for (uint64_t id : r.cut) {
+        const Pipe* p = m.findPipeById(id);
+        CHECK(p && inService(*p));
+        if (p) cut += Manager::pipeCapacity(p->getDiameter());
+    }
+    if (!close(cut, expect)) CHECK_EQ(cut, expect);
+}
+
+void randomNetwork(uint32_t seed, size_t stationCount, size_t pipeCount, size_t edits) {
+    static const double sizes[] = { 219, 325, 530, 720, 1020, 1420 };
+    std::mt19937 rng(seed);
+    auto below = [&](size_t n) { return size_t(rng() % n); };
+    Manager m("test_graph.log");
+    std::vector<uint64_t> stations, pipes;
+    for (size_t i = 0; i < stationCount; ++i) stations.push_back(m.addStation("КС-" + std::to_string(i), 4, 2, "A"));
+    for (size_t i = 0; i < pipeCount; ++i) {
+        pipes.push_back(m.addPipe("P-" + std::to_string(i), sizes[below(6)], below(5) == 0));
+        m.connectPipe(pipes.back(), stations[below(stations.size())], stations[below(stations.size())]);
+    }
+    checkConnectivity(m);
+    for (size_t i = 0; i < edits; ++i) {
+        uint64_t p = pipes[below(pipes.size())];
+        switch (below(6)) {
+            case 0: m.setPipeInRepair(p, true); break;
+            case 1: m.setPipeInRepair(p, false); break;
+            case 2: m.disconnectPipe(p); break;
+            case 3: m.connectPipe(p, stations[below(stations.size())], stations[below(stations.size())]); break;
+            case 4: m.setPipeDiameter(p, sizes[below(6)]); break;
+            case 5:
+                // bulk edits leave connectivity to be rebuilt on the next query
+                m.updatePipes(std::vector<uint64_t>{ p, pipes[below(pipes.size())] }, PipeUpdate().toggleInRepair());
+                break;
+        }
+        if (below(40) == 0 && stations.size() > 2) {
+            size_t k = below(stations.size());
+            CHECK(m.removeStationById(stations[k]));
+            stations.erase(stations.begin() + long(k));
+        }
+        if (i % 25 == 0) checkConnectivity(m);
+        if (i % 50 == 0) checkFlow(m, stations[below(stations.size())], stations[below(stations.size())]);
+    }
+    checkConnectivity(m);
+    for (size_t i = 0; i < 10; ++i) checkFlow(m, stations[below(stations.size())], stations[below(stations.size())]);
+}
+
+}
+
+int main() {
+    // sparse (many components), medium, and dense with parallel pipes
+    for (uint32_t seed = 1; seed <= 3; ++seed) {
+        randomNetwork(seed, 40, 30, 600);
+        randomNetwork(seed + 100, 30, 60, 600);
+        randomNetwork(seed + 200, 12, 80, 400);
+    }
+    return test::testResult("test_graph");
+}
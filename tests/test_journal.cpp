@@ -0,0 +1,202 @@
+// Journal recovery: a journal cut short inside any record, or with a flipped
+// byte in any record, replays exactly the records before the damaged one, and
+// the next session appends after them. Opening a new base keeps the data.
+
+#include "TestSupport.h"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <csignal>
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+const std::string kBase = "test_journal";
+const std::string kWal = kBase + ".wal";
+
+std::string readFile(const std::string& path) {
+    std::ifstream is(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string& path, const std::string& data) {
+    std::ofstream os(path, std::ios::binary | std::ios::trunc);
+    os.write(data.data(), std::streamsize(data.size()));
+}
+
+void removeFiles() {
+    for (const char* ext : { ".wal", ".snap", ".snap.history" }) std::remove((kBase + ext).c_str());
+}
+
+// recovers whatever journal is on disk into a fresh manager
+std::vector<std::string> recover(Manager& m) {
+    m.setJournalGroupCommit(0, 0, 0);
+    CHECK(m.openJournal(kBase));
+    return test::describe(m);
+}
+
+}
+
+int main() {
+    removeFiles();
+    // one journal record per step; states[k] is the network after k records
+    // and ends[k] the journal size at that point
+    std::vector<std::vector<std::string>> states;
+    std::vector<size_t> ends;
+    {
+        Manager m("test_journal.log");
+        m.setJournalGroupCommit(0, 0, 0);
+        CHECK(m.openJournal(kBase));
+        auto step = [&]() {
+            states.push_back(test::describe(m));
+            ends.push_back(readFile(kWal).size());
+        };
+        step();
+        uint64_t a = m.addStation("КС-Север", 6, 4, "A");
+        step();
+        uint64_t b = m.addStation("КС-Юг", 4, 4, "B");
+        step();
+        uint64_t p = m.addPipe("Магистраль-1", 1020, false);
+        step();
+        m.addPipe("Feeder-2", 530, true);
+        step();
+        CHECK(m.connectPipe(p, a, b));
+        step();
+        CHECK_EQ(m.updatePipes(std::vector<uint64_t>{ p }, PipeUpdate().scaleDiameter(1.5)), size_t(1));
+        step();
+        CHECK(m.setStationWorkingWorkshops(a, 2));
+        step();
+        CHECK(m.removePipeById(p));
+        step();
+        m.closeJournal();
+    }
+    for (size_t k = 1; k < ends.size(); ++k) CHECK(ends[k] > ends[k - 1]);
+    const std::string full = readFile(kWal);
+    CHECK_EQ(full.size(), ends.back());
+
+    {
+        Manager m("test_journal.log");
+        CHECK(recover(m) == states.back());
+    }
+
+    for (size_t k = 1; k < ends.size(); ++k) {
+        // torn tail: record k lost its last byte, or everything past its length field
+        for (size_t cut : { ends[k] - 1, ends[k - 1] + 3 }) {
+            writeFile(kWal, full.substr(0, cut));
+            Manager m("test_journal.log");
+            CHECK(recover(m) == states[k - 1]);
+            // the torn tail is cut off, so a record appended now replays next time
+            uint64_t id = m.addPipe("after-recovery", 720, false);
+            m.closeJournal();
+            Manager again("test_journal.log");
+            recover(again);
+            CHECK(again.findPipeById(id) != nullptr);
+            CHECK_EQ(again.getPipes().size(), m.getPipes().size());
+        }
+        // bit flips in the record's length, checksum, op and last payload byte
+        for (size_t at : { ends[k - 1], ends[k - 1] + 4, ends[k - 1] + 8, ends[k] - 1 }) {
+            std::string bad = full;
+            bad[at] = char(bad[at] ^ 0x10);
+            writeFile(kWal, bad);
+            Manager m("test_journal.log");
+            CHECK(recover(m) == states[k - 1]);
+        }
+    }
+
+    {
+        // a header for another snapshot: nothing is replayed
+        std::string other = full;
+        other[ends[0] - 1] = char(other[ends[0] - 1] ^ 1);
+        writeFile(kWal, other);
+        Manager m("test_journal.log");
+        CHECK(recover(m).empty());
+    }
+
+    {
+        // a new base keeps the data in memory and checkpoints it
+        removeFiles();
+        Manager m("test_journal.log");
+        uint64_t a = m.addStation("КС-Запад", 5, 3, "B");
+        uint64_t b = m.addStation("КС-Восток", 2, 1, "A");
+        m.addPipe("Перемычка", 720, false);
+        CHECK(m.connectPipe(m.addPipe("Loop-1", 1020, false), a, b));
+        std::vector<std::string> before = test::describe(m);
+        m.setJournalGroupCommit(0, 0, 0);
+        CHECK(m.openJournal(kBase));
+        CHECK(test::describe(m) == before);
+        CHECK(!readFile(kBase + ".snap").empty());
+        uint64_t id = m.addPipe("after-open", 530, false);
+        m.closeJournal();
+        Manager again("test_journal.log");
+        std::vector<std::string> recovered = recover(again);
+        CHECK_EQ(recovered.size(), before.size() + 1);
+        CHECK(again.findPipeById(id) != nullptr);
+        CHECK(again.stationsConnected(a, b));
+    }
+
+    {
+        // a journal missing the record that added a station: the pipe
+        // connected to it replays disconnected
+        removeFiles();
+        uint64_t a, b, c, p;
+        size_t cStart, cEnd;
+        {
+            Manager m("test_journal.log");
+            m.setJournalGroupCommit(0, 0, 0);
+            CHECK(m.openJournal(kBase));
+            a = m.addStation("КС-Север", 6, 4, "A");
+            b = m.addStation("КС-Юг", 4, 4, "B");
+            CHECK(m.connectPipe(m.addPipe("Loop-1", 1020, false), a, b));
+            cStart = readFile(kWal).size();
+            c = m.addStation("КС-Лишняя", 2, 2, "C");
+            cEnd = readFile(kWal).size();
+            p = m.addPipe("Отвод", 720, false);
+            CHECK(m.connectPipe(p, a, c));
+            m.closeJournal();
+        }
+        std::string wal = readFile(kWal);
+        writeFile(kWal, wal.substr(0, cStart) + wal.substr(cEnd));
+        Manager m("test_journal.log");
+        recover(m);
+        CHECK(m.findStationById(c) == nullptr);
+        const Pipe* pipe = m.findPipeById(p);
+        CHECK(pipe && !pipe->isConnected());
+        CHECK_EQ(m.findConnectedStations(a).size(), size_t(2));
+        // connected again, it carries flow next to the pipe that was never touched
+        CHECK(m.connectPipe(p, a, b));
+        CHECK_EQ(m.maxFlow(a, b).flow, Manager::pipeCapacity(1020) + Manager::pipeCapacity(720));
+    }
+
+#ifdef __linux__
+    {
+        // writes refused by a file size limit stay pending and go out with
+        // the first commit that succeeds
+        removeFiles();
+        Manager m("test_journal.log");
+        m.setJournalGroupCommit(0, 0, 0);
+        CHECK(m.openJournal(kBase));
+        m.addPipe("before", 530, false);
+        std::signal(SIGXFSZ, SIG_IGN);
+        struct rlimit old, low;
+        CHECK(getrlimit(RLIMIT_FSIZE, &old) == 0);
+        low = old;
+        low.rlim_cur = readFile(kWal).size() + 10;
+        CHECK(setrlimit(RLIMIT_FSIZE, &low) == 0);
+        for (int i = 0; i < 5; ++i) m.addPipe("refused-" + std::to_string(i), 720, i % 2 == 0);
+        CHECK(setrlimit(RLIMIT_FSIZE, &old) == 0);
+        CHECK(readFile(kWal).size() <= low.rlim_cur);
+        m.addPipe("after", 1020, false);
+        std::vector<std::string> expect = test::describe(m);
+        m.closeJournal();
+        Manager again("test_journal.log");
+        CHECK(recover(again) == expect);
+    }
+#endif
+
+    removeFiles();
+    return test::testResult("test_journal");
+}
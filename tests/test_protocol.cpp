@@ -0,0 +1,119 @@
+// Frame decoding: a frame cut short anywhere is never read past its end,
+// clears ok and decodes no entity; frameLength waits for whole frames and
+// refuses oversized ones.
+
+#include "TestSupport.h"
+#include "Protocol.h"
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Decoded {
+    bool ok = false;
+    bool at_end = false;
+    uint8_t op = 0;
+    uint32_t tag = 0;
+    std::string name;
+    bool pipe_ok = false, station_ok = false;
+    Pipe pipe;
+    CompressorStation station;
+    std::vector<uint64_t> ids;
+    double f = 0.0;
+};
+
+// decodes a body laid out like the one main() writes
+Decoded decode(const std::string& body, size_t n) {
+    // a copy of exactly n bytes, so reading past them shows up under ASan
+    std::vector<char> bytes(body.begin(), body.begin() + long(n));
+    FrameReader r(bytes.data(), n);
+    Decoded d;
+    d.op = r.u8();
+    d.tag = r.u32();
+    d.name = std::string(r.str());
+    d.pipe_ok = r.pipe(d.pipe);
+    d.station_ok = r.station(d.station);
+    r.ids(d.ids);
+    d.f = r.f64();
+    d.ok = r.ok;
+    d.at_end = r.atEnd();
+    return d;
+}
+
+}
+
+int main() {
+    Pipe pipe(41, "Магистраль-Север", 1420, true);
+    pipe.connect(7, 9);
+    CompressorStation station(9, "КС-Юг", 6, 4, "A+");
+    std::vector<uint64_t> ids = { 3, 5, 8, 13 };
+
+    std::string frame;
+    FrameWriter w(frame);
+    // body offsets where the pipe, the station and the id list end
+    w.request(ServerOp::AddPipe, 0xC0FFEE).str("Feeder").pipe(pipe);
+    size_t pipeEnd = frame.size() - 4;
+    w.station(station);
+    size_t stationEnd = frame.size() - 4;
+    w.ids(ids);
+    size_t idsEnd = frame.size() - 4;
+    w.f64(2.5);
+    w.end();
+    CHECK(frame.size() > 4);
+    uint32_t len = 0;
+    std::memcpy(&len, frame.data(), 4);
+    CHECK_EQ(size_t(len) + 4, frame.size());
+    std::string body = frame.substr(4);
+
+    Decoded whole = decode(body, body.size());
+    CHECK(whole.ok && whole.at_end);
+    CHECK_EQ(whole.op, uint8_t(ServerOp::AddPipe));
+    CHECK_EQ(whole.tag, 0xC0FFEEu);
+    CHECK_EQ(whole.name, std::string("Feeder"));
+    CHECK(whole.pipe_ok && whole.station_ok);
+    CHECK_EQ(whole.pipe.getName(), pipe.getName());
+    CHECK_EQ(whole.pipe.getOutputStation(), uint64_t(9));
+    CHECK_EQ(whole.station.getClassification(), station.getClassification());
+    CHECK(whole.ids == ids);
+    CHECK_EQ(whole.f, 2.5);
+
+    for (size_t n = 0; n < body.size(); ++n) {
+        Decoded d = decode(body, n);
+        CHECK(!d.ok);
+        // what lies wholly before the cut decodes, every read past it yields nothing
+        CHECK_EQ(d.pipe_ok, n >= pipeEnd);
+        CHECK_EQ(d.station_ok, n >= stationEnd);
+        CHECK_EQ(d.ids.size(), n >= idsEnd ? ids.size() : size_t(0));
+        CHECK_EQ(d.f, 0.0);
+    }
+
+    // a string or id list whose count runs past the end
+    for (uint32_t count : { 1u, 1000u, 0xFFFFFFFFu }) {
+        std::string b;
+        FrameWriter fw(b);
+        fw.u32(count).u64(1);
+        FrameReader r(b.data(), b.size());
+        std::vector<uint64_t> out = { 99 };
+        if (count > 1) {
+            r.ids(out);
+            CHECK(!r.ok && out.empty());
+        }
+        FrameReader s(b.data(), b.size());
+        std::string_view sv = s.str();
+        CHECK(count <= 8 ? s.ok : !s.ok && sv.empty());
+    }
+
+    // frameLength: nothing until the whole frame is there
+    for (size_t n = 0; n < frame.size(); ++n) CHECK_EQ(frameLength(frame.data(), n), size_t(0));
+    CHECK_EQ(frameLength(frame.data(), frame.size()), frame.size());
+    std::string two = frame + frame.substr(0, 6);
+    CHECK_EQ(frameLength(two.data(), two.size()), frame.size());
+    uint32_t huge = uint32_t(kMaxFrameBytes) + 1;
+    char header[4];
+    std::memcpy(header, &huge, 4);
+    CHECK_EQ(frameLength(header, 4), SIZE_MAX);
+
+    return test::testResult("test_protocol");
+}
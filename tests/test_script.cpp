@@ -0,0 +1,133 @@
+// Batch scripts: every line that fails to parse is reported with its line
+// number and the message for what is wrong, skipped, and counted; the lines
+// around it still run. Line numbers stay right across chunk boundaries.
+
+#include "TestSupport.h"
+#include "Script.h"
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct Run {
+    ScriptSummary sum;
+    std::string err;
+};
+
+std::string readAll(std::FILE* f) {
+    std::string s;
+    std::rewind(f);
+    char buf[4096];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) s.append(buf, n);
+    return s;
+}
+
+Run run(Manager& m, const std::string& script) {
+    std::FILE* in = std::tmpfile();
+    std::FILE* out = std::tmpfile();
+    std::FILE* err = std::tmpfile();
+    CHECK(in && out && err);
+    Run r;
+    if (!in || !out || !err) return r;
+    std::fwrite(script.data(), 1, script.size(), in);
+    std::rewind(in);
+    r.sum = runScript(m, in, out, err);
+    r.err = readAll(err);
+    std::fclose(in);
+    std::fclose(out);
+    std::fclose(err);
+    return r;
+}
+
+bool reported(const Run& r, size_t line, const std::string& what) {
+    return r.err.find("line " + std::to_string(line) + ": " + what + "\n") != std::string::npos;
+}
+
+// lines that fail to parse, with the error each one gets
+const std::vector<std::pair<std::string, std::string>> kBad = {
+    { "ap|Feeder|530", "wrong number of fields" },
+    { "ap||530|0", "empty name" },
+    { "ap|Feeder|-5|0", "bad diameter" },
+    { "ap|Feeder|wide|0", "bad diameter" },
+    { "ap|Feeder|530|2", "bad repair flag" },
+    { "as|КС-1|x|1|A", "bad total" },
+    { "as|КС-1|2|3|A", "bad working" },
+    { "ep|x|name|N", "bad id" },
+    { "ep|1|colour|red", "unknown field" },
+    { "ep|1|diameter|0", "bad diameter" },
+    { "es|1|total|-1", "bad number" },
+    { "es|1|diameter|5", "unknown field" },
+    { "rp|1|2", "wrong number of fields" },
+    { "cp|1|2", "wrong number of fields" },
+    { "cp|1|a|2", "bad id" },
+    { "fp|Main|x", "bad search flag" },
+    { "save|", "empty file name" },
+    { "save|out.bin|zip", "bad format" },
+    { "reserve|10", "wrong number of fields" },
+    { "reserve|100000000|0", "reserve over 16777216" },
+    { "frobnicate|1", "unknown command" },
+    { "AP|Feeder|530|0", "unknown command" },
+};
+
+}
+
+int main() {
+    {
+        // good and bad lines alternate; blank lines and comments count as lines
+        Manager m("test_script.log");
+        std::string script = "# header\n\n";
+        size_t line = 2;
+        std::vector<size_t> badLines;
+        for (const auto& bad : kBad) {
+            script += "ap|P" + std::to_string(line) + "|530|0\n";
+            script += bad.first + "\r\n";
+            line += 2;
+            badLines.push_back(line);
+        }
+        script += "as|КС-last|2|1|A";   // no final newline
+        Run r = run(m, script);
+        CHECK(r.sum.read_ok);
+        CHECK_EQ(r.sum.lines, line + 1);
+        CHECK_EQ(r.sum.errors, kBad.size());
+        CHECK_EQ(r.sum.commands, 2 * kBad.size() + 1);
+        CHECK_EQ(r.sum.pipes_added, kBad.size());
+        CHECK_EQ(r.sum.stations_added, size_t(1));
+        CHECK_EQ(m.getPipes().size(), kBad.size());
+        for (size_t i = 0; i < kBad.size(); ++i) {
+            if (!reported(r, badLines[i], kBad[i].second)) test::fail(__FILE__, __LINE__, "not reported: " + kBad[i].first);
+        }
+    }
+
+    {
+        // bad lines on both sides of a 1 MiB chunk boundary, and more of
+        // them than are reported one by one
+        Manager m("test_script.log");
+        std::string script;
+        size_t line = 0, bad = 0;
+        std::vector<size_t> shown;
+        while (script.size() < (size_t(3) << 20)) {
+            ++line;
+            if (line % 997 == 0) {
+                script += "ap|broken|0|0\n";
+                if (++bad <= 100) shown.push_back(line);
+            } else {
+                script += "ap|Pipe-" + std::to_string(line) + "|720|" + std::to_string(line % 2) + "\n";
+            }
+        }
+        Run r = run(m, script);
+        CHECK_EQ(r.sum.lines, line);
+        CHECK_EQ(r.sum.errors, bad);
+        CHECK_EQ(r.sum.pipes_added, line - bad);
+        CHECK_EQ(m.getPipes().size(), line - bad);
+        for (size_t l : shown) CHECK(reported(r, l, "bad diameter"));
+        CHECK((bad > 100) == (r.err.find("further errors are only counted") != std::string::npos));
+        // the bulk run rebuilt the name index at the end
+        size_t matches = 0;
+        for (size_t l = 1; l <= line; ++l) matches += l % 997 != 0 && std::to_string(l).compare(0, 4, "1000") == 0;
+        CHECK_EQ(m.findPipesByName("Pipe-1000").size(), matches);
+    }
+    return test::testResult("test_script");
+}
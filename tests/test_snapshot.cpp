@@ -0,0 +1,192 @@
+// Save / load round trips in both formats, and the binary readers of every
+// snapshot version on files laid out by hand from the documented format.
+
+#include "TestSupport.h"
+#include "Snapshot.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+struct PipeSpec { uint64_t id; std::string name; double diameter; bool in_repair; uint64_t in, out; };
+struct StationSpec { uint64_t id; std::string name; int total, working; std::string classification; };
+
+const std::vector<PipeSpec> kPipes = {
+    { 3, "Магистраль-Север-1", 1420, false, 1, 2 },
+    { 4, "Feeder West", 530, true, 2, 1 },
+    { 5, "Отвод", 219, false, 0, 0 },
+};
+const std::vector<StationSpec> kStations = {
+    { 1, "КС-Север", 8, 6, "A+" },
+    { 2, "КС Юг", 4, 0, "B" },
+    { 6, "КС-Восток", 2, 2, "A+" },
+};
+
+// the network a loaded snapshot of the given version should hold
+std::vector<std::string> expected(uint32_t version) {
+    std::vector<std::string> out;
+    for (const PipeSpec& p : kPipes) {
+        bool connected = version >= 3 && p.in;
+        std::string line = "P " + std::to_string(p.id) + '|' + p.name + '|';
+        std::ostringstream os;
+        os << p.diameter << '|' << p.in_repair << '|' << (connected ? p.in : 0) << '|' << (connected ? p.out : 0);
+        out.push_back(line + os.str());
+    }
+    for (const StationSpec& s : kStations) {
+        out.push_back("S " + std::to_string(s.id) + '|' + s.name + '|' + std::to_string(s.total) + '|'
+                      + std::to_string(s.working) + '|' + s.classification);
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+template <typename T>
+void put(std::string& out, const T& v) {
+    out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+// Writes kPipes / kStations as a version 1, 2 or 3 snapshot.
+void writeVersion(const std::string& filename, uint32_t version) {
+    std::string heap;
+    auto str = [&](const std::string& s) {
+        uint64_t off = heap.size();
+        heap += s;
+        return off;
+    };
+    std::vector<std::string> dict;
+    auto code = [&](const std::string& c) {
+        for (size_t i = 0; i < dict.size(); ++i) if (dict[i] == c) return uint32_t(i);
+        dict.push_back(c);
+        return uint32_t(dict.size() - 1);
+    };
+
+    std::string pipes, stations, dictRecords;
+    for (const PipeSpec& p : kPipes) {
+        if (version >= 3) {
+            PipeRecord r{};
+            r.id = p.id; r.name_off = str(p.name); r.name_len = uint32_t(p.name.size());
+            r.in_repair = p.in_repair; r.diameter = p.diameter; r.input_station = p.in; r.output_station = p.out;
+            put(pipes, r);
+        } else {
+            PipeRecordV2 r{};
+            r.id = p.id; r.name_off = str(p.name); r.name_len = uint32_t(p.name.size());
+            r.in_repair = p.in_repair; r.diameter = p.diameter;
+            put(pipes, r);
+        }
+    }
+    for (const StationSpec& s : kStations) {
+        if (version == 1) {
+            StationRecordV1 r{};
+            r.id = s.id; r.name_off = str(s.name); r.name_len = uint32_t(s.name.size());
+            r.total_workshops = s.total; r.working_workshops = s.working;
+            r.class_off = str(s.classification); r.class_len = uint32_t(s.classification.size());
+            put(stations, r);
+        } else {
+            StationRecord r{};
+            r.id = s.id; r.name_off = str(s.name); r.name_len = uint32_t(s.name.size());
+            r.total_workshops = s.total; r.working_workshops = s.working; r.class_code = code(s.classification);
+            put(stations, r);
+        }
+    }
+    for (const std::string& c : dict) {
+        DictRecord r{};
+        r.off = str(c);
+        r.len = uint32_t(c.size());
+        put(dictRecords, r);
+    }
+    heap.resize((heap.size() + 7) / 8 * 8, '\0');
+
+    SnapshotHeader h{};
+    std::memcpy(h.magic, kSnapshotMagic, sizeof(h.magic));
+    h.version = version;
+    h.header_size = version == 1 ? kSnapshotHeaderV1Size : uint32_t(sizeof(SnapshotHeader));
+    h.next_id = 7;
+    h.pipe_count = kPipes.size();
+    h.station_count = kStations.size();
+    h.pipes_offset = h.header_size;
+    h.stations_offset = h.pipes_offset + pipes.size();
+    h.dict_offset = h.stations_offset + stations.size();
+    h.dict_count = dict.size();
+    h.strings_offset = h.dict_offset + dictRecords.size();
+    h.strings_size = heap.size();
+    std::string body = pipes + stations + dictRecords + heap;
+    h.checksum = snapshotChecksum(body.data(), body.size());
+
+    std::ofstream os(filename, std::ios::binary | std::ios::trunc);
+    os.write(reinterpret_cast<const char*>(&h), h.header_size);
+    os.write(body.data(), std::streamsize(body.size()));
+}
+
+void buildNetwork(Manager& m) {
+    uint64_t a = m.addStation("КС-Север", 8, 6, "A+");
+    uint64_t b = m.addStation("КС Юг", 4, 0, "B");
+    uint64_t c = m.addStation("KS-Ωμέγα", 3, 1, "класс-Б");
+    uint64_t p = m.addPipe("Магистраль-Север-1", 1420, false);
+    uint64_t q = m.addPipe("Feeder West", 530, true);
+    m.addPipe("Отвод", 219.5, false);
+    CHECK(m.connectPipe(p, a, b));
+    CHECK(m.connectPipe(q, b, c));
+    CHECK(m.removeStationById(m.addStation("gone", 1, 1, "C")));
+}
+
+void roundTrip(SaveFormat format, const char* filename) {
+    Manager m("test_snapshot.log");
+    buildNetwork(m);
+    CHECK(m.saveToFile(filename, format));
+    Manager n("test_snapshot.log");
+    CHECK(n.loadFromFile(filename));
+    CHECK(test::describe(n) == test::describe(m));
+    // the next id survives, so ids are never handed out twice
+    CHECK_EQ(n.addPipe("next", 720, false), m.addPipe("next", 720, false));
+    // connectivity and names are usable straight after a load
+    CHECK_EQ(n.findPipesByName("west", NameMatch::IgnoreCase).size(), size_t(1));
+    CHECK(n.stationsConnected(1, 2));
+    std::remove(filename);
+    std::remove((std::string(filename) + ".history").c_str());
+}
+
+}
+
+int main() {
+    roundTrip(SaveFormat::Text, "test_snapshot.txt");
+    roundTrip(SaveFormat::Binary, "test_snapshot.bin");
+
+    for (uint32_t version = 1; version <= kSnapshotVersion; ++version) {
+        std::string filename = "test_snapshot_v" + std::to_string(version) + ".bin";
+        writeVersion(filename, version);
+        SnapshotView view;
+        std::string error;
+        CHECK(view.open(filename, error));
+        CHECK_EQ(view.version(), version);
+        CHECK(view.verify());
+        view.close();
+
+        Manager m("test_snapshot.log");
+        CHECK(m.loadFromFile(filename));
+        CHECK(test::describe(m) == expected(version));
+        CHECK_EQ(m.addPipe("next", 720, false), uint64_t(7));
+
+        // a flipped byte anywhere in the body fails the checksum
+        std::string bytes;
+        {
+            std::ifstream is(filename, std::ios::binary);
+            bytes.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+        }
+        bytes[bytes.size() / 2] = char(bytes[bytes.size() / 2] ^ 4);
+        {
+            std::ofstream os(filename, std::ios::binary | std::ios::trunc);
+            os.write(bytes.data(), std::streamsize(bytes.size()));
+        }
+        Manager bad("test_snapshot.log");
+        CHECK(!bad.loadFromFile(filename));
+        std::remove(filename.c_str());
+    }
+    return test::testResult("test_snapshot");
+}